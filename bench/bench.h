@@ -0,0 +1,78 @@
+/**
+ * @file bench.h
+ * @brief Benchmarks shared by the benchmark image.
+ *
+ * This file contains the prototypes of the benchmarks that live outside
+ * bench_main.c.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Each benchmark logs its own results and leaves the hypervisor in a state
+ * where the next one can run.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Benchmark prototypes.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/**
+ * @brief Measure lock contention at 1, 2, 4 and 8 CPUs.
+ *
+ * Starts the secondary CPUs, runs every lock type with each atomic
+ * instruction set the CPU supports, and powers the secondaries off again.
+ */
+void bench_sync(void);
+
+struct vcpu;
+
+/**
+ * @brief Run a spinlock guest with and without the directed yield.
+ *
+ * Puts a two vCPU guest on the calling CPU's run queue and replaces the
+ * loaded vCPU with it. Called from the shutdown hook of the previous
+ * benchmark, which returns into the new guest.
+ *
+ * @param vcpu The loaded vCPU of the previous benchmark.
+ * @param done Called after the last run.
+ */
+void bench_yield(struct vcpu* vcpu, void (*done)(void));
+
+/**
+ * @brief Measure the virtual IPI round trip between two vCPUs.
+ *
+ * Puts vCPU 0 of a two vCPU guest on the calling CPU's run queue, powers
+ * on another CPU for vCPU 1, and replaces the loaded vCPU with vCPU 0.
+ * Called from the shutdown hook of the previous benchmark.
+ *
+ * @param vcpu The loaded vCPU of the previous benchmark.
+ * @param done Called after the run.
+ */
+void bench_ipi(struct vcpu* vcpu, void (*done)(void));
+
+#endif // BENCH_H
@@ -0,0 +1,176 @@
+/**
+ * @file bench_ipi.c
+ * @brief Virtual IPI benchmark.
+ *
+ * This file contains the benchmark that bounces an SGI between the two
+ * vCPUs of a guest on two physical CPUs and reports the round trip
+ * latency.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * vCPU 0 stays on the CPU that ran the previous benchmark, vCPU 1 gets a
+ * CPU of its own, which sched_cpu_on() powers on. Every ping and pong is
+ * a trapped ICC_SGI1R_EL1 write followed by sched_ipi(); the report shows
+ * how many of them needed a physical SGI to reach the target's CPU. With
+ * a single CPU both vCPUs share it and no SGI is ever sent.
+ *
+ * The spinlock guest's other vCPU is left blocked in WFI on the run queue
+ * and never becomes runnable again.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * IPI ping-pong guest benchmark.
+ */
+
+/* this module's header */
+#include "bench.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "logging.h"
+#include "platform.h"
+#include "sched.h"
+#include "smp.h"
+#include "stage2.h"
+#include "sysreg.h"
+#include "vm.h"
+
+#define BENCH_IPI_ID     (4U)             /* VM identifier */
+#define BENCH_IPI_IPA    (0x100000000ULL) /* guest RAM, above the identity mapped image */
+#define BENCH_IPI_SIZE   (0x200000ULL)    /* 2MB of guest RAM, unused */
+#define BENCH_IPI_VCPUS  (2U)             /* ping and pong */
+#define BENCH_IPI_ROUNDS (10000U)         /* round trips */
+
+extern char __frame_pool_start__;  /* Defined by the linker */
+extern void bench_guest_ipi(void); /* Defined in guest_ipi.s */
+
+static vm_t     bench_ipi_vm;                  /* VM running the ping-pong guest */
+static uint64_t bench_ipi_base_ipis  = 0;      /* vIPIs sent before the run */
+static uint64_t bench_ipi_base_kicks = 0;      /* Physical SGIs sent before the run */
+static void     (*bench_ipi_done)(void) = NULL; /* Called after the run */
+
+/**
+ * @brief Sum the vIPI counters of the CPUs running the guest.
+ *
+ * @param ipis Returns the vIPIs sent.
+ * @param kicks Returns the vIPIs that needed a physical SGI.
+ */
+static void bench_ipi_count(uint64_t* ipis, uint64_t* kicks)
+{
+    sched_stats_t stats = { 0 }; /* Counters of one CPU */
+
+    *ipis  = 0;
+    *kicks = 0;
+
+    for (uint32_t i = 0; i < BENCH_IPI_VCPUS; ++i)
+    {
+        uint32_t cpu = bench_ipi_vm.vcpus[i].cpu; /* CPU of the vCPU */
+
+        /* Count a shared CPU once */
+        if ((0 != i) && (cpu == bench_ipi_vm.vcpus[0].cpu))
+        {
+            continue;
+        }
+
+        (void)sched_get_stats(cpu, &stats);
+        *ipis += stats.ipis;
+        *kicks += stats.ipi_kicks;
+    }
+}
+
+/**
+ * @brief Report the run.
+ *
+ * @param vcpu vCPU 0, x1 holds the virtual counter ticks of all round
+ *             trips.
+ */
+static void bench_ipi_on_shutdown(vcpu_t* vcpu)
+{
+    uint64_t freq  = arch_counter_freq(); /* Counter frequency */
+    uint64_t ns    = 0;                   /* Cost per round trip */
+    uint64_t ipis  = 0;                   /* vIPIs sent during the run */
+    uint64_t kicks = 0;                   /* Physical SGIs sent during the run */
+
+    bench_ipi_count(&ipis, &kicks);
+    ns = (0 == freq) ? 0 : (vcpu->ctx.x[1] * 1000000000ULL) / (freq * BENCH_IPI_ROUNDS);
+
+    LOG_INFO("ipi ping-pong cpus=%u: %6lu ns/round trip, %lu vIPIs (%lu kicked)\n\r",
+             (bench_ipi_vm.vcpus[0].cpu == bench_ipi_vm.vcpus[1].cpu) ? 1U : 2U,
+             ns,
+             ipis - bench_ipi_base_ipis,
+             kicks - bench_ipi_base_kicks);
+
+    bench_ipi_done();
+}
+
+/**
+ * @brief Bounce an SGI between two vCPUs on two CPUs.
+ *
+ * @param vcpu The loaded vCPU of the previous benchmark.
+ * @param done Called after the run.
+ */
+void bench_ipi(struct vcpu* vcpu, void (*done)(void))
+{
+    uint64_t image = (uintptr_t)&__frame_pool_start__ - PLATFORM_RAM_BASE; /* Hypervisor image size */
+    uint32_t self  = smp_cpu_id();                                         /* CPU of vCPU 0 */
+    uint32_t peer  = (0 == self) ? 1U : 0U;                                /* CPU of vCPU 1 */
+
+    bench_ipi_done = done;
+
+    if (STATUS_OK != vm_init(&bench_ipi_vm, BENCH_IPI_ID, BENCH_IPI_IPA, BENCH_IPI_SIZE, BENCH_IPI_VCPUS))
+    {
+        LOG_ERR("bench: cannot create IPI VM\n\r");
+        done();
+        return;
+    }
+
+    /* The guest executes in place, read-only */
+    stage2_map(&bench_ipi_vm.s2, PLATFORM_RAM_BASE, PLATFORM_RAM_BASE, image, STAGE2_MEM_NORMAL & ~S2_PTE_S2AP_W);
+    bench_ipi_vm.on_shutdown = bench_ipi_on_shutdown;
+
+    for (uint32_t i = 0; i < BENCH_IPI_VCPUS; ++i)
+    {
+        vcpu_reset(&bench_ipi_vm.vcpus[i], (uintptr_t)bench_guest_ipi, BENCH_IPI_ROUNDS);
+    }
+
+    if ((STATUS_OK != sched_add(&bench_ipi_vm.vcpus[0], self)) ||
+        (STATUS_OK != sched_add(&bench_ipi_vm.vcpus[1], peer)))
+    {
+        LOG_ERR("bench: no room for the IPI vCPUs\n\r");
+        done();
+        return;
+    }
+
+    /* Without a second CPU vCPU 1 moves to this one; it sends nothing before the first ping */
+    (void)sched_cpu_on(peer);
+    bench_ipi_count(&bench_ipi_base_ipis, &bench_ipi_base_kicks);
+
+    /* The previous benchmark's vCPU leaves, the scheduler loads vCPU 0 */
+    sched_exit(vcpu);
+}
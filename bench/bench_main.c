@@ -0,0 +1,253 @@
+/**
+ * @file bench_main.c
+ * @brief Entry point of the benchmark image.
+ *
+ * This file contains the main function of the benchmark image, which boots
+ * a guest stub that compares single and batched hypercalls.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The lock contention benchmark (bench_sync.c) runs first and is the only
+ * one using the secondary CPUs. The channel benchmark follows, driving
+ * both ends of a channel from the hypervisor to measure the ring and
+ * doorbell paths on their own.
+ *
+ * The guest stub (guest_hypercall.s) runs from the hypervisor image, which
+ * is mapped read-only into the VM at its physical address. The batch page
+ * lives in demand paged guest RAM. Each batch size is measured in turn
+ * from the shutdown hook, which restarts the stub with the next size
+ * before the final report.
+ *
+ * The directed yield (bench_yield.c) and virtual IPI (bench_ipi.c)
+ * benchmarks run last, they are the only ones that need the scheduler and
+ * thus the GIC.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Lock contention, hypercall batching and inter-VM channel benchmarks.
+ */
+
+#include "bench.h"
+#include "channel.h"
+#include "frame.h"
+#include "gic.h"
+#include "hypercall.h"
+#include "logging.h"
+#include "mmu.h"
+#include "platform.h"
+#include "semihosting.h"
+#include "stage2.h"
+#include "sync.h"
+#include "sysreg.h"
+#include "trace.h"
+#include "trap.h"
+#include "vgic.h"
+#include "vm.h"
+#include "vm_config_gen.h"
+#include <stdint.h>
+
+#define BENCH_RAM_IPA  (0x100000000ULL) /* guest RAM, above the identity mapped image */
+#define BENCH_RAM_SIZE (0x1000000ULL)   /* 16MB of guest RAM */
+#define BENCH_ROUNDS   (1000U)          /* rounds per batch size */
+
+#define BENCH_CHANNEL_IPA   (0x200000000ULL) /* channel window in both VMs */
+#define BENCH_CHANNEL_MSGS  (100000U)        /* messages per channel run */
+#define BENCH_CHANNEL_BURST (16U)            /* messages per doorbell */
+
+/* operations per round, each measured as single calls and as one batch */
+static const uint32_t bench_batch_sizes[] = { 1, 4, 16, 64, HYPERCALL_BATCH_MAX };
+
+extern char __frame_pool_start__;        /* Defined by the linker */
+extern void bench_guest_hypercall(void); /* Defined in guest_hypercall.s */
+
+static vm_t      bench_vm;       /* VM running the guest stub */
+static vm_t      bench_peer;     /* Other end of the benchmark channel */
+static channel_t bench_channel;  /* Channel between the two VMs */
+static uint32_t  bench_step = 0; /* Index into bench_batch_sizes */
+
+/**
+ * @brief Convert counter ticks to nanoseconds per operation.
+ *
+ * @param ticks Elapsed ticks.
+ * @param ops Operations done in that time.
+ * @return Nanoseconds per operation.
+ */
+static uint64_t bench_ns_per_op(uint64_t ticks, uint64_t ops)
+{
+    uint64_t freq = arch_counter_freq(); /* Counter frequency */
+
+    return ((0 == freq) || (0 == ops)) ? 0 : (ticks * 1000000000ULL) / (freq * ops);
+}
+
+/**
+ * @brief Stream messages through a channel, polling and with interrupts.
+ *
+ * The first half of the run has a polling receiver, so doorbells are
+ * suppressed. The second half arms notification before every burst, so
+ * every doorbell injects an interrupt.
+ */
+static void bench_channels(void)
+{
+    channel_endpoint_t a                    = { .vm = &bench_vm, .ipa = BENCH_CHANNEL_IPA, .irq = 40 };   /* Sender */
+    channel_endpoint_t b                    = { .vm = &bench_peer, .ipa = BENCH_CHANNEL_IPA, .irq = 40 }; /* Receiver */
+    uint8_t            msg[CHANNEL_MSG_MAX] = { 0 };                                                      /* Payload */
+    uint64_t           notified             = 0;                                                          /* Doorbell result */
+
+    if ((STATUS_OK != vm_init(&bench_peer, 2, BENCH_RAM_IPA, BENCH_RAM_SIZE, 1)) ||
+        (STATUS_OK != channel_create(&bench_channel, &a, &b)))
+    {
+        LOG_ERR("bench: cannot create channel\n\r");
+        return;
+    }
+
+    for (uint32_t sent = 0; sent < BENCH_CHANNEL_MSGS; sent += BENCH_CHANNEL_BURST)
+    {
+        if (sent >= (BENCH_CHANNEL_MSGS / 2))
+        {
+            (void)channel_ring_arm(bench_channel.ring[0]);
+        }
+
+        for (uint32_t i = 0; i < BENCH_CHANNEL_BURST; ++i)
+        {
+            msg[0] = (uint8_t)i;
+            (void)channel_ring_send(bench_channel.ring[0], msg, sizeof(msg));
+        }
+
+        (void)channel_doorbell(&bench_vm, 0, &notified);
+
+        while (channel_ring_recv(bench_channel.ring[0], msg) >= 0)
+        {
+        }
+    }
+
+    channel_report(&bench_channel);
+}
+
+/**
+ * @brief Start the guest stub for the current batch size.
+ *
+ * @param vcpu The benchmark vCPU.
+ */
+static void bench_start(vcpu_t* vcpu)
+{
+    vcpu_reset(vcpu, (uintptr_t)bench_guest_hypercall, BENCH_ROUNDS);
+    vcpu->ctx.x[1] = bench_batch_sizes[bench_step];
+    vcpu->ctx.x[2] = BENCH_RAM_IPA;
+}
+
+/**
+ * @brief Dump the trace and power off after the last benchmark.
+ */
+static void bench_finish(void)
+{
+    trace_dump(LOG_SINK_SEMIHOSTING);
+    log_flush();
+    semihosting_exit();
+}
+
+/**
+ * @brief Start the IPI benchmark after the directed yield runs.
+ */
+static void bench_next_ipi(void)
+{
+    bench_ipi(vcpu_current(), bench_finish);
+}
+
+/**
+ * @brief Report one batch size and move on to the next.
+ *
+ * @param vcpu The benchmark vCPU, x1-x3 hold the guest's results.
+ */
+static void bench_on_shutdown(vcpu_t* vcpu)
+{
+    uint64_t ops     = (uint64_t)BENCH_ROUNDS * bench_batch_sizes[bench_step]; /* Operations per mode */
+    uint64_t single  = bench_ns_per_op(vcpu->ctx.x[1], ops);                   /* Single call cost */
+    uint64_t batched = bench_ns_per_op(vcpu->ctx.x[2], ops);                   /* Batched op cost */
+
+    LOG_INFO("hypercall batch=%3u: single %6lu ns/op, batched %6lu ns/op, speedup %lu.%02lux, failed %lu\n\r",
+             bench_batch_sizes[bench_step],
+             single,
+             batched,
+             (0 == batched) ? 0 : single / batched,
+             (0 == batched) ? 0 : ((single * 100) / batched) % 100,
+             vcpu->ctx.x[3]);
+
+    if (++bench_step < (sizeof(bench_batch_sizes) / sizeof(bench_batch_sizes[0])))
+    {
+        bench_start(vcpu);
+        return;
+    }
+
+    hypercall_report(vcpu->vm);
+    bench_yield(vcpu, bench_next_ipi);
+}
+
+/**
+ * @brief Main function.
+ *
+ * Sets up the hypervisor, prepares the benchmark VM and runs it.
+ */
+void main(void)
+{
+    uint64_t           image = (uintptr_t)&__frame_pool_start__ - PLATFORM_RAM_BASE; /* Hypervisor image size */
+    hypercall_entry_t* batch = NULL;                                                 /* Batch page */
+
+    sync_init();
+    log_init(LOG_SINK_SEMIHOSTING);
+
+    mmu_init();
+    trap_init();
+    trace_init();
+    vgic_init();
+    gic_init();
+    gic_cpu_init();
+    stage2_hw_init();
+    frame_init((uintptr_t)&__frame_pool_start__, VM_CONFIG_POOL_END - (uintptr_t)&__frame_pool_start__);
+
+    if (STATUS_OK != vm_init(&bench_vm, 1, BENCH_RAM_IPA, BENCH_RAM_SIZE, 1))
+    {
+        LOG_ERR("bench: cannot create VM\n\r");
+        semihosting_exit();
+    }
+
+    /* The stub executes in place, read-only */
+    stage2_map(&bench_vm.s2, PLATFORM_RAM_BASE, PLATFORM_RAM_BASE, image, STAGE2_MEM_NORMAL & ~S2_PTE_S2AP_W);
+
+    /* Batch page of NOPs, the stub passes how many of them to run */
+    gmem_populate(&bench_vm, BENCH_RAM_IPA);
+    batch = (hypercall_entry_t*)gmem_ipa_to_host(&bench_vm, BENCH_RAM_IPA, FRAME_SIZE);
+    for (uint32_t i = 0; i < HYPERCALL_BATCH_MAX; ++i)
+    {
+        batch[i] = (hypercall_entry_t){ .op = HYPERCALL_NOP };
+    }
+
+    bench_sync();
+    bench_channels();
+
+    bench_vm.on_shutdown = bench_on_shutdown;
+    bench_start(&bench_vm.vcpus[0]);
+    vcpu_run(&bench_vm.vcpus[0]);
+}
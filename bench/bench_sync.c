@@ -0,0 +1,328 @@
+/**
+ * @file bench_sync.c
+ * @brief Lock contention benchmark.
+ *
+ * This file contains the benchmark that measures the synchronization
+ * primitives with 1, 2, 4 and 8 CPUs hammering the same lock.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Secondary CPUs are started once and park in WFE on a job generation
+ * word. For each round the boot CPU publishes the lock type and the number
+ * of participating CPUs, bumps the generation and takes part as CPU 0.
+ * Every participant acquires the lock BENCH_SYNC_ITERS times and updates a
+ * shared counter inside the critical section, which also checks mutual
+ * exclusion. The reported cost is wall time divided by all acquisitions,
+ * so perfect scaling keeps it flat and serialization makes it grow with
+ * the CPU count.
+ *
+ * The sequence counter round has CPU 0 write and everybody else read.
+ * With a single CPU only the write side is measured.
+ *
+ * All rounds run with LL/SC atomics and, if the CPU has them, again with
+ * LSE atomics. run_benchmarks.sh uses -smp 8; CPU=max selects a CPU model
+ * with LSE.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Spinlock, reader-writer lock and sequence counter contention benchmark.
+ */
+
+/* this module's header */
+#include "bench.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "logging.h"
+#include "smp.h"
+#include "sync.h"
+#include "sysreg.h"
+
+#define BENCH_SYNC_ITERS (20000U) /* acquisitions per CPU and round */
+
+/**
+ * @brief Lock types under test.
+ */
+typedef enum bench_lock
+{
+    BENCH_LOCK_TICKET = 0, /* ticket spinlock */
+    BENCH_LOCK_MCS,        /* MCS queued spinlock */
+    BENCH_LOCK_WRITE,      /* reader-writer lock, all writers */
+    BENCH_LOCK_READ,       /* reader-writer lock, all readers */
+    BENCH_LOCK_SEQCOUNT,   /* one sequence counter writer, readers */
+    BENCH_LOCK_NUM,
+} bench_lock_t;
+
+static const char* bench_lock_names[BENCH_LOCK_NUM] = {
+    "ticket",
+    "mcs",
+    "rwlock-write",
+    "rwlock-read",
+    "seqcount",
+};
+
+static const uint32_t bench_sync_cpus[] = { 1, 2, 4, 8 }; /* CPU counts to measure */
+
+static uint32_t bench_job_gen     = 0; /* Bumped to start a round, workers wait on it */
+static uint32_t bench_job_lock    = 0; /* Lock type of the round */
+static uint32_t bench_job_cpus    = 0; /* Participating CPUs */
+static uint32_t bench_job_stop    = 0; /* Workers return when set */
+static uint32_t bench_job_done    = 0; /* CPUs finished with the round */
+static uint32_t bench_sync_online = 1; /* CPUs running, including the boot CPU */
+
+static sync_ticket_t   bench_ticket = SYNC_TICKET_INIT;   /* Lock under test */
+static sync_mcs_t      bench_mcs    = SYNC_MCS_INIT;      /* Lock under test */
+static sync_rwlock_t   bench_rw     = SYNC_RWLOCK_INIT;   /* Lock under test */
+static sync_seqcount_t bench_seq    = SYNC_SEQCOUNT_INIT; /* Counter under test */
+static uint64_t        bench_shared[2];                   /* Data behind the locks, kept equal by writers */
+static uint32_t        bench_torn   = 0;                  /* Reads that saw unequal halves */
+
+/**
+ * @brief Check a snapshot of the shared data taken by a reader.
+ *
+ * @param a First half.
+ * @param b Second half.
+ */
+static void bench_sync_check(uint64_t a, uint64_t b)
+{
+    if (a != b)
+    {
+        (void)sync_fetch_add32(&bench_torn, 1);
+    }
+}
+
+/**
+ * @brief Read the shared data under the sequence counter.
+ */
+static void bench_sync_seq_read(void)
+{
+    uint32_t seq = 0; /* Sequence at read start */
+    uint64_t a   = 0; /* First half */
+    uint64_t b   = 0; /* Second half */
+
+    do
+    {
+        seq = sync_seq_read_begin(&bench_seq);
+        a   = bench_shared[0];
+        b   = bench_shared[1];
+    } while (sync_seq_read_retry(&bench_seq, seq));
+
+    bench_sync_check(a, b);
+}
+
+/**
+ * @brief Run one round of the current job on the calling CPU.
+ *
+ * @param cpu The CPU number.
+ */
+static void bench_sync_round(uint32_t cpu)
+{
+    sync_mcs_node_t node;  /* MCS queue node */
+    uint64_t        a = 0; /* Reader snapshot, first half */
+    uint64_t        b = 0; /* Reader snapshot, second half */
+
+    for (uint32_t i = 0; i < BENCH_SYNC_ITERS; ++i)
+    {
+        switch (bench_job_lock)
+        {
+        case BENCH_LOCK_TICKET:
+            sync_ticket_lock(&bench_ticket);
+            bench_shared[0]++;
+            sync_ticket_unlock(&bench_ticket);
+            break;
+        case BENCH_LOCK_MCS:
+            sync_mcs_lock(&bench_mcs, &node);
+            bench_shared[0]++;
+            sync_mcs_unlock(&bench_mcs, &node);
+            break;
+        case BENCH_LOCK_WRITE:
+            sync_write_lock(&bench_rw);
+            bench_shared[0]++;
+            sync_write_unlock(&bench_rw);
+            break;
+        case BENCH_LOCK_READ:
+            sync_read_lock(&bench_rw);
+            a = bench_shared[0];
+            b = bench_shared[1];
+            sync_read_unlock(&bench_rw);
+            bench_sync_check(a, b);
+            break;
+        case BENCH_LOCK_SEQCOUNT:
+            if (0 != cpu)
+            {
+                bench_sync_seq_read();
+                break;
+            }
+            sync_seq_write_begin(&bench_seq);
+            bench_shared[0]++;
+            bench_shared[1]++;
+            sync_seq_write_end(&bench_seq);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Secondary CPU loop, one round per job generation.
+ *
+ * @param cpu The CPU number.
+ * @param arg Unused.
+ */
+static void bench_sync_worker(uint32_t cpu, void* arg)
+{
+    uint32_t seen = 0; /* Last generation handled */
+
+    (void)arg;
+
+    for (;;)
+    {
+        uint32_t gen = 0; /* Published generation */
+
+        while ((gen = sync_monitor32(&bench_job_gen)) == seen)
+        {
+            WFE();
+        }
+        seen = gen;
+
+        if (bench_job_stop)
+        {
+            return;
+        }
+
+        if (cpu < bench_job_cpus)
+        {
+            bench_sync_round(cpu);
+        }
+
+        (void)sync_fetch_add32(&bench_job_done, 1);
+    }
+}
+
+/**
+ * @brief Publish a job and wait until every online CPU went through it.
+ *
+ * @param lock The lock type, ignored when stopping.
+ * @param cpus Participating CPUs.
+ * @param stop Non-zero to send the workers home.
+ * @return Elapsed counter ticks.
+ */
+static uint64_t bench_sync_dispatch(uint32_t lock, uint32_t cpus, uint32_t stop)
+{
+    uint64_t start = 0; /* Counter at dispatch */
+
+    bench_job_lock = lock;
+    bench_job_cpus = cpus;
+    bench_job_stop = stop;
+    bench_job_done = 0;
+
+    start = arch_counter_read();
+    __atomic_store_n(&bench_job_gen, bench_job_gen + 1U, __ATOMIC_RELEASE);
+
+    if (stop)
+    {
+        return 0;
+    }
+
+    bench_sync_round(0);
+    (void)sync_fetch_add32(&bench_job_done, 1);
+
+    while (sync_monitor32(&bench_job_done) != bench_sync_online)
+    {
+        WFE();
+    }
+
+    return arch_counter_read() - start;
+}
+
+/**
+ * @brief Measure lock contention at 1, 2, 4 and 8 CPUs.
+ *
+ * Starts the secondary CPUs, runs every lock type with each atomic
+ * instruction set the CPU supports, and powers the secondaries off again.
+ */
+void bench_sync(void)
+{
+    sync_impl_t boot_impl = sync_impl;           /* Restored afterwards */
+    uint64_t    freq      = arch_counter_freq(); /* Counter frequency */
+
+    for (uint32_t cpu = 1; cpu < SMP_MAX_CPUS; ++cpu)
+    {
+        if (STATUS_OK == smp_cpu_on(cpu, bench_sync_worker, NULL))
+        {
+            bench_sync_online++;
+        }
+    }
+    LOG_INFO("sync: %u CPU(s) online, LSE atomics %s\n\r", bench_sync_online,
+             sync_lse_supported() ? "available" : "not available");
+
+    for (uint32_t impl = SYNC_IMPL_LLSC; impl <= SYNC_IMPL_LSE; ++impl)
+    {
+        if (STATUS_OK != sync_set_impl((sync_impl_t)impl))
+        {
+            continue;
+        }
+
+        for (uint32_t lock = 0; lock < BENCH_LOCK_NUM; ++lock)
+        {
+            for (uint32_t n = 0; n < (sizeof(bench_sync_cpus) / sizeof(bench_sync_cpus[0])); ++n)
+            {
+                uint32_t cpus  = bench_sync_cpus[n];                /* CPUs in this round */
+                uint64_t ops   = (uint64_t)cpus * BENCH_SYNC_ITERS; /* Acquisitions */
+                uint64_t ticks = 0;                                 /* Round duration */
+                uint64_t want  = 0;                                 /* Expected counter */
+
+                if (cpus > bench_sync_online)
+                {
+                    break;
+                }
+
+                bench_shared[0] = 0;
+                bench_shared[1] = 0;
+                bench_torn      = 0;
+
+                ticks = bench_sync_dispatch(lock, cpus, 0);
+
+                want = ((BENCH_LOCK_READ == lock) ? 0 :
+                        (BENCH_LOCK_SEQCOUNT == lock) ? BENCH_SYNC_ITERS : ops);
+
+                LOG_INFO("sync %-5s %-12s cpus=%u: %6lu ns/acquire%s\n\r",
+                         sync_impl_name((sync_impl_t)impl),
+                         bench_lock_names[lock],
+                         cpus,
+                         (0 == freq) ? 0 : (uint64_t)((ticks * 1000000000ULL) / (freq * ops)),
+                         ((bench_shared[0] != want) || (0 != bench_torn)) ? " MUTUAL EXCLUSION BROKEN" : "");
+            }
+        }
+    }
+
+    (void)bench_sync_dispatch(0, 0, 1);
+    (void)sync_set_impl(boot_impl);
+}
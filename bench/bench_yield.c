@@ -0,0 +1,183 @@
+/**
+ * @file bench_yield.c
+ * @brief Directed yield benchmark.
+ *
+ * This file contains the benchmark that runs a two vCPU guest hammering a
+ * ticket spinlock on a single physical CPU, with and without the directed
+ * yield on WFE.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Both vCPUs share the CPU that ran the hypercall benchmark, so whenever
+ * the lock holder's time slice ends while it is inside the critical
+ * section the other vCPU can only spin. Without the directed yield it
+ * spins away the rest of its slice; with it, its first trapped WFE hands
+ * the CPU back to the holder. The reported cost is wall time divided by
+ * all acquisitions.
+ *
+ * Each run gives the guest a fresh page of demand paged RAM for the lock,
+ * so the hypervisor never writes memory the guest accesses with its MMU
+ * off.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Spinlock guest benchmark for the directed yield.
+ */
+
+/* this module's header */
+#include "bench.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "logging.h"
+#include "platform.h"
+#include "sched.h"
+#include "smp.h"
+#include "stage2.h"
+#include "sysreg.h"
+#include "vm.h"
+
+#define BENCH_YIELD_ID    (3U)             /* VM identifier */
+#define BENCH_YIELD_IPA   (0x100000000ULL) /* guest RAM, above the identity mapped image */
+#define BENCH_YIELD_SIZE  (0x200000ULL)    /* 2MB of guest RAM */
+#define BENCH_YIELD_PAGE  (0x1000ULL)      /* lock page of one run */
+#define BENCH_YIELD_VCPUS (2U)             /* vCPUs contending for the lock */
+#define BENCH_YIELD_ITERS (10000U)         /* acquisitions per vCPU and run */
+#define BENCH_YIELD_HOLD  (2000U)          /* delay loop iterations inside the critical section */
+
+extern char __frame_pool_start__;       /* Defined by the linker */
+extern void bench_guest_spinlock(void); /* Defined in guest_spinlock.s */
+
+static const char* bench_yield_modes[] = { "on", "off" }; /* Directed yield per run */
+
+static vm_t          bench_yield_vm;                /* VM running the spinlock guest */
+static uint32_t      bench_yield_run        = 0;    /* Index into bench_yield_modes */
+static uint64_t      bench_yield_start      = 0;    /* Counter at the start of the run */
+static sched_stats_t bench_yield_base;              /* Scheduler counters at the start of the run */
+static void          (*bench_yield_done)(void) = NULL; /* Called after the last run */
+
+/**
+ * @brief Restart every vCPU of the guest for the current run.
+ */
+static void bench_yield_reset(void)
+{
+    sched_set_yield(0 == bench_yield_run);
+    (void)sched_get_stats(smp_cpu_id(), &bench_yield_base);
+
+    for (uint32_t i = 0; i < BENCH_YIELD_VCPUS; ++i)
+    {
+        vcpu_t* vcpu = &bench_yield_vm.vcpus[i]; /* vCPU to restart */
+
+        vcpu_reset(vcpu, (uintptr_t)bench_guest_spinlock, BENCH_YIELD_ITERS);
+        vcpu->ctx.x[1] = BENCH_YIELD_IPA + (bench_yield_run * BENCH_YIELD_PAGE);
+        vcpu->ctx.x[2] = BENCH_YIELD_HOLD;
+        vcpu->ctx.x[3] = BENCH_YIELD_VCPUS;
+
+        /* The vCPU that did not report waits in WFI, or is about to */
+        if ((vcpu != vcpu_current()) && (VCPU_STATE_OFFLINE != vcpu->state))
+        {
+            __atomic_store_n(&vcpu->state, VCPU_STATE_RUNNABLE, __ATOMIC_RELEASE);
+        }
+    }
+
+    bench_yield_start = arch_counter_read();
+}
+
+/**
+ * @brief Report one run and start the next.
+ *
+ * @param vcpu The vCPU that finished last, x1 holds the lock counter.
+ */
+static void bench_yield_on_shutdown(vcpu_t* vcpu)
+{
+    uint64_t      ticks = arch_counter_read() - bench_yield_start;         /* Run time */
+    uint64_t      ops   = (uint64_t)BENCH_YIELD_ITERS * BENCH_YIELD_VCPUS; /* Acquisitions */
+    uint64_t      freq  = arch_counter_freq();                             /* Counter frequency */
+    uint64_t      ns    = 0;                                               /* Cost per acquisition */
+    sched_stats_t stats = { 0 };                                           /* Counters at the end */
+
+    (void)sched_get_stats(smp_cpu_id(), &stats);
+    ns = (0 == freq) ? 0 : (ticks * 1000000000ULL) / (freq * ops);
+
+    LOG_INFO("spinlock yield=%-3s: %6lu ns/acquire, %lu yields (%lu to preempted, %lu missed), %lu switches%s\n\r",
+             bench_yield_modes[bench_yield_run],
+             ns,
+             stats.yields - bench_yield_base.yields,
+             stats.yield_holders - bench_yield_base.yield_holders,
+             stats.yield_misses - bench_yield_base.yield_misses,
+             stats.switches - bench_yield_base.switches,
+             (ops == vcpu->ctx.x[1]) ? "" : ", LOST UPDATES");
+
+    if (++bench_yield_run < (sizeof(bench_yield_modes) / sizeof(bench_yield_modes[0])))
+    {
+        bench_yield_reset();
+        return;
+    }
+
+    sched_set_yield(1);
+    bench_yield_done();
+}
+
+/**
+ * @brief Run the spinlock guest with and without the directed yield.
+ *
+ * @param vcpu The loaded vCPU of the previous benchmark.
+ * @param done Called after the last run.
+ */
+void bench_yield(struct vcpu* vcpu, void (*done)(void))
+{
+    uint64_t image = (uintptr_t)&__frame_pool_start__ - PLATFORM_RAM_BASE; /* Hypervisor image size */
+
+    bench_yield_done = done;
+
+    if (STATUS_OK != vm_init(&bench_yield_vm, BENCH_YIELD_ID, BENCH_YIELD_IPA, BENCH_YIELD_SIZE, BENCH_YIELD_VCPUS))
+    {
+        LOG_ERR("bench: cannot create spinlock VM\n\r");
+        done();
+        return;
+    }
+
+    /* The guest executes in place, read-only */
+    stage2_map(&bench_yield_vm.s2, PLATFORM_RAM_BASE, PLATFORM_RAM_BASE, image, STAGE2_MEM_NORMAL & ~S2_PTE_S2AP_W);
+    bench_yield_vm.on_shutdown = bench_yield_on_shutdown;
+
+    for (uint32_t i = 0; i < BENCH_YIELD_VCPUS; ++i)
+    {
+        if (STATUS_OK != sched_add(&bench_yield_vm.vcpus[i], smp_cpu_id()))
+        {
+            LOG_ERR("bench: no room for the spinlock vCPUs\n\r");
+            done();
+            return;
+        }
+    }
+    bench_yield_reset();
+
+    /* The previous benchmark's vCPU leaves, the scheduler loads the first spinlock vCPU */
+    sched_exit(vcpu);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file guest_hypercall.s
+ * @brief Guest stub timing single and batched hypercalls.
+ *
+ * This file contains a minimal EL1 guest that issues the same number of
+ * hypercall operations once as single HVCs and once as multicall batches,
+ * and reports both timings through the shutdown hypercall.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The stub runs with its stage-1 MMU off. It keeps all state in registers
+ * and never touches memory itself, so its results do not depend on cache
+ * maintenance between the guest and the hypervisor.
+ *
+ * Entry: x0 = rounds, x1 = operations per round, x2 = IPA of a batch page
+ * holding x1 HYPERCALL_NOP entries.
+ * Exit: HYPERCALL_SHUTDOWN with x1 = ticks for single calls, x2 = ticks
+ * for batched calls, x3 = batched operations that failed.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Hypercall benchmark guest.
+ *
+ * @section examples Examples
+ * No examples available for assembly guest code.
+ */
+
+/* Hypercall function IDs, must match hypercall.h */
+.equ HYPERCALL_NOP,       0xC6000001
+.equ HYPERCALL_MULTICALL, 0xC6000010
+.equ HYPERCALL_SHUTDOWN,  0xC6000011
+
+.section .text
+.global bench_guest_hypercall
+
+bench_guest_hypercall:
+    // Keep the parameters out of the hypercall argument registers
+    mov x19, x0
+    mov x20, x1
+    mov x21, x2
+    mov x27, #0
+
+    // Single calls: rounds * ops HVCs
+    isb
+    mrs x23, cntvct_el0
+    mov x24, x19
+1:
+    mov x25, x20
+2:
+    ldr x0, =HYPERCALL_NOP
+    hvc #0
+    subs x25, x25, #1
+    b.ne 2b
+    subs x24, x24, #1
+    b.ne 1b
+    isb
+    mrs x26, cntvct_el0
+    sub x22, x26, x23
+
+    // Batched calls: one HVC per round
+    isb
+    mrs x23, cntvct_el0
+    mov x24, x19
+3:
+    ldr x0, =HYPERCALL_MULTICALL
+    mov x1, x21
+    mov x2, x20
+    hvc #0
+    // Count failed entries, x1 is the first bad entry if rejected
+    cbz x0, 4f
+    mov x1, x20
+4:
+    add x27, x27, x1
+    subs x24, x24, #1
+    b.ne 3b
+    isb
+    mrs x26, cntvct_el0
+    sub x26, x26, x23
+
+    // Report and power off
+    ldr x0, =HYPERCALL_SHUTDOWN
+    mov x1, x22
+    mov x2, x26
+    mov x3, x27
+    hvc #0
+    b .
@@ -0,0 +1,121 @@
+/**
+ * @file guest_ipi.s
+ * @brief Guest stub bouncing an SGI between two vCPUs.
+ *
+ * This file contains a minimal EL1 guest, run on two vCPUs at once, that
+ * sends an SGI back and forth and reports the elapsed counter ticks
+ * through the shutdown hypercall.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * vCPU 0 pings with a write to ICC_SGI1R_EL1 and waits for the answer,
+ * vCPU 1 waits for the ping and answers, its MPIDR_EL1 Aff0 picks the
+ * role. Both keep IRQs masked and wait in WFI, which a pending virtual
+ * interrupt completes, then acknowledge and complete the SGI through
+ * ICC_IAR1_EL1 and ICC_EOIR1_EL1. The GIC system registers are spelled
+ * out as generic encodings.
+ *
+ * Entry: x0 = round trips.
+ * Exit: vCPU 0 calls HYPERCALL_SHUTDOWN with x1 = virtual counter ticks of
+ * all round trips; vCPU 1 waits in WFI.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * IPI ping-pong benchmark guest.
+ *
+ * @section examples Examples
+ * No examples available for assembly guest code.
+ */
+
+/* Hypercall function IDs, must match hypercall.h */
+.equ HYPERCALL_SHUTDOWN, 0xC6000011
+
+/* ICC_SGI1R_EL1 fields */
+.equ SGI1R_INTID,   (1 << 24) // SGI 1
+.equ SGI1R_TO_VCPU0, 1        // TargetList bit of vCPU 0
+.equ SGI1R_TO_VCPU1, 2        // TargetList bit of vCPU 1
+
+/* ICC_IAR1_EL1 returns 1020-1023 when nothing is pending */
+.equ INTID_SPECIAL, 1020
+
+.section .text
+.global bench_guest_ipi
+
+bench_guest_ipi:
+    mov x19, x0
+
+    // System register interface, every priority unmasked, group 1 enabled
+    mrs x8, S3_0_C12_C12_5
+    orr x8, x8, #1
+    msr S3_0_C12_C12_5, x8
+    isb
+    mov x8, #0xff
+    msr S3_0_C4_C6_0, x8
+    mov x8, #1
+    msr S3_0_C12_C12_7, x8
+    isb
+
+    // x20 is the SGI1R value that reaches the peer
+    mov x20, #SGI1R_INTID
+    mrs x8, mpidr_el1
+    and x8, x8, #0xff
+    cbnz x8, .Lpong
+
+    orr x20, x20, #SGI1R_TO_VCPU1
+    isb
+    mrs x21, cntvct_el0
+1:
+    msr S3_0_C12_C11_5, x20
+    bl .Lwait
+    subs x19, x19, #1
+    b.ne 1b
+    isb
+    mrs x8, cntvct_el0
+    ldr x0, =HYPERCALL_SHUTDOWN
+    sub x1, x8, x21
+    hvc #0
+    b .Lpark
+
+.Lpong:
+    orr x20, x20, #SGI1R_TO_VCPU0
+2:
+    bl .Lwait
+    msr S3_0_C12_C11_5, x20
+    subs x19, x19, #1
+    b.ne 2b
+
+.Lpark:
+    wfi
+    b .Lpark
+
+// Wait for an SGI, then acknowledge and complete it
+.Lwait:
+    wfi
+    mrs x8, S3_0_C12_C12_0
+    cmp x8, #INTID_SPECIAL
+    b.hs .Lwait
+    msr S3_0_C12_C12_1, x8
+    ret
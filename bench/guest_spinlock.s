@@ -0,0 +1,120 @@
+/**
+ * @file guest_spinlock.s
+ * @brief Guest stub contending for a ticket spinlock.
+ *
+ * This file contains a minimal EL1 guest, run on several vCPUs at once,
+ * that takes and releases a shared ticket spinlock and reports through
+ * the shutdown hypercall once every vCPU is done.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The lock is the usual arm64 ticket lock: a 16-bit owner below a 16-bit
+ * next ticket in one word, waiters sleep in WFE until the owner halfword
+ * they monitor with LDAXRH changes. The critical section increments a
+ * counter and runs a delay loop, so a vCPU is often preempted holding the
+ * lock.
+ *
+ * Entry: x0 = acquisitions, x1 = IPA of a zeroed lock page, x2 = delay
+ * loop iterations inside the critical section, x3 = number of vCPUs.
+ * Exit: the last vCPU to finish calls HYPERCALL_SHUTDOWN with x1 = the
+ * counter, which equals all acquisitions of all vCPUs; the others wait in
+ * WFI.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Spinlock benchmark guest.
+ *
+ * @section examples Examples
+ * No examples available for assembly guest code.
+ */
+
+/* Hypercall function IDs, must match hypercall.h */
+.equ HYPERCALL_SHUTDOWN, 0xC6000011
+
+/* Lock page layout */
+// The lock word is at offset 0: owner (bits 15:0), next ticket (bits 31:16)
+.equ LOCK_COUNTER, 8  // incremented inside the critical section
+.equ LOCK_DONE,    16 // vCPUs finished
+
+.section .text
+.global bench_guest_spinlock
+
+bench_guest_spinlock:
+    mov x19, x0
+    mov x20, x1
+    mov x21, x2
+    mov x22, x3
+    add x23, x1, #LOCK_DONE
+
+1:
+    // Take a ticket, w7 is ours and w4 the current owner
+    ldaxr w4, [x20]
+    add w5, w4, #0x10, lsl #12
+    stxr w6, w5, [x20]
+    cbnz w6, 1b
+    lsr w7, w4, #16
+    and w4, w4, #0xffff
+    cmp w4, w7
+    b.eq 3f
+
+    // Wait for the owner to reach our ticket, the release store wakes WFE
+    sevl
+2:
+    wfe
+    ldaxrh w4, [x20]
+    cmp w4, w7
+    b.ne 2b
+
+3:
+    // Critical section
+    ldr x8, [x20, #LOCK_COUNTER]
+    add x8, x8, #1
+    str x8, [x20, #LOCK_COUNTER]
+    mov x9, x21
+4:
+    subs x9, x9, #1
+    b.ne 4b
+
+    // Release: the owner moves to the next ticket
+    add w7, w7, #1
+    stlrh w7, [x20]
+    subs x19, x19, #1
+    b.ne 1b
+
+5:
+    // Count this vCPU as done, the last one reports
+    ldaxr x8, [x23]
+    add x8, x8, #1
+    stlxr w6, x8, [x23]
+    cbnz w6, 5b
+    cmp x8, x22
+    b.ne 6f
+    ldr x0, =HYPERCALL_SHUTDOWN
+    ldr x1, [x20, #LOCK_COUNTER]
+    hvc #0
+6:
+    wfi
+    b 6b
@@ -0,0 +1,431 @@
+# Static VM configuration
+#
+# A VM configuration file (see config/vm_config.cmake) declares VMs, their
+# memory regions, emulated and passthrough devices and the channels between
+# them with the functions below. hl_vm_config_generate() checks the layout and writes:
+#
+#   vm_config_gen.h     counts and sizes used to dimension the static tables
+#   vm_config_table.c   const configuration tables and the .bss instances
+#   vm_config.ld        linker symbols checked by ASSERTs in linker.ld
+#
+# Nothing is parsed at boot; the tables are plain initialized C data.
+
+set(HL_PAGE_SIZE          4096)
+set(HL_IPA_LIMIT          549755813888)   # 1 << 39, stage-2 IPA space
+set(HL_BALLOON_MMIO_SIZE  512)            # VIRTIO_BALLOON_MMIO_SIZE
+set(HL_CHANNEL_SIZE       8192)           # CHANNEL_SIZE
+set(HL_MAX_VCPUS          4)              # VM_MAX_VCPUS
+set(HL_MAX_MMIO_REGIONS   4)              # VM_MAX_MMIO_REGIONS
+set(HL_MAX_CHANNELS       4)              # VM_MAX_CHANNELS
+set(HL_MAX_INTID          1020)           # VGIC_MAX_INTID
+set(HL_MAX_PASSTHROUGHS   4)              # PASSTHROUGH_MAX
+set(HL_GIC_PA             0x08000000)     # PLATFORM_GICD_BASE, distributor and redistributors
+set(HL_GIC_SIZE           0x01000000)
+
+set_property(GLOBAL PROPERTY HL_VMS "")
+set_property(GLOBAL PROPERTY HL_CHANNELS "")
+set_property(GLOBAL PROPERTY HL_PA_RANGES "")
+set_property(GLOBAL PROPERTY HL_PASSTHROUGH_IRQS "")
+set_property(GLOBAL PROPERTY HL_NUM_PASSTHROUGHS 0)
+
+# Convert the named variables to decimal so comparisons are numeric
+macro(_hl_normalize)
+    foreach(var ${ARGN})
+        if(DEFINED ${var})
+            math(EXPR ${var} "${${var}}")
+        endif()
+    endforeach()
+endmacro()
+
+# Format a number as a C hexadecimal literal
+function(_hl_hex out value)
+    math(EXPR hex "${value}" OUTPUT_FORMAT HEXADECIMAL)
+    set(${out} "${hex}ULL" PARENT_SCOPE)
+endfunction()
+
+# Fail unless a value is a multiple of the page size
+function(_hl_check_aligned what value)
+    math(EXPR rem "${value} % ${HL_PAGE_SIZE}")
+    if(NOT rem EQUAL 0)
+        message(FATAL_ERROR "VM config: ${what} (${value}) is not page aligned")
+    endif()
+endfunction()
+
+# Fail unless [start, start + size) lies inside the stage-2 IPA space
+function(_hl_check_ipa what start size)
+    math(EXPR end "${start} + ${size}")
+    if(end GREATER HL_IPA_LIMIT)
+        message(FATAL_ERROR "VM config: ${what} exceeds the IPA space")
+    endif()
+endfunction()
+
+# Record [start, start + size) in a range list property, failing on overlap
+function(_hl_claim property what start size)
+    math(EXPR end "${start} + ${size}")
+    get_property(ranges GLOBAL PROPERTY ${property})
+    foreach(range IN LISTS ranges)
+        string(REPLACE ":" ";" fields "${range}")
+        list(GET fields 0 other_start)
+        list(GET fields 1 other_end)
+        list(GET fields 2 other_what)
+        if((start LESS other_end) AND (other_start LESS end))
+            message(FATAL_ERROR "VM config: ${what} overlaps ${other_what}")
+        endif()
+    endforeach()
+    set_property(GLOBAL APPEND PROPERTY ${property} "${start}:${end}:${what}")
+endfunction()
+
+# Fail unless a VM was declared
+function(_hl_check_vm name)
+    get_property(vms GLOBAL PROPERTY HL_VMS)
+    list(FIND vms "${name}" index)
+    if(index LESS 0)
+        message(FATAL_ERROR "VM config: unknown VM '${name}'")
+    endif()
+endfunction()
+
+# hl_vm(<name> VCPUS <n> RAM_IPA <ipa> RAM_SIZE <bytes> ENTRY <ipa>)
+function(hl_vm name)
+    cmake_parse_arguments(VM "" "VCPUS;RAM_IPA;RAM_SIZE;ENTRY" "" ${ARGN})
+    foreach(key VCPUS RAM_IPA RAM_SIZE ENTRY)
+        if(NOT DEFINED VM_${key})
+            message(FATAL_ERROR "VM config: VM '${name}' lacks ${key}")
+        endif()
+    endforeach()
+    _hl_normalize(VM_VCPUS VM_RAM_IPA VM_RAM_SIZE VM_ENTRY)
+    if((VM_VCPUS LESS 1) OR (VM_VCPUS GREATER HL_MAX_VCPUS))
+        message(FATAL_ERROR "VM config: VM '${name}' needs 1 to ${HL_MAX_VCPUS} vCPUs")
+    endif()
+    _hl_check_aligned("RAM_IPA of VM '${name}'" ${VM_RAM_IPA})
+    _hl_check_aligned("RAM_SIZE of VM '${name}'" ${VM_RAM_SIZE})
+    _hl_check_ipa("RAM of VM '${name}'" ${VM_RAM_IPA} ${VM_RAM_SIZE})
+
+    set_property(GLOBAL APPEND PROPERTY HL_VMS ${name})
+    foreach(key VCPUS RAM_IPA RAM_SIZE ENTRY)
+        set_property(GLOBAL PROPERTY HL_VM_${name}_${key} ${VM_${key}})
+    endforeach()
+    set_property(GLOBAL PROPERTY HL_VM_${name}_REGIONS "")
+    set_property(GLOBAL PROPERTY HL_VM_${name}_DEVICES "")
+    set_property(GLOBAL PROPERTY HL_VM_${name}_PASSTHROUGHS "")
+    set_property(GLOBAL PROPERTY HL_VM_${name}_CHANNELS 0)
+    _hl_claim(HL_VM_${name}_IPA "RAM of VM '${name}'" ${VM_RAM_IPA} ${VM_RAM_SIZE})
+endfunction()
+
+# hl_vm_region(<vm> IPA <ipa> PA <pa> SIZE <bytes> TYPE normal|readonly|device)
+function(hl_vm_region vm)
+    cmake_parse_arguments(R "" "IPA;PA;SIZE;TYPE" "" ${ARGN})
+    _hl_check_vm(${vm})
+    foreach(key IPA PA SIZE TYPE)
+        if(NOT DEFINED R_${key})
+            message(FATAL_ERROR "VM config: region of VM '${vm}' lacks ${key}")
+        endif()
+    endforeach()
+    set(ipa_text ${R_IPA})
+    set(pa_text ${R_PA})
+    _hl_normalize(R_IPA R_PA R_SIZE)
+    if(NOT R_TYPE MATCHES "^(normal|readonly|device)$")
+        message(FATAL_ERROR "VM config: region type '${R_TYPE}' of VM '${vm}' is not normal, readonly or device")
+    endif()
+    _hl_check_aligned("region IPA ${ipa_text} of VM '${vm}'" ${R_IPA})
+    _hl_check_aligned("region PA ${pa_text} of VM '${vm}'" ${R_PA})
+    _hl_check_aligned("region SIZE at ${ipa_text} of VM '${vm}'" ${R_SIZE})
+    _hl_check_ipa("region ${ipa_text} of VM '${vm}'" ${R_IPA} ${R_SIZE})
+    _hl_claim(HL_VM_${vm}_IPA "region ${ipa_text} of VM '${vm}'" ${R_IPA} ${R_SIZE})
+    _hl_claim(HL_PA_RANGES "region PA ${pa_text} of VM '${vm}'" ${R_PA} ${R_SIZE})
+    string(TOUPPER ${R_TYPE} type)
+    set_property(GLOBAL APPEND PROPERTY HL_VM_${vm}_REGIONS "${R_IPA}:${R_PA}:${R_SIZE}:${type}")
+endfunction()
+
+# hl_vm_device(<vm> TYPE virtio_balloon BASE <ipa> IRQ <intid>)
+function(hl_vm_device vm)
+    cmake_parse_arguments(D "" "TYPE;BASE;IRQ" "" ${ARGN})
+    _hl_check_vm(${vm})
+    set(base_text ${D_BASE})
+    _hl_normalize(D_BASE D_IRQ)
+    if(NOT D_TYPE STREQUAL "virtio_balloon")
+        message(FATAL_ERROR "VM config: unknown device type '${D_TYPE}' in VM '${vm}'")
+    endif()
+    if((D_IRQ LESS 32) OR (NOT D_IRQ LESS HL_MAX_INTID))
+        message(FATAL_ERROR "VM config: device IRQ ${D_IRQ} of VM '${vm}' is not a SPI")
+    endif()
+    get_property(devices GLOBAL PROPERTY HL_VM_${vm}_DEVICES)
+    list(LENGTH devices count)
+    if(NOT count LESS HL_MAX_MMIO_REGIONS)
+        message(FATAL_ERROR "VM config: VM '${vm}' has more than ${HL_MAX_MMIO_REGIONS} devices")
+    endif()
+    _hl_claim(HL_VM_${vm}_IPA "${D_TYPE} ${base_text} of VM '${vm}'" ${D_BASE} ${HL_BALLOON_MMIO_SIZE})
+    string(TOUPPER ${D_TYPE} type)
+    set_property(GLOBAL APPEND PROPERTY HL_VM_${vm}_DEVICES "${type}:${D_BASE}:${D_IRQ}")
+endfunction()
+
+# hl_vm_passthrough(<vm> PA <pa> IPA <ipa> SIZE <bytes> [IRQ <intid>])
+#
+# Assigns a physical MMIO range to the VM, mapped Device-nGnRE. IRQ is the
+# device's SPI, forwarded to the same interrupt ID in the VM.
+function(hl_vm_passthrough vm)
+    cmake_parse_arguments(P "" "PA;IPA;SIZE;IRQ" "" ${ARGN})
+    _hl_check_vm(${vm})
+    foreach(key PA IPA SIZE)
+        if(NOT DEFINED P_${key})
+            message(FATAL_ERROR "VM config: passthrough device of VM '${vm}' lacks ${key}")
+        endif()
+    endforeach()
+    if(NOT DEFINED P_IRQ)
+        set(P_IRQ 0)
+    endif()
+    set(pa_text ${P_PA})
+    _hl_normalize(P_PA P_IPA P_SIZE P_IRQ)
+    _hl_check_aligned("passthrough PA ${pa_text} of VM '${vm}'" ${P_PA})
+    _hl_check_aligned("passthrough IPA of ${pa_text} in VM '${vm}'" ${P_IPA})
+    _hl_check_aligned("passthrough SIZE of ${pa_text} in VM '${vm}'" ${P_SIZE})
+    _hl_check_ipa("passthrough ${pa_text} of VM '${vm}'" ${P_IPA} ${P_SIZE})
+    math(EXPR gic_pa "${HL_GIC_PA}")
+    math(EXPR gic_end "${HL_GIC_PA} + ${HL_GIC_SIZE}")
+    math(EXPR pa_end "${P_PA} + ${P_SIZE}")
+    if((P_PA LESS gic_end) AND (gic_pa LESS pa_end))
+        message(FATAL_ERROR "VM config: passthrough ${pa_text} of VM '${vm}' overlaps the GIC")
+    endif()
+    if(NOT P_IRQ EQUAL 0)
+        if((P_IRQ LESS 32) OR (NOT P_IRQ LESS HL_MAX_INTID))
+            message(FATAL_ERROR "VM config: passthrough IRQ ${P_IRQ} of VM '${vm}' is not a SPI")
+        endif()
+        get_property(irqs GLOBAL PROPERTY HL_PASSTHROUGH_IRQS)
+        list(FIND irqs ${P_IRQ} index)
+        if(NOT index LESS 0)
+            message(FATAL_ERROR "VM config: passthrough IRQ ${P_IRQ} of VM '${vm}' is already assigned")
+        endif()
+        set_property(GLOBAL APPEND PROPERTY HL_PASSTHROUGH_IRQS ${P_IRQ})
+    endif()
+    get_property(count GLOBAL PROPERTY HL_NUM_PASSTHROUGHS)
+    if(NOT count LESS HL_MAX_PASSTHROUGHS)
+        message(FATAL_ERROR "VM config: more than ${HL_MAX_PASSTHROUGHS} passthrough devices")
+    endif()
+    math(EXPR next "${count} + 1")
+    set_property(GLOBAL PROPERTY HL_NUM_PASSTHROUGHS ${next})
+    _hl_claim(HL_VM_${vm}_IPA "passthrough ${pa_text} of VM '${vm}'" ${P_IPA} ${P_SIZE})
+    _hl_claim(HL_PA_RANGES "passthrough PA ${pa_text} of VM '${vm}'" ${P_PA} ${P_SIZE})
+    set_property(GLOBAL APPEND PROPERTY HL_VM_${vm}_PASSTHROUGHS "${P_IPA}:${P_PA}:${P_SIZE}:${P_IRQ}:${count}")
+endfunction()
+
+# hl_channel(A <vm> A_IPA <ipa> A_IRQ <intid> B <vm> B_IPA <ipa> B_IRQ <intid>)
+function(hl_channel)
+    cmake_parse_arguments(C "" "A;A_IPA;A_IRQ;B;B_IPA;B_IRQ" "" ${ARGN})
+    _hl_check_vm(${C_A})
+    _hl_check_vm(${C_B})
+    set(A_text ${C_A_IPA})
+    set(B_text ${C_B_IPA})
+    _hl_normalize(C_A_IPA C_A_IRQ C_B_IPA C_B_IRQ)
+    if(C_A STREQUAL C_B)
+        message(FATAL_ERROR "VM config: channel endpoints must be in different VMs ('${C_A}')")
+    endif()
+    foreach(side A B)
+        set(vm ${C_${side}})
+        _hl_check_aligned("channel IPA ${${side}_text} in VM '${vm}'" ${C_${side}_IPA})
+        _hl_check_ipa("channel ${${side}_text} of VM '${vm}'" ${C_${side}_IPA} ${HL_CHANNEL_SIZE})
+        _hl_claim(HL_VM_${vm}_IPA "channel ${${side}_text} of VM '${vm}'" ${C_${side}_IPA} ${HL_CHANNEL_SIZE})
+        get_property(count GLOBAL PROPERTY HL_VM_${vm}_CHANNELS)
+        math(EXPR count "${count} + 1")
+        if(count GREATER HL_MAX_CHANNELS)
+            message(FATAL_ERROR "VM config: VM '${vm}' has more than ${HL_MAX_CHANNELS} channels")
+        endif()
+        set_property(GLOBAL PROPERTY HL_VM_${vm}_CHANNELS ${count})
+    endforeach()
+    get_property(vms GLOBAL PROPERTY HL_VMS)
+    list(FIND vms ${C_A} a)
+    list(FIND vms ${C_B} b)
+    set_property(GLOBAL APPEND PROPERTY HL_CHANNELS "${a}:${C_A_IPA}:${C_A_IRQ}:${b}:${C_B_IPA}:${C_B_IRQ}")
+endfunction()
+
+# hl_vm_config_generate(<output directory> RAM_BASE <pa> RAM_SIZE <bytes> [OVERCOMMIT])
+function(hl_vm_config_generate out_dir)
+    cmake_parse_arguments(G "OVERCOMMIT" "RAM_BASE;RAM_SIZE" "" ${ARGN})
+    _hl_normalize(G_RAM_BASE G_RAM_SIZE)
+    get_property(vms GLOBAL PROPERTY HL_VMS)
+    get_property(channels GLOBAL PROPERTY HL_CHANNELS)
+    get_property(num_passthroughs GLOBAL PROPERTY HL_NUM_PASSTHROUGHS)
+    list(LENGTH vms num_vms)
+    list(LENGTH channels num_channels)
+    math(EXPR ram_end "${G_RAM_BASE} + ${G_RAM_SIZE}")
+
+    set(num_balloons 0)
+    set(guest_ram 0)
+    set(pool_end ${ram_end})
+    set(tables "")
+    set(vm_entries "")
+
+    set(index 0)
+    foreach(vm IN LISTS vms)
+        foreach(key VCPUS RAM_IPA RAM_SIZE ENTRY REGIONS DEVICES PASSTHROUGHS)
+            get_property(${key} GLOBAL PROPERTY HL_VM_${vm}_${key})
+        endforeach()
+        math(EXPR guest_ram "${guest_ram} + ${RAM_SIZE}")
+
+        # Regions: the frame pool must stop below any guest region in RAM
+        set(region_rows "")
+        list(LENGTH REGIONS num_regions)
+        foreach(region IN LISTS REGIONS)
+            string(REPLACE ":" ";" f "${region}")
+            list(GET f 0 ipa)
+            list(GET f 1 pa)
+            list(GET f 2 size)
+            list(GET f 3 type)
+            _hl_hex(ipa_hex ${ipa})
+            _hl_hex(pa_hex ${pa})
+            _hl_hex(size_hex ${size})
+            string(APPEND region_rows "    { ${ipa_hex}, ${pa_hex}, ${size_hex}, VM_CONFIG_REGION_${type} },\n")
+            if((NOT pa LESS G_RAM_BASE) AND (pa LESS pool_end))
+                set(pool_end ${pa})
+            endif()
+        endforeach()
+
+        set(device_rows "")
+        list(LENGTH DEVICES num_devices)
+        foreach(device IN LISTS DEVICES)
+            string(REPLACE ":" ";" f "${device}")
+            list(GET f 0 type)
+            list(GET f 1 base)
+            list(GET f 2 irq)
+            _hl_hex(base_hex ${base})
+            string(APPEND device_rows "    { VM_CONFIG_DEVICE_${type}, ${base_hex}, ${irq}U, ${num_balloons}U },\n")
+            math(EXPR num_balloons "${num_balloons} + 1")
+        endforeach()
+
+        # Passthrough devices: MMIO outside RAM
+        set(passthrough_rows "")
+        list(LENGTH PASSTHROUGHS num_pt)
+        foreach(pt IN LISTS PASSTHROUGHS)
+            string(REPLACE ":" ";" f "${pt}")
+            list(GET f 0 ipa)
+            list(GET f 1 pa)
+            list(GET f 2 size)
+            list(GET f 3 irq)
+            list(GET f 4 instance)
+            math(EXPR pa_end "${pa} + ${size}")
+            if((pa LESS ram_end) AND (G_RAM_BASE LESS pa_end))
+                math(EXPR pa_hex "${pa}" OUTPUT_FORMAT HEXADECIMAL)
+                message(FATAL_ERROR "VM config: passthrough PA ${pa_hex} of VM '${vm}' is in RAM")
+            endif()
+            _hl_hex(ipa_hex ${ipa})
+            _hl_hex(pa_hex ${pa})
+            _hl_hex(size_hex ${size})
+            string(APPEND passthrough_rows "    { ${ipa_hex}, ${pa_hex}, ${size_hex}, ${irq}U, ${instance}U },\n")
+        endforeach()
+
+        set(regions_ref "NULL")
+        if(num_regions GREATER 0)
+            string(APPEND tables "static const vm_config_region_t ${vm}_regions[] = {\n${region_rows}};\n\n")
+            set(regions_ref "${vm}_regions")
+        endif()
+        set(devices_ref "NULL")
+        if(num_devices GREATER 0)
+            string(APPEND tables "static const vm_config_device_t ${vm}_devices[] = {\n${device_rows}};\n\n")
+            set(devices_ref "${vm}_devices")
+        endif()
+
+        set(passthroughs_ref "NULL")
+        if(num_pt GREATER 0)
+            string(APPEND tables "static const vm_config_passthrough_t ${vm}_passthroughs[] = {\n${passthrough_rows}};\n\n")
+            set(passthroughs_ref "${vm}_passthroughs")
+        endif()
+
+        math(EXPR id "${index} + 1")
+        _hl_hex(RAM_IPA ${RAM_IPA})
+        _hl_hex(RAM_SIZE_HEX ${RAM_SIZE})
+        _hl_hex(ENTRY ${ENTRY})
+        string(APPEND vm_entries
+            "    {\n"
+            "        .name             = \"${vm}\",\n"
+            "        .id               = ${id}U,\n"
+            "        .num_vcpus        = ${VCPUS}U,\n"
+            "        .ram_ipa          = ${RAM_IPA},\n"
+            "        .ram_size         = ${RAM_SIZE_HEX},\n"
+            "        .entry            = ${ENTRY},\n"
+            "        .regions          = ${regions_ref},\n"
+            "        .num_regions      = ${num_regions}U,\n"
+            "        .devices          = ${devices_ref},\n"
+            "        .num_devices      = ${num_devices}U,\n"
+            "        .passthroughs     = ${passthroughs_ref},\n"
+            "        .num_passthroughs = ${num_pt}U,\n"
+            "    },\n")
+        math(EXPR index "${index} + 1")
+    endforeach()
+
+    set(channel_entries "")
+    foreach(channel IN LISTS channels)
+        string(REPLACE ":" ";" f "${channel}")
+        list(GET f 0 a)
+        list(GET f 1 a_ipa)
+        list(GET f 2 a_irq)
+        list(GET f 3 b)
+        list(GET f 4 b_ipa)
+        list(GET f 5 b_irq)
+        _hl_hex(a_ipa ${a_ipa})
+        _hl_hex(b_ipa ${b_ipa})
+        string(APPEND channel_entries "    { .ep = { { ${a}U, ${a_ipa}, ${a_irq}U }, { ${b}U, ${b_ipa}, ${b_irq}U } } },\n")
+    endforeach()
+
+    set(overcommit 0)
+    if(G_OVERCOMMIT)
+        set(overcommit 1)
+    endif()
+
+    math(EXPR pool_end_hex "${pool_end}" OUTPUT_FORMAT HEXADECIMAL)
+    math(EXPR guest_ram_hex "${guest_ram}" OUTPUT_FORMAT HEXADECIMAL)
+    math(EXPR ram_end_hex "${ram_end}" OUTPUT_FORMAT HEXADECIMAL)
+
+    file(WRITE ${out_dir}/vm_config_gen.h.tmp
+        "/* Generated by cmake/vm_config.cmake from ${HL_VM_CONFIG_FILE}, do not edit */\n\n"
+        "#ifndef VM_CONFIG_GEN_H\n"
+        "#define VM_CONFIG_GEN_H\n\n"
+        "#define VM_CONFIG_NUM_VMS          (${num_vms}U)\n"
+        "#define VM_CONFIG_NUM_CHANNELS     (${num_channels}U)\n"
+        "#define VM_CONFIG_NUM_BALLOONS     (${num_balloons}U)\n"
+        "#define VM_CONFIG_NUM_PASSTHROUGHS (${num_passthroughs}U)\n"
+        "#define VM_CONFIG_GUEST_RAM        (${guest_ram_hex}ULL)\n"
+        "#define VM_CONFIG_POOL_END         (${pool_end_hex}ULL)\n"
+        "#define VM_CONFIG_OVERCOMMIT       (${overcommit})\n\n"
+        "#endif // VM_CONFIG_GEN_H\n")
+
+    set(vm_table "")
+    if(num_vms GREATER 0)
+        string(CONCAT vm_table
+            "const vm_config_t vm_config_table[VM_CONFIG_NUM_VMS] = {\n${vm_entries}};\n\n"
+            "vm_t vm_config_vms[VM_CONFIG_NUM_VMS];\n\n")
+    endif()
+    set(channel_table "")
+    if(num_channels GREATER 0)
+        string(CONCAT channel_table
+            "const vm_config_channel_t vm_config_channel_table[VM_CONFIG_NUM_CHANNELS] = {\n${channel_entries}};\n\n"
+            "channel_t vm_config_channels[VM_CONFIG_NUM_CHANNELS];\n\n")
+    endif()
+    set(balloon_table "")
+    if(num_balloons GREATER 0)
+        set(balloon_table "virtio_balloon_t vm_config_balloons[VM_CONFIG_NUM_BALLOONS];\n\n")
+    endif()
+
+    set(passthrough_table "")
+    if(num_passthroughs GREATER 0)
+        set(passthrough_table "passthrough_t vm_config_passthroughs[VM_CONFIG_NUM_PASSTHROUGHS];\n\n")
+    endif()
+
+    file(WRITE ${out_dir}/vm_config_table.c.tmp
+        "/* Generated by cmake/vm_config.cmake from ${HL_VM_CONFIG_FILE}, do not edit */\n\n"
+        "#include <stddef.h>\n\n"
+        "#include \"vm_config.h\"\n\n"
+        "${tables}${vm_table}${channel_table}${balloon_table}${passthrough_table}")
+
+    file(WRITE ${out_dir}/vm_config.ld.tmp
+        "/* Generated by cmake/vm_config.cmake from ${HL_VM_CONFIG_FILE}, do not edit */\n\n"
+        "__vm_config_ram_end__    = ${ram_end_hex};\n"
+        "__vm_config_pool_end__   = ${pool_end_hex};\n"
+        "__vm_config_guest_ram__  = ${guest_ram_hex};\n"
+        "__vm_config_overcommit__ = ${overcommit};\n")
+
+    # Only touch the outputs when they change, to avoid needless rebuilds
+    foreach(file vm_config_gen.h vm_config_table.c vm_config.ld)
+        configure_file(${out_dir}/${file}.tmp ${out_dir}/${file} COPYONLY)
+        file(REMOVE ${out_dir}/${file}.tmp)
+    endforeach()
+
+    message(STATUS "VM config: ${num_vms} VM(s), ${num_channels} channel(s), ${guest_ram_hex} bytes of guest RAM")
+endfunction()
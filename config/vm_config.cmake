@@ -0,0 +1,58 @@
+# Hyper-LITE VM configuration
+#
+# Declares the VMs started at boot. The build turns this file into const C
+# tables (see cmake/vm_config.cmake), so nothing here is parsed at run time.
+# Addresses are IPAs unless named PA; everything must be 4KB aligned.
+#
+# Guest images are loaded into their image region by QEMU, for example
+#   -device loader,file=guest.bin,addr=0xBF000000
+# Image regions in RAM are kept out of the hypervisor frame pool.
+
+# Primary guest: 64MB of demand-paged RAM plus a 16MB image region
+hl_vm(primary
+    VCPUS    1
+    RAM_IPA  0x40000000
+    RAM_SIZE 0x4000000
+    ENTRY    0x80000000)
+
+hl_vm_region(primary
+    IPA  0x80000000
+    PA   0xBF000000
+    SIZE 0x1000000
+    TYPE normal)
+
+hl_vm_device(primary
+    TYPE virtio_balloon
+    BASE 0x0A000000
+    IRQ  48)
+
+# To give the primary guest the PL011 and its interrupt (SPI 1), which moves
+# the hypervisor log to semihosting:
+#
+# hl_vm_passthrough(primary
+#     PA   0x09000000
+#     IPA  0x09000000
+#     SIZE 0x1000
+#     IRQ  33)
+
+# Secondary guest: 32MB of demand-paged RAM plus a 16MB image region
+hl_vm(secondary
+    VCPUS    1
+    RAM_IPA  0x40000000
+    RAM_SIZE 0x2000000
+    ENTRY    0x80000000)
+
+hl_vm_region(secondary
+    IPA  0x80000000
+    PA   0xBE000000
+    SIZE 0x1000000
+    TYPE normal)
+
+# Shared-memory channel between the two guests
+hl_channel(
+    A     primary
+    A_IPA 0x90000000
+    A_IRQ 49
+    B     secondary
+    B_IPA 0x90000000
+    B_IRQ 49)
@@ -3,11 +3,12 @@
 echo "."
 
 qemu-system-aarch64 \
-    -machine virt,virtualization=on \
+    -machine virt,virtualization=on,gic-version=3 \
     -cpu cortex-a53 \
     -nographic \
     -smp 1 \
     -m 2048 \
+    -semihosting-config enable=on,target=native \
     -serial mon:stdio \
     -S -s \
     -kernel build/hyper-lite.elf
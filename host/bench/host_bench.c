@@ -0,0 +1,408 @@
+/**
+ * @file host_bench.c
+ * @brief Native microbenchmarks of the table builder and allocators.
+ *
+ * This file contains single-threaded benchmarks of stage-2 map, unmap,
+ * lookup and protect, the frame allocator, the logger and the locks,
+ * built against the native library.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Follows the conventions of google-benchmark without depending on it:
+ * every benchmark runs an increasing number of iterations until one run
+ * takes at least the minimum time, then reports the time per iteration.
+ * Options:
+ *
+ * - --benchmark_filter=<substring> runs the benchmarks whose name
+ *   contains the substring;
+ * - --benchmark_min_time=<seconds> sets the minimum time (default 0.5);
+ * - --quick runs every benchmark briefly, for the test suite.
+ *
+ * The numbers are host numbers, they track regressions in the code, not
+ * the cost on the target, where the table walks also miss in the caches
+ * and every TLBI is broadcast.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Native microbenchmarks.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project includes */
+#include "frame.h"
+#include "host.h"
+#include "logging.h"
+#include "stage2.h"
+#include "sync.h"
+#include "sysreg.h"
+
+#define BENCH_POOL_FRAMES (4096U)          /**< Frame pool (16MB) */
+#define BENCH_IPA         (0x40000000ULL)  /**< IPA the benchmarks map at */
+#define BENCH_PA          (0x100000000ULL) /**< PA the benchmarks map to */
+#define BENCH_CONTIG      (16U)            /**< Frames per contiguous allocation */
+#define BENCH_BUILD_SIZE  (0x4000000ULL)   /**< Range of the build benchmark (64MB) */
+#define BENCH_MAX_ITERS   (1000000000ULL)  /**< Iteration cap */
+
+/**
+ * @brief A benchmark body.
+ *
+ * @param iters Number of iterations to run.
+ */
+typedef void (*bench_fn_t)(uint64_t iters);
+
+/**
+ * @brief A registered benchmark.
+ */
+typedef struct bench
+{
+    const char* name;  /**< benchmark name */
+    bench_fn_t  fn;    /**< body */
+    void (*setup)(void);    /**< runs before every timed run, may be NULL */
+    void (*teardown)(void); /**< runs after every timed run, may be NULL */
+} bench_t;
+
+static stage2_t          bench_s2   = { 0 }; /* Regime the stage-2 benchmarks use */
+static volatile uint64_t bench_sink = 0;     /* Keeps results alive */
+static sync_ticket_t     bench_lock = SYNC_TICKET_INIT; /* Uncontended lock */
+
+/**
+ * @brief Create an empty regime.
+ */
+static void bench_s2_setup(void)
+{
+    if (STATUS_OK != stage2_init(&bench_s2, 1))
+    {
+        fprintf(stderr, "stage2_init failed\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Destroy the regime.
+ */
+static void bench_s2_teardown(void)
+{
+    stage2_destroy(&bench_s2);
+}
+
+/**
+ * @brief Create a regime with 16MB mapped, half as 2MB blocks and half as pages.
+ */
+static void bench_s2_populated_setup(void)
+{
+    bench_s2_setup();
+    (void)stage2_map(&bench_s2, BENCH_IPA, BENCH_PA, 4 * STAGE2_BLOCK_2M, STAGE2_MEM_NORMAL);
+    (void)stage2_map(&bench_s2, BENCH_IPA + (4 * STAGE2_BLOCK_2M), BENCH_PA + STAGE2_PAGE_SIZE, 4 * STAGE2_BLOCK_2M, STAGE2_MEM_NORMAL);
+}
+
+/**
+ * @brief Map and unmap one page.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_stage2_map_unmap_4k(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        (void)stage2_map(&bench_s2, BENCH_IPA, BENCH_PA, STAGE2_PAGE_SIZE, STAGE2_MEM_NORMAL);
+        (void)stage2_unmap(&bench_s2, BENCH_IPA, STAGE2_PAGE_SIZE);
+    }
+}
+
+/**
+ * @brief Map and unmap one 2MB block.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_stage2_map_unmap_2m(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        (void)stage2_map(&bench_s2, BENCH_IPA, BENCH_PA, STAGE2_BLOCK_2M, STAGE2_MEM_NORMAL);
+        (void)stage2_unmap(&bench_s2, BENCH_IPA, STAGE2_BLOCK_2M);
+    }
+}
+
+/**
+ * @brief Map and unmap 2MB that the PA alignment forces into 512 pages.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_stage2_map_unmap_2m_pages(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        (void)stage2_map(&bench_s2, BENCH_IPA, BENCH_PA + STAGE2_PAGE_SIZE, STAGE2_BLOCK_2M, STAGE2_MEM_NORMAL);
+        (void)stage2_unmap(&bench_s2, BENCH_IPA, STAGE2_BLOCK_2M);
+    }
+}
+
+/**
+ * @brief Build and tear down a regime mapping 64MB in pages.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_stage2_build_64m_pages(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        bench_s2_setup();
+        (void)stage2_map(&bench_s2, BENCH_IPA, BENCH_PA + STAGE2_PAGE_SIZE, BENCH_BUILD_SIZE, STAGE2_MEM_NORMAL);
+        bench_s2_teardown();
+    }
+}
+
+/**
+ * @brief Translate addresses spread over blocks and pages.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_stage2_lookup(uint64_t iters)
+{
+    uint64_t pa = 0x0ULL; /* Translation */
+
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        uint64_t off = (i * 0x9E3779B1ULL * STAGE2_PAGE_SIZE) & ((8 * STAGE2_BLOCK_2M) - 1ULL); /* Scattered page */
+
+        (void)stage2_lookup(&bench_s2, BENCH_IPA + off, &pa, NULL);
+        bench_sink += pa;
+    }
+}
+
+/**
+ * @brief Write protect and unprotect 8MB of pages.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_stage2_protect_8m_pages(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        bench_sink += stage2_protect(&bench_s2, BENCH_IPA + (4 * STAGE2_BLOCK_2M), 4 * STAGE2_BLOCK_2M, S2_PTE_S2AP_W, 0x0ULL);
+        bench_sink += stage2_protect(&bench_s2, BENCH_IPA + (4 * STAGE2_BLOCK_2M), 4 * STAGE2_BLOCK_2M, 0x0ULL, S2_PTE_S2AP_W);
+    }
+}
+
+/**
+ * @brief Allocate and free one frame.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_frame_alloc_free(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        frame_free(frame_alloc());
+    }
+}
+
+/**
+ * @brief Allocate and free one zeroed frame, zeroing it each time.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_frame_alloc_zeroed_free(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        frame_free(frame_alloc_zeroed());
+    }
+}
+
+/**
+ * @brief Allocate and free contiguous frames.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_frame_alloc_contig_free(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        frame_free_contig(frame_alloc_contig(BENCH_CONTIG), BENCH_CONTIG);
+    }
+}
+
+/**
+ * @brief Format a message into the semihosting sink.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_log_printf(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        log_printf(LOG_INFO, "vm %u: mapped 0x%llx bytes at 0x%llx\n", 1U, (unsigned long long)i, (unsigned long long)BENCH_IPA);
+    }
+    log_flush();
+}
+
+/**
+ * @brief Take and release an uncontended ticket lock.
+ *
+ * @param iters Number of iterations.
+ */
+static void bench_ticket_lock(uint64_t iters)
+{
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        sync_ticket_lock(&bench_lock);
+        sync_ticket_unlock(&bench_lock);
+    }
+}
+
+/* Registered benchmarks */
+static const bench_t benches[] = {
+    { "stage2_map_unmap_4k",       bench_stage2_map_unmap_4k,       bench_s2_setup,           bench_s2_teardown },
+    { "stage2_map_unmap_2m",       bench_stage2_map_unmap_2m,       bench_s2_setup,           bench_s2_teardown },
+    { "stage2_map_unmap_2m_pages", bench_stage2_map_unmap_2m_pages, bench_s2_setup,           bench_s2_teardown },
+    { "stage2_build_64m_pages",    bench_stage2_build_64m_pages,    NULL,                     NULL },
+    { "stage2_lookup",             bench_stage2_lookup,             bench_s2_populated_setup, bench_s2_teardown },
+    { "stage2_protect_8m_pages",   bench_stage2_protect_8m_pages,   bench_s2_populated_setup, bench_s2_teardown },
+    { "frame_alloc_free",          bench_frame_alloc_free,          NULL,                     NULL },
+    { "frame_alloc_zeroed_free",   bench_frame_alloc_zeroed_free,   NULL,                     NULL },
+    { "frame_alloc_contig_free",   bench_frame_alloc_contig_free,   NULL,                     NULL },
+    { "log_printf",                bench_log_printf,                NULL,                     NULL },
+    { "sync_ticket_lock",          bench_ticket_lock,               NULL,                     NULL },
+};
+
+/**
+ * @brief Time one run of a benchmark.
+ *
+ * @param bench The benchmark.
+ * @param iters Number of iterations.
+ * @return Elapsed nanoseconds.
+ */
+static uint64_t bench_time(const bench_t* bench, uint64_t iters)
+{
+    uint64_t start = 0; /* Counter before the run */
+    uint64_t end   = 0; /* Counter after the run */
+
+    if (NULL != bench->setup)
+    {
+        bench->setup();
+    }
+
+    start = host_counter_read();
+    bench->fn(iters);
+    end = host_counter_read();
+
+    if (NULL != bench->teardown)
+    {
+        bench->teardown();
+    }
+
+    return end - start;
+}
+
+/**
+ * @brief Parse the options and run the selected benchmarks.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments.
+ * @return 0 on success.
+ */
+int main(int argc, char** argv)
+{
+    const char*   filter   = "";           /* Name substring to run */
+    double        min_time = 0.5;          /* Seconds a run must last */
+    frame_stats_t stats    = { 0 };        /* Leak check */
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strncmp(argv[i], "--benchmark_filter=", 19))
+        {
+            filter = argv[i] + 19;
+        }
+        else if (0 == strncmp(argv[i], "--benchmark_min_time=", 21))
+        {
+            min_time = strtod(argv[i] + 21, NULL);
+        }
+        else if (0 == strcmp(argv[i], "--quick"))
+        {
+            min_time = 0.001;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--benchmark_filter=<substring>] [--benchmark_min_time=<seconds>] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    host_frame_pool(BENCH_POOL_FRAMES);
+    host_console_mode(0, 1);
+    log_init(LOG_SINK_SEMIHOSTING);
+
+    printf("%-32s %14s %14s\n", "Benchmark", "Time", "Iterations");
+    printf("------------------------------------------------------------------\n");
+
+    for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); ++b)
+    {
+        uint64_t iters = 1;                                   /* Iterations of the current run */
+        uint64_t next  = 0;                                   /* Iterations of the next run */
+        uint64_t ns    = 0;                                   /* Duration of the current run */
+        uint64_t goal  = (uint64_t)(min_time * 1000000000.0); /* Minimum duration in ns */
+
+        if (NULL == strstr(benches[b].name, filter))
+        {
+            continue;
+        }
+
+        for (;;)
+        {
+            ns = bench_time(&benches[b], iters);
+            if ((ns >= goal) || (iters >= BENCH_MAX_ITERS))
+            {
+                break;
+            }
+
+            /* Aim 40% past the goal, grow by at most 10x per step */
+            next = (0 == ns) ? iters * 10 : (uint64_t)((double)iters * 1.4 * (double)goal / (double)ns) + 1;
+            iters = (next > iters * 10) ? iters * 10 : next;
+            if (iters > BENCH_MAX_ITERS)
+            {
+                iters = BENCH_MAX_ITERS;
+            }
+        }
+
+        printf("%-32s %11.1f ns %14llu\n", benches[b].name, (double)ns / (double)iters, (unsigned long long)iters);
+    }
+
+    frame_get_stats(&stats);
+    if (stats.free != stats.total)
+    {
+        fprintf(stderr, "leaked %llu frames\n", (unsigned long long)(stats.total - stats.free));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file fuzz.h
+ * @brief Input decoding shared by the fuzz targets.
+ *
+ * This file contains a small reader that turns the fuzzer's bytes into
+ * operations and a check macro that aborts with the failing condition.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Reading past the end of the input yields zeros, so every input decodes
+ * to a complete sequence of operations and the fuzzer never has to learn
+ * the format's length rules.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Fuzz input reader and check macro.
+ */
+
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief Abort with the location if a condition does not hold.
+ */
+#define FUZZ_CHECK(cond)                                                             \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                                 \
+        }                                                                            \
+    } while (0)
+
+/**
+ * @brief Cursor over a fuzz input.
+ */
+typedef struct fuzz_input
+{
+    const uint8_t* data; /**< input bytes */
+    size_t         size; /**< input length */
+    size_t         pos;  /**< bytes consumed */
+} fuzz_input_t;
+
+/**
+ * @brief Check whether input remains.
+ *
+ * @param in The input.
+ * @return Non-zero if unread bytes remain.
+ */
+static inline int fuzz_more(const fuzz_input_t* in)
+{
+    return in->pos < in->size;
+}
+
+/**
+ * @brief Consume one byte.
+ *
+ * @param in The input.
+ * @return The byte, 0 past the end.
+ */
+static inline uint8_t fuzz_u8(fuzz_input_t* in)
+{
+    return (in->pos < in->size) ? in->data[in->pos++] : 0;
+}
+
+/**
+ * @brief Consume a little endian 16-bit value.
+ *
+ * @param in The input.
+ * @return The value.
+ */
+static inline uint16_t fuzz_u16(fuzz_input_t* in)
+{
+    uint16_t lo = fuzz_u8(in); /* Low byte */
+
+    return (uint16_t)(lo | ((uint16_t)fuzz_u8(in) << 8));
+}
+
+#endif // FUZZ_H
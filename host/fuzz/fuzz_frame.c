@@ -0,0 +1,256 @@
+/**
+ * @file fuzz_frame.c
+ * @brief Fuzz target for the frame allocator.
+ *
+ * This file contains a target that applies random allocation, free and
+ * pre-zeroing sequences to a small frame pool and checks ownership, zero
+ * fill and the free counters after every operation.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Every allocated frame is filled with a pattern, so a zeroed allocation
+ * that hands out a dirty frame is caught. Each frame of the pool has an
+ * owner in the model, an allocation that returns a frame which is already
+ * owned, or lies outside the pool, fails the run. Aligned runs must also
+ * start on a multiple of their size.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Frame allocator fuzz target.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "frame.h"
+#include "fuzz.h"
+#include "host.h"
+
+#define FUZZ_FRAME_POOL   (96U)  /**< Frames in the pool, more than the zeroed stack holds */
+#define FUZZ_FRAME_CONTIG (16U)  /**< Largest contiguous allocation */
+#define FUZZ_FRAME_OPS    (512U) /**< Operations per input */
+#define FUZZ_FRAME_DIRTY  (0xA5) /**< Fill pattern of allocated frames */
+
+/**
+ * @brief An allocation held by the target.
+ */
+typedef struct fuzz_block
+{
+    uint64_t pa;    /**< first frame */
+    uint64_t count; /**< frames */
+} fuzz_block_t;
+
+static uint64_t     fuzz_pool = 0x0ULL;                 /* Pool address */
+static uint32_t     fuzz_owner[FUZZ_FRAME_POOL];        /* Block index + 1 of every frame, 0 if free */
+static fuzz_block_t fuzz_blocks[FUZZ_FRAME_POOL];       /* Held allocations */
+static uint32_t     fuzz_num    = 0;                    /* Entries in fuzz_blocks */
+static uint64_t     fuzz_held   = 0;                    /* Frames held */
+
+/**
+ * @brief Record and check a new allocation.
+ *
+ * @param pa First frame, 0 if the allocation failed.
+ * @param count Frames requested.
+ * @param zeroed Non-zero if the frames must read as zero.
+ * @param contig Non-zero for frame_alloc_contig(), which may fail on a
+ *               fragmented pool and does not take pre-zeroed frames.
+ */
+static void fuzz_take(uint64_t pa, uint64_t count, int zeroed, int contig)
+{
+    uint64_t first = 0; /* Index of the first frame */
+
+    if (0x0ULL == pa)
+    {
+        /* Single frames are only refused when the pool is exhausted */
+        FUZZ_CHECK(contig || (fuzz_held == FUZZ_FRAME_POOL));
+        return;
+    }
+
+    FUZZ_CHECK(0x0ULL == (pa & ~FRAME_MASK));
+    FUZZ_CHECK(pa >= fuzz_pool);
+
+    first = (pa - fuzz_pool) >> FRAME_SHIFT;
+    FUZZ_CHECK(first + count <= FUZZ_FRAME_POOL);
+
+    for (uint64_t i = first; i < first + count; ++i)
+    {
+        FUZZ_CHECK(0 == fuzz_owner[i]);
+        fuzz_owner[i] = fuzz_num + 1;
+    }
+
+    if (zeroed)
+    {
+        const uint8_t* bytes = (const uint8_t*)(uintptr_t)pa; /* Frame contents */
+
+        for (uint64_t i = 0; i < FRAME_SIZE; ++i)
+        {
+            FUZZ_CHECK(0 == bytes[i]);
+        }
+    }
+
+    memset((void*)(uintptr_t)pa, FUZZ_FRAME_DIRTY, count * FRAME_SIZE);
+
+    fuzz_blocks[fuzz_num].pa    = pa;
+    fuzz_blocks[fuzz_num].count = count;
+    fuzz_num++;
+    fuzz_held += count;
+}
+
+/**
+ * @brief Free a held allocation.
+ *
+ * @param idx Index into fuzz_blocks.
+ */
+static void fuzz_release(uint32_t idx)
+{
+    fuzz_block_t block = fuzz_blocks[idx];                   /* Allocation being freed */
+    uint64_t     first = (block.pa - fuzz_pool) >> FRAME_SHIFT; /* Index of its first frame */
+
+    if (1 == block.count)
+    {
+        frame_free(block.pa);
+    }
+    else
+    {
+        frame_free_contig(block.pa, block.count);
+    }
+
+    for (uint64_t i = first; i < first + block.count; ++i)
+    {
+        fuzz_owner[i] = 0;
+    }
+
+    /* The last block takes the freed slot */
+    fuzz_num--;
+    fuzz_held -= block.count;
+    if (idx != fuzz_num)
+    {
+        uint64_t moved = (fuzz_blocks[fuzz_num].pa - fuzz_pool) >> FRAME_SHIFT; /* First frame of the moved block */
+
+        fuzz_blocks[idx] = fuzz_blocks[fuzz_num];
+        for (uint64_t i = moved; i < moved + fuzz_blocks[idx].count; ++i)
+        {
+            fuzz_owner[i] = idx + 1;
+        }
+    }
+}
+
+/**
+ * @brief Check the allocator's counters against the model.
+ */
+static void fuzz_check_stats(void)
+{
+    frame_stats_t stats = { 0 }; /* Allocator counters */
+
+    frame_get_stats(&stats);
+
+    FUZZ_CHECK(stats.total == FUZZ_FRAME_POOL);
+    FUZZ_CHECK(stats.free == FUZZ_FRAME_POOL - fuzz_held);
+    FUZZ_CHECK(stats.zeroed <= stats.free);
+    FUZZ_CHECK(stats.zeroed <= FRAME_ZEROED_MAX);
+    FUZZ_CHECK(stats.prezeroed >= stats.zeroed_hits);
+    FUZZ_CHECK(stats.refills <= stats.prezeroed);
+}
+
+/**
+ * @brief Run one input.
+ *
+ * @param data Input bytes.
+ * @param size Input length.
+ * @return 0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    fuzz_input_t in = { data, size, 0 }; /* Input cursor */
+
+    if (0x0ULL == fuzz_pool)
+    {
+        fuzz_pool = host_frame_pool(FUZZ_FRAME_POOL);
+    }
+
+    frame_init(fuzz_pool, FUZZ_FRAME_POOL * FRAME_SIZE);
+    memset(fuzz_owner, 0, sizeof(fuzz_owner));
+    fuzz_num  = 0;
+    fuzz_held = 0;
+
+    for (uint32_t op = 0; (op < FUZZ_FRAME_OPS) && fuzz_more(&in); ++op)
+    {
+        uint8_t  code = fuzz_u8(&in); /* Operation */
+        uint8_t  arg  = fuzz_u8(&in); /* Operand */
+        uint64_t count = 1U + (arg % FUZZ_FRAME_CONTIG); /* Frames for a contiguous allocation */
+
+        switch (code % 6U)
+        {
+            case 0:
+                fuzz_take(frame_alloc(), 1, 0, 0);
+                break;
+            case 1:
+                fuzz_take(frame_alloc_zeroed(), 1, 1, 0);
+                break;
+            case 2:
+                if (arg & 0x80U)
+                {
+                    uint64_t pa = 0x0ULL; /* Aligned run */
+
+                    count = 1ULL << (arg % 5U);
+                    pa    = frame_alloc_aligned(count);
+                    FUZZ_CHECK(0x0ULL == (pa & ((count * FRAME_SIZE) - 1ULL)));
+                    fuzz_take(pa, count, 0, 1);
+                    break;
+                }
+                fuzz_take(frame_alloc_contig(count), count, 0, 1);
+                break;
+            case 3:
+            case 4:
+                if (0 != fuzz_num)
+                {
+                    fuzz_release(arg % fuzz_num);
+                }
+                break;
+            default:
+                if (arg & 0x80U)
+                {
+                    (void)frame_refill(arg % 8U);
+                    break;
+                }
+                FUZZ_CHECK(frame_prezero(arg % 8U) <= (arg % 8U));
+                break;
+        }
+
+        fuzz_check_stats();
+    }
+
+    while (0 != fuzz_num)
+    {
+        fuzz_release(fuzz_num - 1);
+    }
+    fuzz_check_stats();
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file fuzz_log.c
+ * @brief Fuzz target for the logger and its sink buffer.
+ *
+ * This file contains a target that interleaves raw writes, formatted
+ * messages and flushes on the semihosting sink and checks that the host
+ * receives exactly the expected byte stream.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Writes are cut from the input at random lengths, up to twice the sink
+ * buffer, so chunks fill, straddle and overflow it. Formatted messages
+ * carry input bytes as a string argument and must come out with their
+ * level prefix, truncated to the Tx buffer. The host may lag behind the
+ * expected stream by less than one sink buffer, except right after a
+ * flush or a message at LOG_ERR and above, where it must be level.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Logger fuzz target.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project includes */
+#include "fuzz.h"
+#include "host.h"
+#include "logging.h"
+
+#define FUZZ_LOG_MSG_MAX (255U)  /**< Longest message log_printf() emits */
+#define FUZZ_LOG_OPS     (128U)  /**< Operations per input */
+
+static char*  fuzz_expect     = NULL;              /* Bytes the host should receive */
+static size_t fuzz_expect_len = 0;                 /* Bytes in fuzz_expect */
+static size_t fuzz_expect_cap = 0;                 /* Size of fuzz_expect */
+static char   fuzz_prefix[LOG_LVL_NUM][16];        /* Level prefixes as emitted */
+static size_t fuzz_prefix_len[LOG_LVL_NUM];        /* Lengths of fuzz_prefix */
+
+/**
+ * @brief Append to the expected stream.
+ *
+ * @param data The bytes.
+ * @param len Number of bytes.
+ */
+static void fuzz_expect_add(const char* data, size_t len)
+{
+    if (fuzz_expect_len + len > fuzz_expect_cap)
+    {
+        fuzz_expect_cap = 2 * (fuzz_expect_len + len);
+        fuzz_expect     = realloc(fuzz_expect, fuzz_expect_cap);
+        FUZZ_CHECK(NULL != fuzz_expect);
+    }
+
+    memcpy(fuzz_expect + fuzz_expect_len, data, len);
+    fuzz_expect_len += len;
+}
+
+/**
+ * @brief Check the host output against the expected stream.
+ *
+ * @param level Non-zero if nothing may be left in the sink buffer.
+ */
+static void fuzz_check_output(int level)
+{
+    size_t      len = 0;                          /* Bytes the host received */
+    const char* out = host_console_captured(&len); /* Host output */
+
+    FUZZ_CHECK(len <= fuzz_expect_len);
+    FUZZ_CHECK(fuzz_expect_len - len < (level ? 1U : LOG_SINK_BUFFER_SIZE));
+    FUZZ_CHECK((0 == len) || (0 == memcmp(out, fuzz_expect, len)));
+}
+
+/**
+ * @brief Learn the prefix of every level by logging empty messages.
+ */
+static void fuzz_learn_prefixes(void)
+{
+    for (int level = 0; level < LOG_LVL_NUM; ++level)
+    {
+        size_t      len = 0;    /* Bytes emitted */
+        const char* out = NULL; /* Emitted prefix */
+
+        host_console_clear();
+        log_printf((log_level_t)level, "%s", "");
+        log_flush();
+
+        out = host_console_captured(&len);
+        FUZZ_CHECK(len < sizeof(fuzz_prefix[level]));
+        memcpy(fuzz_prefix[level], out, len);
+        fuzz_prefix_len[level] = len;
+    }
+}
+
+/**
+ * @brief Run one input.
+ *
+ * @param data Input bytes.
+ * @param size Input length.
+ * @return 0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static int   ready = 0;                  /* Logger set up */
+    fuzz_input_t in    = { data, size, 0 };  /* Input cursor */
+
+    if (!ready)
+    {
+        host_console_mode(1, 1);
+        log_init(LOG_SINK_SEMIHOSTING);
+        FUZZ_CHECK(LOG_SINK_SEMIHOSTING == log_get_sink());
+        fuzz_learn_prefixes();
+        ready = 1;
+    }
+
+    log_flush();
+    host_console_clear();
+    fuzz_expect_len = 0;
+
+    for (uint32_t op = 0; (op < FUZZ_LOG_OPS) && fuzz_more(&in); ++op)
+    {
+        uint8_t     code  = fuzz_u8(&in);                          /* Operation */
+        size_t      len   = fuzz_u16(&in) % (2U * LOG_SINK_BUFFER_SIZE); /* Chunk length */
+        const char* chunk = (const char*)in.data + in.pos;         /* Chunk bytes */
+        int         level = 0;                                     /* Output must be level */
+
+        if (len > in.size - in.pos)
+        {
+            len = in.size - in.pos;
+        }
+        in.pos += len;
+
+        switch (code % 4U)
+        {
+            case 0:
+            case 1:
+                log_write(chunk, len);
+                fuzz_expect_add(chunk, len);
+                break;
+            case 2:
+            {
+                log_level_t lvl = (log_level_t)((code >> 2) % LOG_LVL_NUM); /* Message level */
+                char*       msg = malloc(len + 1);                         /* Chunk as a string */
+                size_t      n   = 0;                                       /* Bytes expected */
+
+                FUZZ_CHECK(NULL != msg);
+                memcpy(msg, chunk, len);
+                msg[len] = '\0';
+
+                log_printf(lvl, "%s", msg);
+
+                fuzz_expect_add(fuzz_prefix[lvl], fuzz_prefix_len[lvl]);
+                n = strlen(msg);
+                if (fuzz_prefix_len[lvl] + n > FUZZ_LOG_MSG_MAX)
+                {
+                    n = FUZZ_LOG_MSG_MAX - fuzz_prefix_len[lvl];
+                }
+                fuzz_expect_add(msg, n);
+                free(msg);
+
+                level = (lvl <= LOG_ERR);
+                break;
+            }
+            default:
+                log_flush();
+                level = 1;
+                break;
+        }
+
+        fuzz_check_output(level);
+    }
+
+    log_flush();
+    fuzz_check_output(1);
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file fuzz_main.c
+ * @brief Standalone driver for the fuzz targets.
+ *
+ * This file contains a main() that feeds LLVMFuzzerTestOneInput() when
+ * the fuzzers are not linked against libFuzzer.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Understands the libFuzzer options used by the tests and the README:
+ * files given on the command line are replayed once each, otherwise
+ * -runs random inputs of up to -max_len bytes are generated from -seed.
+ * There is no coverage feedback, build with HL_HOST_LIBFUZZER=ON and clang
+ * for guided fuzzing; crash inputs it finds replay here unchanged.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the standalone fuzz driver.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#define FUZZ_MAX_LEN_DFLT (4096U)   /**< Default largest generated input */
+#define FUZZ_RUNS_DFLT    (100000U) /**< Default number of generated inputs */
+
+/**
+ * @brief Advance a xorshift64* generator.
+ *
+ * @param state Generator state, never 0.
+ * @return The next pseudo-random value.
+ */
+static uint64_t fuzz_rand(uint64_t* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Run one input read from a file.
+ *
+ * @param path The file.
+ * @return 0 on success, 1 if the file cannot be read.
+ */
+static int fuzz_replay(const char* path)
+{
+    FILE*    file = fopen(path, "rb"); /* Input file */
+    uint8_t* data = NULL;              /* File contents */
+    long     size = 0;                 /* File size */
+
+    if (NULL == file)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    data = malloc((size > 0) ? (size_t)size : 1);
+    if ((NULL == data) || (fread(data, 1, (size_t)size, file) != (size_t)size))
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        fclose(file);
+        free(data);
+        return 1;
+    }
+    fclose(file);
+
+    printf("replaying %s (%ld bytes)\n", path, size);
+    LLVMFuzzerTestOneInput(data, (size_t)size);
+
+    free(data);
+
+    return 0;
+}
+
+/**
+ * @brief Parse the options and run the target.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments.
+ * @return 0 on success.
+ */
+int main(int argc, char** argv)
+{
+    uint64_t runs    = FUZZ_RUNS_DFLT;    /* Inputs to generate */
+    uint64_t seed    = 1;                 /* Generator seed */
+    size_t   max_len = FUZZ_MAX_LEN_DFLT; /* Largest generated input */
+    int      files   = 0;                 /* Inputs replayed from files */
+    int      rc      = 0;                 /* Exit code */
+    uint8_t* data    = NULL;              /* Generated input */
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strncmp(argv[i], "-runs=", 6))
+        {
+            runs = strtoull(argv[i] + 6, NULL, 0);
+        }
+        else if (0 == strncmp(argv[i], "-seed=", 6))
+        {
+            seed = strtoull(argv[i] + 6, NULL, 0);
+        }
+        else if (0 == strncmp(argv[i], "-max_len=", 9))
+        {
+            max_len = strtoull(argv[i] + 9, NULL, 0);
+        }
+        else if ('-' == argv[i][0])
+        {
+            fprintf(stderr, "ignoring option %s\n", argv[i]);
+        }
+        else
+        {
+            rc |= fuzz_replay(argv[i]);
+            files++;
+        }
+    }
+
+    if (0 != files)
+    {
+        return rc;
+    }
+
+    if (0 == seed)
+    {
+        seed = 1;
+    }
+
+    data = malloc((0 != max_len) ? max_len : 1);
+    if (NULL == data)
+    {
+        return 1;
+    }
+
+    for (uint64_t run = 0; run < runs; ++run)
+    {
+        size_t len = (0 != max_len) ? (size_t)(fuzz_rand(&seed) % (max_len + 1)) : 0; /* Input length */
+
+        for (size_t i = 0; i < len; ++i)
+        {
+            data[i] = (uint8_t)fuzz_rand(&seed);
+        }
+
+        LLVMFuzzerTestOneInput(data, len);
+    }
+
+    printf("done %llu runs\n", (unsigned long long)runs);
+    free(data);
+
+    return 0;
+}
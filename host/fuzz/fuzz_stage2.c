@@ -0,0 +1,460 @@
+/**
+ * @file fuzz_stage2.c
+ * @brief Fuzz target for the stage-2 table builder.
+ *
+ * This file contains a target that applies random map, unmap, protect,
+ * split and promote sequences to a stage-2 regime and checks every result against a page
+ * granular model.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Operations stay within a 16MB IPA window that straddles a 1GB boundary,
+ * so 2MB blocks, level 3 tables and both level 2 tables are exercised.
+ * Two 16-bit values pick each range, a flag in the first one aligns it to
+ * 2MB so that block mappings are likely. The model only has to know what
+ * each call may change, not how the tables are laid out:
+ *
+ * - a successful map translates the whole range linearly, a failed one
+ *   leaves mapped pages alone and may have mapped a prefix of the rest;
+ * - a successful unmap clears the range, a failed one (split block) may
+ *   have cleared a prefix;
+ * - protect updates every page of the range and at most the rest of the
+ *   blocks they belong to;
+ * - split and promote change the layout only, every page keeps its
+ *   translation, and the census of the affected range must show the
+ *   leaf sizes they report.
+ *
+ * After the sequence the leaves of the whole IPA space are walked and the
+ * regime is destroyed, which must return every table to the frame pool.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Stage-2 fuzz target.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "frame.h"
+#include "fuzz.h"
+#include "host.h"
+#include "stage2.h"
+
+#define FUZZ_S2_BASE   (0x3F800000ULL)                 /**< Window start, 8MB below 1GB */
+#define FUZZ_S2_PAGES  (4096U)                         /**< Window size in pages (16MB) */
+#define FUZZ_S2_PA     (0x100000000ULL)                /**< Output addresses start here */
+#define FUZZ_S2_FRAMES (64U)                           /**< Table frames, enough for the window */
+#define FUZZ_S2_OPS    (256U)                          /**< Operations per input */
+#define FUZZ_S2_BLOCK  (STAGE2_BLOCK_2M / STAGE2_PAGE_SIZE) /**< Pages per 2MB block */
+
+/**
+ * @brief Model of one page of the window.
+ */
+typedef struct fuzz_page
+{
+    uint64_t pa;   /**< output address, 0 if unmapped */
+    uint64_t attr; /**< descriptor attributes */
+} fuzz_page_t;
+
+static fuzz_page_t fuzz_model[FUZZ_S2_PAGES]; /* Expected translation of every page */
+
+/* Attribute sets a mapping is created with */
+static const uint64_t fuzz_attrs[] = {
+    STAGE2_MEM_NORMAL,
+    STAGE2_MEM_NORMAL & ~S2_PTE_S2AP_W,
+    STAGE2_MEM_DEVICE,
+    STAGE2_MEM_NORMAL | S2_PTE_XN,
+};
+
+/* Bits protect may clear or set, all keep the descriptor valid */
+static const uint64_t fuzz_protect_bits[] = {
+    S2_PTE_S2AP_W,
+    S2_PTE_XN,
+    S2_PTE_S2AP_W | S2_PTE_XN,
+};
+
+/**
+ * @brief Get the IPA of a window page.
+ *
+ * @param page Page index.
+ * @return The IPA.
+ */
+static uint64_t fuzz_ipa(uint32_t page)
+{
+    return FUZZ_S2_BASE + ((uint64_t)page * STAGE2_PAGE_SIZE);
+}
+
+/**
+ * @brief Read a page range from the input.
+ *
+ * @param in The input.
+ * @param first Receives the first page.
+ * @param count Receives the number of pages, at least 1.
+ * @param aligned Receives non-zero if the range was aligned to 2MB.
+ */
+static void fuzz_range(fuzz_input_t* in, uint32_t* first, uint32_t* count, int* aligned)
+{
+    uint16_t where = fuzz_u16(in); /* Start and alignment */
+    uint16_t len   = fuzz_u16(in); /* Length */
+
+    *aligned = where & 1U;
+    *first   = (where >> 1) % FUZZ_S2_PAGES;
+    *count   = 1U + (len % FUZZ_S2_BLOCK);
+
+    if (*aligned)
+    {
+        *first &= ~(FUZZ_S2_BLOCK - 1U);
+        *count = FUZZ_S2_BLOCK * (1U + (len % 3U));
+    }
+    if (*first + *count > FUZZ_S2_PAGES)
+    {
+        *count = FUZZ_S2_PAGES - *first;
+    }
+}
+
+/**
+ * @brief Check that the regime and the model agree on one page.
+ *
+ * @param s2 The regime.
+ * @param page Page index.
+ */
+static void fuzz_check_page(const stage2_t* s2, uint32_t page)
+{
+    uint64_t pa   = 0x0ULL; /* Translated address */
+    uint64_t attr = 0x0ULL; /* Translated attributes */
+
+    if (0x0ULL == fuzz_model[page].pa)
+    {
+        FUZZ_CHECK(STATUS_ERR_NOT_FOUND == stage2_lookup(s2, fuzz_ipa(page), &pa, &attr));
+        return;
+    }
+
+    FUZZ_CHECK(STATUS_OK == stage2_lookup(s2, fuzz_ipa(page), &pa, &attr));
+    FUZZ_CHECK(pa == fuzz_model[page].pa);
+    FUZZ_CHECK(attr == fuzz_model[page].attr);
+}
+
+/**
+ * @brief Map a range and check the outcome.
+ *
+ * @param s2 The regime.
+ * @param in The input.
+ */
+static void fuzz_op_map(stage2_t* s2, fuzz_input_t* in)
+{
+    uint32_t first   = 0;                                                          /* First page */
+    uint32_t count   = 0;                                                          /* Pages */
+    int      aligned = 0;                                                          /* 2MB aligned range */
+    uint64_t attr    = fuzz_attrs[fuzz_u8(in) % (sizeof(fuzz_attrs) / sizeof(fuzz_attrs[0]))]; /* Attributes */
+    uint64_t pa      = 0x0ULL;                                                     /* Output address */
+    status_t status  = STATUS_OK;                                                  /* Result */
+
+    fuzz_range(in, &first, &count, &aligned);
+
+    pa = FUZZ_S2_PA + ((uint64_t)fuzz_u16(in) * STAGE2_PAGE_SIZE);
+    if (aligned)
+    {
+        pa &= ~(STAGE2_BLOCK_2M - 1ULL);
+    }
+
+    status = stage2_map(s2, fuzz_ipa(first), pa, (uint64_t)count * STAGE2_PAGE_SIZE, attr);
+    FUZZ_CHECK((STATUS_OK == status) || (STATUS_ERR_EXISTS == status));
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t page   = first + i;                                 /* Page being checked */
+        uint64_t expect = pa + ((uint64_t)i * STAGE2_PAGE_SIZE);     /* Linear translation */
+        uint64_t got    = 0x0ULL;                                    /* Translated address */
+        uint64_t got_at = 0x0ULL;                                    /* Translated attributes */
+
+        if (0x0ULL != fuzz_model[page].pa)
+        {
+            /* Mapped before, any map of it must have failed */
+            FUZZ_CHECK(STATUS_OK != status);
+        }
+        else if (STATUS_OK == stage2_lookup(s2, fuzz_ipa(page), &got, &got_at))
+        {
+            FUZZ_CHECK(got == expect);
+            FUZZ_CHECK(got_at == attr);
+            fuzz_model[page].pa   = got;
+            fuzz_model[page].attr = got_at;
+        }
+        else
+        {
+            FUZZ_CHECK(STATUS_OK != status);
+        }
+
+        fuzz_check_page(s2, page);
+    }
+}
+
+/**
+ * @brief Unmap a range and check the outcome.
+ *
+ * @param s2 The regime.
+ * @param in The input.
+ */
+static void fuzz_op_unmap(stage2_t* s2, fuzz_input_t* in)
+{
+    uint32_t first   = 0;         /* First page */
+    uint32_t count   = 0;         /* Pages */
+    int      aligned = 0;         /* 2MB aligned range */
+    status_t status  = STATUS_OK; /* Result */
+
+    fuzz_range(in, &first, &count, &aligned);
+
+    status = stage2_unmap(s2, fuzz_ipa(first), (uint64_t)count * STAGE2_PAGE_SIZE);
+    FUZZ_CHECK((STATUS_OK == status) || (STATUS_ERR_NOT_SUPPORTED == status));
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t page = first + i; /* Page being checked */
+
+        if ((STATUS_OK == status) ||
+            (STATUS_ERR_NOT_FOUND == stage2_lookup(s2, fuzz_ipa(page), NULL, NULL)))
+        {
+            fuzz_model[page].pa = 0x0ULL;
+        }
+
+        fuzz_check_page(s2, page);
+    }
+}
+
+/**
+ * @brief Change attributes of a range and check the outcome.
+ *
+ * @param s2 The regime.
+ * @param in The input.
+ */
+static void fuzz_op_protect(stage2_t* s2, fuzz_input_t* in)
+{
+    uint32_t first   = 0;                                                 /* First page */
+    uint32_t count   = 0;                                                 /* Pages */
+    int      aligned = 0;                                                 /* 2MB aligned range */
+    uint8_t  sel     = fuzz_u8(in);                                       /* Masks to use */
+    uint64_t bits    = fuzz_protect_bits[sel % 3U];                       /* Bits to change */
+    uint64_t clear   = (sel & 0x10U) ? bits : 0x0ULL;                     /* Bits to clear */
+    uint64_t set     = (sel & 0x10U) ? 0x0ULL : bits;                     /* Bits to set */
+    uint32_t mapped  = 0;                                                 /* Mapped pages in the range */
+    uint64_t leaves  = 0;                                                 /* Leaves updated */
+    uint32_t start   = 0;                                                 /* First page that may change */
+    uint32_t end     = 0;                                                 /* Page after the last that may */
+
+    fuzz_range(in, &first, &count, &aligned);
+
+    leaves = stage2_protect(s2, fuzz_ipa(first), (uint64_t)count * STAGE2_PAGE_SIZE, clear, set);
+
+    /* Blocks in the window are 2MB at most, nothing beyond those touched can change */
+    start = first & ~(FUZZ_S2_BLOCK - 1U);
+    end   = (first + count + FUZZ_S2_BLOCK - 1U) & ~(FUZZ_S2_BLOCK - 1U);
+
+    for (uint32_t page = start; page < end; ++page)
+    {
+        uint64_t updated = (fuzz_model[page].attr & ~clear) | set; /* Attributes after protect */
+        uint64_t attr    = 0x0ULL;                                 /* Translated attributes */
+
+        if (0x0ULL == fuzz_model[page].pa)
+        {
+            continue;
+        }
+
+        if ((page >= first) && (page < first + count))
+        {
+            fuzz_model[page].attr = updated;
+            mapped++;
+        }
+        else
+        {
+            /* Pages sharing a block with the range change with it */
+            FUZZ_CHECK(STATUS_OK == stage2_lookup(s2, fuzz_ipa(page), NULL, &attr));
+            FUZZ_CHECK((attr == fuzz_model[page].attr) || (attr == updated));
+            fuzz_model[page].attr = attr;
+        }
+
+        fuzz_check_page(s2, page);
+    }
+
+    FUZZ_CHECK((0 == mapped) == (0 == leaves));
+    FUZZ_CHECK(leaves <= mapped);
+}
+
+/**
+ * @brief Split the block mapping a page and check the outcome.
+ *
+ * @param s2 The regime.
+ * @param in The input.
+ */
+static void fuzz_op_split(stage2_t* s2, fuzz_input_t* in)
+{
+    uint32_t        first   = 0;         /* Page to split at */
+    uint32_t        count   = 0;         /* Unused */
+    int             aligned = 0;         /* Unused */
+    uint32_t        start   = 0;         /* First page of its 2MB region */
+    stage2_census_t census  = { 0 };     /* Leaves of the page */
+    status_t        status  = STATUS_OK; /* Result */
+
+    fuzz_range(in, &first, &count, &aligned);
+    start = first & ~(FUZZ_S2_BLOCK - 1U);
+
+    status = stage2_split(s2, fuzz_ipa(first));
+    FUZZ_CHECK((STATUS_OK == status) || (STATUS_ERR_EXISTS == status) || (STATUS_ERR_NOT_FOUND == status));
+    FUZZ_CHECK((STATUS_ERR_NOT_FOUND == status) == (0x0ULL == fuzz_model[first].pa));
+
+    if (STATUS_ERR_NOT_FOUND != status)
+    {
+        stage2_census(s2, fuzz_ipa(first), STAGE2_PAGE_SIZE, &census);
+        FUZZ_CHECK((1 == census.pages) && (0 == census.blocks_2m));
+    }
+
+    for (uint32_t page = start; page < start + FUZZ_S2_BLOCK; ++page)
+    {
+        fuzz_check_page(s2, page);
+    }
+}
+
+/**
+ * @brief Fold a 2MB region into a block and check the outcome.
+ *
+ * @param s2 The regime.
+ * @param in The input.
+ */
+static void fuzz_op_promote(stage2_t* s2, fuzz_input_t* in)
+{
+    uint32_t        first   = 0;         /* Page in the region */
+    uint32_t        count   = 0;         /* Unused */
+    int             aligned = 0;         /* Unused */
+    uint32_t        start   = 0;         /* First page of the region */
+    stage2_census_t census  = { 0 };     /* Leaves of the region */
+    status_t        status  = STATUS_OK; /* Result */
+
+    fuzz_range(in, &first, &count, &aligned);
+    start = first & ~(FUZZ_S2_BLOCK - 1U);
+
+    status = stage2_promote(s2, fuzz_ipa(start), STAGE2_BLOCK_2M);
+    FUZZ_CHECK((STATUS_OK == status) || (STATUS_ERR_EXISTS == status) ||
+               (STATUS_ERR_NOT_FOUND == status) || (STATUS_ERR_NOT_SUPPORTED == status));
+
+    stage2_census(s2, fuzz_ipa(start), STAGE2_BLOCK_2M, &census);
+    if ((STATUS_OK == status) || (STATUS_ERR_EXISTS == status))
+    {
+        FUZZ_CHECK((1 == census.blocks_2m) && (0 == census.pages));
+    }
+    else
+    {
+        FUZZ_CHECK(0 == census.blocks_2m);
+    }
+
+    for (uint32_t page = start; page < start + FUZZ_S2_BLOCK; ++page)
+    {
+        fuzz_check_page(s2, page);
+    }
+}
+
+/**
+ * @brief Leaf callback that accounts the mapped bytes.
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor.
+ * @param arg Running byte count.
+ */
+static void fuzz_count_leaf(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg)
+{
+    (void)pte;
+
+    FUZZ_CHECK(ipa >= FUZZ_S2_BASE);
+    FUZZ_CHECK(ipa + size <= fuzz_ipa(FUZZ_S2_PAGES));
+
+    *(uint64_t*)arg += size;
+}
+
+/**
+ * @brief Run one input.
+ *
+ * @param data Input bytes.
+ * @param size Input length.
+ * @return 0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static int   ready    = 0;                         /* Frame pool allocated */
+    fuzz_input_t in       = { data, size, 0 };         /* Input cursor */
+    stage2_t     s2       = { 0 };                     /* Regime under test */
+    frame_stats_t stats   = { 0 };                     /* Pool counters */
+    uint64_t     mapped   = 0x0ULL;                    /* Bytes the leaves map */
+    uint64_t     expected = 0x0ULL;                    /* Bytes the model maps */
+
+    if (!ready)
+    {
+        host_frame_pool(FUZZ_S2_FRAMES);
+        ready = 1;
+    }
+
+    memset(fuzz_model, 0, sizeof(fuzz_model));
+    FUZZ_CHECK(STATUS_OK == stage2_init(&s2, 1));
+
+    for (uint32_t op = 0; (op < FUZZ_S2_OPS) && fuzz_more(&in); ++op)
+    {
+        switch (fuzz_u8(&in) % 6U)
+        {
+            case 0:
+            case 1:
+                fuzz_op_map(&s2, &in);
+                break;
+            case 2:
+                fuzz_op_unmap(&s2, &in);
+                break;
+            case 3:
+                fuzz_op_split(&s2, &in);
+                break;
+            case 4:
+                fuzz_op_promote(&s2, &in);
+                break;
+            default:
+                fuzz_op_protect(&s2, &in);
+                break;
+        }
+    }
+
+    for (uint32_t page = 0; page < FUZZ_S2_PAGES; ++page)
+    {
+        fuzz_check_page(&s2, page);
+        expected += (0x0ULL != fuzz_model[page].pa) ? STAGE2_PAGE_SIZE : 0x0ULL;
+    }
+
+    stage2_for_each_leaf(&s2, 0x0ULL, 1ULL << STAGE2_IPA_BITS, fuzz_count_leaf, &mapped);
+    FUZZ_CHECK(mapped == expected);
+
+    stage2_destroy(&s2);
+
+    frame_get_stats(&stats);
+    FUZZ_CHECK(stats.free == stats.total);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file host.h
+ * @brief Stand-ins for the hardware in native builds.
+ *
+ * This file contains the function prototypes the fuzzers and benchmarks
+ * use to control the emulated system registers and console.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A native build (HL_HOST_BUILD) compiles the MMU, the frame allocator,
+ * the synchronization library and the logger unchanged. System register
+ * accesses go to a table in host_sysreg.c, the UART and semihosting
+ * drivers are replaced by host_console.c, which writes to stdout or to a
+ * capture buffer. Physical addresses are host pointers, the frame pool is
+ * allocated with host_frame_pool().
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Native build helper function prototypes.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Restore every emulated system register to its reset value.
+ */
+void host_sysreg_reset(void);
+
+/**
+ * @brief Get the number of TLB maintenance operations issued.
+ *
+ * @return Operations since the last host_sysreg_reset().
+ */
+uint64_t host_tlbi_count(void);
+
+/**
+ * @brief Allocate a frame aligned pool and hand it to the frame allocator.
+ *
+ * The previous pool, if any, is released first.
+ *
+ * @param frames Number of frames.
+ * @return Address of the pool.
+ */
+uint64_t host_frame_pool(uint64_t frames);
+
+/**
+ * @brief Select where console output goes.
+ *
+ * @param capture Non-zero to collect output in the capture buffer, zero
+ *                to write it to stdout.
+ * @param quiet Non-zero to drop output that is not captured.
+ */
+void host_console_mode(int capture, int quiet);
+
+/**
+ * @brief Get the captured console output.
+ *
+ * @param len Receives the number of bytes captured.
+ * @return The capture buffer.
+ */
+const char* host_console_captured(size_t* len);
+
+/**
+ * @brief Empty the capture buffer.
+ */
+void host_console_clear(void);
+
+#endif // HOST_H
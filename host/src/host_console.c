@@ -0,0 +1,214 @@
+/**
+ * @file host_console.c
+ * @brief UART and semihosting stand-ins for native builds.
+ *
+ * This file contains the console functions the logger calls, routed to
+ * stdout or to a capture buffer.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Both the UART and the semihosting console end up in the same place.
+ * Captured output grows the buffer as needed, so a fuzzer can compare
+ * everything the logger emitted with what it was given. Semihosting calls
+ * other than console output are not emulated and fail.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the native console.
+ */
+
+/* this module's header */
+#include "host.h"
+
+/* standard includes */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project includes */
+#include "semihosting.h"
+#include "uart.h"
+
+#define HOST_CONSOLE_HANDLE (1) /**< Handle returned for SEMIHOSTING_STDOUT */
+
+static int    host_capture     = 0;    /* Collect output instead of printing it */
+static int    host_quiet       = 0;    /* Drop output that is not collected */
+static char*  host_capture_buf = NULL; /* Captured output */
+static size_t host_capture_len = 0;    /* Bytes captured */
+static size_t host_capture_cap = 0;    /* Size of host_capture_buf */
+
+/**
+ * @brief Emit console output.
+ *
+ * @param data The bytes.
+ * @param len Number of bytes.
+ */
+static void host_console_out(const char* data, size_t len)
+{
+    if (!host_capture)
+    {
+        if (!host_quiet)
+        {
+            fwrite(data, 1, len, stdout);
+        }
+        return;
+    }
+
+    if (host_capture_len + len > host_capture_cap)
+    {
+        size_t cap = (0 == host_capture_cap) ? 0x1000 : host_capture_cap; /* New buffer size */
+
+        while (host_capture_len + len > cap)
+        {
+            cap *= 2;
+        }
+
+        host_capture_buf = realloc(host_capture_buf, cap);
+        if (NULL == host_capture_buf)
+        {
+            fprintf(stderr, "host_console: out of memory\n");
+            abort();
+        }
+        host_capture_cap = cap;
+    }
+
+    memcpy(host_capture_buf + host_capture_len, data, len);
+    host_capture_len += len;
+}
+
+/**
+ * @brief Select where console output goes.
+ *
+ * @param capture Non-zero to collect output in the capture buffer.
+ * @param quiet Non-zero to drop output that is not captured.
+ */
+void host_console_mode(int capture, int quiet)
+{
+    host_capture = capture;
+    host_quiet   = quiet;
+}
+
+/**
+ * @brief Get the captured console output.
+ *
+ * @param len Receives the number of bytes captured.
+ * @return The capture buffer.
+ */
+const char* host_console_captured(size_t* len)
+{
+    *len = host_capture_len;
+
+    return host_capture_buf;
+}
+
+/**
+ * @brief Empty the capture buffer.
+ */
+void host_console_clear(void)
+{
+    host_capture_len = 0;
+}
+
+/**
+ * @brief Initialize the UART, nothing to do.
+ */
+void uart_init(void)
+{
+}
+
+/**
+ * @brief Send a character to the console.
+ *
+ * @param c The character.
+ */
+void uart_putc(char c)
+{
+    host_console_out(&c, 1);
+}
+
+/**
+ * @brief Send a string to the console.
+ *
+ * @param str NUL terminated string.
+ */
+void uart_puts(const char* str)
+{
+    host_console_out(str, strlen(str));
+}
+
+/**
+ * @brief Open a host file, only the console is available.
+ *
+ * @param path File name.
+ * @param mode Open mode.
+ * @return A handle, or -1.
+ */
+int64_t semihosting_open(const char* path, uint32_t mode)
+{
+    (void)mode;
+
+    return (0 == strcmp(path, SEMIHOSTING_STDOUT)) ? HOST_CONSOLE_HANDLE : -1;
+}
+
+/**
+ * @brief Write to a host file.
+ *
+ * @param handle Handle from semihosting_open().
+ * @param buf The bytes.
+ * @param len Number of bytes.
+ * @return STATUS_OK, or STATUS_ERR_IO for any handle but the console.
+ */
+status_t semihosting_write(int64_t handle, const void* buf, uint64_t len)
+{
+    if (HOST_CONSOLE_HANDLE != handle)
+    {
+        return STATUS_ERR_IO;
+    }
+
+    host_console_out(buf, (size_t)len);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Write a NUL terminated string to the console.
+ *
+ * @param str The string.
+ */
+void semihosting_write0(const char* str)
+{
+    host_console_out(str, strlen(str));
+}
+
+/**
+ * @brief Terminate the program.
+ */
+void semihosting_exit(void)
+{
+    fflush(stdout);
+    exit(0);
+}
@@ -0,0 +1,234 @@
+/**
+ * @file host_sysreg.c
+ * @brief Emulated system registers for native builds.
+ *
+ * This file contains the register table behind SYSREG_READ() and
+ * SYSREG_WRITE() when HL_HOST_BUILD is defined, and the host frame pool.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Registers are identified by the name the macro was given, so the same
+ * register spelled differently (e.g. ICC_PMR_EL1 and S3_0_C4_C6_0) is two
+ * entries. Unknown registers read as zero until written, a few feature
+ * registers have the reset values of the QEMU cortex-a53 the hypervisor
+ * normally runs on. The counter is CLOCK_MONOTONIC in nanoseconds.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the emulated system registers.
+ */
+
+/* this module's header */
+#include "host.h"
+
+/* standard includes */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* project includes */
+#include "frame.h"
+#include "sysreg.h"
+
+#define HOST_SYSREG_MAX (64U) /**< Distinct registers a program may touch */
+
+/**
+ * @brief An emulated system register.
+ */
+typedef struct host_sysreg
+{
+    const char* name; /**< register name as passed to the macros */
+    uint64_t    val;  /**< current value */
+} host_sysreg_t;
+
+/* Reset values that differ from zero */
+static const host_sysreg_t host_sysreg_defaults[] = {
+    { "id_aa64mmfr0_el1", 0x0000000000001122ULL }, /* 40-bit PA, 4KB and 64KB granules */
+    { "id_aa64isar0_el1", 0x0000000000010000ULL }, /* AES only, no LSE atomics */
+    { "mpidr_el1",        0x0000000080000000ULL }, /* CPU 0 */
+    { "cntfrq_el0",       1000000000ULL },         /* Matches host_counter_read() */
+};
+
+static host_sysreg_t host_sysregs[HOST_SYSREG_MAX]; /* Registers touched so far */
+static uint32_t      host_sysreg_num  = 0;          /* Entries in host_sysregs */
+static uint64_t      host_tlbi_ops    = 0x0ULL;     /* TLB maintenance operations */
+static void*         host_pool        = NULL;       /* Current frame pool */
+
+/**
+ * @brief Find the entry of a register, creating it on first use.
+ *
+ * @param name The register name.
+ * @return The entry.
+ */
+static host_sysreg_t* host_sysreg_find(const char* name)
+{
+    for (uint32_t i = 0; i < host_sysreg_num; ++i)
+    {
+        if (0 == strcmp(host_sysregs[i].name, name))
+        {
+            return &host_sysregs[i];
+        }
+    }
+
+    if (HOST_SYSREG_MAX == host_sysreg_num)
+    {
+        fprintf(stderr, "host_sysreg: too many registers, raise HOST_SYSREG_MAX\n");
+        abort();
+    }
+
+    host_sysregs[host_sysreg_num].name = name;
+    host_sysregs[host_sysreg_num].val  = 0x0ULL;
+
+    for (size_t i = 0; i < sizeof(host_sysreg_defaults) / sizeof(host_sysreg_defaults[0]); ++i)
+    {
+        if (0 == strcmp(host_sysreg_defaults[i].name, name))
+        {
+            host_sysregs[host_sysreg_num].val = host_sysreg_defaults[i].val;
+        }
+    }
+
+    return &host_sysregs[host_sysreg_num++];
+}
+
+/**
+ * @brief Emulated MRS.
+ *
+ * @param name The register name.
+ * @return The register value.
+ */
+uint64_t host_sysreg_read(const char* name)
+{
+    return host_sysreg_find(name)->val;
+}
+
+/**
+ * @brief Emulated MSR.
+ *
+ * @param name The register name.
+ * @param val The new value.
+ */
+void host_sysreg_write(const char* name, uint64_t val)
+{
+    host_sysreg_find(name)->val = val;
+}
+
+/**
+ * @brief Emulated TLB maintenance, only counted.
+ *
+ * @param op The TLBI operation.
+ * @param arg The operand, 0 if the operation has none.
+ */
+void host_tlbi(const char* op, uint64_t arg)
+{
+    (void)op;
+    (void)arg;
+
+    host_tlbi_ops++;
+}
+
+/**
+ * @brief Emulated AT, the translation always aborts.
+ *
+ * Callers fall back to their software walkers, which is what the native
+ * build is meant to exercise.
+ *
+ * @param op The AT operation.
+ * @param addr The address to translate.
+ */
+void host_at(const char* op, uint64_t addr)
+{
+    (void)op;
+    (void)addr;
+
+    host_sysreg_write("par_el1", PAR_EL1_F);
+}
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return Nanoseconds since an arbitrary point.
+ */
+uint64_t host_counter_read(void)
+{
+    struct timespec ts; /* Current time */
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Get the frequency of host_counter_read().
+ *
+ * @return Ticks per second.
+ */
+uint64_t host_counter_freq(void)
+{
+    return 1000000000ULL;
+}
+
+/**
+ * @brief Restore every emulated system register to its reset value.
+ */
+void host_sysreg_reset(void)
+{
+    host_sysreg_num = 0;
+    host_tlbi_ops   = 0;
+}
+
+/**
+ * @brief Get the number of TLB maintenance operations issued.
+ *
+ * @return Operations since the last host_sysreg_reset().
+ */
+uint64_t host_tlbi_count(void)
+{
+    return host_tlbi_ops;
+}
+
+/**
+ * @brief Allocate a frame aligned pool and hand it to the frame allocator.
+ *
+ * @param frames Number of frames.
+ * @return Address of the pool.
+ */
+uint64_t host_frame_pool(uint64_t frames)
+{
+    free(host_pool);
+
+    host_pool = aligned_alloc(FRAME_SIZE, frames * FRAME_SIZE);
+    if (NULL == host_pool)
+    {
+        fprintf(stderr, "host_frame_pool: out of memory\n");
+        abort();
+    }
+
+    frame_init((uint64_t)(uintptr_t)host_pool, frames * FRAME_SIZE);
+
+    return (uint64_t)(uintptr_t)host_pool;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+#
+# @file trace2json.py
+# @brief Convert a Hyper-LITE exit trace to Chrome trace JSON.
+#
+# Reads the binary file written by trace_dump(LOG_SINK_SEMIHOSTING), or a
+# console log holding the "@HLT " hex lines of trace_dump(LOG_SINK_UART),
+# and prints a Chrome trace that chrome://tracing and Perfetto display as
+# one process per VM and one thread per vCPU.
+#
+# @date 2026-10-18
+# @version 1.0
+# @author Charles Fulton Greiner
+#
+# Usage: trace2json.py hyperlite.trace > trace.json
+#        trace2json.py console.log > trace.json
+
+import json
+import struct
+import sys
+
+TRACE_MAGIC = b"HLTRACE1"
+TRACE_UART_TAG = "@HLT "
+
+FILE_HDR = struct.Struct("<8sIIQ")    # trace_file_hdr_t
+CPU_HDR = struct.Struct("<IIQ")       # trace_cpu_hdr_t
+EVENT = struct.Struct("<QQIIHBBI")    # trace_event_t
+
+TRACE_EXIT_SYNC = 0
+TRACE_EXIT_IRQ = 1
+
+# ESR_EL2.EC of the exits the hypervisor handles
+EXIT_NAMES = {
+    0x01: "wfx",
+    0x16: "hvc",
+    0x17: "smc",
+    0x18: "sys64",
+    0x20: "iabt",
+    0x24: "dabt",
+}
+
+
+def load(path):
+    """Return the dump bytes of a binary trace or of a console log."""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data.startswith(TRACE_MAGIC):
+        return data
+
+    hexdata = []
+    for line in data.decode("ascii", "replace").splitlines():
+        pos = line.find(TRACE_UART_TAG)
+        if pos >= 0:
+            hexdata.append(line[pos + len(TRACE_UART_TAG):].strip())
+
+    return bytes.fromhex("".join(hexdata))
+
+
+def exit_name(kind, esr, arg):
+    if kind == TRACE_EXIT_IRQ:
+        return "irq %u" % arg
+    ec = (esr >> 26) & 0x3F
+    return EXIT_NAMES.get(ec, "ec 0x%02x" % ec)
+
+
+def convert(data):
+    magic, cpus, event_size, freq = FILE_HDR.unpack_from(data, 0)
+    if magic != TRACE_MAGIC:
+        raise ValueError("not a Hyper-LITE trace")
+    if event_size != EVENT.size:
+        raise ValueError("unsupported record size %u" % event_size)
+
+    us_per_tick = 1e6 / freq
+    events = []
+    threads = set()
+    offset = FILE_HDR.size
+
+    for _ in range(cpus):
+        cpu, count, lost = CPU_HDR.unpack_from(data, offset)
+        offset += CPU_HDR.size
+
+        if lost:
+            events.append({"name": "lost %u records" % lost, "ph": "i", "s": "g", "ts": 0,
+                           "pid": 0, "tid": 0, "args": {"cpu": cpu}})
+
+        for _ in range(count):
+            ts, arg, esr, duration, vm, vcpu, kind, _ = EVENT.unpack_from(data, offset)
+            offset += EVENT.size
+            threads.add((vm, vcpu))
+            events.append({
+                "name": exit_name(kind, esr, arg),
+                "cat": "irq" if kind == TRACE_EXIT_IRQ else "sync",
+                "ph": "X",
+                "ts": ts * us_per_tick,
+                "dur": duration * us_per_tick,
+                "pid": vm,
+                "tid": vcpu,
+                "args": {"cpu": cpu, "esr": "0x%x" % esr, "arg": "0x%x" % arg},
+            })
+
+    for vm in sorted({vm for vm, _ in threads}):
+        events.append({"name": "process_name", "ph": "M", "pid": vm, "args": {"name": "VM %u" % vm}})
+    for vm, vcpu in sorted(threads):
+        events.append({"name": "thread_name", "ph": "M", "pid": vm, "tid": vcpu,
+                       "args": {"name": "vCPU %u" % vcpu}})
+
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write("usage: %s <hyperlite.trace | console.log>\n" % argv[0])
+        return 2
+
+    json.dump(convert(load(argv[1])), sys.stdout)
+    sys.stdout.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+
+# must use the ELF, using binary breaks static/global variables?
+qemu-system-aarch64 \
+    -machine virt,virtualization=on,gic-version=3 \
+    -cpu "${CPU:-cortex-a53}" \
+    -nographic \
+    -smp 8 \
+    -m 2048 \
+    -semihosting-config enable=on,target=native \
+    -kernel build/hyper-lite-bench.elf \
+    -serial mon:stdio \
+    -monitor none \
+    -no-reboot
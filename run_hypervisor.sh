@@ -2,12 +2,14 @@
 
 # must use the ELF, using binary breaks static/global variables?
 qemu-system-aarch64 \
-    -machine virt,virtualization=on \
+    -machine virt,virtualization=on,gic-version=3 \
     -cpu cortex-a53 \
     -nographic \
     -smp 1 \
     -m 2048 \
+    -semihosting-config enable=on,target=native \
     -kernel build/hyper-lite.elf \
     -serial mon:stdio \
     -monitor none \
-    -no-reboot
+    -no-reboot \
+    "$@"
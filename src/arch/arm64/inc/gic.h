@@ -0,0 +1,142 @@
+/**
+ * @file gic.h
+ * @brief Physical GICv3 distributor, redistributor and CPU interface.
+ *
+ * This file contains the definitions and function prototypes to route
+ * physical interrupts to the hypervisor and to acknowledge them.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Only what the hypervisor itself needs is set up: the distributor with
+ * affinity routing, the redistributor of each CPU and the group 1 system
+ * register interface. All interrupts are group 1 and are delivered as
+ * IRQs, which HCR_EL2.IMO routes to EL2 while a guest runs. Outside of
+ * guest context PSTATE.I stays set, so the hypervisor polls with
+ * gic_ack() after a WFI instead of taking the exception.
+ *
+ * An SPI can be forwarded to a guest with gic_forward_spi(). The guest
+ * then deactivates the physical interrupt itself, see gic_eoi().
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Physical GIC definitions and function prototypes.
+ */
+
+#ifndef GIC_H
+#define GIC_H
+
+#include <stdint.h>
+
+#include "status.h"
+
+#define GIC_INTID_SPURIOUS (1020U) /**< First special interrupt ID */
+#define GIC_PRIORITY_DFLT  (0x80U) /**< Priority of the hypervisor's interrupts */
+
+/**
+ * @brief Enable the distributor.
+ *
+ * Called once by the boot CPU.
+ */
+void gic_init(void);
+
+/**
+ * @brief Wake the calling CPU's redistributor and enable its CPU interface.
+ *
+ * @return STATUS_OK, or STATUS_ERR_NOT_FOUND if no redistributor matches
+ *         the calling CPU.
+ */
+status_t gic_cpu_init(void);
+
+/**
+ * @brief Enable an SGI or PPI on the calling CPU.
+ *
+ * @param intid The interrupt ID, below 32.
+ * @param priority The interrupt priority, lower is more urgent.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NOT_FOUND if the
+ *         calling CPU's redistributor is unknown.
+ */
+status_t gic_enable_private(uint32_t intid, uint8_t priority);
+
+/**
+ * @brief Forward an SPI to a guest.
+ *
+ * Makes the SPI group 1, routes it to a CPU and enables it. From then on
+ * gic_eoi() leaves its deactivation to the guest, which must receive it
+ * with vgic_inject_hw().
+ *
+ * @param intid The interrupt ID, an SPI.
+ * @param cpu The CPU number to route it to.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t gic_forward_spi(uint32_t intid, uint32_t cpu);
+
+/**
+ * @brief Route a forwarded SPI to another CPU.
+ *
+ * @param intid The interrupt ID, an SPI.
+ * @param cpu The CPU number.
+ */
+void gic_route_spi(uint32_t intid, uint32_t cpu);
+
+/**
+ * @brief Stop forwarding an SPI and disable it.
+ *
+ * @param intid The interrupt ID, an SPI.
+ */
+void gic_release_spi(uint32_t intid);
+
+/**
+ * @brief Acknowledge the highest priority pending interrupt.
+ *
+ * @return The interrupt ID, GIC_INTID_SPURIOUS or above if none is pending.
+ */
+uint32_t gic_ack(void);
+
+/**
+ * @brief Check for a pending interrupt without acknowledging it.
+ *
+ * @return Non-zero if an interrupt is pending.
+ */
+int gic_pending(void);
+
+/**
+ * @brief Drop the priority of and deactivate an acknowledged interrupt.
+ *
+ * A forwarded SPI is only dropped, the guest deactivates it.
+ *
+ * @param intid The interrupt ID returned by gic_ack().
+ */
+void gic_eoi(uint32_t intid);
+
+/**
+ * @brief Send a software generated interrupt to another CPU.
+ *
+ * @param cpu The target CPU number.
+ * @param intid The SGI number, below 16.
+ */
+void gic_send_sgi(uint32_t cpu, uint32_t intid);
+
+#endif // GIC_H
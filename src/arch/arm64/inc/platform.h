@@ -0,0 +1,55 @@
+/**
+ * @file platform.h
+ * @brief Memory map of the QEMU virt platform.
+ *
+ * Provides the physical addresses of RAM and of the peripherals used by
+ * the hypervisor.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The values match `qemu-system-aarch64 -machine virt,gic-version=3 -m 2048`
+ * as launched by run_hypervisor.sh.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Platform memory map constants.
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#define PLATFORM_RAM_BASE (0x40000000ULL) /**< Start of RAM */
+#define PLATFORM_RAM_SIZE (0x80000000ULL) /**< Size of RAM (2GB) */
+#define PLATFORM_RAM_END  (PLATFORM_RAM_BASE + PLATFORM_RAM_SIZE) /**< End of RAM */
+
+#define PLATFORM_GICD_BASE (0x08000000ULL) /**< GICv3 distributor */
+#define PLATFORM_GICR_BASE (0x080A0000ULL) /**< GICv3 redistributors */
+
+#define PLATFORM_UART_BASE (0x09000000ULL) /**< PL011 UART, the hypervisor console */
+#define PLATFORM_UART_SIZE (0x1000ULL)     /**< Size of the UART register window */
+#define PLATFORM_UART_IRQ  (33U)           /**< UART interrupt, SPI 1 */
+
+#endif // PLATFORM_H
@@ -0,0 +1,105 @@
+/**
+ * @file smp.h
+ * @brief Secondary CPU bring-up.
+ *
+ * This file contains the definitions and function prototypes to start
+ * secondary physical CPUs through PSCI and identify the calling CPU.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * QEMU's virt machine with virtualization enabled implements PSCI behind
+ * the SMC conduit. CPU_ON starts the target at EL2 in smp_secondary_entry
+ * (smp_entry.s), which switches to a per-CPU stack and calls into C. The C
+ * side repeats the per-CPU part of boot (MMU, vectors, vGIC, stage-2,
+ * event stream) and then runs the requested function. When that function
+ * returns, the CPU powers itself off with CPU_OFF.
+ *
+ * CPU numbers are MPIDR_EL1.Aff0, which is how QEMU numbers up to eight
+ * CPUs in the first cluster.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Secondary CPU bring-up definitions and function prototypes.
+ */
+
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+
+#include "status.h"
+#include "sysreg.h"
+
+#define SMP_MAX_CPUS   (8U)      /**< Physical CPUs supported */
+#define SMP_STACK_SIZE (0x4000U) /**< Stack of each secondary CPU */
+
+/* PSCI function IDs and return codes */
+#define PSCI_CPU_OFF            (0x84000002U) /**< Power down the calling CPU */
+#define PSCI_CPU_ON             (0xC4000003U) /**< Power up a CPU (SMC64) */
+#define PSCI_SUCCESS            (0)           /**< Success */
+#define PSCI_INVALID_PARAMETERS (-2)          /**< No such CPU */
+#define PSCI_ALREADY_ON         (-4)          /**< CPU is running */
+#define PSCI_ON_PENDING         (-5)          /**< CPU is being started */
+
+#define MPIDR_EL1_AFF0_MASK (0xFFULL) /**< Affinity level 0 */
+
+/**
+ * @brief Function run by a secondary CPU.
+ *
+ * @param cpu The CPU number.
+ * @param arg Argument passed to smp_cpu_on().
+ */
+typedef void (*smp_entry_fn_t)(uint32_t cpu, void* arg);
+
+/**
+ * @brief Get the number of the calling CPU.
+ *
+ * @return MPIDR_EL1.Aff0.
+ */
+static inline uint32_t smp_cpu_id(void)
+{
+    return (uint32_t)(SYSREG_READ(mpidr_el1) & MPIDR_EL1_AFF0_MASK);
+}
+
+/**
+ * @brief Start a secondary CPU.
+ *
+ * @param cpu The CPU number, 1 to SMP_MAX_CPUS - 1.
+ * @param fn Function to run on it, the CPU powers off when it returns.
+ * @param arg Argument passed to fn.
+ * @return STATUS_OK, STATUS_ERR_NOT_FOUND if the CPU does not exist,
+ *         STATUS_ERR_BUSY if it is running, or STATUS_ERR_INVALID.
+ */
+status_t smp_cpu_on(uint32_t cpu, smp_entry_fn_t fn, void* arg);
+
+/**
+ * @brief C entry of a secondary CPU, called from smp_entry.s.
+ *
+ * @param cpu The CPU number passed as the PSCI context ID.
+ */
+void smp_secondary_main(uint64_t cpu) __attribute__((noreturn));
+
+#endif // SMP_H
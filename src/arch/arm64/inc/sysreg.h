@@ -0,0 +1,166 @@
+/**
+ * @file sysreg.h
+ * @brief ARM64 system register and barrier helpers.
+ *
+ * Provides macros to access system registers and issue barriers.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The register name is pasted into the instruction, so any name (or
+ * S<op0>_<op1>_C<n>_C<m>_<op2> encoding) known to the assembler can be
+ * used.
+ *
+ * With HL_HOST_BUILD defined (see host/) the same macros compile natively:
+ * registers become entries of a table in host_sysreg.c, looked up by name,
+ * barriers and cache maintenance become compiler fences, TLB maintenance
+ * is only counted and AT instructions always report an aborted
+ * translation.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * System register access macros, barriers and the generic timer counter.
+ *
+ * @section examples Examples
+ * @code
+ * uint64_t hcr = SYSREG_READ(hcr_el2);
+ * SYSREG_WRITE(hcr_el2, hcr | HCR_EL2_VM);
+ * ISB();
+ * @endcode
+ */
+
+#ifndef SYSREG_H
+#define SYSREG_H
+
+#include <stdint.h>
+
+/* Physical Address Register, result of an AT instruction */
+#define PAR_EL1_F       (1ULL << 0)              /**< Translation aborted */
+#define PAR_EL1_PA_MASK (0x0000FFFFFFFFF000ULL) /**< Output address of a successful translation */
+
+#ifdef HL_HOST_BUILD
+
+uint64_t host_sysreg_read(const char* name);             /**< Emulated MRS, host_sysreg.c */
+void     host_sysreg_write(const char* name, uint64_t val); /**< Emulated MSR, host_sysreg.c */
+void     host_tlbi(const char* op, uint64_t arg);          /**< Counts TLB maintenance, host_sysreg.c */
+void     host_at(const char* op, uint64_t addr);           /**< Reports an aborted translation, host_sysreg.c */
+uint64_t host_counter_read(void);                          /**< Monotonic clock in counter ticks */
+uint64_t host_counter_freq(void);                          /**< Ticks per second of host_counter_read() */
+
+#define SYSREG_READ(reg)       host_sysreg_read(#reg)                   /**< Read an emulated register */
+#define SYSREG_WRITE(reg, val) host_sysreg_write(#reg, (uint64_t)(val)) /**< Write an emulated register */
+
+#define ISB()             __atomic_signal_fence(__ATOMIC_SEQ_CST) /**< Compiler barrier */
+#define DSB(opt)          __atomic_thread_fence(__ATOMIC_SEQ_CST) /**< Full fence */
+#define DMB(opt)          __atomic_thread_fence(__ATOMIC_SEQ_CST) /**< Full fence */
+#define WFI()             __atomic_signal_fence(__ATOMIC_SEQ_CST) /**< Nothing to wait for */
+#define WFE()             __atomic_signal_fence(__ATOMIC_SEQ_CST) /**< Waits spin instead */
+#define SEV()             __atomic_signal_fence(__ATOMIC_SEQ_CST) /**< Waits spin instead */
+#define TLBI(op)          host_tlbi(#op, 0x0ULL)                  /**< Counted TLB maintenance */
+#define TLBI_ARG(op, arg) host_tlbi(#op, (uint64_t)(arg))         /**< Counted TLB maintenance */
+#define AT(op, addr)      host_at(#op, (uint64_t)(addr))          /**< Always aborts, callers walk in software */
+#define DC(op, addr)      ((void)(addr), __atomic_signal_fence(__ATOMIC_SEQ_CST)) /**< Caches are coherent */
+#define IC(op, addr)      ((void)(addr), __atomic_signal_fence(__ATOMIC_SEQ_CST)) /**< Caches are coherent */
+
+/**
+ * @brief Read the emulated physical counter.
+ *
+ * @return A monotonic tick count.
+ */
+static inline uint64_t arch_counter_read(void)
+{
+    return host_counter_read();
+}
+
+/**
+ * @brief Read the emulated counter frequency.
+ *
+ * @return Ticks per second.
+ */
+static inline uint64_t arch_counter_freq(void)
+{
+    return host_counter_freq();
+}
+
+#else
+
+/**
+ * @brief Read a system register.
+ *
+ * @param reg The system register name.
+ * @return The 64-bit register value.
+ */
+#define SYSREG_READ(reg) ({                      \
+    uint64_t __val;                              \
+    asm volatile("mrs %0, " #reg : "=r"(__val)); \
+    __val;                                       \
+})
+
+/**
+ * @brief Write a system register.
+ *
+ * @param reg The system register name.
+ * @param val The value to write.
+ */
+#define SYSREG_WRITE(reg, val) \
+    asm volatile("msr " #reg ", %0" ::"r"((uint64_t)(val)) : "memory")
+
+#define ISB()     asm volatile("isb" ::: "memory")         /**< Instruction synchronization barrier */
+#define DSB(opt)  asm volatile("dsb " #opt ::: "memory")   /**< Data synchronization barrier */
+#define DMB(opt)  asm volatile("dmb " #opt ::: "memory")   /**< Data memory barrier */
+#define WFI()     asm volatile("wfi" ::: "memory")         /**< Wait for interrupt */
+#define WFE()     asm volatile("wfe" ::: "memory")         /**< Wait for event */
+#define SEV()     asm volatile("sev" ::: "memory")         /**< Send event */
+
+#define TLBI(op)          asm volatile("tlbi " #op ::: "memory")                           /**< TLB maintenance */
+#define TLBI_ARG(op, arg) asm volatile("tlbi " #op ", %0" ::"r"((uint64_t)(arg)) : "memory") /**< TLB maintenance with an operand */
+#define AT(op, addr)      asm volatile("at " #op ", %0" ::"r"((uint64_t)(addr)) : "memory")   /**< Address translation into PAR_EL1 */
+#define DC(op, addr)      asm volatile("dc " #op ", %0" ::"r"((uint64_t)(addr)) : "memory")   /**< Data cache maintenance by address */
+#define IC(op, addr)      asm volatile("ic " #op ", %0" ::"r"((uint64_t)(addr)) : "memory")   /**< Instruction cache maintenance by address */
+
+/**
+ * @brief Read the physical counter.
+ *
+ * @return The current CNTPCT_EL0 value.
+ */
+static inline uint64_t arch_counter_read(void)
+{
+    ISB();
+    return SYSREG_READ(cntpct_el0);
+}
+
+/**
+ * @brief Read the counter frequency.
+ *
+ * @return The CNTFRQ_EL0 value in Hz.
+ */
+static inline uint64_t arch_counter_freq(void)
+{
+    return SYSREG_READ(cntfrq_el0);
+}
+
+#endif // HL_HOST_BUILD
+
+#endif // SYSREG_H
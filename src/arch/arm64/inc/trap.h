@@ -0,0 +1,173 @@
+/**
+ * @file trap.h
+ * @brief EL2 exception vectors and trap handling.
+ *
+ * Provides the trap frame layout and the entry points called from the
+ * EL2 exception vector table.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Exceptions taken from a guest save the guest general purpose registers,
+ * ELR_EL2 and SPSR_EL2 into the trap frame of the current vCPU, whose
+ * address is kept in TPIDR_EL2. The handlers may modify the frame (or
+ * switch TPIDR_EL2 to another vCPU) before the vector code restores it
+ * and returns to the guest.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Trap frame definition, ESR decoding helpers and trap handler prototypes.
+ */
+
+#ifndef TRAP_H
+#define TRAP_H
+
+#include <stdint.h>
+
+/* Exception Syndrome Register */
+#define ESR_EC_SHIFT      (26ULL)                                /**< Exception class offset */
+#define ESR_EC_MASK       (0x3FULL)                              /**< Exception class mask */
+#define ESR_EC(esr)       (((esr) >> ESR_EC_SHIFT) & ESR_EC_MASK) /**< Extract exception class */
+#define ESR_IL            (1ULL << 25)                           /**< 32-bit instruction length */
+#define ESR_ISS_MASK      (0x1FFFFFFULL)                         /**< Instruction specific syndrome mask */
+#define ESR_ISS(esr)      ((esr) & ESR_ISS_MASK)                 /**< Extract ISS */
+#define ESR_EC_WFX        (0x01ULL)                              /**< WFI or WFE */
+#define ESR_EC_HVC64      (0x16ULL)                              /**< HVC from AArch64 */
+#define ESR_EC_SMC64      (0x17ULL)                              /**< SMC from AArch64 */
+#define ESR_EC_SYS64      (0x18ULL)                              /**< MSR/MRS/SYS from AArch64 */
+#define ESR_EC_IABT_LOW   (0x20ULL)                              /**< Instruction abort from a lower EL */
+#define ESR_EC_DABT_LOW   (0x24ULL)                              /**< Data abort from a lower EL */
+
+/* WFI/WFE ISS */
+#define ESR_WFX_TI_WFE     (1ULL << 0)                  /**< Trapped WFE, not WFI */
+
+/* MSR/MRS/SYS ISS */
+#define ESR_SYS_OP0(esr)   (((esr) >> 20) & 0x3ULL)     /**< Op0 */
+#define ESR_SYS_OP2(esr)   (((esr) >> 17) & 0x7ULL)     /**< Op2 */
+#define ESR_SYS_OP1(esr)   (((esr) >> 14) & 0x7ULL)     /**< Op1 */
+#define ESR_SYS_CRN(esr)   (((esr) >> 10) & 0xFULL)     /**< CRn */
+#define ESR_SYS_RT(esr)    (((esr) >> 5) & 0x1FULL)     /**< Transfer register */
+#define ESR_SYS_CRM(esr)   (((esr) >> 1) & 0xFULL)      /**< CRm */
+#define ESR_SYS_READ       (1ULL << 0)                  /**< MRS, not MSR or SYS */
+
+/* Data abort ISS */
+#define ESR_DABT_ISV       (1ULL << 24)                 /**< Syndrome valid */
+#define ESR_DABT_SAS(esr)  (((esr) >> 22) & 0x3ULL)     /**< Access size (log2 bytes) */
+#define ESR_DABT_SSE       (1ULL << 21)                 /**< Sign extend */
+#define ESR_DABT_SRT(esr)  (((esr) >> 16) & 0x1FULL)    /**< Transfer register */
+#define ESR_DABT_SF        (1ULL << 15)                 /**< 64-bit transfer register */
+#define ESR_DABT_WNR       (1ULL << 6)                  /**< Write, not read */
+#define ESR_FSC(esr)       ((esr) & 0x3FULL)            /**< Fault status code */
+#define ESR_FSC_TYPE(esr)  (ESR_FSC(esr) & 0x3CULL)     /**< Fault status code without level */
+#define ESR_FSC_TRANS      (0x04ULL)                    /**< Translation fault */
+#define ESR_FSC_ACCESS     (0x08ULL)                    /**< Access flag fault */
+#define ESR_FSC_PERM       (0x0CULL)                    /**< Permission fault */
+
+/**
+ * @brief Guest state saved on exception entry.
+ *
+ * The layout is shared with vectors.s and must not change without
+ * updating the offsets there.
+ */
+typedef struct trap_frame
+{
+    uint64_t x[31]; /**< general purpose registers x0-x30 */
+    uint64_t elr;   /**< ELR_EL2, guest return address */
+    uint64_t spsr;  /**< SPSR_EL2, guest PSTATE */
+    uint64_t pad;   /**< keeps the frame 16-byte aligned */
+} trap_frame_t;
+
+/**
+ * @brief Install the EL2 exception vector table.
+ */
+void trap_init(void);
+
+/**
+ * @brief Handle a synchronous exception taken from a guest.
+ *
+ * Called from vectors.s with the trap frame of the current vCPU.
+ *
+ * @param frame The trap frame of the current vCPU.
+ */
+void trap_handle_sync(trap_frame_t* frame);
+
+/**
+ * @brief Handle a physical IRQ taken while a guest was running.
+ *
+ * @param frame The trap frame of the current vCPU.
+ */
+void trap_handle_irq(trap_frame_t* frame);
+
+/**
+ * @brief Handle an exception that should never be taken.
+ *
+ * Logs the syndrome and halts the core.
+ *
+ * @param type Index of the vector table entry that was taken.
+ */
+void trap_handle_invalid(uint64_t type);
+
+/**
+ * @brief Prepare the current vCPU for guest entry.
+ *
+ * Called from vectors.s right before the trap frame is restored.
+ */
+void trap_exit_prepare(void);
+
+/**
+ * @brief Read a guest register from a trap frame.
+ *
+ * @param frame The trap frame.
+ * @param reg Register number, 31 reads as zero.
+ * @return The register value.
+ */
+static inline uint64_t trap_frame_get_reg(const trap_frame_t* frame, uint64_t reg)
+{
+    return (reg < 31) ? frame->x[reg] : 0x0ULL;
+}
+
+/**
+ * @brief Write a guest register in a trap frame.
+ *
+ * @param frame The trap frame.
+ * @param reg Register number, writes to 31 are discarded.
+ * @param val The value to write.
+ */
+static inline void trap_frame_set_reg(trap_frame_t* frame, uint64_t reg, uint64_t val)
+{
+    if (reg < 31)
+    {
+        frame->x[reg] = val;
+    }
+}
+
+/**
+ * @brief Restore the trap frame of the current vCPU and enter the guest.
+ *
+ * Implemented in vectors.s. TPIDR_EL2 must point to the vCPU to run.
+ */
+void trap_guest_enter(void) __attribute__((noreturn));
+
+#endif // TRAP_H
@@ -0,0 +1,146 @@
+/**
+ * @file vgic.h
+ * @brief Virtual interrupt injection through the GICv3 list registers.
+ *
+ * Provides functions to mark virtual interrupts pending for a vCPU and to
+ * load them into the GICv3 virtual CPU interface before guest entry.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Interrupts are first recorded in a per-vCPU pending bitmap, which may be
+ * done from any context. vgic_flush() then moves as many pending
+ * interrupts as there are free list registers into the ICH_LR<n>_EL2
+ * registers of the physical CPU the vCPU is about to run on. Interrupts
+ * that do not fit stay pending and are retried on the next guest entry.
+ *
+ * SGIs between the vCPUs of a VM are emulated: the sender's trapped
+ * ICC_SGI1R_EL1 write queues the SGI for every target and leaves waking
+ * them to sched_ipi().
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Virtual GIC state and injection function prototypes.
+ */
+
+#ifndef VGIC_H
+#define VGIC_H
+
+#include <stdint.h>
+
+#include "status.h"
+
+#define VGIC_MAX_INTID     (1020U) /**< Number of supported interrupt IDs */
+#define VGIC_PRIORITY_DFLT (0xA0U) /**< Priority of injected interrupts */
+#define VGIC_MAX_LRS       (16U)   /**< Architectural maximum number of list registers */
+
+struct vcpu;
+
+/**
+ * @brief Per-vCPU virtual interrupt state.
+ */
+typedef struct vgic_state
+{
+    uint64_t pending[(VGIC_MAX_INTID + 63) / 64]; /**< interrupts waiting for a list register */
+    uint64_t hw[(VGIC_MAX_INTID + 63) / 64];      /**< interrupts backed by the same physical ID */
+    uint64_t lr[VGIC_MAX_LRS];                    /**< active list registers while not loaded */
+    uint64_t vmcr;                                /**< ICH_VMCR_EL2 while not loaded */
+    uint64_t ap1r0;                               /**< ICH_AP1R0_EL2 while not loaded */
+} vgic_state_t;
+
+/**
+ * @brief Enable the virtual CPU interface on the calling physical CPU.
+ */
+void vgic_init(void);
+
+/**
+ * @brief Mark a virtual interrupt pending for a vCPU.
+ *
+ * @param vcpu The target vCPU.
+ * @param intid The virtual interrupt ID.
+ */
+void vgic_inject(struct vcpu* vcpu, uint32_t intid);
+
+/**
+ * @brief Mark a virtual interrupt pending and link it to a physical one.
+ *
+ * The guest's deactivation of the virtual interrupt also deactivates the
+ * physical interrupt with the same ID.
+ *
+ * @param vcpu The target vCPU.
+ * @param intid The interrupt ID, both virtual and physical.
+ */
+void vgic_inject_hw(struct vcpu* vcpu, uint32_t intid);
+
+/**
+ * @brief Load pending virtual interrupts into free list registers.
+ *
+ * Must be called on the physical CPU the vCPU is about to run on.
+ *
+ * @param vcpu The vCPU about to run.
+ */
+void vgic_flush(struct vcpu* vcpu);
+
+/**
+ * @brief Unload the virtual CPU interface state of a vCPU.
+ *
+ * Interrupts that are only pending go back to the pending bitmap, so that
+ * vgic_has_pending() sees them, the others are kept with the vCPU. The
+ * list registers are left empty.
+ *
+ * @param vcpu The vCPU currently loaded on the calling physical CPU.
+ */
+void vgic_save(struct vcpu* vcpu);
+
+/**
+ * @brief Load the virtual CPU interface state of a vCPU.
+ *
+ * @param vcpu The vCPU about to run on the calling physical CPU.
+ */
+void vgic_restore(const struct vcpu* vcpu);
+
+/**
+ * @brief Check whether a vCPU has virtual interrupts waiting.
+ *
+ * @param vcpu The vCPU.
+ * @return Non-zero if an interrupt is pending in the bitmap.
+ */
+int vgic_has_pending(const struct vcpu* vcpu);
+
+/**
+ * @brief Emulate a trapped guest write to ICC_SGI1R_EL1.
+ *
+ * Supports the target list and the broadcast routing mode. Targets are
+ * vCPUs of the sender's VM by index, the SGI is made pending for each of
+ * them and each is woken with sched_ipi().
+ *
+ * @param vcpu The sending vCPU.
+ * @param esr The exception syndrome (EC 0x18).
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the trapped
+ *         instruction is not a write to ICC_SGI1R_EL1.
+ */
+status_t vgic_handle_sgi(struct vcpu* vcpu, uint64_t esr);
+
+#endif // VGIC_H
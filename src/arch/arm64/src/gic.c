@@ -0,0 +1,347 @@
+/**
+ * @file gic.c
+ * @brief Physical GICv3 distributor, redistributor and CPU interface.
+ *
+ * This file contains the bring-up of the physical GIC and the helpers to
+ * acknowledge, complete and send interrupts.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Redistributors are found by walking the frames from PLATFORM_GICR_BASE
+ * until GICR_TYPER.Affinity matches the calling CPU, the result is cached
+ * per CPU.
+ *
+ * ICC_CTLR_EL1.EOImode is 1, so dropping the priority and deactivating are
+ * separate steps. gic_eoi() does both for the hypervisor's own interrupts.
+ * For an SPI forwarded to a guest it only drops the priority: the guest
+ * deactivates the physical interrupt through the hardware list register
+ * it is injected with, and a level-triggered line cannot fire again before
+ * the guest has serviced the device.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the physical GIC driver.
+ */
+
+/* this module's header */
+#include "gic.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "platform.h"
+#include "smp.h"
+#include "sysreg.h"
+
+/* Distributor */
+#define GICD_CTLR            (0x0000U)                /**< Control register */
+#define GICD_CTLR_GRP0       (1U << 0)                /**< Enable group 0 */
+#define GICD_CTLR_GRP1       (1U << 1)                /**< Enable (non-secure) group 1 */
+#define GICD_CTLR_ARE        (1U << 4)                /**< Affinity routing */
+#define GICD_CTLR_RWP        (1U << 31)               /**< Register write pending */
+#define GICD_IGROUPR         (0x0080U)                /**< Interrupt group, one bit each */
+#define GICD_ISENABLER       (0x0100U)                /**< Set-enable, one bit each */
+#define GICD_ICENABLER       (0x0180U)                /**< Clear-enable, one bit each */
+#define GICD_IPRIORITYR      (0x0400U)                /**< Priorities, one byte each */
+#define GICD_IROUTER         (0x6000U)                /**< Affinity routing, 64 bits each */
+
+/* Redistributor, RD_base frame */
+#define GICR_FRAME_SIZE      (0x20000U)               /**< RD_base plus SGI_base */
+#define GICR_TYPER           (0x0008U)                /**< Type register (64-bit) */
+#define GICR_TYPER_LAST      (1ULL << 4)              /**< Last redistributor in the region */
+#define GICR_TYPER_AFF_SHIFT (32U)                    /**< Affinity value */
+#define GICR_WAKER           (0x0014U)                /**< Power management */
+#define GICR_WAKER_SLEEP     (1U << 1)                /**< ProcessorSleep */
+#define GICR_WAKER_ASLEEP    (1U << 2)                /**< ChildrenAsleep */
+
+/* Redistributor, SGI_base frame */
+#define GICR_SGI_BASE        (0x10000U)               /**< Offset of SGI_base from RD_base */
+#define GICR_IGROUPR0        (0x0080U)                /**< Interrupt group */
+#define GICR_ISENABLER0      (0x0100U)                /**< Set-enable */
+#define GICR_IPRIORITYR      (0x0400U)                /**< Priorities, one byte each */
+
+#define GIC_MAX_REDISTS      (128U)                   /**< Bound of the redistributor walk */
+
+/* CPU interface */
+#define ICC_PMR_ALL          (0xFFU)                  /**< Unmask every priority */
+#define ICC_IGRPEN1_EN       (1U << 0)                /**< Enable group 1 */
+#define ICC_CTLR_EOIMODE     (1U << 1)                /**< EOIR only drops the priority */
+#define ICC_IAR_INTID_MASK   (0xFFFFFFU)              /**< Interrupt ID field of ICC_IAR1_EL1 */
+#define ICC_SGI1R_INTID(id)  ((uint64_t)(id) << 24)   /**< SGI number */
+#define ICC_SGI1R_AFF1(a)    ((uint64_t)(a) << 16)    /**< Target affinity level 1 */
+
+#define GIC_REG32(addr) (*(volatile uint32_t*)(uintptr_t)(addr)) /**< 32-bit MMIO register */
+#define GIC_REG64(addr) (*(volatile uint64_t*)(uintptr_t)(addr)) /**< 64-bit MMIO register */
+
+static uintptr_t gic_rdist[SMP_MAX_CPUS];                       /* RD_base of each CPU, 0 if unknown */
+static uint64_t  gic_forwarded[(GIC_INTID_SPURIOUS + 63) / 64]; /* SPIs deactivated by a guest */
+
+/**
+ * @brief Get the RD_base of the calling CPU.
+ *
+ * @return The frame address, or 0 if it was not found.
+ */
+static uintptr_t gic_rdist_base(void)
+{
+    uint32_t cpu = smp_cpu_id(); /* Calling CPU */
+
+    return (cpu < SMP_MAX_CPUS) ? gic_rdist[cpu] : 0;
+}
+
+/**
+ * @brief Enable the distributor.
+ */
+void gic_init(void)
+{
+    GIC_REG32(PLATFORM_GICD_BASE + GICD_CTLR) = GICD_CTLR_ARE | GICD_CTLR_GRP1 | GICD_CTLR_GRP0;
+
+    while (GIC_REG32(PLATFORM_GICD_BASE + GICD_CTLR) & GICD_CTLR_RWP)
+    {
+    }
+}
+
+/**
+ * @brief Wake the calling CPU's redistributor and enable its CPU interface.
+ *
+ * @return STATUS_OK, or STATUS_ERR_NOT_FOUND if no redistributor matches
+ *         the calling CPU.
+ */
+status_t gic_cpu_init(void)
+{
+    uint64_t  mpidr = SYSREG_READ(mpidr_el1);                    /* Calling CPU */
+    uint32_t  aff   = (uint32_t)(mpidr & 0xFFFFFFULL);           /* Aff2.Aff1.Aff0 */
+    uint32_t  cpu   = (uint32_t)(mpidr & MPIDR_EL1_AFF0_MASK);   /* CPU number */
+    uintptr_t rd    = PLATFORM_GICR_BASE;                        /* Frame being probed */
+
+    if (cpu >= SMP_MAX_CPUS)
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    for (uint32_t i = 0; i < GIC_MAX_REDISTS; ++i, rd += GICR_FRAME_SIZE)
+    {
+        uint64_t typer = GIC_REG64(rd + GICR_TYPER); /* Frame affinity and flags */
+
+        if ((uint32_t)(typer >> GICR_TYPER_AFF_SHIFT) == aff)
+        {
+            gic_rdist[cpu] = rd;
+            break;
+        }
+        if (typer & GICR_TYPER_LAST)
+        {
+            return STATUS_ERR_NOT_FOUND;
+        }
+    }
+
+    if (0 == gic_rdist[cpu])
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    rd = gic_rdist[cpu];
+
+    GIC_REG32(rd + GICR_WAKER) &= ~GICR_WAKER_SLEEP;
+    while (GIC_REG32(rd + GICR_WAKER) & GICR_WAKER_ASLEEP)
+    {
+    }
+
+    /* Every private interrupt is group 1, none is enabled yet */
+    GIC_REG32(rd + GICR_SGI_BASE + GICR_IGROUPR0) = 0xFFFFFFFFU;
+
+    SYSREG_WRITE(S3_0_C4_C6_0, ICC_PMR_ALL);                                      /* ICC_PMR_EL1 */
+    SYSREG_WRITE(S3_0_C12_C12_4, SYSREG_READ(S3_0_C12_C12_4) | ICC_CTLR_EOIMODE); /* ICC_CTLR_EL1 */
+    SYSREG_WRITE(S3_0_C12_C12_7, ICC_IGRPEN1_EN);                                 /* ICC_IGRPEN1_EL1 */
+    ISB();
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Enable an SGI or PPI on the calling CPU.
+ *
+ * @param intid The interrupt ID, below 32.
+ * @param priority The interrupt priority, lower is more urgent.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NOT_FOUND if the
+ *         calling CPU's redistributor is unknown.
+ */
+status_t gic_enable_private(uint32_t intid, uint8_t priority)
+{
+    uintptr_t sgi = gic_rdist_base(); /* SGI_base of the calling CPU */
+
+    if (intid >= 32)
+    {
+        return STATUS_ERR_INVALID;
+    }
+    if (0 == sgi)
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    sgi += GICR_SGI_BASE;
+
+    *(volatile uint8_t*)(sgi + GICR_IPRIORITYR + intid) = priority;
+    GIC_REG32(sgi + GICR_ISENABLER0)                     = 1U << intid;
+    DSB(sy);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Get the affinity routing value of a CPU.
+ *
+ * @param cpu The CPU number.
+ * @return The GICD_IROUTER value, in the caller's cluster.
+ */
+static uint64_t gic_affinity(uint32_t cpu)
+{
+    return (SYSREG_READ(mpidr_el1) & 0xFF00ULL) | (cpu & 0xFFU);
+}
+
+/**
+ * @brief Forward an SPI to a guest.
+ *
+ * Makes the SPI group 1, routes it to a CPU and enables it. From then on
+ * gic_eoi() leaves its deactivation to the guest, which must receive it
+ * with vgic_inject_hw().
+ *
+ * @param intid The interrupt ID, an SPI.
+ * @param cpu The CPU number to route it to.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t gic_forward_spi(uint32_t intid, uint32_t cpu)
+{
+    if ((intid < 32) || (intid >= GIC_INTID_SPURIOUS) || (cpu >= SMP_MAX_CPUS))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    __atomic_fetch_or(&gic_forwarded[intid / 64], 1ULL << (intid % 64), __ATOMIC_RELAXED);
+
+    GIC_REG32(PLATFORM_GICD_BASE + GICD_IGROUPR + ((intid / 32) * 4)) |= 1U << (intid % 32);
+    *(volatile uint8_t*)(uintptr_t)(PLATFORM_GICD_BASE + GICD_IPRIORITYR + intid) = GIC_PRIORITY_DFLT;
+    GIC_REG64(PLATFORM_GICD_BASE + GICD_IROUTER + (intid * 8)) = gic_affinity(cpu);
+    GIC_REG32(PLATFORM_GICD_BASE + GICD_ISENABLER + ((intid / 32) * 4)) = 1U << (intid % 32);
+    DSB(sy);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Route a forwarded SPI to another CPU.
+ *
+ * @param intid The interrupt ID, an SPI.
+ * @param cpu The CPU number.
+ */
+void gic_route_spi(uint32_t intid, uint32_t cpu)
+{
+    if ((intid < 32) || (intid >= GIC_INTID_SPURIOUS) || (cpu >= SMP_MAX_CPUS))
+    {
+        return;
+    }
+
+    GIC_REG64(PLATFORM_GICD_BASE + GICD_IROUTER + (intid * 8)) = gic_affinity(cpu);
+    DSB(sy);
+}
+
+/**
+ * @brief Stop forwarding an SPI and disable it.
+ *
+ * @param intid The interrupt ID, an SPI.
+ */
+void gic_release_spi(uint32_t intid)
+{
+    if ((intid < 32) || (intid >= GIC_INTID_SPURIOUS))
+    {
+        return;
+    }
+
+    GIC_REG32(PLATFORM_GICD_BASE + GICD_ICENABLER + ((intid / 32) * 4)) = 1U << (intid % 32);
+    while (GIC_REG32(PLATFORM_GICD_BASE + GICD_CTLR) & GICD_CTLR_RWP)
+    {
+    }
+
+    __atomic_fetch_and(&gic_forwarded[intid / 64], ~(1ULL << (intid % 64)), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Acknowledge the highest priority pending interrupt.
+ *
+ * @return The interrupt ID, GIC_INTID_SPURIOUS or above if none is pending.
+ */
+uint32_t gic_ack(void)
+{
+    uint32_t intid = (uint32_t)(SYSREG_READ(S3_0_C12_C12_0) & ICC_IAR_INTID_MASK); /* ICC_IAR1_EL1 */
+
+    DSB(sy);
+
+    return intid;
+}
+
+/**
+ * @brief Check for a pending interrupt without acknowledging it.
+ *
+ * @return Non-zero if an interrupt is pending.
+ */
+int gic_pending(void)
+{
+    return (SYSREG_READ(S3_0_C12_C12_2) & ICC_IAR_INTID_MASK) < GIC_INTID_SPURIOUS; /* ICC_HPPIR1_EL1 */
+}
+
+/**
+ * @brief Drop the priority of and deactivate an acknowledged interrupt.
+ *
+ * A forwarded SPI is only dropped, the guest deactivates it.
+ *
+ * @param intid The interrupt ID returned by gic_ack().
+ */
+void gic_eoi(uint32_t intid)
+{
+    SYSREG_WRITE(S3_0_C12_C12_1, intid); /* ICC_EOIR1_EL1 */
+
+    if ((intid >= GIC_INTID_SPURIOUS) ||
+        !(__atomic_load_n(&gic_forwarded[intid / 64], __ATOMIC_RELAXED) & (1ULL << (intid % 64))))
+    {
+        SYSREG_WRITE(S3_0_C12_C11_1, intid); /* ICC_DIR_EL1 */
+    }
+    ISB();
+}
+
+/**
+ * @brief Send a software generated interrupt to another CPU.
+ *
+ * @param cpu The target CPU number.
+ * @param intid The SGI number, below 16.
+ */
+void gic_send_sgi(uint32_t cpu, uint32_t intid)
+{
+    uint64_t aff1 = (SYSREG_READ(mpidr_el1) >> 8) & 0xFFULL; /* Same cluster as the caller */
+
+    DSB(ishst);
+    SYSREG_WRITE(S3_0_C12_C11_5, ICC_SGI1R_INTID(intid & 0xFU) | ICC_SGI1R_AFF1(aff1) | (1ULL << (cpu & 0xFU))); /* ICC_SGI1R_EL1 */
+    ISB();
+}
@@ -0,0 +1,150 @@
+/**
+ * @file smp.c
+ * @brief Secondary CPU bring-up.
+ *
+ * This file contains the PSCI calls that start and stop secondary CPUs
+ * and the per-CPU initialization they run before their entry function.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The entry function and its argument are published in per-CPU slots
+ * before CPU_ON. The new CPU starts with its MMU off, so it turns the MMU
+ * on with the tables built by the boot CPU before it takes any lock:
+ * exclusive accesses need Normal memory.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of secondary CPU bring-up.
+ */
+
+/* this module's header */
+#include "smp.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "gic.h"
+#include "mmu.h"
+#include "stage2.h"
+#include "sync.h"
+#include "trap.h"
+#include "vgic.h"
+
+extern void smp_secondary_entry(void); /* Defined in smp_entry.s */
+
+uint8_t smp_stacks[SMP_MAX_CPUS][SMP_STACK_SIZE] __attribute__((aligned(16))); /* Secondary CPU stacks, used by smp_entry.s */
+
+static smp_entry_fn_t smp_entry[SMP_MAX_CPUS]; /* Function each CPU runs */
+static void*          smp_arg[SMP_MAX_CPUS];   /* Argument of that function */
+
+/**
+ * @brief Issue a PSCI call.
+ *
+ * @param fn PSCI function ID.
+ * @param a1 First argument.
+ * @param a2 Second argument.
+ * @param a3 Third argument.
+ * @return The PSCI return code.
+ */
+static int64_t smp_psci(uint64_t fn, uint64_t a1, uint64_t a2, uint64_t a3)
+{
+    register uint64_t x0 asm("x0") = fn;
+    register uint64_t x1 asm("x1") = a1;
+    register uint64_t x2 asm("x2") = a2;
+    register uint64_t x3 asm("x3") = a3;
+
+    asm volatile("smc #0"
+                 : "+r"(x0)
+                 : "r"(x1), "r"(x2), "r"(x3)
+                 : "memory");
+
+    return (int64_t)x0;
+}
+
+/**
+ * @brief Start a secondary CPU.
+ *
+ * @param cpu The CPU number, 1 to SMP_MAX_CPUS - 1.
+ * @param fn Function to run on it, the CPU powers off when it returns.
+ * @param arg Argument passed to fn.
+ * @return STATUS_OK, STATUS_ERR_NOT_FOUND if the CPU does not exist,
+ *         STATUS_ERR_BUSY if it is running, or STATUS_ERR_INVALID.
+ */
+status_t smp_cpu_on(uint32_t cpu, smp_entry_fn_t fn, void* arg)
+{
+    int64_t ret = PSCI_SUCCESS; /* PSCI return code */
+
+    if ((0 == cpu) || (cpu >= SMP_MAX_CPUS) || (NULL == fn))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    smp_entry[cpu] = fn;
+    smp_arg[cpu]   = arg;
+    DSB(ish);
+
+    ret = smp_psci(PSCI_CPU_ON, cpu, (uintptr_t)smp_secondary_entry, cpu);
+    switch (ret)
+    {
+    case PSCI_SUCCESS:
+        return STATUS_OK;
+    case PSCI_INVALID_PARAMETERS:
+        return STATUS_ERR_NOT_FOUND;
+    case PSCI_ALREADY_ON:
+    case PSCI_ON_PENDING:
+        return STATUS_ERR_BUSY;
+    default:
+        return STATUS_ERR_INVALID;
+    }
+}
+
+/**
+ * @brief C entry of a secondary CPU, called from smp_entry.s.
+ *
+ * @param cpu The CPU number passed as the PSCI context ID.
+ */
+void smp_secondary_main(uint64_t cpu)
+{
+    mmu_enable();     // Same stage-1 tables as the boot CPU
+    trap_init();      // Install the EL2 exception vectors
+    vgic_init();      // Enable the virtual CPU interface
+    gic_cpu_init();   // Route this CPU's private interrupts
+    stage2_hw_init(); // Configure the stage-2 translation layout
+    sync_cpu_init();  // Bound WFE waits with the event stream
+
+    SYSREG_WRITE(tpidr_el2, 0); // No vCPU loaded yet
+    ISB();
+
+    smp_entry[cpu]((uint32_t)cpu, smp_arg[cpu]);
+
+    (void)smp_psci(PSCI_CPU_OFF, 0, 0, 0);
+    for (;;)
+    {
+        WFI();
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file smp_entry.s
+ * @brief Secondary CPU entry point.
+ *
+ * This file contains the code a secondary CPU executes first after PSCI
+ * CPU_ON.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * PSCI starts the CPU at EL2 with the MMU off and the context ID (the CPU
+ * number) in x0. The entry selects the CPU's stack from smp_stacks and
+ * calls smp_secondary_main(), which does not return.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Secondary CPU stack setup and transition to C.
+ *
+ * @section examples Examples
+ * No examples available for assembly bootstrapping code.
+ */
+
+/* Must match SMP_STACK_SIZE in smp.h */
+.equ SMP_STACK_SIZE, 0x4000
+
+.section .text
+.global smp_secondary_entry
+
+smp_secondary_entry:
+    // Stack top of this CPU: smp_stacks + (cpu + 1) * SMP_STACK_SIZE
+    ldr x1, =smp_stacks
+    add x2, x0, #1
+    mov x3, #SMP_STACK_SIZE
+    madd x1, x2, x3, x1
+    mov sp, x1
+
+    // x0 still holds the CPU number
+    bl smp_secondary_main
+    b .
@@ -0,0 +1,233 @@
+/**
+ * @file trap.c
+ * @brief EL2 exception vectors and trap handling.
+ *
+ * This file contains the C side of the EL2 exception handling: it decodes
+ * the exception syndrome of a guest trap and dispatches it to the module
+ * that emulates it.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A trap that cannot be handled is fatal for the whole system for now:
+ * the syndrome is logged and the core is halted.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the guest trap dispatcher.
+ */
+
+/* module includes */
+#include "trap.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "gic.h"
+#include "hypercall.h"
+#include "logging.h"
+#include "passthrough.h"
+#include "sched.h"
+#include "status.h"
+#include "sysreg.h"
+#include "trace.h"
+#include "vgic.h"
+#include "vm.h"
+#include "xlate.h"
+
+/* Hypervisor IPA Fault Address Register */
+#define HPFAR_EL2_FIPA_MASK  (0x00000FFFFFFFFFF0ULL) /**< IPA[51:12] of the faulting page */
+#define HPFAR_EL2_FIPA_SHIFT (8ULL)                  /**< Shift to turn FIPA into an address */
+
+#define FAR_PAGE_OFFSET_MASK (0xFFFULL) /**< Offset of the faulting address in its page */
+
+#define AARCH64_INSN_SIZE (4ULL) /**< Size of a trapped instruction */
+
+extern char el2_vector_table[]; /* Defined in vectors.s */
+
+/**
+ * @brief Log a trap that cannot be handled and halt the core.
+ *
+ * @param frame The trap frame.
+ * @param esr The exception syndrome.
+ * @param status The status returned by the handler.
+ */
+static void trap_fatal(const trap_frame_t* frame, uint64_t esr, status_t status)
+{
+    LOG_CRIT("Unhandled guest trap: esr=0x%lx elr=0x%lx far=0x%lx status=%d\n\r",
+             esr,
+             frame->elr,
+             SYSREG_READ(far_el2),
+             status);
+
+    for (;;)
+    {
+        WFI();
+    }
+}
+
+/**
+ * @brief Install the EL2 exception vector table.
+ */
+void trap_init(void)
+{
+    SYSREG_WRITE(vbar_el2, (uintptr_t)el2_vector_table);
+    ISB();
+}
+
+/**
+ * @brief Handle a synchronous exception taken from a guest.
+ *
+ * @param frame The trap frame of the current vCPU.
+ */
+void trap_handle_sync(trap_frame_t* frame)
+{
+    uint64_t esr    = SYSREG_READ(esr_el2);     /* Exception syndrome */
+    vcpu_t*  vcpu   = (vcpu_t*)frame;           /* The frame is the first member of the vCPU */
+    status_t status = STATUS_ERR_NOT_SUPPORTED; /* Handler status */
+
+    trace_exit_begin(TRACE_EXIT_SYNC, vcpu->vm->id, vcpu->id, esr, frame->elr);
+
+    switch (ESR_EC(esr))
+    {
+    case ESR_EC_DABT_LOW:
+    case ESR_EC_IABT_LOW:
+    {
+        uint64_t ipa = ((SYSREG_READ(hpfar_el2) & HPFAR_EL2_FIPA_MASK) << HPFAR_EL2_FIPA_SHIFT) |
+                       (SYSREG_READ(far_el2) & FAR_PAGE_OFFSET_MASK);
+
+        status = vm_handle_abort(vcpu, esr, ipa);
+        break;
+    }
+    case ESR_EC_HVC64:
+        /* ELR_EL2 already points past the HVC */
+        status = hypercall_handle(vcpu);
+        break;
+    case ESR_EC_WFX:
+        /* ELR_EL2 points at the trapped instruction */
+        frame->elr += AARCH64_INSN_SIZE;
+        if (ESR_ISS(esr) & ESR_WFX_TI_WFE)
+        {
+            sched_yield(vcpu);
+        }
+        else
+        {
+            sched_wait(vcpu);
+        }
+        status = STATUS_OK;
+        break;
+    case ESR_EC_SYS64:
+        /* TLB maintenance is trapped, see xlate_va(), and so is SGI generation */
+        status = xlate_handle_tlbi(vcpu, esr);
+        if (STATUS_ERR_NOT_SUPPORTED == status)
+        {
+            status = vgic_handle_sgi(vcpu, esr);
+        }
+        if (STATUS_OK == status)
+        {
+            frame->elr += AARCH64_INSN_SIZE;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (STATUS_OK != status)
+    {
+        trap_fatal(frame, esr, status);
+    }
+}
+
+/**
+ * @brief Handle a physical IRQ taken while a guest was running.
+ *
+ * @param frame The trap frame of the current vCPU.
+ */
+void trap_handle_irq(trap_frame_t* frame)
+{
+    uint32_t intid  = gic_ack();                /* Acknowledged interrupt */
+    vcpu_t*  vcpu   = (vcpu_t*)frame;           /* The frame is the first member of the vCPU */
+    status_t status = STATUS_ERR_NOT_SUPPORTED; /* Handler status */
+
+    if (intid >= GIC_INTID_SPURIOUS)
+    {
+        return;
+    }
+
+    trace_exit_begin(TRACE_EXIT_IRQ, vcpu->vm->id, vcpu->id, 0, intid);
+
+    status = sched_irq(intid);
+    if (STATUS_ERR_NOT_SUPPORTED == status)
+    {
+        status = passthrough_irq(intid);
+    }
+    if (STATUS_OK != status)
+    {
+        LOG_WARNING("Unhandled physical IRQ %u\n\r", intid);
+    }
+
+    gic_eoi(intid);
+
+    /* Only after the EOI: the scheduler may idle on this CPU */
+    if (STATUS_OK == status)
+    {
+        sched_preempt();
+    }
+}
+
+/**
+ * @brief Handle an exception that should never be taken.
+ *
+ * @param type Index of the vector table entry that was taken.
+ */
+void trap_handle_invalid(uint64_t type)
+{
+    LOG_EMERG("Unexpected exception %lu: esr=0x%lx elr=0x%lx far=0x%lx\n\r",
+              type,
+              SYSREG_READ(esr_el2),
+              SYSREG_READ(elr_el2),
+              SYSREG_READ(far_el2));
+
+    for (;;)
+    {
+        WFI();
+    }
+}
+
+/**
+ * @brief Prepare the current vCPU for guest entry.
+ *
+ * Called from vectors.s right before the trap frame is restored.
+ */
+void trap_exit_prepare(void)
+{
+    vcpu_t* vcpu = vcpu_current(); /* vCPU about to be entered */
+
+    vgic_flush(vcpu);
+    vcpu_sync_traps(vcpu);
+    trace_exit_end();
+}
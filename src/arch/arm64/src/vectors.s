@@ -0,0 +1,183 @@
+/**
+ * @file vectors.s
+ * @brief EL2 exception vector table.
+ *
+ * This file contains the EL2 exception vector table together with the
+ * code that saves and restores guest state around trap handlers.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * TPIDR_EL2 holds the address of the current vCPU, whose trap frame
+ * (see trap_frame_t in trap.h) is its first member. On entry from a lower
+ * EL the guest x0-x30, ELR_EL2 and SPSR_EL2 are stored into that frame and
+ * the C handler is called with its address. On the way out the frame of
+ * whichever vCPU TPIDR_EL2 then points to is restored, so a handler may
+ * switch vCPUs simply by updating TPIDR_EL2.
+ *
+ * Exceptions taken from EL2 itself indicate a hypervisor bug and are
+ * reported through trap_handle_invalid().
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Exception vector table and guest context save/restore.
+ *
+ * @section examples Examples
+ * No examples available for assembly vector code.
+ */
+
+/* Trap frame offsets, must match trap_frame_t */
+.equ FRAME_X0,   0
+.equ FRAME_ELR,  248
+.equ FRAME_SPSR, 256
+
+/**
+ * @brief Save the guest registers into the current vCPU trap frame.
+ *
+ * Leaves the address of the trap frame in x0.
+ */
+.macro save_guest_ctx
+    // Free up x0/x1 on the EL2 stack
+    stp x0, x1, [sp, #-16]!
+    // Load the current vCPU trap frame
+    mrs x0, tpidr_el2
+    // Save x2-x30
+    stp x2, x3, [x0, #16]
+    stp x4, x5, [x0, #32]
+    stp x6, x7, [x0, #48]
+    stp x8, x9, [x0, #64]
+    stp x10, x11, [x0, #80]
+    stp x12, x13, [x0, #96]
+    stp x14, x15, [x0, #112]
+    stp x16, x17, [x0, #128]
+    stp x18, x19, [x0, #144]
+    stp x20, x21, [x0, #160]
+    stp x22, x23, [x0, #176]
+    stp x24, x25, [x0, #192]
+    stp x26, x27, [x0, #208]
+    stp x28, x29, [x0, #224]
+    str x30, [x0, #240]
+    // Save the original x0/x1
+    ldp x2, x3, [sp], #16
+    stp x2, x3, [x0, #FRAME_X0]
+    // Save the guest return state
+    mrs x2, elr_el2
+    mrs x3, spsr_el2
+    stp x2, x3, [x0, #FRAME_ELR]
+.endm
+
+/**
+ * @brief Vector table entry.
+ *
+ * Each entry is 0x80 bytes long and branches to its handler.
+ */
+.macro ventry label
+    .balign 0x80
+    b \label
+.endm
+
+/**
+ * @brief Vector table entry for unexpected exceptions.
+ */
+.macro vinvalid type
+    .balign 0x80
+    mov x0, #\type
+    b invalid_exception
+.endm
+
+.section .text
+.balign 0x800
+.global el2_vector_table
+el2_vector_table:
+    // Current EL with SP_EL0
+    vinvalid 0
+    vinvalid 1
+    vinvalid 2
+    vinvalid 3
+    // Current EL with SP_ELx
+    vinvalid 4
+    vinvalid 5
+    vinvalid 6
+    vinvalid 7
+    // Lower EL using AArch64
+    ventry lower_el_sync
+    ventry lower_el_irq
+    vinvalid 10
+    vinvalid 11
+    // Lower EL using AArch32
+    vinvalid 12
+    vinvalid 13
+    vinvalid 14
+    vinvalid 15
+
+lower_el_sync:
+    save_guest_ctx
+    // Dispatch on the exception syndrome
+    bl trap_handle_sync
+    b trap_guest_enter
+
+lower_el_irq:
+    save_guest_ctx
+    // Acknowledge and route the physical interrupt
+    bl trap_handle_irq
+    b trap_guest_enter
+
+invalid_exception:
+    // Report the exception, does not return
+    bl trap_handle_invalid
+    b .
+
+/**
+ * @brief Restore the current vCPU trap frame and return to the guest.
+ */
+.global trap_guest_enter
+trap_guest_enter:
+    // Let C code finalize the vCPU state (pending virtual interrupts, ...)
+    bl trap_exit_prepare
+    // Load the trap frame of the (possibly new) current vCPU
+    mrs x0, tpidr_el2
+    // Restore the guest return state
+    ldp x2, x3, [x0, #FRAME_ELR]
+    msr elr_el2, x2
+    msr spsr_el2, x3
+    // Restore x2-x30
+    ldp x2, x3, [x0, #16]
+    ldp x4, x5, [x0, #32]
+    ldp x6, x7, [x0, #48]
+    ldp x8, x9, [x0, #64]
+    ldp x10, x11, [x0, #80]
+    ldp x12, x13, [x0, #96]
+    ldp x14, x15, [x0, #112]
+    ldp x16, x17, [x0, #128]
+    ldp x18, x19, [x0, #144]
+    ldp x20, x21, [x0, #160]
+    ldp x22, x23, [x0, #176]
+    ldp x24, x25, [x0, #192]
+    ldp x26, x27, [x0, #208]
+    ldp x28, x29, [x0, #224]
+    ldr x30, [x0, #240]
+    // Restore x0/x1 last since x0 holds the frame address
+    ldp x0, x1, [x0, #FRAME_X0]
+    eret
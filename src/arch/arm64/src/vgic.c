@@ -0,0 +1,436 @@
+/**
+ * @file vgic.c
+ * @brief Virtual interrupt injection through the GICv3 list registers.
+ *
+ * This file contains the implementation of virtual interrupt injection
+ * using the GICv3 virtual CPU interface.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The list registers are accessed through their S3_4_C12_C1x_y encodings
+ * so that no particular assembler GIC extension is required.
+ *
+ * A guest sends SGIs by writing ICC_SGI1R_EL1, which traps to EL2 while
+ * HCR_EL2.IMO is set. The write is decoded against the guest's MPIDR
+ * layout, where Aff0 is the vCPU index and the higher levels are zero,
+ * and the SGI is queued for each target in the VM. Targets that are not
+ * vCPUs of the VM are ignored, as the GIC ignores absent PEs.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the GICv3 list register based virtual interrupt
+ * injection.
+ */
+
+/* module includes */
+#include "vgic.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "sched.h"
+#include "sysreg.h"
+#include "trap.h"
+#include "vm.h"
+
+/* GIC system register interface */
+#define ICC_SRE_EL2_SRE    (1ULL << 0) /**< System register interface enable */
+#define ICC_SRE_EL2_ENABLE (1ULL << 3) /**< Allow EL1 access to ICC_SRE_EL1 */
+#define ICH_HCR_EL2_EN     (1ULL << 0) /**< Virtual CPU interface enable */
+#define ICH_VTR_LISTREGS   (0x1FULL)   /**< Number of list registers minus one */
+
+/* List register fields */
+#define ICH_LR_VINTID(id)    ((uint64_t)(id))               /**< Virtual interrupt ID */
+#define ICH_LR_PINTID(id)    ((uint64_t)(id) << 32)         /**< Physical interrupt ID */
+#define ICH_LR_PRIORITY(pri) ((uint64_t)(pri) << 48)        /**< Interrupt priority */
+#define ICH_LR_GROUP1        (1ULL << 60)                   /**< Group 1 interrupt */
+#define ICH_LR_HW            (1ULL << 61)                   /**< Linked to a physical interrupt */
+#define ICH_LR_PENDING       (1ULL << 62)                   /**< State: pending */
+#define ICH_LR_STATE_MASK    (3ULL << 62)                   /**< State mask */
+#define ICH_LR_INTID_MASK    (0xFFFFFFFFULL)                /**< Virtual interrupt ID mask */
+
+/* ICC_SGI1R_EL1 as trapped from EL1: op0 3, op1 0, CRn 12, CRm 11, op2 5 */
+#define ESR_SYS_SGI1R(esr)   ((3ULL == ESR_SYS_OP0(esr)) && (0ULL == ESR_SYS_OP1(esr)) && (12ULL == ESR_SYS_CRN(esr)) && \
+                              (11ULL == ESR_SYS_CRM(esr)) && (5ULL == ESR_SYS_OP2(esr)))
+
+/* ICC_SGI1R_EL1 fields */
+#define ICC_SGI1R_TARGETS(v) ((uint32_t)((v) & 0xFFFFULL))        /**< Aff0 target list */
+#define ICC_SGI1R_INTID(v)   ((uint32_t)(((v) >> 24) & 0xFULL))   /**< SGI number */
+#define ICC_SGI1R_IRM        (1ULL << 40)                         /**< Every PE but the sender */
+#define ICC_SGI1R_ROUTE_MASK (0x00FFF0FF00FF0000ULL)              /**< Aff3, RS, Aff2 and Aff1 */
+
+static uint32_t vgic_num_lrs = 0; /* Implemented list registers */
+
+/**
+ * @brief Read a list register.
+ *
+ * @param n The list register index.
+ * @return The list register value.
+ */
+static uint64_t vgic_read_lr(uint32_t n)
+{
+    switch (n)
+    {
+    case 0:
+        return SYSREG_READ(S3_4_C12_C12_0);
+    case 1:
+        return SYSREG_READ(S3_4_C12_C12_1);
+    case 2:
+        return SYSREG_READ(S3_4_C12_C12_2);
+    case 3:
+        return SYSREG_READ(S3_4_C12_C12_3);
+    case 4:
+        return SYSREG_READ(S3_4_C12_C12_4);
+    case 5:
+        return SYSREG_READ(S3_4_C12_C12_5);
+    case 6:
+        return SYSREG_READ(S3_4_C12_C12_6);
+    case 7:
+        return SYSREG_READ(S3_4_C12_C12_7);
+    case 8:
+        return SYSREG_READ(S3_4_C12_C13_0);
+    case 9:
+        return SYSREG_READ(S3_4_C12_C13_1);
+    case 10:
+        return SYSREG_READ(S3_4_C12_C13_2);
+    case 11:
+        return SYSREG_READ(S3_4_C12_C13_3);
+    case 12:
+        return SYSREG_READ(S3_4_C12_C13_4);
+    case 13:
+        return SYSREG_READ(S3_4_C12_C13_5);
+    case 14:
+        return SYSREG_READ(S3_4_C12_C13_6);
+    default:
+        return SYSREG_READ(S3_4_C12_C13_7);
+    }
+}
+
+/**
+ * @brief Write a list register.
+ *
+ * @param n The list register index.
+ * @param val The value to write.
+ */
+static void vgic_write_lr(uint32_t n, uint64_t val)
+{
+    switch (n)
+    {
+    case 0:
+        SYSREG_WRITE(S3_4_C12_C12_0, val);
+        break;
+    case 1:
+        SYSREG_WRITE(S3_4_C12_C12_1, val);
+        break;
+    case 2:
+        SYSREG_WRITE(S3_4_C12_C12_2, val);
+        break;
+    case 3:
+        SYSREG_WRITE(S3_4_C12_C12_3, val);
+        break;
+    case 4:
+        SYSREG_WRITE(S3_4_C12_C12_4, val);
+        break;
+    case 5:
+        SYSREG_WRITE(S3_4_C12_C12_5, val);
+        break;
+    case 6:
+        SYSREG_WRITE(S3_4_C12_C12_6, val);
+        break;
+    case 7:
+        SYSREG_WRITE(S3_4_C12_C12_7, val);
+        break;
+    case 8:
+        SYSREG_WRITE(S3_4_C12_C13_0, val);
+        break;
+    case 9:
+        SYSREG_WRITE(S3_4_C12_C13_1, val);
+        break;
+    case 10:
+        SYSREG_WRITE(S3_4_C12_C13_2, val);
+        break;
+    case 11:
+        SYSREG_WRITE(S3_4_C12_C13_3, val);
+        break;
+    case 12:
+        SYSREG_WRITE(S3_4_C12_C13_4, val);
+        break;
+    case 13:
+        SYSREG_WRITE(S3_4_C12_C13_5, val);
+        break;
+    case 14:
+        SYSREG_WRITE(S3_4_C12_C13_6, val);
+        break;
+    default:
+        SYSREG_WRITE(S3_4_C12_C13_7, val);
+        break;
+    }
+}
+
+/**
+ * @brief Enable the virtual CPU interface on the calling physical CPU.
+ */
+void vgic_init(void)
+{
+    uint64_t sre = SYSREG_READ(S3_4_C12_C9_5); /* ICC_SRE_EL2 */
+
+    SYSREG_WRITE(S3_4_C12_C9_5, sre | ICC_SRE_EL2_SRE | ICC_SRE_EL2_ENABLE);
+    ISB();
+
+    vgic_num_lrs = (uint32_t)(SYSREG_READ(S3_4_C12_C11_1) & ICH_VTR_LISTREGS) + 1; /* ICH_VTR_EL2 */
+    if (vgic_num_lrs > VGIC_MAX_LRS)
+    {
+        vgic_num_lrs = VGIC_MAX_LRS;
+    }
+
+    for (uint32_t i = 0; i < vgic_num_lrs; ++i)
+    {
+        vgic_write_lr(i, 0x0ULL);
+    }
+
+    SYSREG_WRITE(S3_4_C12_C11_0, ICH_HCR_EL2_EN); /* ICH_HCR_EL2 */
+    ISB();
+}
+
+/**
+ * @brief Mark a virtual interrupt pending for a vCPU.
+ *
+ * @param vcpu The target vCPU.
+ * @param intid The virtual interrupt ID.
+ */
+void vgic_inject(struct vcpu* vcpu, uint32_t intid)
+{
+    if ((NULL == vcpu) || (intid >= VGIC_MAX_INTID))
+    {
+        return;
+    }
+
+    __atomic_fetch_or(&vcpu->vgic.pending[intid / 64], 1ULL << (intid % 64), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Mark a virtual interrupt pending and link it to a physical one.
+ *
+ * @param vcpu The target vCPU.
+ * @param intid The interrupt ID, both virtual and physical.
+ */
+void vgic_inject_hw(struct vcpu* vcpu, uint32_t intid)
+{
+    if ((NULL == vcpu) || (intid >= VGIC_MAX_INTID))
+    {
+        return;
+    }
+
+    __atomic_fetch_or(&vcpu->vgic.hw[intid / 64], 1ULL << (intid % 64), __ATOMIC_RELAXED);
+    vgic_inject(vcpu, intid);
+}
+
+/**
+ * @brief Load pending virtual interrupts into free list registers.
+ *
+ * @param vcpu The vCPU about to run.
+ */
+void vgic_flush(struct vcpu* vcpu)
+{
+    uint64_t elrsr = 0x0ULL; /* Empty list register status */
+
+    if ((NULL == vcpu) || (0 == vgic_num_lrs) || !vgic_has_pending(vcpu))
+    {
+        return;
+    }
+
+    elrsr = SYSREG_READ(S3_4_C12_C11_5); /* ICH_ELRSR_EL2 */
+
+    for (uint32_t word = 0; word < sizeof(vcpu->vgic.pending) / sizeof(vcpu->vgic.pending[0]); ++word)
+    {
+        uint64_t bits = __atomic_exchange_n(&vcpu->vgic.pending[word], 0x0ULL, __ATOMIC_ACQUIRE);
+
+        while (0x0ULL != bits)
+        {
+            uint32_t intid = (word * 64) + (uint32_t)__builtin_ctzll(bits);
+            uint32_t lr    = 0;
+            uint64_t val   = 0x0ULL;
+
+            bits &= bits - 1;
+
+            /* Already in a list register: mark it pending again in place */
+            for (lr = 0; lr < vgic_num_lrs; ++lr)
+            {
+                val = vgic_read_lr(lr);
+                if (!(elrsr & (1ULL << lr)) && ((val & ICH_LR_INTID_MASK) == intid))
+                {
+                    break;
+                }
+            }
+            if (lr < vgic_num_lrs)
+            {
+                if (val & ICH_LR_HW)
+                {
+                    /* Pending and active is not allowed for hardware interrupts */
+                    vgic_inject(vcpu, intid);
+                }
+                else
+                {
+                    vgic_write_lr(lr, val | ICH_LR_PENDING);
+                }
+                continue;
+            }
+
+            if (0x0ULL == (elrsr & ((1ULL << vgic_num_lrs) - 1)))
+            {
+                /* No free list register, keep it pending for the next entry */
+                vgic_inject(vcpu, intid);
+                continue;
+            }
+
+            lr  = (uint32_t)__builtin_ctzll(elrsr);
+            val = ICH_LR_VINTID(intid) | ICH_LR_PRIORITY(VGIC_PRIORITY_DFLT) | ICH_LR_GROUP1 | ICH_LR_PENDING;
+            if (vcpu->vgic.hw[word] & (1ULL << (intid % 64)))
+            {
+                val |= ICH_LR_HW | ICH_LR_PINTID(intid);
+            }
+            vgic_write_lr(lr, val);
+            elrsr &= ~(1ULL << lr);
+        }
+    }
+
+    ISB();
+}
+
+/**
+ * @brief Unload the virtual CPU interface state of a vCPU.
+ *
+ * @param vcpu The vCPU currently loaded on the calling physical CPU.
+ */
+void vgic_save(struct vcpu* vcpu)
+{
+    vgic_state_t* vgic = &vcpu->vgic; /* Saved state */
+
+    vgic->vmcr  = SYSREG_READ(S3_4_C12_C11_7); /* ICH_VMCR_EL2 */
+    vgic->ap1r0 = SYSREG_READ(S3_4_C12_C9_0);  /* ICH_AP1R0_EL2 */
+
+    for (uint32_t i = 0; i < vgic_num_lrs; ++i)
+    {
+        uint64_t val = vgic_read_lr(i); /* List register contents */
+
+        vgic->lr[i] = 0x0ULL;
+        if ((val & ICH_LR_STATE_MASK) == ICH_LR_PENDING)
+        {
+            /* Not taken by the guest yet, it may land in any list register later */
+            vgic_inject(vcpu, (uint32_t)(val & ICH_LR_INTID_MASK));
+        }
+        else if (0x0ULL != (val & ICH_LR_STATE_MASK))
+        {
+            vgic->lr[i] = val;
+        }
+
+        vgic_write_lr(i, 0x0ULL);
+    }
+
+    ISB();
+}
+
+/**
+ * @brief Load the virtual CPU interface state of a vCPU.
+ *
+ * @param vcpu The vCPU about to run on the calling physical CPU.
+ */
+void vgic_restore(const struct vcpu* vcpu)
+{
+    const vgic_state_t* vgic = &vcpu->vgic; /* Saved state */
+
+    SYSREG_WRITE(S3_4_C12_C11_7, vgic->vmcr); /* ICH_VMCR_EL2 */
+    SYSREG_WRITE(S3_4_C12_C9_0, vgic->ap1r0); /* ICH_AP1R0_EL2 */
+
+    for (uint32_t i = 0; i < vgic_num_lrs; ++i)
+    {
+        vgic_write_lr(i, vgic->lr[i]);
+    }
+
+    ISB();
+}
+
+/**
+ * @brief Check whether a vCPU has virtual interrupts waiting.
+ *
+ * @param vcpu The vCPU.
+ * @return Non-zero if an interrupt is pending in the bitmap.
+ */
+int vgic_has_pending(const struct vcpu* vcpu)
+{
+    for (size_t word = 0; word < sizeof(vcpu->vgic.pending) / sizeof(vcpu->vgic.pending[0]); ++word)
+    {
+        if (0x0ULL != __atomic_load_n(&vcpu->vgic.pending[word], __ATOMIC_RELAXED))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Emulate a trapped guest write to ICC_SGI1R_EL1.
+ *
+ * @param vcpu The sending vCPU.
+ * @param esr The exception syndrome (EC 0x18).
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the trapped
+ *         instruction is not a write to ICC_SGI1R_EL1.
+ */
+status_t vgic_handle_sgi(struct vcpu* vcpu, uint64_t esr)
+{
+    vm_t*    vm      = vcpu->vm; /* Sending VM */
+    uint64_t val     = 0x0ULL;   /* Value written */
+    uint32_t targets = 0;        /* Target vCPUs, bit n is vCPU n */
+
+    if (!ESR_SYS_SGI1R(esr) || (esr & ESR_SYS_READ))
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    val = trap_frame_get_reg(&vcpu->ctx, ESR_SYS_RT(esr));
+    if (val & ICC_SGI1R_IRM)
+    {
+        targets = ~(1U << vcpu->id);
+    }
+    else if (0x0ULL == (val & ICC_SGI1R_ROUTE_MASK))
+    {
+        targets = ICC_SGI1R_TARGETS(val);
+    }
+
+    for (uint32_t i = 0; i < vm->num_vcpus; ++i)
+    {
+        if (targets & (1U << i))
+        {
+            vgic_inject(&vm->vcpus[i], ICC_SGI1R_INTID(val));
+            sched_ipi(&vm->vcpus[i]);
+        }
+    }
+
+    return STATUS_OK;
+}
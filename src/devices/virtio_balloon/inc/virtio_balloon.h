@@ -0,0 +1,116 @@
+/**
+ * @file virtio_balloon.h
+ * @brief Virtio memory balloon device model.
+ *
+ * This file contains the device state and function prototypes of the
+ * virtio-mmio balloon device that lets guests return unused pages to the
+ * hypervisor.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The device follows the virtio 1.x MMIO transport (version 2 register
+ * layout). The hypervisor sets a target with virtio_balloon_set_target();
+ * the guest driver then reports pages on the inflate queue, which are
+ * unmapped from stage-2 and freed, or on the deflate queue when it wants
+ * them back. Deflated pages are repopulated lazily on the next fault.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Virtio balloon device state and function prototypes.
+ *
+ * @section examples Examples
+ * @code
+ * static virtio_balloon_t balloon;
+ * virtio_balloon_init(&balloon, &vm, 0x0A000000ULL, 48);
+ * virtio_balloon_set_target(&balloon, 0x10000);
+ * @endcode
+ */
+
+#ifndef VIRTIO_BALLOON_H
+#define VIRTIO_BALLOON_H
+
+#include <stdint.h>
+
+#include "status.h"
+
+#define VIRTIO_BALLOON_MMIO_SIZE (0x200ULL) /**< Size of the register window */
+#define VIRTIO_BALLOON_QUEUES    (2U)       /**< Inflate and deflate queues */
+#define VIRTIO_BALLOON_QUEUE_MAX (128U)     /**< Largest supported queue */
+
+struct vm;
+
+/**
+ * @brief State of a split virtqueue.
+ */
+typedef struct virtio_queue
+{
+    uint32_t num;        /**< queue size chosen by the driver */
+    uint32_t ready;      /**< queue enabled by the driver */
+    uint64_t desc;       /**< IPA of the descriptor table */
+    uint64_t driver;     /**< IPA of the available ring */
+    uint64_t device;     /**< IPA of the used ring */
+    uint16_t last_avail; /**< next available entry to process */
+} virtio_queue_t;
+
+/**
+ * @brief State of a balloon device.
+ */
+typedef struct virtio_balloon
+{
+    struct vm*     vm;                              /**< owning VM */
+    uint32_t       irq;                             /**< virtual interrupt ID */
+    uint32_t       status;                          /**< device status */
+    uint32_t       device_features_sel;             /**< selected device feature word */
+    uint32_t       driver_features_sel;             /**< selected driver feature word */
+    uint64_t       driver_features;                 /**< features acknowledged by the driver */
+    uint32_t       queue_sel;                       /**< selected queue */
+    uint32_t       interrupt_status;                /**< pending interrupt causes */
+    uint32_t       config_generation;               /**< bumped on every config change */
+    uint32_t       num_pages;                       /**< target balloon size in pages */
+    uint32_t       actual;                          /**< balloon size reported by the guest */
+    virtio_queue_t queues[VIRTIO_BALLOON_QUEUES];   /**< inflate and deflate queues */
+} virtio_balloon_t;
+
+/**
+ * @brief Create a balloon device and attach it to a VM.
+ *
+ * @param dev The device state.
+ * @param vm The VM.
+ * @param base IPA of the register window.
+ * @param irq Virtual interrupt ID raised by the device.
+ * @return STATUS_OK or the error from vm_mmio_register().
+ */
+status_t virtio_balloon_init(virtio_balloon_t* dev, struct vm* vm, uint64_t base, uint32_t irq);
+
+/**
+ * @brief Ask the guest to grow or shrink the balloon.
+ *
+ * @param dev The device state.
+ * @param num_pages Target balloon size in 4KB pages.
+ */
+void virtio_balloon_set_target(virtio_balloon_t* dev, uint32_t num_pages);
+
+#endif // VIRTIO_BALLOON_H
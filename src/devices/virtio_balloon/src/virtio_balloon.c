@@ -0,0 +1,540 @@
+/**
+ * @file virtio_balloon.c
+ * @brief Virtio memory balloon device model.
+ *
+ * This file contains the implementation of the virtio-mmio balloon
+ * device.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Guest accesses to the register window trap as stage-2 aborts and are
+ * forwarded here by the VM MMIO dispatcher. Queue notifications are
+ * processed synchronously in the trapping context. Ring memory is read
+ * through gmem_ipa_to_host() one field at a time, so rings may straddle
+ * page boundaries.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the virtio balloon device model.
+ */
+
+/* module includes */
+#include "virtio_balloon.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "gmem.h"
+#include "logging.h"
+#include "sysreg.h"
+#include "vm.h"
+
+/* virtio-mmio registers */
+#define VIRTIO_MMIO_MAGIC_VALUE         (0x000ULL) /**< Magic value "virt" */
+#define VIRTIO_MMIO_VERSION             (0x004ULL) /**< Transport version */
+#define VIRTIO_MMIO_DEVICE_ID           (0x008ULL) /**< Device type */
+#define VIRTIO_MMIO_VENDOR_ID           (0x00CULL) /**< Vendor ID */
+#define VIRTIO_MMIO_DEVICE_FEATURES     (0x010ULL) /**< Device feature word */
+#define VIRTIO_MMIO_DEVICE_FEATURES_SEL (0x014ULL) /**< Device feature word selector */
+#define VIRTIO_MMIO_DRIVER_FEATURES     (0x020ULL) /**< Driver feature word */
+#define VIRTIO_MMIO_DRIVER_FEATURES_SEL (0x024ULL) /**< Driver feature word selector */
+#define VIRTIO_MMIO_QUEUE_SEL           (0x030ULL) /**< Queue selector */
+#define VIRTIO_MMIO_QUEUE_NUM_MAX       (0x034ULL) /**< Maximum queue size */
+#define VIRTIO_MMIO_QUEUE_NUM           (0x038ULL) /**< Queue size */
+#define VIRTIO_MMIO_QUEUE_READY         (0x044ULL) /**< Queue ready */
+#define VIRTIO_MMIO_QUEUE_NOTIFY        (0x050ULL) /**< Queue notifier */
+#define VIRTIO_MMIO_INTERRUPT_STATUS    (0x060ULL) /**< Interrupt status */
+#define VIRTIO_MMIO_INTERRUPT_ACK       (0x064ULL) /**< Interrupt acknowledge */
+#define VIRTIO_MMIO_STATUS              (0x070ULL) /**< Device status */
+#define VIRTIO_MMIO_QUEUE_DESC_LOW      (0x080ULL) /**< Descriptor table address, low */
+#define VIRTIO_MMIO_QUEUE_DESC_HIGH     (0x084ULL) /**< Descriptor table address, high */
+#define VIRTIO_MMIO_QUEUE_DRIVER_LOW    (0x090ULL) /**< Available ring address, low */
+#define VIRTIO_MMIO_QUEUE_DRIVER_HIGH   (0x094ULL) /**< Available ring address, high */
+#define VIRTIO_MMIO_QUEUE_DEVICE_LOW    (0x0A0ULL) /**< Used ring address, low */
+#define VIRTIO_MMIO_QUEUE_DEVICE_HIGH   (0x0A4ULL) /**< Used ring address, high */
+#define VIRTIO_MMIO_CONFIG_GENERATION   (0x0FCULL) /**< Configuration generation */
+#define VIRTIO_MMIO_CONFIG              (0x100ULL) /**< Device configuration space */
+
+#define VIRTIO_MMIO_MAGIC     (0x74726976U) /**< "virt" in little endian */
+#define VIRTIO_MMIO_VERSION_2 (2U)          /**< Modern (virtio 1.x) transport */
+#define VIRTIO_ID_BALLOON     (5U)          /**< Balloon device type */
+#define VIRTIO_VENDOR_ID      (0x4C544948U) /**< "HITL" */
+
+#define VIRTIO_F_VERSION_1          (32U)      /**< Feature bit: virtio 1.x compliant */
+#define VIRTIO_STATUS_NEEDS_RESET   (0x40U)    /**< Device status: needs reset */
+#define VIRTIO_INT_USED_RING        (1U << 0)  /**< Interrupt cause: used ring update */
+#define VIRTIO_INT_CONFIG           (1U << 1)  /**< Interrupt cause: configuration change */
+
+/* Configuration space layout */
+#define BALLOON_CONFIG_NUM_PAGES (0x0ULL) /**< Target size in pages */
+#define BALLOON_CONFIG_ACTUAL    (0x4ULL) /**< Current size in pages */
+#define BALLOON_CONFIG_SIZE      (0x8ULL) /**< Size of the configuration space */
+
+#define BALLOON_QUEUE_INFLATE (0U) /**< Pages given to the hypervisor */
+#define BALLOON_QUEUE_DEFLATE (1U) /**< Pages taken back by the guest */
+
+#define BALLOON_PFN_SHIFT (12ULL) /**< Balloon PFNs are in 4KB units */
+
+/* Split virtqueue layout */
+#define VRING_DESC_SIZE       (16ULL)    /**< Size of a descriptor */
+#define VRING_DESC_F_NEXT     (1U << 0)  /**< Descriptor continues via next */
+#define VRING_DESC_F_INDIRECT (1U << 2)  /**< Descriptor points to a table */
+#define VRING_AVAIL_IDX       (2ULL)     /**< Offset of avail->idx */
+#define VRING_AVAIL_RING      (4ULL)     /**< Offset of avail->ring */
+#define VRING_USED_IDX        (2ULL)     /**< Offset of used->idx */
+#define VRING_USED_RING       (4ULL)     /**< Offset of used->ring */
+#define VRING_USED_ELEM_SIZE  (8ULL)     /**< Size of a used ring element */
+
+/**
+ * @brief Read a little endian field from guest memory.
+ *
+ * @param dev The device state.
+ * @param ipa Address of the field.
+ * @param size Size of the field (2, 4 or 8).
+ * @param value Receives the value.
+ * @return Non-zero on success.
+ */
+static int balloon_guest_read(virtio_balloon_t* dev, uint64_t ipa, uint32_t size, uint64_t* value)
+{
+    void* ptr = NULL; /* Hypervisor view of the field */
+
+    gmem_pin(dev->vm);
+
+    ptr = gmem_ipa_to_host(dev->vm, ipa, size);
+    if (NULL == ptr)
+    {
+        gmem_unpin(dev->vm);
+        return 0;
+    }
+
+    switch (size)
+    {
+    case 2:
+        *value = *(volatile uint16_t*)ptr;
+        break;
+    case 4:
+        *value = *(volatile uint32_t*)ptr;
+        break;
+    default:
+        *value = *(volatile uint64_t*)ptr;
+        break;
+    }
+
+    gmem_unpin(dev->vm);
+
+    return 1;
+}
+
+/**
+ * @brief Write a little endian field to guest memory.
+ *
+ * @param dev The device state.
+ * @param ipa Address of the field.
+ * @param size Size of the field (2 or 4).
+ * @param value The value.
+ * @return Non-zero on success.
+ */
+static int balloon_guest_write(virtio_balloon_t* dev, uint64_t ipa, uint32_t size, uint64_t value)
+{
+    void* ptr = NULL; /* Hypervisor view of the field */
+
+    gmem_pin(dev->vm);
+
+    ptr = gmem_ipa_to_host(dev->vm, ipa, size);
+    if (NULL == ptr)
+    {
+        gmem_unpin(dev->vm);
+        return 0;
+    }
+
+    if (2 == size)
+    {
+        *(volatile uint16_t*)ptr = (uint16_t)value;
+    }
+    else
+    {
+        *(volatile uint32_t*)ptr = (uint32_t)value;
+    }
+
+    gmem_unpin(dev->vm);
+
+    return 1;
+}
+
+/**
+ * @brief Raise the device interrupt.
+ *
+ * @param dev The device state.
+ * @param cause Interrupt cause bits.
+ */
+static void balloon_notify_guest(virtio_balloon_t* dev, uint32_t cause)
+{
+    dev->interrupt_status |= cause;
+    vm_irq_raise(dev->vm, dev->irq);
+}
+
+/**
+ * @brief Apply one buffer of page frame numbers.
+ *
+ * @param dev The device state.
+ * @param qidx Queue the buffer came from.
+ * @param addr IPA of the buffer.
+ * @param len Length of the buffer in bytes.
+ * @return Non-zero on success.
+ */
+static int balloon_process_buffer(virtio_balloon_t* dev, uint32_t qidx, uint64_t addr, uint32_t len)
+{
+    for (uint32_t off = 0; (off + sizeof(uint32_t)) <= len; off += sizeof(uint32_t))
+    {
+        uint64_t pfn = 0x0ULL; /* Guest page frame number */
+        uint64_t ipa = 0x0ULL; /* Guest page address */
+
+        if (!balloon_guest_read(dev, addr + off, sizeof(uint32_t), &pfn))
+        {
+            return 0;
+        }
+
+        ipa = pfn << BALLOON_PFN_SHIFT;
+
+        if (BALLOON_QUEUE_INFLATE == qidx)
+        {
+            gmem_release(dev->vm, ipa);
+        }
+        else
+        {
+            gmem_reclaim(dev->vm, ipa);
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Process all available buffers of a queue.
+ *
+ * @param dev The device state.
+ * @param qidx The notified queue.
+ */
+static void balloon_process_queue(virtio_balloon_t* dev, uint32_t qidx)
+{
+    virtio_queue_t* q         = &dev->queues[qidx]; /* Notified queue */
+    uint64_t        avail_idx = 0x0ULL;             /* Driver's available index */
+    uint64_t        used_idx  = 0x0ULL;             /* Device's used index */
+    int             done      = 0;                  /* Buffers completed */
+
+    if (!q->ready || (0 == q->num) ||
+        !balloon_guest_read(dev, q->driver + VRING_AVAIL_IDX, 2, &avail_idx) ||
+        !balloon_guest_read(dev, q->device + VRING_USED_IDX, 2, &used_idx))
+    {
+        goto fail;
+    }
+
+    DMB(ish); /* Read the ring entries after the index */
+
+    while (q->last_avail != (uint16_t)avail_idx)
+    {
+        uint64_t head = 0x0ULL; /* First descriptor of the chain */
+        uint64_t desc = 0x0ULL; /* Current descriptor */
+
+        if (!balloon_guest_read(dev, q->driver + VRING_AVAIL_RING + (2ULL * (q->last_avail % q->num)), 2, &head) ||
+            (head >= q->num))
+        {
+            goto fail;
+        }
+
+        desc = head;
+        for (uint32_t n = 0; n < q->num; ++n)
+        {
+            uint64_t base  = q->desc + (desc * VRING_DESC_SIZE); /* Descriptor address */
+            uint64_t addr  = 0x0ULL;                             /* Buffer address */
+            uint64_t len   = 0x0ULL;                             /* Buffer length */
+            uint64_t flags = 0x0ULL;                             /* Descriptor flags */
+            uint64_t next  = 0x0ULL;                             /* Next descriptor */
+
+            if (!balloon_guest_read(dev, base, 8, &addr) ||
+                !balloon_guest_read(dev, base + 8, 4, &len) ||
+                !balloon_guest_read(dev, base + 12, 2, &flags) ||
+                !balloon_guest_read(dev, base + 14, 2, &next) ||
+                (flags & VRING_DESC_F_INDIRECT) ||
+                !balloon_process_buffer(dev, qidx, addr, (uint32_t)len))
+            {
+                goto fail;
+            }
+
+            if (!(flags & VRING_DESC_F_NEXT))
+            {
+                break;
+            }
+            if (next >= q->num)
+            {
+                goto fail;
+            }
+            desc = next;
+        }
+
+        /* Return the chain to the driver */
+        {
+            uint64_t elem = q->device + VRING_USED_RING + (VRING_USED_ELEM_SIZE * (used_idx % q->num));
+
+            if (!balloon_guest_write(dev, elem, 4, head) ||
+                !balloon_guest_write(dev, elem + 4, 4, 0))
+            {
+                goto fail;
+            }
+        }
+
+        used_idx = (used_idx + 1) & 0xFFFFULL;
+        q->last_avail++;
+        done++;
+    }
+
+    if (done)
+    {
+        DMB(ish); /* Publish the elements before the index */
+        balloon_guest_write(dev, q->device + VRING_USED_IDX, 2, used_idx);
+        balloon_notify_guest(dev, VIRTIO_INT_USED_RING);
+    }
+
+    return;
+
+fail:
+    LOG_ERR("VM%u: malformed balloon queue %u\n\r", dev->vm->id, qidx);
+    dev->status |= VIRTIO_STATUS_NEEDS_RESET;
+    balloon_notify_guest(dev, VIRTIO_INT_CONFIG);
+}
+
+/**
+ * @brief Reset the device to its initial state.
+ *
+ * @param dev The device state.
+ */
+static void balloon_reset(virtio_balloon_t* dev)
+{
+    dev->status              = 0;
+    dev->device_features_sel = 0;
+    dev->driver_features_sel = 0;
+    dev->driver_features     = 0;
+    dev->queue_sel           = 0;
+    dev->interrupt_status    = 0;
+    memset(dev->queues, 0x0, sizeof(dev->queues));
+}
+
+/**
+ * @brief Handle a guest load from the register window.
+ *
+ * @param opaque The device state.
+ * @param offset Offset in the register window.
+ * @param size Access size in bytes.
+ * @return The register value.
+ */
+static uint64_t balloon_mmio_read(void* opaque, uint64_t offset, uint32_t size)
+{
+    virtio_balloon_t* dev = (virtio_balloon_t*)opaque; /* Device state */
+    virtio_queue_t*   q   = NULL;                      /* Selected queue */
+
+    if (offset >= VIRTIO_MMIO_CONFIG)
+    {
+        uint32_t config[BALLOON_CONFIG_SIZE / sizeof(uint32_t)] = { dev->num_pages, dev->actual };
+        uint64_t value = 0x0ULL;
+        uint64_t off   = offset - VIRTIO_MMIO_CONFIG;
+
+        if ((off + size) <= BALLOON_CONFIG_SIZE)
+        {
+            memcpy(&value, (const uint8_t*)config + off, size);
+        }
+
+        return value;
+    }
+
+    q = (dev->queue_sel < VIRTIO_BALLOON_QUEUES) ? &dev->queues[dev->queue_sel] : NULL;
+
+    switch (offset)
+    {
+    case VIRTIO_MMIO_MAGIC_VALUE:
+        return VIRTIO_MMIO_MAGIC;
+    case VIRTIO_MMIO_VERSION:
+        return VIRTIO_MMIO_VERSION_2;
+    case VIRTIO_MMIO_DEVICE_ID:
+        return VIRTIO_ID_BALLOON;
+    case VIRTIO_MMIO_VENDOR_ID:
+        return VIRTIO_VENDOR_ID;
+    case VIRTIO_MMIO_DEVICE_FEATURES:
+        return (1 == dev->device_features_sel) ? (1U << (VIRTIO_F_VERSION_1 - 32)) : 0;
+    case VIRTIO_MMIO_QUEUE_NUM_MAX:
+        return (NULL != q) ? VIRTIO_BALLOON_QUEUE_MAX : 0;
+    case VIRTIO_MMIO_QUEUE_READY:
+        return (NULL != q) ? q->ready : 0;
+    case VIRTIO_MMIO_INTERRUPT_STATUS:
+        return dev->interrupt_status;
+    case VIRTIO_MMIO_STATUS:
+        return dev->status;
+    case VIRTIO_MMIO_CONFIG_GENERATION:
+        return dev->config_generation;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Handle a guest store to the register window.
+ *
+ * @param opaque The device state.
+ * @param offset Offset in the register window.
+ * @param size Access size in bytes.
+ * @param value The stored value.
+ */
+static void balloon_mmio_write(void* opaque, uint64_t offset, uint32_t size, uint64_t value)
+{
+    virtio_balloon_t* dev = (virtio_balloon_t*)opaque; /* Device state */
+    virtio_queue_t*   q   = NULL;                      /* Selected queue */
+
+    if (offset >= VIRTIO_MMIO_CONFIG)
+    {
+        /* Only "actual" is writable by the driver */
+        if (((offset - VIRTIO_MMIO_CONFIG) == BALLOON_CONFIG_ACTUAL) && (4 == size))
+        {
+            dev->actual = (uint32_t)value;
+        }
+        return;
+    }
+
+    q = (dev->queue_sel < VIRTIO_BALLOON_QUEUES) ? &dev->queues[dev->queue_sel] : NULL;
+
+    switch (offset)
+    {
+    case VIRTIO_MMIO_DEVICE_FEATURES_SEL:
+        dev->device_features_sel = (uint32_t)value;
+        break;
+    case VIRTIO_MMIO_DRIVER_FEATURES:
+        if (dev->driver_features_sel < 2)
+        {
+            dev->driver_features &= ~(0xFFFFFFFFULL << (32 * dev->driver_features_sel));
+            dev->driver_features |= (value & 0xFFFFFFFFULL) << (32 * dev->driver_features_sel);
+        }
+        break;
+    case VIRTIO_MMIO_DRIVER_FEATURES_SEL:
+        dev->driver_features_sel = (uint32_t)value;
+        break;
+    case VIRTIO_MMIO_QUEUE_SEL:
+        dev->queue_sel = (uint32_t)value;
+        break;
+    case VIRTIO_MMIO_QUEUE_NUM:
+        if ((NULL != q) && (value > 0) && (value <= VIRTIO_BALLOON_QUEUE_MAX))
+        {
+            q->num = (uint32_t)value;
+        }
+        break;
+    case VIRTIO_MMIO_QUEUE_READY:
+        if (NULL != q)
+        {
+            q->ready      = (uint32_t)value & 0x1U;
+            q->last_avail = 0;
+        }
+        break;
+    case VIRTIO_MMIO_QUEUE_NOTIFY:
+        if (value < VIRTIO_BALLOON_QUEUES)
+        {
+            balloon_process_queue(dev, (uint32_t)value);
+        }
+        break;
+    case VIRTIO_MMIO_INTERRUPT_ACK:
+        dev->interrupt_status &= ~(uint32_t)value;
+        break;
+    case VIRTIO_MMIO_STATUS:
+        if (0 == value)
+        {
+            balloon_reset(dev);
+        }
+        else
+        {
+            dev->status = (uint32_t)value;
+        }
+        break;
+    case VIRTIO_MMIO_QUEUE_DESC_LOW:
+    case VIRTIO_MMIO_QUEUE_DESC_HIGH:
+    case VIRTIO_MMIO_QUEUE_DRIVER_LOW:
+    case VIRTIO_MMIO_QUEUE_DRIVER_HIGH:
+    case VIRTIO_MMIO_QUEUE_DEVICE_LOW:
+    case VIRTIO_MMIO_QUEUE_DEVICE_HIGH:
+        if (NULL != q)
+        {
+            uint64_t* field = (offset < VIRTIO_MMIO_QUEUE_DRIVER_LOW)   ? &q->desc
+                              : (offset < VIRTIO_MMIO_QUEUE_DEVICE_LOW) ? &q->driver
+                                                                        : &q->device;
+            uint32_t shift  = (offset & 0x4ULL) ? 32 : 0;
+
+            *field = (*field & ~(0xFFFFFFFFULL << shift)) | ((value & 0xFFFFFFFFULL) << shift);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Register window callbacks */
+static const vm_mmio_ops_t balloon_mmio_ops = {
+    .read  = balloon_mmio_read,
+    .write = balloon_mmio_write,
+};
+
+/**
+ * @brief Create a balloon device and attach it to a VM.
+ *
+ * @param dev The device state.
+ * @param vm The VM.
+ * @param base IPA of the register window.
+ * @param irq Virtual interrupt ID raised by the device.
+ * @return STATUS_OK or the error from vm_mmio_register().
+ */
+status_t virtio_balloon_init(virtio_balloon_t* dev, struct vm* vm, uint64_t base, uint32_t irq)
+{
+    if ((NULL == dev) || (NULL == vm))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    memset(dev, 0x0, sizeof(*dev));
+    dev->vm  = vm;
+    dev->irq = irq;
+
+    return vm_mmio_register(vm, base, VIRTIO_BALLOON_MMIO_SIZE, &balloon_mmio_ops, dev);
+}
+
+/**
+ * @brief Ask the guest to grow or shrink the balloon.
+ *
+ * @param dev The device state.
+ * @param num_pages Target balloon size in 4KB pages.
+ */
+void virtio_balloon_set_target(virtio_balloon_t* dev, uint32_t num_pages)
+{
+    dev->num_pages = num_pages;
+    dev->config_generation++;
+    balloon_notify_guest(dev, VIRTIO_INT_CONFIG);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file semihosting.h
+ * @brief ARM semihosting interface.
+ *
+ * This file contains the operation numbers and function prototypes to
+ * access files on the debug host through the semihosting interface.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Semihosting requests are issued with HLT 0xF000, the operation number
+ * in x0 and a pointer to a parameter block in x1. QEMU only services them
+ * when started with -semihosting-config enable=on,target=native; without
+ * it the HLT traps to EL2 like any undefined instruction.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Semihosting operation numbers and function prototypes.
+ */
+
+#ifndef SEMIHOSTING_H
+#define SEMIHOSTING_H
+
+#include <stdint.h>
+
+#include "status.h"
+
+#define SEMIHOSTING_SYS_OPEN   (0x01U) /**< Open a host file */
+#define SEMIHOSTING_SYS_CLOSE  (0x02U) /**< Close a host file */
+#define SEMIHOSTING_SYS_WRITE0 (0x04U) /**< Write a NUL terminated string to the console */
+#define SEMIHOSTING_SYS_WRITE  (0x05U) /**< Write to a host file */
+#define SEMIHOSTING_SYS_READ   (0x06U) /**< Read from a host file */
+#define SEMIHOSTING_SYS_SEEK   (0x0AU) /**< Set the position in a host file */
+#define SEMIHOSTING_SYS_FLEN   (0x0CU) /**< Get the length of a host file */
+#define SEMIHOSTING_SYS_EXIT   (0x18U) /**< Terminate the simulation */
+
+#define SEMIHOSTING_MODE_RB (1U) /**< fopen() mode "rb" */
+#define SEMIHOSTING_MODE_WB (5U) /**< fopen() mode "wb" */
+#define SEMIHOSTING_MODE_AB (9U) /**< fopen() mode "ab" */
+
+#define SEMIHOSTING_STDOUT ":tt" /**< Special file name of the host console */
+
+#define SEMIHOSTING_ADP_STOPPED_EXIT (0x20026U) /**< SYS_EXIT reason for a normal application exit */
+
+/**
+ * @brief Issue a raw semihosting request.
+ *
+ * @param op Operation number.
+ * @param arg Parameter block or immediate argument.
+ * @return Value returned by the host in x0.
+ */
+int64_t semihosting_call(uint32_t op, uint64_t arg);
+
+/**
+ * @brief Open a host file.
+ *
+ * @param path NUL terminated file name.
+ * @param mode One of SEMIHOSTING_MODE_*.
+ * @return Non-negative handle, or -1 on failure.
+ */
+int64_t semihosting_open(const char* path, uint32_t mode);
+
+/**
+ * @brief Close a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @return STATUS_OK or STATUS_ERR_IO.
+ */
+status_t semihosting_close(int64_t handle);
+
+/**
+ * @brief Write a buffer to a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @param buf Data to write.
+ * @param len Number of bytes.
+ * @return STATUS_OK if every byte was written, STATUS_ERR_IO otherwise.
+ */
+status_t semihosting_write(int64_t handle, const void* buf, uint64_t len);
+
+/**
+ * @brief Read a buffer from a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @param buf Receives the data.
+ * @param len Number of bytes.
+ * @return STATUS_OK if every byte was read, STATUS_ERR_IO otherwise.
+ */
+status_t semihosting_read(int64_t handle, void* buf, uint64_t len);
+
+/**
+ * @brief Set the position in a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @param pos Absolute byte offset.
+ * @return STATUS_OK or STATUS_ERR_IO.
+ */
+status_t semihosting_seek(int64_t handle, uint64_t pos);
+
+/**
+ * @brief Get the length of a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @return Length in bytes, or -1 on failure.
+ */
+int64_t semihosting_flen(int64_t handle);
+
+/**
+ * @brief Write a NUL terminated string to the host console.
+ *
+ * @param str The string.
+ */
+void semihosting_write0(const char* str);
+
+/**
+ * @brief Terminate the simulation.
+ */
+void semihosting_exit(void) __attribute__((noreturn));
+
+#endif // SEMIHOSTING_H
@@ -0,0 +1,200 @@
+/**
+ * @file semihosting.c
+ * @brief ARM semihosting interface.
+ *
+ * This file contains the implementation of the semihosting wrappers used
+ * to write snapshots and logs to files on the debug host.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Every request is a full trap to the emulator, so callers should batch
+ * data into large buffers rather than issue one request per record.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the semihosting interface.
+ */
+
+/* this module's header */
+#include "semihosting.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Issue a raw semihosting request.
+ *
+ * @param op Operation number.
+ * @param arg Parameter block or immediate argument.
+ * @return Value returned by the host in x0.
+ */
+int64_t semihosting_call(uint32_t op, uint64_t arg)
+{
+    register uint64_t x0 asm("x0") = op;
+    register uint64_t x1 asm("x1") = arg;
+
+    asm volatile(
+        "hlt 0xf000\n"
+        : "+r"(x0)
+        : "r"(x1)
+        : "memory");
+
+    return (int64_t)x0;
+}
+
+/**
+ * @brief Open a host file.
+ *
+ * @param path NUL terminated file name.
+ * @param mode One of SEMIHOSTING_MODE_*.
+ * @return Non-negative handle, or -1 on failure.
+ */
+int64_t semihosting_open(const char* path, uint32_t mode)
+{
+    uint64_t block[3] = { 0 }; /* name, mode, name length */
+
+    if (NULL == path)
+    {
+        return -1;
+    }
+
+    block[0] = (uint64_t)(uintptr_t)path;
+    block[1] = mode;
+    block[2] = strlen(path);
+
+    return semihosting_call(SEMIHOSTING_SYS_OPEN, (uint64_t)(uintptr_t)block);
+}
+
+/**
+ * @brief Close a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @return STATUS_OK or STATUS_ERR_IO.
+ */
+status_t semihosting_close(int64_t handle)
+{
+    uint64_t block[1] = { (uint64_t)handle }; /* handle */
+
+    return (0 == semihosting_call(SEMIHOSTING_SYS_CLOSE, (uint64_t)(uintptr_t)block)) ? STATUS_OK : STATUS_ERR_IO;
+}
+
+/**
+ * @brief Write a buffer to a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @param buf Data to write.
+ * @param len Number of bytes.
+ * @return STATUS_OK if every byte was written, STATUS_ERR_IO otherwise.
+ */
+status_t semihosting_write(int64_t handle, const void* buf, uint64_t len)
+{
+    uint64_t block[3] = { (uint64_t)handle, (uint64_t)(uintptr_t)buf, len }; /* handle, data, length */
+
+    if (0 == len)
+    {
+        return STATUS_OK;
+    }
+
+    /* The host returns the number of bytes it could NOT write */
+    return (0 == semihosting_call(SEMIHOSTING_SYS_WRITE, (uint64_t)(uintptr_t)block)) ? STATUS_OK : STATUS_ERR_IO;
+}
+
+/**
+ * @brief Read a buffer from a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @param buf Receives the data.
+ * @param len Number of bytes.
+ * @return STATUS_OK if every byte was read, STATUS_ERR_IO otherwise.
+ */
+status_t semihosting_read(int64_t handle, void* buf, uint64_t len)
+{
+    uint64_t block[3] = { (uint64_t)handle, (uint64_t)(uintptr_t)buf, len }; /* handle, buffer, length */
+
+    if (0 == len)
+    {
+        return STATUS_OK;
+    }
+
+    /* The host returns the number of bytes it could NOT read */
+    return (0 == semihosting_call(SEMIHOSTING_SYS_READ, (uint64_t)(uintptr_t)block)) ? STATUS_OK : STATUS_ERR_IO;
+}
+
+/**
+ * @brief Set the position in a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @param pos Absolute byte offset.
+ * @return STATUS_OK or STATUS_ERR_IO.
+ */
+status_t semihosting_seek(int64_t handle, uint64_t pos)
+{
+    uint64_t block[2] = { (uint64_t)handle, pos }; /* handle, position */
+
+    return (0 == semihosting_call(SEMIHOSTING_SYS_SEEK, (uint64_t)(uintptr_t)block)) ? STATUS_OK : STATUS_ERR_IO;
+}
+
+/**
+ * @brief Get the length of a host file.
+ *
+ * @param handle Handle returned by semihosting_open().
+ * @return Length in bytes, or -1 on failure.
+ */
+int64_t semihosting_flen(int64_t handle)
+{
+    uint64_t block[1] = { (uint64_t)handle }; /* handle */
+
+    return semihosting_call(SEMIHOSTING_SYS_FLEN, (uint64_t)(uintptr_t)block);
+}
+
+/**
+ * @brief Write a NUL terminated string to the host console.
+ *
+ * @param str The string.
+ */
+void semihosting_write0(const char* str)
+{
+    if (NULL != str)
+    {
+        (void)semihosting_call(SEMIHOSTING_SYS_WRITE0, (uint64_t)(uintptr_t)str);
+    }
+}
+
+/**
+ * @brief Terminate the simulation.
+ */
+void semihosting_exit(void)
+{
+    (void)semihosting_call(SEMIHOSTING_SYS_EXIT, SEMIHOSTING_ADP_STOPPED_EXIT);
+
+    /* Not reached when the host honours the request */
+    for (;;)
+    {
+        asm volatile("wfi");
+    }
+}
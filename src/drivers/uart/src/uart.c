@@ -45,9 +45,10 @@
  */
 
 #include "uart.h"
+#include "platform.h"
 #include <stdint.h>
 
-#define UART0_BASE 0x09000000
+#define UART0_BASE PLATFORM_UART_BASE
 #define UART0_DR   (*(volatile uint32_t*)(UART0_BASE + 0x00))
 #define UART0_FR   (*(volatile uint32_t*)(UART0_BASE + 0x18))
 #define UART0_IBRD (*(volatile uint32_t*)(UART0_BASE + 0x24))
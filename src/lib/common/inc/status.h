@@ -0,0 +1,58 @@
+/**
+ * @file status.h
+ * @brief Common status codes for the hypervisor.
+ *
+ * Provides the status codes returned by hypervisor modules.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Modules that can fail return a status_t. Zero means success and every
+ * error is negative, so callers can simply test for `< STATUS_OK`.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Defines the status codes shared by all hypervisor modules.
+ */
+
+#ifndef STATUS_H
+#define STATUS_H
+
+/**
+ * @brief Status codes returned by hypervisor modules.
+ */
+typedef enum status
+{
+    STATUS_OK                = 0,  /**< success */
+    STATUS_ERR_INVALID       = -1, /**< invalid argument */
+    STATUS_ERR_NO_MEMORY     = -2, /**< out of memory */
+    STATUS_ERR_NOT_FOUND     = -3, /**< entry not found */
+    STATUS_ERR_EXISTS        = -4, /**< entry already exists */
+    STATUS_ERR_BUSY          = -5, /**< resource busy */
+    STATUS_ERR_IO            = -6, /**< I/O error */
+    STATUS_ERR_NOT_SUPPORTED = -7, /**< operation not supported */
+} status_t;
+
+#endif // STATUS_H
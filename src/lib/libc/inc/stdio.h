@@ -0,0 +1,90 @@
+/**
+ * @file stdio.h
+ * @brief Formatted output of the in-tree C runtime.
+ *
+ * This file contains the function prototypes of the subset of the C
+ * library stdio functions the hypervisor uses.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * vsnprintf() formats into the caller's buffer only: it never allocates,
+ * keeps no state between calls and is safe on any CPU and in trap context.
+ * Its cost only depends on the format and the arguments.
+ *
+ * Supported are the flags '-', '0', '+', ' ' and '#', a field width and a
+ * precision (both may be '*'), the length modifiers hh, h, l, ll, z, j
+ * and t, and the conversions d, i, u, o, x, X, p, c, s and %. Floating
+ * point conversions are not supported and are emitted verbatim.
+ *
+ * There are no streams. putchar() writes to the active log sink, it is
+ * what the Unity test framework prints through.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * C runtime formatted output function prototypes.
+ */
+
+#ifndef STDIO_H
+#define STDIO_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+#define EOF (-1) /**< End of file */
+
+/**
+ * @brief Format a string.
+ *
+ * @param buf Destination, always NUL terminated if size is not 0.
+ * @param size Size of buf.
+ * @param format The format string.
+ * @param args The arguments for the format string.
+ * @return Length of the complete output, without the NUL; the output was
+ *         truncated if this is size or more.
+ */
+int vsnprintf(char* buf, size_t size, const char* format, va_list args) __attribute__((format(printf, 3, 0)));
+
+/**
+ * @brief Format a string.
+ *
+ * @param buf Destination, always NUL terminated if size is not 0.
+ * @param size Size of buf.
+ * @param format The format string.
+ * @param ... The arguments for the format string.
+ * @return Length of the complete output, without the NUL; the output was
+ *         truncated if this is size or more.
+ */
+int snprintf(char* buf, size_t size, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Write a character to the active log sink.
+ *
+ * @param c The character, converted to unsigned char.
+ * @return The character written.
+ */
+int putchar(int c);
+
+#endif // STDIO_H
@@ -0,0 +1,123 @@
+/**
+ * @file string.h
+ * @brief Memory and string functions of the in-tree C runtime.
+ *
+ * This file contains the function prototypes of the subset of the C
+ * library string functions the hypervisor uses.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * memcpy(), memmove(), memset() and memcmp() are written in assembly and
+ * move 16 to 64 bytes per iteration with LDP/STP; memset() clears large
+ * zero fills a cache line at a time with DC ZVA. Until the MMU is on, all
+ * data accesses are Device accesses, which fault when unaligned and on
+ * DC ZVA, so the routines fall back to byte accesses while SCTLR_EL2.M is
+ * clear. The remaining functions are plain C.
+ *
+ * The compiler also emits calls to memcpy() and memset() for structure
+ * copies and initialization.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * C runtime memory and string function prototypes.
+ */
+
+#ifndef STRING_H
+#define STRING_H
+
+#include <stddef.h>
+
+/**
+ * @brief Copy memory, the areas must not overlap.
+ *
+ * @param dst Destination.
+ * @param src Source.
+ * @param n Number of bytes.
+ * @return dst.
+ */
+void* memcpy(void* dst, const void* src, size_t n);
+
+/**
+ * @brief Copy memory, the areas may overlap.
+ *
+ * @param dst Destination.
+ * @param src Source.
+ * @param n Number of bytes.
+ * @return dst.
+ */
+void* memmove(void* dst, const void* src, size_t n);
+
+/**
+ * @brief Fill memory with a byte.
+ *
+ * @param s Destination.
+ * @param c The byte, converted to unsigned char.
+ * @param n Number of bytes.
+ * @return s.
+ */
+void* memset(void* s, int c, size_t n);
+
+/**
+ * @brief Compare memory.
+ *
+ * @param a First area.
+ * @param b Second area.
+ * @param n Number of bytes.
+ * @return Difference of the first differing bytes as unsigned char, 0 if
+ *         the areas are equal.
+ */
+int memcmp(const void* a, const void* b, size_t n);
+
+/**
+ * @brief Get the length of a string.
+ *
+ * @param s The string.
+ * @return Number of characters before the terminating NUL.
+ */
+size_t strlen(const char* s);
+
+/**
+ * @brief Compare strings.
+ *
+ * @param a First string.
+ * @param b Second string.
+ * @return Difference of the first differing characters as unsigned char,
+ *         0 if the strings are equal.
+ */
+int strcmp(const char* a, const char* b);
+
+/**
+ * @brief Copy a string into a fixed size field.
+ *
+ * @param dst Destination, padded with NULs up to n bytes.
+ * @param src Source string.
+ * @param n Size of dst; dst is not terminated if src is n characters or
+ *          longer.
+ * @return dst.
+ */
+char* strncpy(char* dst, const char* src, size_t n);
+
+#endif // STRING_H
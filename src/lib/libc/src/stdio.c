@@ -0,0 +1,496 @@
+/**
+ * @file stdio.c
+ * @brief Formatted output of the in-tree C runtime.
+ *
+ * This file contains the implementation of vsnprintf(), snprintf() and
+ * putchar().
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The formatter writes through a small cursor that counts every character
+ * but only stores those that fit, so the return value is the length of the
+ * complete output as the C standard requires. Numbers are converted into a
+ * buffer on the stack, no state survives a call.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the C runtime formatted output functions.
+ */
+
+/* this module's header */
+#include "stdio.h"
+
+/* standard includes */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "logging.h"
+
+#define FMT_LEFT  (1U << 0) /**< '-': pad on the right */
+#define FMT_ZERO  (1U << 1) /**< '0': pad numbers with zeros */
+#define FMT_PLUS  (1U << 2) /**< '+': sign on positive numbers */
+#define FMT_SPACE (1U << 3) /**< ' ': space on positive numbers */
+#define FMT_ALT   (1U << 4) /**< '#': 0x / 0 prefix */
+#define FMT_UPPER (1U << 5) /**< upper case hex digits */
+
+#define FMT_NUM_DIGITS (24U) /**< Digits of the largest 64-bit number, in octal */
+
+/**
+ * @brief Output cursor of one vsnprintf() call.
+ */
+typedef struct fmt_out
+{
+    char*  buf;  /**< destination */
+    size_t size; /**< usable bytes in buf, without the NUL */
+    size_t len;  /**< characters produced so far */
+} fmt_out_t;
+
+/**
+ * @brief Length modifier of a conversion.
+ */
+typedef enum fmt_len
+{
+    FMT_LEN_INT = 0, /**< none */
+    FMT_LEN_CHAR,    /**< hh */
+    FMT_LEN_SHORT,   /**< h */
+    FMT_LEN_LONG,    /**< l, z, j, t */
+    FMT_LEN_LLONG,   /**< ll */
+} fmt_len_t;
+
+/**
+ * @brief Emit one character.
+ *
+ * @param out The cursor.
+ * @param c The character.
+ */
+static void fmt_putc(fmt_out_t* out, char c)
+{
+    if (out->len < out->size)
+    {
+        out->buf[out->len] = c;
+    }
+    out->len++;
+}
+
+/**
+ * @brief Emit a character several times.
+ *
+ * @param out The cursor.
+ * @param c The character.
+ * @param count Number of times, may be negative.
+ */
+static void fmt_fill(fmt_out_t* out, char c, int count)
+{
+    while (count-- > 0)
+    {
+        fmt_putc(out, c);
+    }
+}
+
+/**
+ * @brief Emit a string with field padding.
+ *
+ * @param out The cursor.
+ * @param s The string.
+ * @param len Characters of s to emit.
+ * @param width Field width.
+ * @param flags FMT_* flags.
+ */
+static void fmt_string(fmt_out_t* out, const char* s, int len, int width, uint32_t flags)
+{
+    if (!(flags & FMT_LEFT))
+    {
+        fmt_fill(out, ' ', width - len);
+    }
+    for (int i = 0; i < len; ++i)
+    {
+        fmt_putc(out, s[i]);
+    }
+    if (flags & FMT_LEFT)
+    {
+        fmt_fill(out, ' ', width - len);
+    }
+}
+
+/**
+ * @brief Emit a number with sign, prefix, precision and field padding.
+ *
+ * @param out The cursor.
+ * @param value Magnitude of the number.
+ * @param negative The number is negative.
+ * @param base 8, 10 or 16.
+ * @param width Field width.
+ * @param precision Minimum digits, -1 if none was given.
+ * @param flags FMT_* flags.
+ */
+static void fmt_number(fmt_out_t* out, uint64_t value, int negative, uint32_t base, int width, int precision, uint32_t flags)
+{
+    const char* digits = (flags & FMT_UPPER) ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    char        num[FMT_NUM_DIGITS]; /* Digits, least significant first */
+    int         len    = 0;          /* Digits in num */
+    const char* prefix = "";         /* Sign and base prefix */
+    int         plen   = 0;          /* Characters in prefix */
+    int         zeros  = 0;          /* Zeros between prefix and digits */
+    int         pad    = 0;          /* Field padding */
+
+    while (0 != value)
+    {
+        num[len++] = digits[value % base];
+        value /= base;
+    }
+
+    /* Zero has one digit, unless an explicit precision of 0 was given */
+    if ((0 == len) && (0 != precision))
+    {
+        num[len++] = '0';
+    }
+
+    if (negative)
+    {
+        prefix = "-";
+    }
+    else if (flags & FMT_PLUS)
+    {
+        prefix = "+";
+    }
+    else if (flags & FMT_SPACE)
+    {
+        prefix = " ";
+    }
+    else if ((flags & FMT_ALT) && (16U == base) && (0 != len) && ('0' != num[len - 1]))
+    {
+        prefix = (flags & FMT_UPPER) ? "0X" : "0x";
+    }
+    else if ((flags & FMT_ALT) && (8U == base) && ((0 == len) || ('0' != num[len - 1])))
+    {
+        prefix = "0";
+    }
+    while ('\0' != prefix[plen])
+    {
+        plen++;
+    }
+
+    if (precision > len)
+    {
+        zeros = precision - len;
+    }
+    else if ((precision < 0) && (flags & FMT_ZERO) && !(flags & FMT_LEFT))
+    {
+        zeros = width - plen - len;
+    }
+    pad = width - plen - ((zeros > 0) ? zeros : 0) - len;
+
+    if (!(flags & FMT_LEFT))
+    {
+        fmt_fill(out, ' ', pad);
+    }
+    for (int i = 0; i < plen; ++i)
+    {
+        fmt_putc(out, prefix[i]);
+    }
+    fmt_fill(out, '0', zeros);
+    while (len > 0)
+    {
+        fmt_putc(out, num[--len]);
+    }
+    if (flags & FMT_LEFT)
+    {
+        fmt_fill(out, ' ', pad);
+    }
+}
+
+/**
+ * @brief Format a string.
+ *
+ * @param buf Destination, always NUL terminated if size is not 0.
+ * @param size Size of buf.
+ * @param format The format string.
+ * @param args The arguments for the format string.
+ * @return Length of the complete output, without the NUL; the output was
+ *         truncated if this is size or more.
+ */
+int vsnprintf(char* buf, size_t size, const char* format, va_list args)
+{
+    fmt_out_t   out = { .buf = buf, .size = (0 == size) ? 0 : size - 1, .len = 0 }; /* Output cursor */
+    const char* p   = format;                                                       /* Next format character */
+
+    while ('\0' != *p)
+    {
+        const char* spec      = p;           /* Start of the conversion, for verbatim output */
+        uint32_t    flags     = 0;           /* FMT_* flags */
+        int         width     = 0;           /* Field width */
+        int         precision = -1;          /* Precision, -1 if none */
+        fmt_len_t   length    = FMT_LEN_INT; /* Length modifier */
+        uint64_t    value     = 0x0ULL;      /* Integer argument */
+        int         negative  = 0;           /* Signed argument was negative */
+        uint32_t    base      = 10U;         /* Integer base */
+
+        if ('%' != *p)
+        {
+            fmt_putc(&out, *p++);
+            continue;
+        }
+        p++;
+
+        /* Flags */
+        for (;; ++p)
+        {
+            if ('-' == *p)
+            {
+                flags |= FMT_LEFT;
+            }
+            else if ('0' == *p)
+            {
+                flags |= FMT_ZERO;
+            }
+            else if ('+' == *p)
+            {
+                flags |= FMT_PLUS;
+            }
+            else if (' ' == *p)
+            {
+                flags |= FMT_SPACE;
+            }
+            else if ('#' == *p)
+            {
+                flags |= FMT_ALT;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        /* Field width */
+        if ('*' == *p)
+        {
+            width = va_arg(args, int);
+            if (width < 0)
+            {
+                flags |= FMT_LEFT;
+                width = -width;
+            }
+            p++;
+        }
+        while (('0' <= *p) && ('9' >= *p))
+        {
+            width = (width * 10) + (*p++ - '0');
+        }
+
+        /* Precision */
+        if ('.' == *p)
+        {
+            p++;
+            precision = 0;
+            if ('*' == *p)
+            {
+                precision = va_arg(args, int);
+                p++;
+            }
+            while (('0' <= *p) && ('9' >= *p))
+            {
+                precision = (precision * 10) + (*p++ - '0');
+            }
+            if (precision < 0)
+            {
+                precision = -1;
+            }
+        }
+
+        /* Length modifier */
+        if ('h' == *p)
+        {
+            length = ('h' == *++p) ? FMT_LEN_CHAR : FMT_LEN_SHORT;
+            p += (FMT_LEN_CHAR == length) ? 1 : 0;
+        }
+        else if ('l' == *p)
+        {
+            length = ('l' == *++p) ? FMT_LEN_LLONG : FMT_LEN_LONG;
+            p += (FMT_LEN_LLONG == length) ? 1 : 0;
+        }
+        else if (('z' == *p) || ('j' == *p) || ('t' == *p))
+        {
+            length = FMT_LEN_LONG;
+            p++;
+        }
+
+        switch (*p)
+        {
+        case 'd':
+        case 'i':
+        {
+            int64_t sval = 0; /* Signed argument */
+
+            switch (length)
+            {
+            case FMT_LEN_LONG:
+                sval = va_arg(args, long);
+                break;
+            case FMT_LEN_LLONG:
+                sval = va_arg(args, long long);
+                break;
+            case FMT_LEN_CHAR:
+                sval = (signed char)va_arg(args, int);
+                break;
+            case FMT_LEN_SHORT:
+                sval = (short)va_arg(args, int);
+                break;
+            default:
+                sval = va_arg(args, int);
+                break;
+            }
+
+            negative = (sval < 0);
+            value    = negative ? (0ULL - (uint64_t)sval) : (uint64_t)sval;
+            fmt_number(&out, value, negative, 10U, width, precision, flags);
+            break;
+        }
+        case 'X':
+            flags |= FMT_UPPER;
+            /* fall through */
+        case 'x':
+            base = 16U;
+            /* fall through */
+        case 'o':
+            base = ('o' == *p) ? 8U : base;
+            /* fall through */
+        case 'u':
+            switch (length)
+            {
+            case FMT_LEN_LONG:
+                value = va_arg(args, unsigned long);
+                break;
+            case FMT_LEN_LLONG:
+                value = va_arg(args, unsigned long long);
+                break;
+            case FMT_LEN_CHAR:
+                value = (unsigned char)va_arg(args, unsigned int);
+                break;
+            case FMT_LEN_SHORT:
+                value = (unsigned short)va_arg(args, unsigned int);
+                break;
+            default:
+                value = va_arg(args, unsigned int);
+                break;
+            }
+
+            fmt_number(&out, value, 0, base, width, precision, flags & ~(FMT_PLUS | FMT_SPACE));
+            break;
+        case 'p':
+            value = (uint64_t)(uintptr_t)va_arg(args, void*);
+            fmt_number(&out, value, 0, 16U, width, precision, (flags & ~(FMT_PLUS | FMT_SPACE)) | FMT_ALT);
+            break;
+        case 'c':
+        {
+            char c = (char)va_arg(args, int); /* The character */
+
+            fmt_string(&out, &c, 1, width, flags);
+            break;
+        }
+        case 's':
+        {
+            const char* s   = va_arg(args, const char*); /* The string */
+            int         len = 0;                         /* Characters to emit */
+
+            if (NULL == s)
+            {
+                s = "(null)";
+            }
+            while (('\0' != s[len]) && ((precision < 0) || (len < precision)))
+            {
+                len++;
+            }
+
+            fmt_string(&out, s, len, width, flags);
+            break;
+        }
+        case '%':
+            fmt_putc(&out, '%');
+            break;
+        default:
+            /* Unsupported or truncated conversion, emit it as written */
+            while (spec < p)
+            {
+                fmt_putc(&out, *spec++);
+            }
+            if ('\0' == *p)
+            {
+                continue;
+            }
+            fmt_putc(&out, *p);
+            break;
+        }
+
+        p++;
+    }
+
+    if (0 != size)
+    {
+        buf[(out.len < out.size) ? out.len : out.size] = '\0';
+    }
+
+    return (int)out.len;
+}
+
+/**
+ * @brief Format a string.
+ *
+ * @param buf Destination, always NUL terminated if size is not 0.
+ * @param size Size of buf.
+ * @param format The format string.
+ * @param ... The arguments for the format string.
+ * @return Length of the complete output, without the NUL; the output was
+ *         truncated if this is size or more.
+ */
+int snprintf(char* buf, size_t size, const char* format, ...)
+{
+    va_list args;
+    int     len = 0; /* Length of the complete output */
+
+    va_start(args, format);
+    len = vsnprintf(buf, size, format, args);
+    va_end(args);
+
+    return len;
+}
+
+/**
+ * @brief Write a character to the active log sink.
+ *
+ * @param c The character, converted to unsigned char.
+ * @return The character written.
+ */
+int putchar(int c)
+{
+    char ch = (char)c; /* The byte */
+
+    log_write(&ch, 1);
+
+    return (unsigned char)ch;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file string.c
+ * @brief String functions of the in-tree C runtime.
+ *
+ * This file contains the implementation of the string functions that are
+ * not performance critical; the memory functions are in string.s.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The hypervisor only handles short strings (log prefixes, semihosting
+ * paths, test messages), so these are simple byte loops.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the C runtime string functions.
+ */
+
+/* this module's header */
+#include "string.h"
+
+/* standard includes */
+#include <stddef.h>
+
+/**
+ * @brief Get the length of a string.
+ *
+ * @param s The string.
+ * @return Number of characters before the terminating NUL.
+ */
+size_t strlen(const char* s)
+{
+    size_t len = 0; /* Characters counted */
+
+    while ('\0' != s[len])
+    {
+        len++;
+    }
+
+    return len;
+}
+
+/**
+ * @brief Compare strings.
+ *
+ * @param a First string.
+ * @param b Second string.
+ * @return Difference of the first differing characters as unsigned char,
+ *         0 if the strings are equal.
+ */
+int strcmp(const char* a, const char* b)
+{
+    while (('\0' != *a) && (*a == *b))
+    {
+        a++;
+        b++;
+    }
+
+    return (int)(unsigned char)*a - (int)(unsigned char)*b;
+}
+
+/**
+ * @brief Copy a string into a fixed size field.
+ *
+ * @param dst Destination, padded with NULs up to n bytes.
+ * @param src Source string.
+ * @param n Size of dst; dst is not terminated if src is n characters or
+ *          longer.
+ * @return dst.
+ */
+char* strncpy(char* dst, const char* src, size_t n)
+{
+    size_t i = 0; /* Bytes written */
+
+    for (; (i < n) && ('\0' != src[i]); ++i)
+    {
+        dst[i] = src[i];
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] = '\0';
+    }
+
+    return dst;
+}
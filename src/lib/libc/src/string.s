@@ -0,0 +1,313 @@
+/**
+ * @file string.s
+ * @brief Memory functions of the in-tree C runtime.
+ *
+ * This file contains memcpy(), memmove(), memset() and memcmp() for
+ * AArch64.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Bulk copies move 64 bytes per iteration with four LDP/STP pairs after
+ * aligning the destination to 16 bytes; tails are finished with one
+ * access per remaining size bit. Zero fills of at least two DC ZVA blocks
+ * clear whole blocks with DC ZVA, unless DCZID_EL0 prohibits it.
+ *
+ * While SCTLR_EL2.M is clear every data access is a Device access, which
+ * faults when unaligned and on DC ZVA. All routines then fall back to
+ * byte accesses; this covers the C code that runs before mmu_init().
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * AArch64 memory copy, fill and compare routines.
+ *
+ * @section examples Examples
+ * No examples available, see string.h.
+ */
+
+/* SCTLR_EL2.M, stage-1 translation enabled */
+.equ SCTLR_EL2_M_BIT, 0
+
+/* DCZID_EL0.DZP, DC ZVA prohibited */
+.equ DCZID_DZP_BIT, 4
+
+/* Smallest fill worth the DC ZVA setup */
+.equ MEMSET_ZVA_MIN, 256
+
+.section .text
+.global memcpy
+.global memmove
+.global memset
+.global memcmp
+
+.type memcpy, %function
+.type memmove, %function
+.type memset, %function
+.type memcmp, %function
+
+// void* memcpy(void* dst (x0), const void* src (x1), size_t n (x2))
+memcpy:
+    // x3 walks the destination, x0 is returned
+    mov x3, x0
+    mrs x4, sctlr_el2
+    tbz x4, #SCTLR_EL2_M_BIT, .Lcpy_bytes
+    cmp x2, #64
+    b.lo .Lcpy_16
+
+    // Copy 16 bytes, then advance to the next 16-byte aligned destination
+    ldp x4, x5, [x1]
+    stp x4, x5, [x3]
+    neg x4, x3
+    and x4, x4, #15
+    add x1, x1, x4
+    add x3, x3, x4
+    sub x2, x2, x4
+
+.Lcpy_64:
+    // 64 bytes per iteration, loads ahead of stores
+    cmp x2, #64
+    b.lo .Lcpy_16
+    ldp x4, x5, [x1]
+    ldp x6, x7, [x1, #16]
+    ldp x8, x9, [x1, #32]
+    ldp x10, x11, [x1, #48]
+    add x1, x1, #64
+    sub x2, x2, #64
+    stp x4, x5, [x3]
+    stp x6, x7, [x3, #16]
+    stp x8, x9, [x3, #32]
+    stp x10, x11, [x3, #48]
+    add x3, x3, #64
+    b .Lcpy_64
+
+.Lcpy_16:
+    // Up to 63 bytes left
+    cmp x2, #16
+    b.lo .Lcpy_tail
+    ldp x4, x5, [x1], #16
+    stp x4, x5, [x3], #16
+    sub x2, x2, #16
+    b .Lcpy_16
+
+.Lcpy_tail:
+    // Up to 15 bytes left, one access per size bit
+    tbz x2, #3, 1f
+    ldr x4, [x1], #8
+    str x4, [x3], #8
+1:
+    tbz x2, #2, 2f
+    ldr w4, [x1], #4
+    str w4, [x3], #4
+2:
+    tbz x2, #1, 3f
+    ldrh w4, [x1], #2
+    strh w4, [x3], #2
+3:
+    tbz x2, #0, 4f
+    ldrb w4, [x1]
+    strb w4, [x3]
+4:
+    ret
+
+.Lcpy_bytes:
+    cbz x2, 5f
+    ldrb w4, [x1], #1
+    strb w4, [x3], #1
+    sub x2, x2, #1
+    b .Lcpy_bytes
+5:
+    ret
+.size memcpy, . - memcpy
+
+// void* memmove(void* dst (x0), const void* src (x1), size_t n (x2))
+memmove:
+    // dst - src >= n (unsigned): dst is below src or the areas are disjoint
+    sub x3, x0, x1
+    cmp x3, x2
+    b.lo .Lmove_back
+
+    // A forward copy is safe as long as every block is loaded before it is stored
+    mov x3, x0
+    mrs x4, sctlr_el2
+    tbz x4, #SCTLR_EL2_M_BIT, .Lcpy_bytes
+    b .Lcpy_64
+
+.Lmove_back:
+    // Copy from the end, x1 and x3 point past the areas
+    add x1, x1, x2
+    add x3, x0, x2
+    mrs x4, sctlr_el2
+    tbz x4, #SCTLR_EL2_M_BIT, .Lmove_back_bytes
+
+.Lmove_back_16:
+    cmp x2, #16
+    b.lo .Lmove_back_bytes
+    ldp x4, x5, [x1, #-16]!
+    stp x4, x5, [x3, #-16]!
+    sub x2, x2, #16
+    b .Lmove_back_16
+
+.Lmove_back_bytes:
+    cbz x2, 1f
+    ldrb w4, [x1, #-1]!
+    strb w4, [x3, #-1]!
+    sub x2, x2, #1
+    b .Lmove_back_bytes
+1:
+    ret
+.size memmove, . - memmove
+
+// void* memset(void* s (x0), int c (w1), size_t n (x2))
+memset:
+    // x3 walks the destination, x0 is returned
+    mov x3, x0
+    and x1, x1, #0xff
+    mrs x4, sctlr_el2
+    tbz x4, #SCTLR_EL2_M_BIT, .Lset_bytes
+
+    // Replicate the byte into all of x1
+    orr x1, x1, x1, lsl #8
+    orr x1, x1, x1, lsl #16
+    orr x1, x1, x1, lsl #32
+
+    cmp x2, #64
+    b.lo .Lset_16
+
+    // Fill 16 bytes, then advance to the next 16-byte aligned destination
+    stp x1, x1, [x3]
+    neg x4, x3
+    and x4, x4, #15
+    add x3, x3, x4
+    sub x2, x2, x4
+
+    // Zero fills of at least two blocks (and MEMSET_ZVA_MIN) use DC ZVA
+    cbnz x1, .Lset_64
+    cmp x2, #MEMSET_ZVA_MIN
+    b.lo .Lset_64
+    mrs x5, dczid_el0
+    tbnz x5, #DCZID_DZP_BIT, .Lset_64
+    and x5, x5, #15
+    mov x6, #4
+    lsl x6, x6, x5
+    cmp x2, x6, lsl #1
+    b.lo .Lset_64
+
+    // x6 is the block size in bytes, x7 the mask of the offset within a block
+    sub x7, x6, #1
+.Lset_zva_head:
+    tst x3, x7
+    b.eq .Lset_zva
+    stp xzr, xzr, [x3], #16
+    sub x2, x2, #16
+    b .Lset_zva_head
+
+.Lset_zva:
+    dc zva, x3
+    add x3, x3, x6
+    sub x2, x2, x6
+    cmp x2, x6
+    b.hs .Lset_zva
+
+.Lset_64:
+    // 64 bytes per iteration
+    cmp x2, #64
+    b.lo .Lset_16
+    stp x1, x1, [x3]
+    stp x1, x1, [x3, #16]
+    stp x1, x1, [x3, #32]
+    stp x1, x1, [x3, #48]
+    add x3, x3, #64
+    sub x2, x2, #64
+    b .Lset_64
+
+.Lset_16:
+    // Up to 63 bytes left
+    cmp x2, #16
+    b.lo .Lset_tail
+    stp x1, x1, [x3], #16
+    sub x2, x2, #16
+    b .Lset_16
+
+.Lset_tail:
+    // Up to 15 bytes left, one access per size bit
+    tbz x2, #3, 1f
+    str x1, [x3], #8
+1:
+    tbz x2, #2, 2f
+    str w1, [x3], #4
+2:
+    tbz x2, #1, 3f
+    strh w1, [x3], #2
+3:
+    tbz x2, #0, 4f
+    strb w1, [x3]
+4:
+    ret
+
+.Lset_bytes:
+    cbz x2, 5f
+    strb w1, [x3], #1
+    sub x2, x2, #1
+    b .Lset_bytes
+5:
+    ret
+.size memset, . - memset
+
+// int memcmp(const void* a (x0), const void* b (x1), size_t n (x2))
+memcmp:
+    mrs x3, sctlr_el2
+    tbz x3, #SCTLR_EL2_M_BIT, .Lcmp_bytes
+
+.Lcmp_16:
+    // Compare 16 bytes at a time, a difference is located byte by byte
+    cmp x2, #16
+    b.lo .Lcmp_bytes
+    ldp x3, x4, [x0]
+    ldp x5, x6, [x1]
+    cmp x3, x5
+    ccmp x4, x6, #0, eq
+    b.ne 1f
+    add x0, x0, #16
+    add x1, x1, #16
+    sub x2, x2, #16
+    b .Lcmp_16
+1:
+    mov x2, #16
+
+.Lcmp_bytes:
+    cbz x2, 2f
+    ldrb w3, [x0], #1
+    ldrb w4, [x1], #1
+    subs w3, w3, w4
+    b.ne 3f
+    sub x2, x2, #1
+    b .Lcmp_bytes
+2:
+    mov w0, #0
+    ret
+3:
+    mov w0, w3
+    ret
+.size memcmp, . - memcmp
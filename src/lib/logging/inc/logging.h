@@ -13,6 +13,17 @@
  * with different severity levels. It includes macros for logging
  * messages with a specific logging level.
  *
+ * Formatted messages go to a sink chosen at log_init() time. The UART
+ * sink writes each byte to the PL011 data register, which traps to the
+ * emulator once per character. The semihosting sink collects output in a
+ * buffer and hands whole buffers to the host with SYS_WRITE, which is the
+ * one to use for verbose test and benchmark runs.
+ *
+ * Once the UART is assigned to a guest, log_release_uart() moves the log
+ * to semihosting, or to an in-memory ring holding the most recent output
+ * when the host does not answer, and the hypervisor never touches the
+ * UART again.
+ *
  * @section license License
  * MIT License
  *
@@ -44,6 +55,11 @@
 
 /* standard includes */
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_SINK_BUFFER_SIZE (0x1000ULL) /**< Bytes collected before a semihosting write */
+#define LOG_FATAL_SPINS      (100000U)     /**< Lock attempts before a LOG_CRIT or worse message goes out unserialized */
 
 /**
  * @brief Logging levels, similar to syslog levels.
@@ -64,24 +80,85 @@ typedef enum log_level
     LOG_LVL_NUM,   /**< number of log levels */
 } log_level_t;
 
+/**
+ * @brief Destination of log output.
+ */
+typedef enum log_sink
+{
+    LOG_SINK_UART        = 0, /**< PL011 console, one trap per character */
+    LOG_SINK_SEMIHOSTING = 1, /**< buffered host console through semihosting */
+    LOG_SINK_MEMORY      = 2, /**< ring of the latest output, for a debugger */
+} log_sink_t;
+
 /**
  * @brief Initialize the logging system.
  *
- * Sets up the UART for logging.
+ * Sets up the UART, which stays the console for interactive use, and
+ * selects where log output goes. Falls back to the UART if the host does
+ * not answer semihosting requests. LOG_SINK_MEMORY starts an empty ring.
+ *
+ * @param sink The log sink.
+ */
+void log_init(log_sink_t sink);
+
+/**
+ * @brief Get the active log sink.
+ *
+ * @return The log sink.
+ */
+log_sink_t log_get_sink(void);
+
+/**
+ * @brief Get the position in the sink buffer.
+ *
+ * For the memory ring this is where the next byte goes, so the newest
+ * output ends right before it once the ring has wrapped.
+ *
+ * @param wraps Receives how many times the memory ring wrapped, may be
+ *              NULL.
+ * @return Bytes in the sink buffer.
+ */
+size_t log_get_fill(uint64_t* wraps);
+
+/**
+ * @brief Stop using the UART, it was assigned to a guest.
+ *
+ * Switches a UART log to semihosting, or to LOG_SINK_MEMORY if the host
+ * does not answer semihosting requests.
+ */
+void log_release_uart(void);
+
+/**
+ * @brief Write raw bytes to the active log sink.
+ *
+ * Also used by putchar() of the C runtime.
+ *
+ * @param data The bytes.
+ * @param len Number of bytes.
+ */
+void log_write(const char* data, size_t len);
+
+/**
+ * @brief Push buffered output to the sink.
+ *
+ * Must be called before the hypervisor stops, messages at LOG_ERR and
+ * above are flushed right away.
  */
-void log_init(void);
+void log_flush(void);
 
 /**
  * @brief Log a formatted message with a specific logging level.
  *
  * Logs a message with the given format and arguments at the specified
- * logging level.
+ * logging level. Messages at LOG_CRIT and above give up waiting for the
+ * log lock after LOG_FATAL_SPINS attempts, so a fault raised while the
+ * lock is held still gets reported.
  *
  * @param level The logging level.
  * @param format The format string.
  * @param ... The arguments for the format string.
  */
-void log_printf(log_level_t level, const char* format, ...);
+void log_printf(log_level_t level, const char* format, ...) __attribute__((format(printf, 2, 3)));
 
 #define LOG_EMERG(...)   log_printf(LOG_EMERG, __VA_ARGS__)
 #define LOG_ALERT(...)   log_printf(LOG_ALERT, __VA_ARGS__)
@@ -13,6 +13,16 @@
  * with different severity levels. It includes the log_init and log_printf
  * functions.
  *
+ * The semihosting sink only issues a host request when its buffer is full,
+ * on log_flush() or for messages at LOG_ERR and above, so that an
+ * error is visible even if the hypervisor hangs right after logging it.
+ *
+ * Messages are formatted on the caller's stack; log_lock only covers the
+ * sink buffer and the device, so a fault inside vsnprintf() cannot leave
+ * it held. The memory ring counts its wraps next to the fill level: a
+ * debugger reads the newest output up to log_sink_fill and the oldest
+ * from there to the end of the buffer.
+ *
  * @section license License
  * MIT License
  *
@@ -44,10 +54,13 @@
 
 /* standard includes */
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
-#include <string.h>
 
 /* project includes */
+#include "semihosting.h"
+#include "sync.h"
 #include "uart.h"
 
 #define MAX_LOG_LEN (256ULL) /* Max length in bytes for a log string */
@@ -64,23 +77,214 @@ static const char* level_strings[LOG_LVL_NUM] = {
     "DEBUG: "
 };
 
-static char log_tx_buffer[MAX_LOG_LEN] = { 0 }; /* Log Tx buffer */
+static char       log_sink_buffer[LOG_SINK_BUFFER_SIZE] = { 0 };         /* Semihosting buffer or memory ring */
+static size_t     log_sink_fill                         = 0;             /* Bytes in the sink buffer, the ring's write position */
+static uint64_t   log_sink_wraps                        = 0;             /* Times the memory ring wrapped */
+static int64_t    log_sink_handle                       = -1;            /* Host console handle */
+static log_sink_t log_sink                              = LOG_SINK_UART; /* Active sink */
+
+static sync_ticket_t log_lock = SYNC_TICKET_INIT; /* Serializes the buffers and the sink across CPUs */
 
 /**
  * @brief Initialize the logging system.
  *
- * Sets up the UART for logging.
+ * Sets up the UART, which stays the console for interactive use, and
+ * selects where log output goes.
+ *
+ * @param sink The log sink.
  */
-void log_init(void)
+void log_init(log_sink_t sink)
 {
     uart_init();
+
+    log_sink       = LOG_SINK_UART;
+    log_sink_fill  = 0;
+    log_sink_wraps = 0;
+
+    if (LOG_SINK_MEMORY == sink)
+    {
+        log_sink = LOG_SINK_MEMORY;
+    }
+    else if (LOG_SINK_SEMIHOSTING == sink)
+    {
+        log_sink_handle = semihosting_open(SEMIHOSTING_STDOUT, SEMIHOSTING_MODE_WB);
+        if (log_sink_handle >= 0)
+        {
+            log_sink = LOG_SINK_SEMIHOSTING;
+        }
+    }
+}
+
+/**
+ * @brief Get the active log sink.
+ *
+ * @return The log sink.
+ */
+log_sink_t log_get_sink(void)
+{
+    return log_sink;
+}
+
+/**
+ * @brief Get the position in the sink buffer.
+ *
+ * @param wraps Receives how many times the memory ring wrapped, may be
+ *              NULL.
+ * @return Bytes in the sink buffer.
+ */
+size_t log_get_fill(uint64_t* wraps)
+{
+    size_t fill = 0; /* Bytes buffered */
+
+    sync_ticket_lock(&log_lock);
+    fill = log_sink_fill;
+    if (NULL != wraps)
+    {
+        *wraps = log_sink_wraps;
+    }
+    sync_ticket_unlock(&log_lock);
+
+    return fill;
+}
+
+/**
+ * @brief Stop using the UART, it was assigned to a guest.
+ *
+ * Switches a UART log to semihosting, or to LOG_SINK_MEMORY if the host
+ * does not answer semihosting requests.
+ */
+void log_release_uart(void)
+{
+    sync_ticket_lock(&log_lock);
+
+    if (LOG_SINK_UART == log_sink)
+    {
+        log_sink_fill   = 0;
+        log_sink_wraps  = 0;
+        log_sink_handle = semihosting_open(SEMIHOSTING_STDOUT, SEMIHOSTING_MODE_WB);
+        log_sink        = (log_sink_handle >= 0) ? LOG_SINK_SEMIHOSTING : LOG_SINK_MEMORY;
+    }
+
+    sync_ticket_unlock(&log_lock);
+}
+
+/**
+ * @brief Push buffered output to the sink, log_lock held.
+ */
+static void log_flush_locked(void)
+{
+    if ((LOG_SINK_SEMIHOSTING == log_sink) && (0 != log_sink_fill))
+    {
+        (void)semihosting_write(log_sink_handle, log_sink_buffer, log_sink_fill);
+        log_sink_fill = 0;
+    }
+}
+
+/**
+ * @brief Write raw bytes to the active log sink, log_lock held.
+ *
+ * @param data The bytes.
+ * @param len Number of bytes.
+ */
+static void log_write_locked(const char* data, size_t len)
+{
+    if (LOG_SINK_UART == log_sink)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            uart_putc(data[i]);
+        }
+        return;
+    }
+
+    while (0 != len)
+    {
+        size_t chunk = LOG_SINK_BUFFER_SIZE - log_sink_fill; /* Room in the buffer */
+
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+
+        for (size_t i = 0; i < chunk; ++i)
+        {
+            log_sink_buffer[log_sink_fill + i] = data[i];
+        }
+
+        log_sink_fill += chunk;
+        data          += chunk;
+        len           -= chunk;
+
+        if (LOG_SINK_BUFFER_SIZE == log_sink_fill)
+        {
+            if (LOG_SINK_MEMORY == log_sink)
+            {
+                /* Wrap around, the ring keeps the most recent output */
+                log_sink_fill = 0;
+                log_sink_wraps++;
+            }
+            else
+            {
+                log_flush_locked();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Write raw bytes to the active log sink.
+ *
+ * @param data The bytes.
+ * @param len Number of bytes.
+ */
+void log_write(const char* data, size_t len)
+{
+    sync_ticket_lock(&log_lock);
+    log_write_locked(data, len);
+    sync_ticket_unlock(&log_lock);
+}
+
+/**
+ * @brief Push buffered output to the sink.
+ */
+void log_flush(void)
+{
+    sync_ticket_lock(&log_lock);
+    log_flush_locked();
+    sync_ticket_unlock(&log_lock);
+}
+
+/**
+ * @brief Take log_lock, giving up for fatal messages.
+ *
+ * @param level The level of the message.
+ * @return Non-zero if the lock was taken.
+ */
+static int log_lock_for(log_level_t level)
+{
+    if (level > LOG_CRIT)
+    {
+        sync_ticket_lock(&log_lock);
+        return 1;
+    }
+
+    /* The holder may be the faulting code on this very CPU */
+    for (uint32_t i = 0; i < LOG_FATAL_SPINS; ++i)
+    {
+        if (sync_ticket_trylock(&log_lock))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
 }
 
 /**
  * @brief Log a formatted message with a specific logging level.
  *
  * Logs a message with the given format and arguments at the specified
- * logging level.
+ * logging level. Messages longer than MAX_LOG_LEN are truncated.
  *
  * @param level The logging level.
  * @param format The format string.
@@ -88,33 +292,48 @@ void log_init(void)
  */
 void log_printf(log_level_t level, const char* format, ...)
 {
+    char    msg[MAX_LOG_LEN]; /* Formatted message */
     int     len_prefix = 0x0; /* length of log level prefix */
     int     len_msg    = 0x0; /* length of log message */
+    size_t  len        = 0;   /* bytes to send */
+    int     locked     = 0;   /* log_lock taken */
     va_list args;
 
-    va_start(args, format);
+    if ((unsigned)level >= LOG_LVL_NUM)
+    {
+        level = LOG_DEBUG;
+    }
 
-    len_prefix = snprintf(log_tx_buffer, sizeof(log_tx_buffer), "%s", level_strings[level]);
-    if ((0 > len_prefix) || (len_prefix >= sizeof(log_tx_buffer)))
+    len_prefix = snprintf(msg, sizeof(msg), "%s", level_strings[level]);
+    if (0 <= len_prefix)
     {
-        /* TODO: handle error */
-        printf("%s", "Buffer too small (or encoding error)!\n\r");
-        return;
+        va_start(args, format);
+        len_msg = vsnprintf(msg + len_prefix, sizeof(msg) - len_prefix, format, args);
+        va_end(args);
     }
 
-    len_msg = snprintf(log_tx_buffer + len_prefix, sizeof(log_tx_buffer), format, args);
-    if ((0 > len_msg) || ((len_msg + len_prefix) >= sizeof(log_tx_buffer)))
+    if ((0 > len_prefix) || (0 > len_msg))
     {
-        /* TODO: handle error */
-        printf("%s", "Buffer too small (or encoding error)!\n\r");
         return;
     }
 
-    va_end(args);
+    len = (size_t)len_prefix + (size_t)len_msg;
+    if (len >= sizeof(msg))
+    {
+        len = sizeof(msg) - 1;
+    }
 
-    /* Print the formatted string */
-    printf(log_tx_buffer);
+    /* A message is emitted as one unit */
+    locked = log_lock_for(level);
 
-    /* Reset the Tx buffer */
-    memset(log_tx_buffer, 0x0, len_prefix + len_msg);
+    log_write_locked(msg, len);
+    if (level <= LOG_ERR)
+    {
+        log_flush_locked();
+    }
+
+    if (locked)
+    {
+        sync_ticket_unlock(&log_lock);
+    }
 }
@@ -0,0 +1,568 @@
+/**
+ * @file sync.h
+ * @brief SMP synchronization primitives.
+ *
+ * This file contains the atomic operations, lock types and function
+ * prototypes shared by every module that touches state reachable from more
+ * than one physical CPU.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Read-modify-write operations come in two flavours. Armv8.1 LSE atomics
+ * (CAS, LDADD, SWP) are single instructions that the interconnect can
+ * execute near memory. Armv8.0 cores only have load/store exclusive loops.
+ * sync_init() reads ID_AA64ISAR0_EL1.Atomic once and the inline operations
+ * below branch on the result. Until then the LL/SC sequences are used,
+ * which work everywhere.
+ *
+ * Waiters never spin on plain loads. They arm the exclusive monitor on the
+ * word they wait for with a load-acquire exclusive and sleep in WFE. The
+ * store that releases them clears the monitor, and that sends the wakeup
+ * event. The EL2 event stream is enabled as a safety net, so a missed
+ * event costs a few microseconds rather than a hang.
+ *
+ * Lock types:
+ * - sync_ticket_t: FIFO spinlock in one word, for short critical sections.
+ * - sync_mcs_t: queued spinlock, each waiter spins on its own node, for
+ *   contended locks.
+ * - sync_rwlock_t: readers share, writers exclude, waiting writers block
+ *   new readers.
+ * - sync_seqcount_t: lock-free readers that retry if a writer interfered.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Atomic operations, spinlocks, reader-writer locks and sequence counters.
+ *
+ * @section examples Examples
+ * @code
+ * static sync_ticket_t lock = SYNC_TICKET_INIT;
+ *
+ * sync_ticket_lock(&lock);
+ * shared++;
+ * sync_ticket_unlock(&lock);
+ *
+ * // MCS: the node lives on the caller's stack for the duration
+ * sync_mcs_node_t node;
+ * sync_mcs_lock(&queue, &node);
+ * shared++;
+ * sync_mcs_unlock(&queue, &node);
+ * @endcode
+ */
+
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "status.h"
+#include "sysreg.h"
+
+#define ID_AA64ISAR0_EL1_ATOMIC_SHIFT (20U)  /**< Atomic instructions field */
+#define ID_AA64ISAR0_EL1_ATOMIC_MASK  (0xFU) /**< Atomic field width */
+#define ID_AA64ISAR0_EL1_ATOMIC_LSE   (0x2U) /**< CAS, LDADD, SWP and friends */
+
+#define CNTHCTL_EL2_EVNTEN     (1ULL << 2)            /**< Enable the event stream */
+#define CNTHCTL_EL2_EVNTI(n)   (((uint64_t)(n)) << 4) /**< Event on counter bit n toggling */
+#define CNTHCTL_EL2_EVNTI_MASK (0xFULL << 4)          /**< Event stream bit selector */
+#define SYNC_EVENT_STREAM_BIT  (9U)                   /**< Bit 9 toggles every 16us at 62.5MHz */
+
+#define SYNC_RWLOCK_WRITER  (1U << 31)                 /**< Writer holds the lock */
+#define SYNC_RWLOCK_WAITING (1U << 30)                 /**< Writer waits, readers stay out */
+#define SYNC_RWLOCK_READERS (SYNC_RWLOCK_WAITING - 1U) /**< Reader count mask */
+
+#define SYNC_TICKET_INIT   { .word = 0 }    /**< Unlocked ticket lock */
+#define SYNC_MCS_INIT      { .tail = NULL } /**< Unlocked MCS lock */
+#define SYNC_RWLOCK_INIT   { .word = 0 }    /**< Unlocked reader-writer lock */
+#define SYNC_SEQCOUNT_INIT { .seq = 0 }     /**< Sequence counter with no writer */
+
+/**
+ * @brief Atomic instruction set in use.
+ */
+typedef enum sync_impl
+{
+    SYNC_IMPL_LLSC = 0, /**< Load/store exclusive loops (Armv8.0) */
+    SYNC_IMPL_LSE  = 1, /**< Large System Extensions (Armv8.1) */
+} sync_impl_t;
+
+/**
+ * @brief Ticket spinlock.
+ *
+ * A locker takes a ticket from next and waits until owner reaches it.
+ */
+typedef union sync_ticket
+{
+    uint32_t word; /**< both halves, for atomic updates */
+    struct
+    {
+        uint16_t owner; /**< ticket being served */
+        uint16_t next;  /**< next ticket to hand out */
+    };
+} sync_ticket_t;
+
+/**
+ * @brief Queue node of an MCS lock, one per waiting CPU.
+ */
+typedef struct sync_mcs_node
+{
+    struct sync_mcs_node* next;   /**< successor in the queue */
+    uint32_t              locked; /**< set by the predecessor on hand-over */
+} sync_mcs_node_t;
+
+/**
+ * @brief MCS queued spinlock.
+ */
+typedef struct sync_mcs
+{
+    sync_mcs_node_t* tail; /**< last queued node, NULL if free */
+} sync_mcs_t;
+
+/**
+ * @brief Reader-writer spinlock.
+ */
+typedef struct sync_rwlock
+{
+    uint32_t word; /**< writer and waiting flags, reader count */
+} sync_rwlock_t;
+
+/**
+ * @brief Sequence counter, odd while a write is in progress.
+ */
+typedef struct sync_seqcount
+{
+    uint32_t seq; /**< write sequence */
+} sync_seqcount_t;
+
+extern sync_impl_t sync_impl; /**< Atomics used by the operations below */
+
+#ifdef HL_HOST_BUILD
+
+/* Native builds have neither exclusives nor WFE, both implementations map to the compiler's atomics */
+
+/**
+ * @brief Atomically add to a 32-bit word.
+ *
+ * @param ptr The word.
+ * @param val Value to add.
+ * @return The previous value.
+ */
+static inline uint32_t sync_fetch_add32(uint32_t* ptr, uint32_t val)
+{
+    return __atomic_fetch_add(ptr, val, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @brief Atomically exchange a 64-bit word.
+ *
+ * @param ptr The word.
+ * @param val New value.
+ * @return The previous value.
+ */
+static inline uint64_t sync_swap64(uint64_t* ptr, uint64_t val)
+{
+    return __atomic_exchange_n(ptr, val, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @brief Atomically compare and swap a 32-bit word.
+ *
+ * @param ptr The word.
+ * @param expected Value the word must hold.
+ * @param desired Value to store if it does.
+ * @return The previous value, equal to expected on success.
+ */
+static inline uint32_t sync_cas32(uint32_t* ptr, uint32_t expected, uint32_t desired)
+{
+    __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return expected;
+}
+
+/**
+ * @brief Atomically compare and swap a 64-bit word.
+ *
+ * @param ptr The word.
+ * @param expected Value the word must hold.
+ * @param desired Value to store if it does.
+ * @return The previous value, equal to expected on success.
+ */
+static inline uint64_t sync_cas64(uint64_t* ptr, uint64_t expected, uint64_t desired)
+{
+    __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return expected;
+}
+
+/**
+ * @brief Load a 32-bit word with acquire semantics.
+ *
+ * @param ptr The word.
+ * @return The current value.
+ */
+static inline uint32_t sync_monitor32(const uint32_t* ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Load a 64-bit word with acquire semantics.
+ *
+ * @param ptr The word.
+ * @return The current value.
+ */
+static inline uint64_t sync_monitor64(const uint64_t* ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+#else
+
+/**
+ * @brief Atomically add to a 32-bit word.
+ *
+ * @param ptr The word.
+ * @param val Value to add.
+ * @return The previous value.
+ */
+static inline uint32_t sync_fetch_add32(uint32_t* ptr, uint32_t val)
+{
+    uint32_t old = 0; /* Previous value */
+    uint32_t tmp = 0; /* Store status or sum */
+
+    if (SYNC_IMPL_LSE == sync_impl)
+    {
+        asm volatile(".arch_extension lse\n"
+                     "ldaddal %w[val], %w[old], %[mem]"
+                     : [old] "=&r"(old), [mem] "+Q"(*ptr)
+                     : [val] "r"(val)
+                     : "memory");
+        return old;
+    }
+
+    asm volatile("1: ldaxr  %w[old], %[mem]\n"
+                 "   add    %w[tmp], %w[old], %w[val]\n"
+                 "   stlxr  %w[tmp], %w[tmp], %[mem]\n"
+                 "   cbnz   %w[tmp], 1b"
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [mem] "+Q"(*ptr)
+                 : [val] "r"(val)
+                 : "memory");
+    return old;
+}
+
+/**
+ * @brief Atomically exchange a 64-bit word.
+ *
+ * @param ptr The word.
+ * @param val New value.
+ * @return The previous value.
+ */
+static inline uint64_t sync_swap64(uint64_t* ptr, uint64_t val)
+{
+    uint64_t old = 0; /* Previous value */
+    uint32_t tmp = 0; /* Store status */
+
+    if (SYNC_IMPL_LSE == sync_impl)
+    {
+        asm volatile(".arch_extension lse\n"
+                     "swpal %[val], %[old], %[mem]"
+                     : [old] "=&r"(old), [mem] "+Q"(*ptr)
+                     : [val] "r"(val)
+                     : "memory");
+        return old;
+    }
+
+    asm volatile("1: ldaxr  %[old], %[mem]\n"
+                 "   stlxr  %w[tmp], %[val], %[mem]\n"
+                 "   cbnz   %w[tmp], 1b"
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [mem] "+Q"(*ptr)
+                 : [val] "r"(val)
+                 : "memory");
+    return old;
+}
+
+/**
+ * @brief Atomically compare and swap a 32-bit word.
+ *
+ * @param ptr The word.
+ * @param expected Value the word must hold.
+ * @param desired Value to store if it does.
+ * @return The previous value, equal to expected on success.
+ */
+static inline uint32_t sync_cas32(uint32_t* ptr, uint32_t expected, uint32_t desired)
+{
+    uint32_t old = expected; /* Previous value */
+    uint32_t tmp = 0;        /* Store status */
+
+    if (SYNC_IMPL_LSE == sync_impl)
+    {
+        asm volatile(".arch_extension lse\n"
+                     "casal %w[old], %w[new], %[mem]"
+                     : [old] "+&r"(old), [mem] "+Q"(*ptr)
+                     : [new] "r"(desired)
+                     : "memory");
+        return old;
+    }
+
+    asm volatile("1: ldaxr  %w[old], %[mem]\n"
+                 "   cmp    %w[old], %w[exp]\n"
+                 "   b.ne   2f\n"
+                 "   stlxr  %w[tmp], %w[new], %[mem]\n"
+                 "   cbnz   %w[tmp], 1b\n"
+                 "   b      3f\n"
+                 "2: clrex\n"
+                 "3:"
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [mem] "+Q"(*ptr)
+                 : [exp] "r"(expected), [new] "r"(desired)
+                 : "cc", "memory");
+    return old;
+}
+
+/**
+ * @brief Atomically compare and swap a 64-bit word.
+ *
+ * @param ptr The word.
+ * @param expected Value the word must hold.
+ * @param desired Value to store if it does.
+ * @return The previous value, equal to expected on success.
+ */
+static inline uint64_t sync_cas64(uint64_t* ptr, uint64_t expected, uint64_t desired)
+{
+    uint64_t old = expected; /* Previous value */
+    uint32_t tmp = 0;        /* Store status */
+
+    if (SYNC_IMPL_LSE == sync_impl)
+    {
+        asm volatile(".arch_extension lse\n"
+                     "casal %[old], %[new], %[mem]"
+                     : [old] "+&r"(old), [mem] "+Q"(*ptr)
+                     : [new] "r"(desired)
+                     : "memory");
+        return old;
+    }
+
+    asm volatile("1: ldaxr  %[old], %[mem]\n"
+                 "   cmp    %[old], %[exp]\n"
+                 "   b.ne   2f\n"
+                 "   stlxr  %w[tmp], %[new], %[mem]\n"
+                 "   cbnz   %w[tmp], 1b\n"
+                 "   b      3f\n"
+                 "2: clrex\n"
+                 "3:"
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [mem] "+Q"(*ptr)
+                 : [exp] "r"(expected), [new] "r"(desired)
+                 : "cc", "memory");
+    return old;
+}
+
+/**
+ * @brief Load a 32-bit word and arm the exclusive monitor on it.
+ *
+ * A following WFE returns once another CPU writes the word.
+ *
+ * @param ptr The word.
+ * @return The current value, with acquire semantics.
+ */
+static inline uint32_t sync_monitor32(const uint32_t* ptr)
+{
+    uint32_t val = 0; /* Loaded value */
+
+    asm volatile("ldaxr %w[val], %[mem]"
+                 : [val] "=r"(val)
+                 : [mem] "Q"(*ptr)
+                 : "memory");
+    return val;
+}
+
+/**
+ * @brief Load a 64-bit word and arm the exclusive monitor on it.
+ *
+ * @param ptr The word.
+ * @return The current value, with acquire semantics.
+ */
+static inline uint64_t sync_monitor64(const uint64_t* ptr)
+{
+    uint64_t val = 0; /* Loaded value */
+
+    asm volatile("ldaxr %[val], %[mem]"
+                 : [val] "=r"(val)
+                 : [mem] "Q"(*ptr)
+                 : "memory");
+    return val;
+}
+
+#endif // HL_HOST_BUILD
+
+/**
+ * @brief Wake CPUs waiting in WFE for a change made by plain stores.
+ *
+ * Stores to a monitored word wake waiters by themselves; this is for flags
+ * that waiters poll without arming the monitor.
+ */
+static inline void sync_wake(void)
+{
+    DSB(ishst);
+    SEV();
+}
+
+/**
+ * @brief Detect the atomic instruction set and set up the calling CPU.
+ *
+ * Must run on the boot CPU before secondary CPUs are started.
+ */
+void sync_init(void);
+
+/**
+ * @brief Set up synchronization support on a secondary CPU.
+ *
+ * Enables the EL2 event stream that bounds every WFE wait.
+ */
+void sync_cpu_init(void);
+
+/**
+ * @brief Check whether the CPU implements LSE atomics.
+ *
+ * @return Non-zero if LSE atomics are available.
+ */
+int sync_lse_supported(void);
+
+/**
+ * @brief Select the atomic instruction set.
+ *
+ * Only for benchmarks, with no other CPU inside a primitive.
+ *
+ * @param impl The instruction set.
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the CPU lacks LSE.
+ */
+status_t sync_set_impl(sync_impl_t impl);
+
+/**
+ * @brief Get the name of an atomic instruction set.
+ *
+ * @param impl The instruction set.
+ * @return A static string.
+ */
+const char* sync_impl_name(sync_impl_t impl);
+
+/**
+ * @brief Acquire a ticket lock.
+ *
+ * @param lock The lock.
+ */
+void sync_ticket_lock(sync_ticket_t* lock);
+
+/**
+ * @brief Try to acquire a ticket lock without waiting.
+ *
+ * @param lock The lock.
+ * @return Non-zero if the lock was acquired.
+ */
+int sync_ticket_trylock(sync_ticket_t* lock);
+
+/**
+ * @brief Release a ticket lock.
+ *
+ * @param lock The lock, held by the caller.
+ */
+void sync_ticket_unlock(sync_ticket_t* lock);
+
+/**
+ * @brief Acquire an MCS lock.
+ *
+ * @param lock The lock.
+ * @param node Queue node owned by the caller until the lock is released.
+ */
+void sync_mcs_lock(sync_mcs_t* lock, sync_mcs_node_t* node);
+
+/**
+ * @brief Release an MCS lock.
+ *
+ * @param lock The lock, held by the caller.
+ * @param node The node passed to sync_mcs_lock().
+ */
+void sync_mcs_unlock(sync_mcs_t* lock, sync_mcs_node_t* node);
+
+/**
+ * @brief Acquire a reader-writer lock for reading.
+ *
+ * @param lock The lock.
+ */
+void sync_read_lock(sync_rwlock_t* lock);
+
+/**
+ * @brief Release a read hold on a reader-writer lock.
+ *
+ * @param lock The lock.
+ */
+void sync_read_unlock(sync_rwlock_t* lock);
+
+/**
+ * @brief Acquire a reader-writer lock for writing.
+ *
+ * @param lock The lock.
+ */
+void sync_write_lock(sync_rwlock_t* lock);
+
+/**
+ * @brief Release a write hold on a reader-writer lock.
+ *
+ * @param lock The lock.
+ */
+void sync_write_unlock(sync_rwlock_t* lock);
+
+/**
+ * @brief Start reading data protected by a sequence counter.
+ *
+ * Waits while a write is in progress.
+ *
+ * @param sc The sequence counter.
+ * @return Sequence to pass to sync_seq_read_retry().
+ */
+uint32_t sync_seq_read_begin(const sync_seqcount_t* sc);
+
+/**
+ * @brief Finish reading data protected by a sequence counter.
+ *
+ * @param sc The sequence counter.
+ * @param start Value returned by sync_seq_read_begin().
+ * @return Non-zero if a writer interfered and the read must be repeated.
+ */
+int sync_seq_read_retry(const sync_seqcount_t* sc, uint32_t start);
+
+/**
+ * @brief Start updating data protected by a sequence counter.
+ *
+ * Writers must be serialized by a lock of their own.
+ *
+ * @param sc The sequence counter.
+ */
+void sync_seq_write_begin(sync_seqcount_t* sc);
+
+/**
+ * @brief Finish updating data protected by a sequence counter.
+ *
+ * @param sc The sequence counter.
+ */
+void sync_seq_write_end(sync_seqcount_t* sc);
+
+#endif // SYNC_H
@@ -0,0 +1,362 @@
+/**
+ * @file sync.c
+ * @brief SMP synchronization primitives.
+ *
+ * This file contains the atomic instruction set detection and the lock,
+ * reader-writer lock and sequence counter implementations.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Every wait loop follows the same pattern: sync_monitor32() loads the
+ * word with acquire semantics and arms the exclusive monitor, and if the
+ * condition does not hold yet, WFE sleeps until a store to that word (or
+ * the event stream) wakes the CPU. Hand-over stores are store-release, so
+ * the new owner observes everything the previous owner wrote.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the synchronization library.
+ */
+
+/* this module's header */
+#include "sync.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "sysreg.h"
+
+sync_impl_t sync_impl = SYNC_IMPL_LLSC; /* Atomics in use, LL/SC until detected */
+
+/**
+ * @brief Check whether the CPU implements LSE atomics.
+ *
+ * @return Non-zero if LSE atomics are available.
+ */
+int sync_lse_supported(void)
+{
+    uint64_t isar0 = SYSREG_READ(id_aa64isar0_el1); /* Instruction set attributes */
+
+    return ((isar0 >> ID_AA64ISAR0_EL1_ATOMIC_SHIFT) & ID_AA64ISAR0_EL1_ATOMIC_MASK) >= ID_AA64ISAR0_EL1_ATOMIC_LSE;
+}
+
+/**
+ * @brief Detect the atomic instruction set and set up the calling CPU.
+ *
+ * Must run on the boot CPU before secondary CPUs are started.
+ */
+void sync_init(void)
+{
+    sync_impl = sync_lse_supported() ? SYNC_IMPL_LSE : SYNC_IMPL_LLSC;
+
+    sync_cpu_init();
+}
+
+/**
+ * @brief Set up synchronization support on a secondary CPU.
+ *
+ * Enables the EL2 event stream that bounds every WFE wait.
+ */
+void sync_cpu_init(void)
+{
+    uint64_t cnthctl = SYSREG_READ(cnthctl_el2); /* Counter-timer hypervisor control */
+
+    cnthctl &= ~CNTHCTL_EL2_EVNTI_MASK;
+    cnthctl |= CNTHCTL_EL2_EVNTI(SYNC_EVENT_STREAM_BIT) | CNTHCTL_EL2_EVNTEN;
+
+    SYSREG_WRITE(cnthctl_el2, cnthctl);
+    ISB();
+}
+
+/**
+ * @brief Select the atomic instruction set.
+ *
+ * Only for benchmarks, with no other CPU inside a primitive.
+ *
+ * @param impl The instruction set.
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the CPU lacks LSE.
+ */
+status_t sync_set_impl(sync_impl_t impl)
+{
+    if ((SYNC_IMPL_LSE == impl) && !sync_lse_supported())
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    sync_impl = impl;
+    DSB(ish);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Get the name of an atomic instruction set.
+ *
+ * @param impl The instruction set.
+ * @return A static string.
+ */
+const char* sync_impl_name(sync_impl_t impl)
+{
+    return (SYNC_IMPL_LSE == impl) ? "LSE" : "LL/SC";
+}
+
+/**
+ * @brief Acquire a ticket lock.
+ *
+ * @param lock The lock.
+ */
+void sync_ticket_lock(sync_ticket_t* lock)
+{
+    uint16_t ticket = (uint16_t)(sync_fetch_add32(&lock->word, 1U << 16) >> 16); /* Our place in line */
+
+    while ((uint16_t)sync_monitor32(&lock->word) != ticket)
+    {
+        WFE();
+    }
+}
+
+/**
+ * @brief Try to acquire a ticket lock without waiting.
+ *
+ * @param lock The lock.
+ * @return Non-zero if the lock was acquired.
+ */
+int sync_ticket_trylock(sync_ticket_t* lock)
+{
+    uint32_t word = __atomic_load_n(&lock->word, __ATOMIC_RELAXED); /* Current state */
+
+    if ((word & 0xFFFFU) != (word >> 16))
+    {
+        return 0;
+    }
+
+    return sync_cas32(&lock->word, word, word + (1U << 16)) == word;
+}
+
+/**
+ * @brief Release a ticket lock.
+ *
+ * @param lock The lock, held by the caller.
+ */
+void sync_ticket_unlock(sync_ticket_t* lock)
+{
+    /* Only the holder writes owner, the half-word store leaves next alone */
+    __atomic_store_n(&lock->owner, (uint16_t)(lock->owner + 1U), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Acquire an MCS lock.
+ *
+ * @param lock The lock.
+ * @param node Queue node owned by the caller until the lock is released.
+ */
+void sync_mcs_lock(sync_mcs_t* lock, sync_mcs_node_t* node)
+{
+    sync_mcs_node_t* prev = NULL; /* Node queued before ours */
+
+    node->next   = NULL;
+    node->locked = 0;
+
+    prev = (sync_mcs_node_t*)(uintptr_t)sync_swap64((uint64_t*)&lock->tail, (uintptr_t)node);
+    if (NULL == prev)
+    {
+        return;
+    }
+
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+
+    /* Spin on our own node, the predecessor hands over with one store */
+    while (0 == sync_monitor32(&node->locked))
+    {
+        WFE();
+    }
+}
+
+/**
+ * @brief Release an MCS lock.
+ *
+ * @param lock The lock, held by the caller.
+ * @param node The node passed to sync_mcs_lock().
+ */
+void sync_mcs_unlock(sync_mcs_t* lock, sync_mcs_node_t* node)
+{
+    sync_mcs_node_t* next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE); /* Successor */
+
+    if (NULL == next)
+    {
+        if (sync_cas64((uint64_t*)&lock->tail, (uintptr_t)node, 0) == (uintptr_t)node)
+        {
+            return;
+        }
+
+        /* A successor swapped the tail but has not linked itself in yet */
+        while (NULL == (next = (sync_mcs_node_t*)(uintptr_t)sync_monitor64((uint64_t*)&node->next)))
+        {
+            WFE();
+        }
+    }
+
+    __atomic_store_n(&next->locked, 1U, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Acquire a reader-writer lock for reading.
+ *
+ * @param lock The lock.
+ */
+void sync_read_lock(sync_rwlock_t* lock)
+{
+    for (;;)
+    {
+        uint32_t word = sync_monitor32(&lock->word); /* Current state */
+
+        if (0 != (word & (SYNC_RWLOCK_WRITER | SYNC_RWLOCK_WAITING)))
+        {
+            WFE();
+            continue;
+        }
+
+        if (sync_cas32(&lock->word, word, word + 1U) == word)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Release a read hold on a reader-writer lock.
+ *
+ * @param lock The lock.
+ */
+void sync_read_unlock(sync_rwlock_t* lock)
+{
+    (void)sync_fetch_add32(&lock->word, (uint32_t)-1);
+}
+
+/**
+ * @brief Acquire a reader-writer lock for writing.
+ *
+ * @param lock The lock.
+ */
+void sync_write_lock(sync_rwlock_t* lock)
+{
+    for (;;)
+    {
+        uint32_t word = sync_monitor32(&lock->word); /* Current state */
+
+        if (0 == (word & (SYNC_RWLOCK_WRITER | SYNC_RWLOCK_READERS)))
+        {
+            if (sync_cas32(&lock->word, word, SYNC_RWLOCK_WRITER) == word)
+            {
+                return;
+            }
+            continue;
+        }
+
+        /* Announce ourselves so that no new readers get in */
+        if ((0 == (word & SYNC_RWLOCK_WAITING)) &&
+            (sync_cas32(&lock->word, word, word | SYNC_RWLOCK_WAITING) != word))
+        {
+            continue;
+        }
+
+        WFE();
+    }
+}
+
+/**
+ * @brief Release a write hold on a reader-writer lock.
+ *
+ * @param lock The lock.
+ */
+void sync_write_unlock(sync_rwlock_t* lock)
+{
+    /* Other waiting writers set the waiting flag again on their next pass */
+    __atomic_store_n(&lock->word, 0U, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Start reading data protected by a sequence counter.
+ *
+ * Waits while a write is in progress.
+ *
+ * @param sc The sequence counter.
+ * @return Sequence to pass to sync_seq_read_retry().
+ */
+uint32_t sync_seq_read_begin(const sync_seqcount_t* sc)
+{
+    uint32_t seq = sync_monitor32(&sc->seq); /* Sequence at entry */
+
+    while (0 != (seq & 1U))
+    {
+        WFE();
+        seq = sync_monitor32(&sc->seq);
+    }
+
+    return seq;
+}
+
+/**
+ * @brief Finish reading data protected by a sequence counter.
+ *
+ * @param sc The sequence counter.
+ * @param start Value returned by sync_seq_read_begin().
+ * @return Non-zero if a writer interfered and the read must be repeated.
+ */
+int sync_seq_read_retry(const sync_seqcount_t* sc, uint32_t start)
+{
+    /* Order the protected loads before the second look at the sequence */
+    DMB(ishld);
+
+    return __atomic_load_n(&sc->seq, __ATOMIC_RELAXED) != start;
+}
+
+/**
+ * @brief Start updating data protected by a sequence counter.
+ *
+ * Writers must be serialized by a lock of their own.
+ *
+ * @param sc The sequence counter.
+ */
+void sync_seq_write_begin(sync_seqcount_t* sc)
+{
+    __atomic_store_n(&sc->seq, sc->seq + 1U, __ATOMIC_RELAXED);
+
+    /* Readers that see the new data also see the odd sequence */
+    DMB(ishst);
+}
+
+/**
+ * @brief Finish updating data protected by a sequence counter.
+ *
+ * @param sc The sequence counter.
+ */
+void sync_seq_write_end(sync_seqcount_t* sc)
+{
+    __atomic_store_n(&sc->seq, sc->seq + 1U, __ATOMIC_RELEASE);
+}
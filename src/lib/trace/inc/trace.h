@@ -0,0 +1,237 @@
+/**
+ * @file trace.h
+ * @brief Binary VM exit tracing.
+ *
+ * This file contains the fixed-format trace record, the static key that
+ * switches tracing on and off and the function prototypes to record and
+ * dump VM exits.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Every physical CPU owns a ring of TRACE_EVENTS records that it alone
+ * writes, so recording takes no lock; once the ring is full the oldest
+ * record is overwritten. An exit is opened on trap entry and committed on
+ * the next guest entry of the same CPU, its duration covers everything in
+ * between, including idling when the vCPU went to sleep.
+ *
+ * The hooks sit behind a static key: every call site is a single NOP
+ * until trace_enable() patches it into a branch to the recording code, so
+ * a disabled trace costs no memory access and no conditional branch.
+ *
+ * trace_dump() writes the rings to a host file through semihosting or as
+ * hex lines on the UART; host/tools/trace2json.py turns either into a
+ * Chrome trace (chrome://tracing, Perfetto).
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Trace record layout, static key and tracing function prototypes.
+ *
+ * @section examples Examples
+ * @code
+ * trace_enable(1);
+ * // ... run guests ...
+ * trace_enable(0);
+ * trace_dump(LOG_SINK_SEMIHOSTING); // host: trace2json.py hyperlite.trace > trace.json
+ * @endcode
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "logging.h"
+#include "status.h"
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS (1024U) /**< Records kept per CPU, a power of two */
+#endif
+
+#ifndef TRACE_AT_BOOT
+#define TRACE_AT_BOOT (0) /**< Non-zero to enable tracing in trace_init() */
+#endif
+
+#define TRACE_DUMP_PATH "hyperlite.trace" /**< Host file written by trace_dump() */
+#define TRACE_MAGIC     "HLTRACE1"        /**< First bytes of a dump */
+#define TRACE_UART_TAG  "@HLT "           /**< Prefix of the hex lines of a UART dump */
+
+#if (TRACE_EVENTS & (TRACE_EVENTS - 1)) != 0
+#error "TRACE_EVENTS must be a power of two"
+#endif
+
+/**
+ * @brief Kind of a trace record.
+ */
+typedef enum trace_type
+{
+    TRACE_EXIT_SYNC = 0, /**< synchronous exception, see esr */
+    TRACE_EXIT_IRQ  = 1, /**< physical interrupt */
+} trace_type_t;
+
+/**
+ * @brief One trace record, 32 bytes, little endian.
+ *
+ * The layout is part of the dump format read by trace2json.py.
+ */
+typedef struct trace_event
+{
+    uint64_t ts;       /**< CNTVCT_EL0 when the exit was taken */
+    uint64_t arg;      /**< guest PC for synchronous exits, INTID for IRQs */
+    uint32_t esr;      /**< ESR_EL2, 0 for IRQs */
+    uint32_t duration; /**< counter ticks until the next guest entry */
+    uint16_t vm;       /**< VM identifier */
+    uint8_t  vcpu;     /**< vCPU index within the VM */
+    uint8_t  type;     /**< trace_type_t */
+    uint32_t reserved; /**< zero */
+} trace_event_t;
+
+/**
+ * @brief Dump file header, followed by one trace_cpu_hdr_t and its
+ *        records per CPU.
+ */
+typedef struct trace_file_hdr
+{
+    char     magic[8];   /**< TRACE_MAGIC, not NUL terminated */
+    uint32_t cpus;       /**< CPU blocks that follow */
+    uint32_t event_size; /**< sizeof(trace_event_t) */
+    uint64_t freq;       /**< counter ticks per second */
+} trace_file_hdr_t;
+
+/**
+ * @brief Header of the records of one CPU in a dump.
+ */
+typedef struct trace_cpu_hdr
+{
+    uint32_t cpu;   /**< physical CPU */
+    uint32_t count; /**< records that follow, oldest first */
+    uint64_t lost;  /**< older records that were overwritten */
+} trace_cpu_hdr_t;
+
+/**
+ * @brief Test the static key.
+ *
+ * Compiles to a NOP that trace_enable() rewrites into a branch; the site
+ * and its target are recorded in the .trace_sites section.
+ *
+ * @return Non-zero if tracing is on.
+ */
+static inline __attribute__((always_inline)) int trace_on(void)
+{
+    asm goto("1: nop\n"
+             ".pushsection .trace_sites, \"a\"\n"
+             ".balign 8\n"
+             ".quad 1b, %l[on]\n"
+             ".popsection\n"
+             :
+             :
+             :
+             : on);
+    return 0;
+on:
+    return 1;
+}
+
+/**
+ * @brief Enable tracing if the build asks for it (HL_TRACE).
+ */
+void trace_init(void);
+
+/**
+ * @brief Switch tracing on or off.
+ *
+ * Rewrites every call site of trace_on(). Safe while other CPUs run: a
+ * NOP and a branch may be swapped under a running CPU.
+ *
+ * @param on Non-zero to record exits.
+ */
+void trace_enable(int on);
+
+/**
+ * @brief Open an exit record, use trace_exit_begin().
+ *
+ * @param type trace_type_t of the exit.
+ * @param vm VM identifier.
+ * @param vcpu vCPU index within the VM.
+ * @param esr ESR_EL2 of synchronous exits.
+ * @param arg See trace_event_t.
+ */
+void trace_exit_open(uint32_t type, uint32_t vm, uint32_t vcpu, uint64_t esr, uint64_t arg);
+
+/**
+ * @brief Commit the open exit record, use trace_exit_end().
+ */
+void trace_exit_commit(void);
+
+/**
+ * @brief Record that a guest exit was taken on the calling CPU.
+ *
+ * @param type trace_type_t of the exit.
+ * @param vm VM identifier.
+ * @param vcpu vCPU index within the VM.
+ * @param esr ESR_EL2 of synchronous exits.
+ * @param arg See trace_event_t.
+ */
+static inline void trace_exit_begin(uint32_t type, uint32_t vm, uint32_t vcpu, uint64_t esr, uint64_t arg)
+{
+    if (trace_on())
+    {
+        trace_exit_open(type, vm, vcpu, esr, arg);
+    }
+}
+
+/**
+ * @brief Record that the calling CPU enters a guest again.
+ */
+static inline void trace_exit_end(void)
+{
+    if (trace_on())
+    {
+        trace_exit_commit();
+    }
+}
+
+/**
+ * @brief Copy the records of one CPU, oldest first.
+ *
+ * @param cpu The physical CPU.
+ * @param out Receives up to TRACE_EVENTS records.
+ * @param lost Receives the number of overwritten records, may be NULL.
+ * @return Number of records copied.
+ */
+uint32_t trace_snapshot(uint32_t cpu, trace_event_t* out, uint64_t* lost);
+
+/**
+ * @brief Write all rings to the host.
+ *
+ * Does nothing if no record was ever taken.
+ *
+ * @param sink LOG_SINK_SEMIHOSTING writes TRACE_DUMP_PATH, LOG_SINK_UART
+ *             prints the same bytes as TRACE_UART_TAG prefixed hex lines.
+ * @return STATUS_OK or STATUS_ERR_IO.
+ */
+status_t trace_dump(log_sink_t sink);
+
+#endif // TRACE_H
@@ -0,0 +1,396 @@
+/**
+ * @file trace.c
+ * @brief Binary VM exit tracing.
+ *
+ * This file contains the implementation of the per-CPU trace rings, the
+ * static key patching and the dump to the host.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A ring is only written by its own CPU from trap context, with interrupts
+ * masked, so a record is published by a release store of the ring's head.
+ * Readers on other CPUs copy the ring and then re-read the head to drop
+ * the records the writer lapped during the copy.
+ *
+ * The static key relies on the hypervisor text being writable at EL2,
+ * which the flat EL2 mapping set up by mmu_init() provides.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of VM exit tracing.
+ */
+
+/* this module's header */
+#include "trace.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "semihosting.h"
+#include "smp.h"
+#include "sync.h"
+#include "sysreg.h"
+
+#define TRACE_INSN_NOP   (0xD503201FU) /**< NOP */
+#define TRACE_INSN_B     (0x14000000U) /**< B, imm26 in words */
+#define TRACE_INSN_B_IMM (0x03FFFFFFU) /**< imm26 field of B */
+
+#define TRACE_HEX_BYTES (32U) /**< Dump bytes per UART line */
+
+/**
+ * @brief A static key call site, emitted by trace_on().
+ */
+typedef struct trace_site
+{
+    uint64_t site;   /**< address of the NOP */
+    uint64_t target; /**< branch target when tracing is on */
+} trace_site_t;
+
+/**
+ * @brief Trace state of one physical CPU.
+ */
+typedef struct trace_ring
+{
+    trace_event_t events[TRACE_EVENTS]; /**< records, indexed by sequence number */
+    uint64_t      head;                 /**< records ever committed */
+    trace_event_t open;                 /**< exit taken but not yet returned from */
+    uint32_t      open_valid;           /**< open holds a record */
+} trace_ring_t;
+
+/**
+ * @brief Destination of a dump.
+ */
+typedef struct trace_out
+{
+    log_sink_t sink;                   /**< where the bytes go */
+    int64_t    handle;                 /**< host file for LOG_SINK_SEMIHOSTING */
+    status_t   status;                 /**< first error */
+    uint8_t    line[TRACE_HEX_BYTES];  /**< bytes of the UART line being built */
+    uint32_t   fill;                   /**< bytes in line */
+} trace_out_t;
+
+extern const trace_site_t __trace_sites_start__[]; /* Defined by the linker */
+extern const trace_site_t __trace_sites_end__[];   /* Defined by the linker */
+
+static trace_ring_t  trace_rings[SMP_MAX_CPUS];      /* Per-CPU rings */
+static trace_event_t trace_copy[TRACE_EVENTS];       /* Ring snapshot being dumped */
+static uint32_t      trace_used = 0;                 /* A record was committed */
+static sync_ticket_t trace_lock = SYNC_TICKET_INIT;  /* Serializes patching and dumps */
+
+/**
+ * @brief Rewrite one instruction of the hypervisor text.
+ *
+ * @param site The instruction.
+ * @param insn The new encoding.
+ */
+static void trace_patch(uint32_t* site, uint32_t insn)
+{
+    __atomic_store_n(site, insn, __ATOMIC_RELAXED);
+
+    /* Push the store to the point of unification, then drop stale copies from every I-cache */
+    DC(cvau, site);
+    DSB(ish);
+    IC(ivau, site);
+    DSB(ish);
+}
+
+/**
+ * @brief Enable tracing if the build asks for it (HL_TRACE).
+ */
+void trace_init(void)
+{
+    if (TRACE_AT_BOOT)
+    {
+        trace_enable(1);
+    }
+}
+
+/**
+ * @brief Switch tracing on or off.
+ *
+ * @param on Non-zero to record exits.
+ */
+void trace_enable(int on)
+{
+    sync_ticket_lock(&trace_lock);
+
+    if (on)
+    {
+        /* Exits opened before the key was last switched off were never committed */
+        for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; ++cpu)
+        {
+            trace_rings[cpu].open_valid = 0;
+        }
+        DSB(ish);
+    }
+
+    for (const trace_site_t* s = __trace_sites_start__; s < __trace_sites_end__; ++s)
+    {
+        uint32_t insn = TRACE_INSN_NOP; /* Off: fall through to "return 0" */
+
+        if (on)
+        {
+            insn = TRACE_INSN_B | (uint32_t)(((s->target - s->site) >> 2) & TRACE_INSN_B_IMM);
+        }
+
+        trace_patch((uint32_t*)(uintptr_t)s->site, insn);
+    }
+
+    ISB();
+
+    sync_ticket_unlock(&trace_lock);
+}
+
+/**
+ * @brief Open an exit record.
+ *
+ * @param type trace_type_t of the exit.
+ * @param vm VM identifier.
+ * @param vcpu vCPU index within the VM.
+ * @param esr ESR_EL2 of synchronous exits.
+ * @param arg See trace_event_t.
+ */
+void trace_exit_open(uint32_t type, uint32_t vm, uint32_t vcpu, uint64_t esr, uint64_t arg)
+{
+    trace_ring_t* ring = &trace_rings[smp_cpu_id()]; /* This CPU's ring */
+
+    ring->open.ts       = SYSREG_READ(cntvct_el0);
+    ring->open.arg      = arg;
+    ring->open.esr      = (uint32_t)esr;
+    ring->open.duration = 0;
+    ring->open.vm       = (uint16_t)vm;
+    ring->open.vcpu     = (uint8_t)vcpu;
+    ring->open.type     = (uint8_t)type;
+    ring->open.reserved = 0;
+    ring->open_valid    = 1;
+}
+
+/**
+ * @brief Commit the open exit record.
+ */
+void trace_exit_commit(void)
+{
+    trace_ring_t* ring     = &trace_rings[smp_cpu_id()];          /* This CPU's ring */
+    uint64_t      head     = ring->head;                          /* Sequence number of the record */
+    uint64_t      duration = 0x0ULL;                              /* Ticks since the exit */
+
+    if (!ring->open_valid)
+    {
+        return;
+    }
+
+    duration            = SYSREG_READ(cntvct_el0) - ring->open.ts;
+    ring->open.duration = (duration > UINT32_MAX) ? UINT32_MAX : (uint32_t)duration;
+    ring->open_valid    = 0;
+
+    ring->events[head & (TRACE_EVENTS - 1U)] = ring->open;
+    __atomic_store_n(&ring->head, head + 1ULL, __ATOMIC_RELEASE);
+
+    if (0 == __atomic_load_n(&trace_used, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&trace_used, 1U, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Copy the records of one CPU, oldest first.
+ *
+ * @param cpu The physical CPU.
+ * @param out Receives up to TRACE_EVENTS records.
+ * @param lost Receives the number of overwritten records, may be NULL.
+ * @return Number of records copied.
+ */
+uint32_t trace_snapshot(uint32_t cpu, trace_event_t* out, uint64_t* lost)
+{
+    trace_ring_t* ring  = NULL;  /* The CPU's ring */
+    uint64_t      head  = 0x0ULL; /* Records committed before the copy */
+    uint64_t      first = 0x0ULL; /* Oldest record still in the ring */
+    uint64_t      after = 0x0ULL; /* Records committed after the copy */
+    uint64_t      skip  = 0x0ULL; /* Copied records the writer lapped */
+
+    if (cpu >= SMP_MAX_CPUS)
+    {
+        return 0;
+    }
+
+    ring  = &trace_rings[cpu];
+    head  = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    first = (head > TRACE_EVENTS) ? (head - TRACE_EVENTS) : 0x0ULL;
+
+    for (uint64_t seq = first; seq < head; ++seq)
+    {
+        out[seq - first] = ring->events[seq & (TRACE_EVENTS - 1U)];
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    /* Record "after" may be half written over the slot of after - TRACE_EVENTS */
+    if ((after + 1ULL) > (first + TRACE_EVENTS))
+    {
+        skip = (after + 1ULL) - (first + TRACE_EVENTS);
+        if (skip > (head - first))
+        {
+            skip = head - first;
+        }
+        memmove(out, out + skip, (size_t)(head - first - skip) * sizeof(trace_event_t));
+    }
+
+    if (NULL != lost)
+    {
+        *lost = first + skip;
+    }
+
+    return (uint32_t)(head - first - skip);
+}
+
+/**
+ * @brief Print the pending bytes of a UART dump as one hex line.
+ *
+ * @param out The dump.
+ */
+static void trace_out_line(trace_out_t* out)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    char   text[sizeof(TRACE_UART_TAG) + (2U * TRACE_HEX_BYTES) + 2U]; /* Line */
+    size_t len = sizeof(TRACE_UART_TAG) - 1U;                          /* Characters in text */
+
+    if (0 == out->fill)
+    {
+        return;
+    }
+
+    memcpy(text, TRACE_UART_TAG, len);
+    for (uint32_t i = 0; i < out->fill; ++i)
+    {
+        text[len++] = hex[out->line[i] >> 4];
+        text[len++] = hex[out->line[i] & 0xFU];
+    }
+    text[len++] = '\n';
+    text[len++] = '\r';
+
+    log_write(text, len);
+    out->fill = 0;
+}
+
+/**
+ * @brief Append bytes to a dump.
+ *
+ * @param out The dump.
+ * @param data The bytes.
+ * @param len Number of bytes.
+ */
+static void trace_out_write(trace_out_t* out, const void* data, uint64_t len)
+{
+    const uint8_t* bytes = (const uint8_t*)data; /* Next byte */
+
+    if (LOG_SINK_SEMIHOSTING == out->sink)
+    {
+        if ((STATUS_OK == out->status) && (0 != len))
+        {
+            out->status = semihosting_write(out->handle, data, len);
+        }
+        return;
+    }
+
+    while (0 != len--)
+    {
+        out->line[out->fill++] = *bytes++;
+        if (TRACE_HEX_BYTES == out->fill)
+        {
+            trace_out_line(out);
+        }
+    }
+}
+
+/**
+ * @brief Write all rings to the host.
+ *
+ * @param sink LOG_SINK_SEMIHOSTING writes TRACE_DUMP_PATH, LOG_SINK_UART
+ *             prints the same bytes as TRACE_UART_TAG prefixed hex lines.
+ * @return STATUS_OK or STATUS_ERR_IO.
+ */
+status_t trace_dump(log_sink_t sink)
+{
+    trace_out_t      out   = { .sink = sink, .handle = -1, .status = STATUS_OK }; /* Destination */
+    trace_file_hdr_t hdr   = { 0 };                                               /* File header */
+    uint64_t         total = 0x0ULL;                                              /* Records dumped */
+
+    if (0 == __atomic_load_n(&trace_used, __ATOMIC_RELAXED))
+    {
+        return STATUS_OK;
+    }
+
+    sync_ticket_lock(&trace_lock);
+
+    if (LOG_SINK_SEMIHOSTING == sink)
+    {
+        out.handle = semihosting_open(TRACE_DUMP_PATH, SEMIHOSTING_MODE_WB);
+        if (out.handle < 0)
+        {
+            sync_ticket_unlock(&trace_lock);
+            return STATUS_ERR_IO;
+        }
+    }
+
+    memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.cpus       = SMP_MAX_CPUS;
+    hdr.event_size = sizeof(trace_event_t);
+    hdr.freq       = arch_counter_freq();
+    trace_out_write(&out, &hdr, sizeof(hdr));
+
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; ++cpu)
+    {
+        trace_cpu_hdr_t cpu_hdr = { .cpu = cpu }; /* Block header */
+
+        cpu_hdr.count = trace_snapshot(cpu, trace_copy, &cpu_hdr.lost);
+        trace_out_write(&out, &cpu_hdr, sizeof(cpu_hdr));
+        trace_out_write(&out, trace_copy, (uint64_t)cpu_hdr.count * sizeof(trace_event_t));
+        total += cpu_hdr.count;
+    }
+
+    if (LOG_SINK_SEMIHOSTING == sink)
+    {
+        if (STATUS_OK != semihosting_close(out.handle))
+        {
+            out.status = STATUS_ERR_IO;
+        }
+    }
+    else
+    {
+        trace_out_line(&out);
+    }
+
+    sync_ticket_unlock(&trace_lock);
+
+    LOG_INFO("trace: %lu records dumped%s\n\r", total, (LOG_SINK_SEMIHOSTING == sink) ? " to " TRACE_DUMP_PATH : "");
+
+    return out.status;
+}
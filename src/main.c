@@ -3,14 +3,16 @@
  * @brief Entry point of the hypervisor.
  *
  * This file contains the main function that initializes the logging system,
- * tests the MMU setup and functionality, and exits QEMU.
+ * the MMU and the virtualization support, starts the configured VMs and
+ * exits QEMU when there is no guest to run.
  *
  * @date 2024-05-18
  * @version 1.0
  * @details
- * The main function initializes the logging system, sets up the MMU, tests
- * memory access before and after enabling the MMU, logs the current Exception
- * Level (EL), and exits QEMU.
+ * The main function initializes the logging system, sets up the MMU, logs
+ * the current Exception Level (EL), creates the VMs from the static
+ * configuration tables and hands the CPUs to the scheduler. Without a guest
+ * image it exits QEMU.
  *
  * @section license License
  * MIT License
@@ -34,10 +36,23 @@
  * SOFTWARE.
  */
 
+#include "frame.h"
+#include "gic.h"
 #include "logging.h"
 #include "mmu.h"
+#include "platform.h"
+#include "sched.h"
+#include "stage2.h"
+#include "sync.h"
+#include "trace.h"
+#include "trap.h"
+#include "vgic.h"
+#include "vm_config.h"
+#include <stddef.h>
 #include <stdint.h>
 
+extern char __frame_pool_start__; /* Defined by the linker */
+
 /**
  * @brief Exit QEMU.
  *
@@ -57,12 +72,14 @@ void qemu_exit(void)
 /**
  * @brief Main function.
  *
- * This function initializes the logging system, sets up and tests the MMU,
- * logs the current Exception Level (EL), and exits QEMU.
+ * This function initializes the logging system, sets up the MMU, logs the
+ * current Exception Level (EL), launches the configured VMs and schedules
+ * those with a guest image. It exits QEMU if there is nothing to run.
  */
 void main(void)
 {
-    log_init(); // Initialize logging system
+    sync_init();             // Pick the atomic instruction set before anything takes a lock
+    log_init(LOG_SINK_UART); // Initialize logging system, the UART is the interactive console
 
     // Log the current EL
     uint64_t current_el;
@@ -76,5 +93,28 @@ void main(void)
     mmu_init(); // Initialize the MMU
     LOG_INFO("MMU Initialization Complete\n\r");
 
+    trap_init();      // Install the EL2 exception vectors
+    trace_init();     // Switch exit tracing on if the build asks for it
+    vgic_init();      // Enable the virtual CPU interface
+    gic_init();       // Enable the physical distributor
+    gic_cpu_init();   // Route this CPU's private interrupts
+    stage2_hw_init(); // Configure the stage-2 translation layout
+
+    // Hand the RAM between the hypervisor image and the guest regions to the frame allocator
+    frame_init((uintptr_t)&__frame_pool_start__,
+               VM_CONFIG_POOL_END - (uintptr_t)&__frame_pool_start__);
+
+    if (STATUS_OK == vm_config_launch())
+    {
+        if (0 != vm_config_schedule())
+        {
+            log_flush();
+            sched_start(); // Idles tickless whenever every vCPU of a CPU waits
+        }
+
+        LOG_WARNING("No guest image loaded, nothing to run\n\r");
+    }
+
+    log_flush(); // Drain buffered log output before leaving
     qemu_exit(); // Call the function to exit QEMU
 }
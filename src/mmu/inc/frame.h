@@ -0,0 +1,193 @@
+/**
+ * @file frame.h
+ * @brief Physical frame allocator.
+ *
+ * This file contains the function prototypes and constants for the
+ * allocator that hands out 4KB physical frames for guest memory and
+ * stage-2 translation tables.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The allocator tracks the frame pool with a bitmap, one bit per frame.
+ * A small stack of frames that have already been zeroed is kept aside so
+ * that latency sensitive paths, such as the stage-2 fault handler, do not
+ * have to clear a page before handing it out.
+ *
+ * The stack is refilled by idle CPUs through frame_refill(): once it drops
+ * below FRAME_ZEROED_LOW, idle time is spent zeroing frames (with DC ZVA,
+ * see memset()) until it holds FRAME_ZEROED_HIGH frames again. Zeroed
+ * allocations fall back to clearing the frame synchronously only when the
+ * stack is empty.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Function prototypes and constants for the physical frame allocator.
+ *
+ * @section examples Examples
+ * @code
+ * uint64_t pa = frame_alloc_zeroed();
+ * if (0x0ULL != pa)
+ * {
+ *     frame_free(pa);
+ * }
+ * @endcode
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+#define FRAME_SHIFT (12ULL)                /**< log2 of the frame size */
+#define FRAME_SIZE  (1ULL << FRAME_SHIFT)  /**< Frame size (4KB) */
+#define FRAME_MASK  (~(FRAME_SIZE - 1ULL)) /**< Frame address mask */
+
+#define FRAME_POOL_MAX_FRAMES (0x80000ULL) /**< Largest pool that can be managed (2GB) */
+#define FRAME_ZEROED_MAX      (256U)       /**< Capacity of the pre-zeroed frame stack */
+
+#ifndef FRAME_ZEROED_LOW
+#define FRAME_ZEROED_LOW (64U) /**< Idle refill starts below this many pre-zeroed frames */
+#endif
+
+#ifndef FRAME_ZEROED_HIGH
+#define FRAME_ZEROED_HIGH (FRAME_ZEROED_MAX) /**< Idle refill stops at this many pre-zeroed frames */
+#endif
+
+#define FRAME_REFILL_BATCH (4U) /**< Frames an idle CPU zeroes between checks for work */
+
+#if (FRAME_ZEROED_LOW > FRAME_ZEROED_HIGH) || (FRAME_ZEROED_HIGH > FRAME_ZEROED_MAX)
+#error "FRAME_ZEROED_LOW <= FRAME_ZEROED_HIGH <= FRAME_ZEROED_MAX is required"
+#endif
+
+/**
+ * @brief Frame allocator statistics.
+ */
+typedef struct frame_stats
+{
+    uint64_t total;         /**< frames in the pool */
+    uint64_t free;          /**< frames currently free, including pre-zeroed */
+    uint64_t zeroed;        /**< frames currently on the pre-zeroed stack */
+    uint64_t zeroed_hits;   /**< zeroed allocations served from the stack */
+    uint64_t zeroed_miss;   /**< zeroed allocations that had to clear a frame */
+    uint64_t refills;       /**< refills below FRAME_ZEROED_LOW that zeroed a frame */
+    uint64_t prezeroed;     /**< frames zeroed ahead of time */
+    uint64_t prezero_ticks; /**< counter ticks spent zeroing them */
+} frame_stats_t;
+
+/**
+ * @brief Initialize the frame allocator.
+ *
+ * @param base Physical start of the pool, rounded up to a frame boundary.
+ * @param size Size of the pool in bytes.
+ */
+void frame_init(uint64_t base, uint64_t size);
+
+/**
+ * @brief Allocate a frame.
+ *
+ * The contents of the frame are undefined.
+ *
+ * @return Physical address of the frame, or 0 if the pool is exhausted.
+ */
+uint64_t frame_alloc(void);
+
+/**
+ * @brief Allocate a zero filled frame.
+ *
+ * Served from the pre-zeroed stack when possible.
+ *
+ * @return Physical address of the frame, or 0 if the pool is exhausted.
+ */
+uint64_t frame_alloc_zeroed(void);
+
+/**
+ * @brief Allocate physically contiguous frames.
+ *
+ * @param count Number of frames.
+ * @return Physical address of the first frame, or 0 on failure.
+ */
+uint64_t frame_alloc_contig(uint64_t count);
+
+/**
+ * @brief Allocate physically contiguous frames aligned to their size.
+ *
+ * Used to back a stage-2 block mapping, e.g. 512 frames for 2MB.
+ *
+ * @param count Number of frames, a power of two.
+ * @return Physical address of the first frame, or 0 on failure.
+ */
+uint64_t frame_alloc_aligned(uint64_t count);
+
+/**
+ * @brief Return a frame to the pool.
+ *
+ * @param pa Physical address of the frame.
+ */
+void frame_free(uint64_t pa);
+
+/**
+ * @brief Return physically contiguous frames to the pool.
+ *
+ * @param pa Physical address of the first frame.
+ * @param count Number of frames.
+ */
+void frame_free_contig(uint64_t pa, uint64_t count);
+
+/**
+ * @brief Refill the pre-zeroed stack.
+ *
+ * Meant to be called off the critical path, e.g. at VM creation or when a
+ * core is idle.
+ *
+ * @param max Upper bound on the number of frames to zero.
+ * @return Number of frames added to the stack.
+ */
+uint32_t frame_prezero(uint32_t max);
+
+/**
+ * @brief Zero frames for the pre-zeroed stack from an idle CPU.
+ *
+ * Does nothing unless the stack dropped below FRAME_ZEROED_LOW and has not
+ * been refilled to FRAME_ZEROED_HIGH since.
+ *
+ * @param max Upper bound on the number of frames to zero.
+ * @return Non-zero if the stack still needs frames.
+ */
+int frame_refill(uint32_t max);
+
+/**
+ * @brief Retrieve allocator statistics.
+ *
+ * @param stats Filled with the current statistics.
+ */
+void frame_get_stats(frame_stats_t* stats);
+
+/**
+ * @brief Log the pre-zeroed stack hit rate and refill bandwidth.
+ */
+void frame_report(void);
+
+#endif // FRAME_H
@@ -46,6 +46,8 @@
 
 #include <stdint.h>
 
+#include "status.h"
+
 typedef uint64_t mmu_pte_t;
 
 typedef struct
@@ -54,6 +56,8 @@ typedef struct
 } mmu_table_t;
 
 void     mmu_init(void);
+void     mmu_enable(void);
 uint64_t mmu_get_page_table_base(void);
+status_t mmu_translate_va(uint64_t va, uint64_t* pa);
 
 #endif // MMU_H
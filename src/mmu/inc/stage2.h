@@ -0,0 +1,318 @@
+/**
+ * @file stage2.h
+ * @brief Stage-2 translation table management.
+ *
+ * This file contains the function prototypes and constants for building
+ * the stage-2 (IPA to PA) translation tables of a VM.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Stage-2 tables use the 4KB granule with a 39-bit IPA space, so a walk
+ * starts at level 1 and maps 1GB blocks (level 1), 2MB blocks (level 2)
+ * or 4KB pages (level 3). Tables are allocated from the frame allocator.
+ *
+ * A block is split into a table of smaller leaves when part of it needs
+ * other attributes, and a table whose leaves map one aligned physical
+ * range with the same attributes can be folded back into a block. Both
+ * use break-before-make with TLB invalidation by IPA.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Function prototypes and constants for stage-2 translation tables.
+ *
+ * @section examples Examples
+ * @code
+ * stage2_t s2;
+ * stage2_init(&s2, 1);
+ * stage2_map(&s2, 0x40000000ULL, pa, FRAME_SIZE, STAGE2_MEM_NORMAL);
+ * stage2_activate(&s2);
+ * @endcode
+ */
+
+#ifndef STAGE2_H
+#define STAGE2_H
+
+#include <stdint.h>
+
+#include "mmu.h"
+#include "status.h"
+
+#define STAGE2_IPA_BITS   (39ULL)  /**< Size of the IPA space */
+#define STAGE2_ENTRIES    (512ULL) /**< Descriptors per table */
+#define STAGE2_PAGE_SIZE  (0x1000ULL)     /**< Level 3 page size */
+#define STAGE2_BLOCK_2M   (0x200000ULL)   /**< Level 2 block size */
+#define STAGE2_BLOCK_1G   (0x40000000ULL) /**< Level 1 block size */
+
+/* Stage-2 descriptor bits */
+#define S2_PTE_VALID      (1ULL << 0)               /**< Valid descriptor */
+#define S2_PTE_TABLE      (1ULL << 1)               /**< Table (levels 1-2) or page (level 3) */
+#define S2_PTE_MEM_NORMAL (0xFULL << 2)             /**< Normal, write-back cacheable */
+#define S2_PTE_MEM_DEVICE (0x1ULL << 2)             /**< Device-nGnRE */
+#define S2_PTE_MEM_MASK   (0xFULL << 2)             /**< Memory attribute mask */
+#define S2_PTE_S2AP_R     (1ULL << 6)               /**< Readable */
+#define S2_PTE_S2AP_W     (1ULL << 7)               /**< Writable */
+#define S2_PTE_SH_INNER   (3ULL << 8)               /**< Inner shareable */
+#define S2_PTE_AF         (1ULL << 10)              /**< Access flag */
+#define S2_PTE_XN         (1ULL << 54)              /**< Execute never */
+#define S2_PTE_ADDR_MASK  (0x0000FFFFFFFFF000ULL)   /**< Output address mask */
+#define S2_PTE_ATTR_MASK  (~S2_PTE_ADDR_MASK & ~(S2_PTE_VALID | S2_PTE_TABLE)) /**< Attribute bits */
+
+/* Common attribute sets */
+#define STAGE2_MEM_NORMAL (S2_PTE_MEM_NORMAL | S2_PTE_S2AP_R | S2_PTE_S2AP_W | S2_PTE_SH_INNER | S2_PTE_AF) /**< Guest RAM */
+#define STAGE2_MEM_DEVICE (S2_PTE_MEM_DEVICE | S2_PTE_S2AP_R | S2_PTE_S2AP_W | S2_PTE_AF | S2_PTE_XN)      /**< Guest MMIO */
+
+/**
+ * @brief Callback invoked for each valid leaf descriptor.
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor, may be modified in place.
+ * @param arg Caller context.
+ */
+typedef void (*stage2_leaf_fn_t)(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg);
+
+/**
+ * @brief Leaves of an IPA range, by size.
+ */
+typedef struct stage2_census
+{
+    uint64_t blocks_1g; /**< 1GB block leaves */
+    uint64_t blocks_2m; /**< 2MB block leaves */
+    uint64_t pages;     /**< 4KB page leaves */
+} stage2_census_t;
+
+/**
+ * @brief Stage-2 translation regime of a VM.
+ */
+typedef struct stage2
+{
+    mmu_pte_t* root; /**< level 1 table */
+    uint16_t   vmid; /**< virtual machine identifier */
+    uint32_t   gen;  /**< bumped by every TLB invalidation */
+} stage2_t;
+
+/**
+ * @brief Configure VTCR_EL2 for the stage-2 layout.
+ *
+ * Must be called once on every physical CPU.
+ */
+void stage2_hw_init(void);
+
+/**
+ * @brief Create an empty stage-2 translation regime.
+ *
+ * @param s2 The regime to initialize.
+ * @param vmid The VMID tagging this regime's TLB entries.
+ * @return STATUS_OK or STATUS_ERR_NO_MEMORY.
+ */
+status_t stage2_init(stage2_t* s2, uint16_t vmid);
+
+/**
+ * @brief Free all translation tables of a regime.
+ *
+ * Frames mapped by the regime are not freed.
+ *
+ * @param s2 The regime.
+ */
+void stage2_destroy(stage2_t* s2);
+
+/**
+ * @brief Map an IPA range.
+ *
+ * The largest block size allowed by the alignment of ipa, pa and size is
+ * used for each part of the range. Existing mappings must be unmapped
+ * first.
+ *
+ * @param s2 The regime.
+ * @param ipa Page aligned start IPA.
+ * @param pa Page aligned start PA.
+ * @param size Page aligned size in bytes.
+ * @param attr Descriptor attributes, e.g. STAGE2_MEM_NORMAL.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS or
+ *         STATUS_ERR_NO_MEMORY.
+ */
+status_t stage2_map(stage2_t* s2, uint64_t ipa, uint64_t pa, uint64_t size, uint64_t attr);
+
+/**
+ * @brief Unmap an IPA range and invalidate its TLB entries.
+ *
+ * Block mappings must be unmapped as a whole, or split first with
+ * stage2_split().
+ *
+ * @param s2 The regime.
+ * @param ipa Page aligned start IPA.
+ * @param size Page aligned size in bytes.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NOT_SUPPORTED when
+ *         the range splits a block.
+ */
+status_t stage2_unmap(stage2_t* s2, uint64_t ipa, uint64_t size);
+
+/**
+ * @brief Translate an IPA.
+ *
+ * @param s2 The regime.
+ * @param ipa The IPA to translate.
+ * @param pa Receives the PA, may be NULL.
+ * @param attr Receives the descriptor attributes, may be NULL.
+ * @return STATUS_OK or STATUS_ERR_NOT_FOUND.
+ */
+status_t stage2_lookup(const stage2_t* s2, uint64_t ipa, uint64_t* pa, uint64_t* attr);
+
+/**
+ * @brief Visit every valid leaf overlapping an IPA range.
+ *
+ * Leaves are visited in ascending IPA order. Missing tables are skipped
+ * as a whole, so the cost depends on the mapped part of the range only.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA.
+ * @param size Size of the range in bytes.
+ * @param fn Called for each leaf.
+ * @param arg Passed to fn.
+ */
+void stage2_for_each_leaf(stage2_t* s2, uint64_t ipa, uint64_t size, stage2_leaf_fn_t fn, void* arg);
+
+/**
+ * @brief Change the attributes of the leaves in an IPA range.
+ *
+ * The TLB is not invalidated, the caller flushes once after a batch of
+ * updates with stage2_tlb_flush_ipa() or stage2_tlb_flush_all().
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA.
+ * @param size Size of the range in bytes.
+ * @param clear Attribute bits to clear, e.g. S2_PTE_S2AP_W.
+ * @param set Attribute bits to set.
+ * @return Number of leaves updated.
+ */
+uint64_t stage2_protect(stage2_t* s2, uint64_t ipa, uint64_t size, uint64_t clear, uint64_t set);
+
+/**
+ * @brief Break the blocks covering an IPA down to a 4KB page.
+ *
+ * A 1GB block becomes 2MB blocks and the one covering the IPA becomes
+ * pages, all with the attributes and output addresses of the original.
+ * Each block is invalidated and flushed by IPA before the table that
+ * replaces it is installed.
+ *
+ * @param s2 The regime.
+ * @param ipa The IPA.
+ * @return STATUS_OK if a block was split, STATUS_ERR_EXISTS if the IPA is
+ *         mapped by a page already, STATUS_ERR_INVALID,
+ *         STATUS_ERR_NOT_FOUND or STATUS_ERR_NO_MEMORY.
+ */
+status_t stage2_split(stage2_t* s2, uint64_t ipa);
+
+/**
+ * @brief Fold a range mapped linearly by smaller leaves into one block.
+ *
+ * Every leaf of the table mapping the range must be valid, have the same
+ * attributes and continue the output address of the previous one, from a
+ * size aligned start. A 1GB range qualifies once its 2MB parts are blocks.
+ * The table is invalidated and its leaves flushed by IPA before the block
+ * is written, then freed.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA, aligned to size.
+ * @param size STAGE2_BLOCK_2M or STAGE2_BLOCK_1G.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS if the range is
+ *         a block already, STATUS_ERR_NOT_FOUND if it has no table, or
+ *         STATUS_ERR_NOT_SUPPORTED if the leaves cannot form a block.
+ */
+status_t stage2_promote(stage2_t* s2, uint64_t ipa, uint64_t size);
+
+/**
+ * @brief Map a fully populated range with one block at a new address.
+ *
+ * Like stage2_promote(), but the leaves may map any addresses with any
+ * attributes; the caller has copied their contents to pa. fn typically
+ * frees the frames of the old leaves.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA, aligned to size.
+ * @param size STAGE2_BLOCK_2M or STAGE2_BLOCK_1G.
+ * @param pa Output address of the block, aligned to size.
+ * @param attr Attributes of the block.
+ * @param fn Called for each replaced leaf once the block is in place, may
+ *           be NULL.
+ * @param arg Passed to fn.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS,
+ *         STATUS_ERR_NOT_FOUND or STATUS_ERR_NOT_SUPPORTED if a part of
+ *         the range is unmapped.
+ */
+status_t stage2_collapse(stage2_t* s2, uint64_t ipa, uint64_t size, uint64_t pa, uint64_t attr, stage2_leaf_fn_t fn, void* arg);
+
+/**
+ * @brief Count the leaves of an IPA range by size.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA.
+ * @param size Size of the range in bytes.
+ * @param census Receives the counts.
+ */
+void stage2_census(stage2_t* s2, uint64_t ipa, uint64_t size, stage2_census_t* census);
+
+/**
+ * @brief Make a regime the active stage-2 translation.
+ *
+ * @param s2 The regime.
+ */
+void stage2_activate(const stage2_t* s2);
+
+/**
+ * @brief Invalidate the TLB entries of one IPA page.
+ *
+ * Bumps the regime's generation, so software caches of its translations
+ * see the change.
+ *
+ * @param s2 The regime.
+ * @param ipa The IPA.
+ */
+void stage2_tlb_flush_ipa(stage2_t* s2, uint64_t ipa);
+
+/**
+ * @brief Invalidate the TLB entries of an IPA range.
+ *
+ * One invalidation per page, ranges larger than a 2MB block fall back to
+ * stage2_tlb_flush_all(). Bumps the regime's generation like
+ * stage2_tlb_flush_ipa().
+ *
+ * @param s2 The regime.
+ * @param ipa Page aligned start IPA.
+ * @param size Page aligned size in bytes.
+ */
+void stage2_tlb_flush_range(stage2_t* s2, uint64_t ipa, uint64_t size);
+
+/**
+ * @brief Invalidate all TLB entries of a regime.
+ *
+ * Bumps the regime's generation like stage2_tlb_flush_ipa().
+ *
+ * @param s2 The regime.
+ */
+void stage2_tlb_flush_all(stage2_t* s2);
+
+#endif // STAGE2_H
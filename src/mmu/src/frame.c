@@ -0,0 +1,580 @@
+/**
+ * @file frame.c
+ * @brief Physical frame allocator.
+ *
+ * This file contains the implementation of the allocator that hands out
+ * 4KB physical frames for guest memory and stage-2 translation tables.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A set bit in the bitmap marks a frame as in use. Frames sitting on the
+ * pre-zeroed stack are marked in use in the bitmap so that the two free
+ * lists never hand out the same frame. The hypervisor runs with an
+ * identity stage-1 mapping, so physical addresses can be dereferenced
+ * directly.
+ *
+ * zeroed_refill implements the watermark hysteresis: it is raised when the
+ * stack drops below FRAME_ZEROED_LOW and cleared once it is back at
+ * FRAME_ZEROED_HIGH, or when the pool has no free frame left to zero.
+ * Idle CPUs test it without the lock. A refill is counted when its first
+ * frame lands on the stack, so raising the flag again on every free while
+ * the pool is exhausted does not inflate the count.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the physical frame allocator.
+ */
+
+/* this module's header */
+#include "frame.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "logging.h"
+#include "sync.h"
+#include "sysreg.h"
+
+#define BITMAP_WORDS (FRAME_POOL_MAX_FRAMES / 64ULL) /**< Words in the allocation bitmap */
+
+static uint64_t frame_bitmap[BITMAP_WORDS] = { 0 }; /* Allocation bitmap, 1 = in use */
+static uint64_t frame_base                 = 0x0ULL; /* Physical base of the pool */
+static uint64_t frame_count                = 0x0ULL; /* Frames in the pool */
+static uint64_t frame_words                = 0x0ULL; /* Bitmap words covering the pool */
+static uint64_t frame_free_count           = 0x0ULL; /* Frames free in the bitmap */
+static uint64_t frame_hint                 = 0x0ULL; /* Bitmap word to start searching from */
+
+static uint64_t zeroed_stack[FRAME_ZEROED_MAX] = { 0 };     /* Pre-zeroed frames */
+static uint32_t zeroed_top                     = 0;         /* Entries on the stack */
+static uint32_t zeroed_refill                  = 0;         /* Idle CPUs should refill the stack */
+static uint32_t zeroed_started                 = 0;         /* The current refill zeroed a frame */
+static uint64_t zeroed_hits                    = 0x0ULL;    /* Allocations served from the stack */
+static uint64_t zeroed_miss                    = 0x0ULL;    /* Allocations zeroed synchronously */
+static uint64_t zeroed_refills                 = 0x0ULL;    /* Refills that zeroed at least one frame */
+static uint64_t zeroed_frames                  = 0x0ULL;    /* Frames zeroed ahead of time */
+static uint64_t zeroed_ticks                   = 0x0ULL;    /* Counter ticks spent zeroing them */
+
+static sync_mcs_t frame_lock = SYNC_MCS_INIT; /* Guards the pool, queued since every faulting CPU lands here */
+
+/**
+ * @brief Mark a range of frames in use or free.
+ *
+ * @param first Index of the first frame.
+ * @param count Number of frames.
+ * @param used Non-zero to mark in use, zero to mark free.
+ */
+static void frame_mark(uint64_t first, uint64_t count, int used)
+{
+    for (uint64_t i = first; i < first + count; ++i)
+    {
+        if (used)
+        {
+            frame_bitmap[i / 64] |= 1ULL << (i % 64);
+        }
+        else
+        {
+            frame_bitmap[i / 64] &= ~(1ULL << (i % 64));
+        }
+    }
+}
+
+/**
+ * @brief Ask idle CPUs for frames once the stack is below the low watermark, frame_lock held.
+ */
+static void frame_zeroed_check_locked(void)
+{
+    if ((0 == zeroed_refill) && (zeroed_top < FRAME_ZEROED_LOW))
+    {
+        zeroed_started = 0;
+        __atomic_store_n(&zeroed_refill, 1U, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Initialize the frame allocator.
+ *
+ * @param base Physical start of the pool, rounded up to a frame boundary.
+ * @param size Size of the pool in bytes.
+ */
+void frame_init(uint64_t base, uint64_t size)
+{
+    uint64_t aligned = (base + FRAME_SIZE - 1ULL) & FRAME_MASK; /* First whole frame */
+
+    size = (size > (aligned - base)) ? size - (aligned - base) : 0x0ULL;
+
+    frame_base  = aligned;
+    frame_count = size >> FRAME_SHIFT;
+    if (frame_count > FRAME_POOL_MAX_FRAMES)
+    {
+        frame_count = FRAME_POOL_MAX_FRAMES;
+    }
+    frame_words = (frame_count + 63ULL) / 64ULL;
+
+    /* Everything beyond the pool stays marked in use */
+    memset(frame_bitmap, 0xFF, sizeof(frame_bitmap));
+    frame_mark(0, frame_count, 0);
+
+    frame_free_count = frame_count;
+    frame_hint       = 0;
+    zeroed_top       = 0;
+    zeroed_refill    = 0;
+    zeroed_started   = 0;
+    zeroed_hits      = 0;
+    zeroed_miss      = 0;
+    zeroed_refills   = 0;
+    zeroed_frames    = 0;
+    zeroed_ticks     = 0;
+
+    frame_zeroed_check_locked();
+}
+
+/**
+ * @brief Allocate a frame, frame_lock held.
+ *
+ * @return Physical address of the frame, or 0 if the pool is exhausted.
+ */
+static uint64_t frame_alloc_locked(void)
+{
+    /* Only the words that cover the pool, an exhausted bitmap is not scanned */
+    for (uint64_t n = 0; (0 != frame_free_count) && (n < frame_words); ++n)
+    {
+        uint64_t word = (frame_hint + n) % frame_words;
+        uint64_t bit  = 0;
+
+        if (~0x0ULL == frame_bitmap[word])
+        {
+            continue;
+        }
+
+        bit = (uint64_t)__builtin_ctzll(~frame_bitmap[word]);
+        frame_bitmap[word] |= 1ULL << bit;
+        frame_free_count--;
+        frame_hint = word;
+
+        return frame_base + (((word * 64) + bit) << FRAME_SHIFT);
+    }
+
+    /* Fall back to frames that were already zeroed */
+    if (zeroed_top > 0)
+    {
+        uint64_t pa = zeroed_stack[--zeroed_top];
+
+        frame_zeroed_check_locked();
+        return pa;
+    }
+
+    return 0x0ULL;
+}
+
+/**
+ * @brief Allocate a frame.
+ *
+ * @return Physical address of the frame, or 0 if the pool is exhausted.
+ */
+uint64_t frame_alloc(void)
+{
+    sync_mcs_node_t node;          /* Our place in the lock queue */
+    uint64_t        pa   = 0x0ULL; /* Allocated frame */
+
+    sync_mcs_lock(&frame_lock, &node);
+    pa = frame_alloc_locked();
+    sync_mcs_unlock(&frame_lock, &node);
+
+    return pa;
+}
+
+/**
+ * @brief Allocate a zero filled frame.
+ *
+ * @return Physical address of the frame, or 0 if the pool is exhausted.
+ */
+uint64_t frame_alloc_zeroed(void)
+{
+    sync_mcs_node_t node;          /* Our place in the lock queue */
+    uint64_t        pa   = 0x0ULL; /* Allocated frame */
+
+    sync_mcs_lock(&frame_lock, &node);
+
+    if (zeroed_top > 0)
+    {
+        zeroed_hits++;
+        pa = zeroed_stack[--zeroed_top];
+        frame_zeroed_check_locked();
+        sync_mcs_unlock(&frame_lock, &node);
+        return pa;
+    }
+
+    pa = frame_alloc_locked();
+    if (0x0ULL != pa)
+    {
+        zeroed_miss++;
+    }
+
+    sync_mcs_unlock(&frame_lock, &node);
+
+    /* Zero outside the lock, the frame is ours already */
+    if (0x0ULL != pa)
+    {
+        memset((void*)(uintptr_t)pa, 0x0, FRAME_SIZE);
+    }
+
+    return pa;
+}
+
+/**
+ * @brief Find the last frame in use within a range, frame_lock held.
+ *
+ * Checks the range a bitmap word at a time, from its end, so a run
+ * search can skip past everything up to the frame returned.
+ *
+ * @param first Index of the first frame.
+ * @param count Number of frames, not 0.
+ * @return Index of the last frame in use plus one, or 0 if all are free.
+ */
+static uint64_t frame_run_used(uint64_t first, uint64_t count)
+{
+    uint64_t last = first + count - 1ULL; /* Last frame of the range */
+
+    for (uint64_t word = last / 64; (word >= first / 64) && (word <= last / 64); --word)
+    {
+        uint64_t mask = ~0x0ULL; /* Bits of the word inside the range */
+        uint64_t used = 0x0ULL;  /* Those in use */
+
+        if (word == last / 64)
+        {
+            mask &= ~0x0ULL >> (63 - (last % 64));
+        }
+
+        if (word == first / 64)
+        {
+            mask &= ~0x0ULL << (first % 64);
+        }
+
+        used = frame_bitmap[word] & mask;
+        if (0x0ULL != used)
+        {
+            return (word * 64) + (uint64_t)(64 - __builtin_clzll(used));
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Allocate a run of free frames starting on an alignment boundary.
+ *
+ * Each candidate start is checked word by word; a frame in use moves the
+ * next candidate to the first boundary past it, and fully used words are
+ * stepped over whole, so a search costs O(pool / 64) under frame_lock.
+ *
+ * @param count Number of frames.
+ * @param align Alignment of the first frame's physical address in frames.
+ * @return Physical address of the first frame, or 0 on failure.
+ */
+static uint64_t frame_alloc_run(uint64_t count, uint64_t align)
+{
+    sync_mcs_node_t node;                              /* Our place in the lock queue */
+    uint64_t        pa    = 0x0ULL;                    /* First allocated frame */
+    uint64_t        pfn0  = frame_base >> FRAME_SHIFT; /* Frame number of the pool start */
+    uint64_t        first = 0;                         /* Candidate start of the run */
+    uint64_t        next  = 0;                         /* Frame past the last one in use */
+
+    if (0 == count)
+    {
+        return 0x0ULL;
+    }
+
+    sync_mcs_lock(&frame_lock, &node);
+
+    /* A run may only start on the boundary */
+    first = (((pfn0 + align - 1ULL) / align) * align) - pfn0;
+
+    while ((count <= frame_free_count) && (first < frame_count) && (count <= (frame_count - first)))
+    {
+        if (~0x0ULL == frame_bitmap[first / 64])
+        {
+            next = ((first / 64) + 1ULL) * 64;
+        }
+        else
+        {
+            next = frame_run_used(first, count);
+        }
+
+        if (0 == next)
+        {
+            frame_mark(first, count, 1);
+            frame_free_count -= count;
+
+            pa = frame_base + (first << FRAME_SHIFT);
+            break;
+        }
+
+        first = ((((pfn0 + next) + align - 1ULL) / align) * align) - pfn0;
+    }
+
+    sync_mcs_unlock(&frame_lock, &node);
+
+    return pa;
+}
+
+/**
+ * @brief Allocate physically contiguous frames.
+ *
+ * @param count Number of frames.
+ * @return Physical address of the first frame, or 0 on failure.
+ */
+uint64_t frame_alloc_contig(uint64_t count)
+{
+    return frame_alloc_run(count, 1);
+}
+
+/**
+ * @brief Allocate physically contiguous frames aligned to their size.
+ *
+ * @param count Number of frames, a power of two.
+ * @return Physical address of the first frame, or 0 on failure.
+ */
+uint64_t frame_alloc_aligned(uint64_t count)
+{
+    if ((0 == count) || (0 != (count & (count - 1ULL))))
+    {
+        return 0x0ULL;
+    }
+
+    return frame_alloc_run(count, count);
+}
+
+/**
+ * @brief Return a frame to the pool.
+ *
+ * @param pa Physical address of the frame.
+ */
+void frame_free(uint64_t pa)
+{
+    frame_free_contig(pa, 1);
+}
+
+/**
+ * @brief Return physically contiguous frames to the pool.
+ *
+ * @param pa Physical address of the first frame.
+ * @param count Number of frames.
+ */
+void frame_free_contig(uint64_t pa, uint64_t count)
+{
+    sync_mcs_node_t node;      /* Our place in the lock queue */
+    uint64_t        first = 0; /* Index of the first frame */
+
+    if ((pa < frame_base) || (0 != (pa & ~FRAME_MASK)))
+    {
+        return;
+    }
+
+    first = (pa - frame_base) >> FRAME_SHIFT;
+    if ((first + count) > frame_count)
+    {
+        return;
+    }
+
+    sync_mcs_lock(&frame_lock, &node);
+
+    frame_mark(first, count, 0);
+    frame_free_count += count;
+
+    /* The refill may have stopped for lack of free frames */
+    frame_zeroed_check_locked();
+
+    if ((first / 64) < frame_hint)
+    {
+        frame_hint = first / 64;
+    }
+
+    sync_mcs_unlock(&frame_lock, &node);
+}
+
+/**
+ * @brief Refill the pre-zeroed stack.
+ *
+ * @param max Upper bound on the number of frames to zero.
+ * @return Number of frames added to the stack.
+ */
+uint32_t frame_prezero(uint32_t max)
+{
+    sync_mcs_node_t node;      /* Our place in the lock queue */
+    uint32_t        added = 0; /* Frames added to the stack */
+
+    while (added < max)
+    {
+        uint64_t pa    = 0x0ULL; /* Frame being zeroed */
+        uint64_t start = 0x0ULL; /* Counter before zeroing */
+
+        sync_mcs_lock(&frame_lock, &node);
+        if ((zeroed_top < FRAME_ZEROED_MAX) && (frame_free_count > 0))
+        {
+            pa = frame_alloc_locked();
+        }
+        sync_mcs_unlock(&frame_lock, &node);
+
+        if (0x0ULL == pa)
+        {
+            break;
+        }
+
+        start = arch_counter_read();
+        memset((void*)(uintptr_t)pa, 0x0, FRAME_SIZE);
+        start = arch_counter_read() - start;
+
+        /* Another CPU may have filled the stack meanwhile */
+        sync_mcs_lock(&frame_lock, &node);
+        if (zeroed_top < FRAME_ZEROED_MAX)
+        {
+            zeroed_stack[zeroed_top++] = pa;
+            pa = 0x0ULL;
+            added++;
+            zeroed_frames++;
+            zeroed_ticks += start;
+            if ((0 != zeroed_refill) && (0 == zeroed_started))
+            {
+                zeroed_started = 1;
+                zeroed_refills++;
+            }
+        }
+        if (zeroed_top >= FRAME_ZEROED_HIGH)
+        {
+            __atomic_store_n(&zeroed_refill, 0U, __ATOMIC_RELAXED);
+        }
+        sync_mcs_unlock(&frame_lock, &node);
+
+        if (0x0ULL != pa)
+        {
+            frame_free(pa);
+            break;
+        }
+    }
+
+    return added;
+}
+
+/**
+ * @brief Zero frames for the pre-zeroed stack from an idle CPU.
+ *
+ * @param max Upper bound on the number of frames to zero.
+ * @return Non-zero if the stack still needs frames.
+ */
+int frame_refill(uint32_t max)
+{
+    sync_mcs_node_t node;     /* Our place in the lock queue */
+    uint32_t        want = 0; /* Frames missing up to the high watermark */
+
+    if ((0 == __atomic_load_n(&zeroed_refill, __ATOMIC_RELAXED)) || (0 == max))
+    {
+        return (int)__atomic_load_n(&zeroed_refill, __ATOMIC_RELAXED);
+    }
+
+    sync_mcs_lock(&frame_lock, &node);
+    want = (zeroed_top < FRAME_ZEROED_HIGH) ? (FRAME_ZEROED_HIGH - zeroed_top) : 0;
+    sync_mcs_unlock(&frame_lock, &node);
+
+    if (want > max)
+    {
+        want = max;
+    }
+
+    if (0 != want)
+    {
+        (void)frame_prezero(want);
+    }
+
+    /* A short batch may only mean that another CPU pushed or took frames meanwhile */
+    sync_mcs_lock(&frame_lock, &node);
+    if ((zeroed_top >= FRAME_ZEROED_HIGH) || (0 == frame_free_count))
+    {
+        /* Full, or no free frame left: frame_free() raises the flag again */
+        __atomic_store_n(&zeroed_refill, 0U, __ATOMIC_RELAXED);
+    }
+    sync_mcs_unlock(&frame_lock, &node);
+
+    return (int)__atomic_load_n(&zeroed_refill, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Retrieve allocator statistics.
+ *
+ * @param stats Filled with the current statistics.
+ */
+void frame_get_stats(frame_stats_t* stats)
+{
+    sync_mcs_node_t node; /* Our place in the lock queue */
+
+    if (NULL == stats)
+    {
+        return;
+    }
+
+    sync_mcs_lock(&frame_lock, &node);
+
+    stats->total         = frame_count;
+    stats->free          = frame_free_count + zeroed_top;
+    stats->zeroed        = zeroed_top;
+    stats->zeroed_hits   = zeroed_hits;
+    stats->zeroed_miss   = zeroed_miss;
+    stats->refills       = zeroed_refills;
+    stats->prezeroed     = zeroed_frames;
+    stats->prezero_ticks = zeroed_ticks;
+
+    sync_mcs_unlock(&frame_lock, &node);
+}
+
+/**
+ * @brief Log the pre-zeroed stack hit rate and refill bandwidth.
+ */
+void frame_report(void)
+{
+    frame_stats_t stats = { 0 };               /* Snapshot of the counters */
+    uint64_t      freq  = arch_counter_freq(); /* Counter ticks per second */
+    uint64_t      bw    = 0x0ULL;              /* Refill bandwidth in MB/s */
+
+    frame_get_stats(&stats);
+
+    if ((0 != stats.prezero_ticks) && (0 != freq))
+    {
+        bw = (stats.prezeroed * FRAME_SIZE * freq) / stats.prezero_ticks / 1000000ULL;
+    }
+
+    LOG_INFO("frame: %lu of %lu free, %lu pre-zeroed; zeroed allocations %lu hits, %lu misses; "
+             "%lu refills, %lu frames zeroed ahead at %lu MB/s\n\r",
+             stats.free,
+             stats.total,
+             stats.zeroed,
+             stats.zeroed_hits,
+             stats.zeroed_miss,
+             stats.refills,
+             stats.prezeroed,
+             bw);
+}
@@ -47,7 +47,11 @@
 /* standard includes */
 #include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
+
+/* project includes */
+#include "logging.h"
+#include "sync.h"
+#include "sysreg.h"
 
 /* Memory type attributes */
 #define MT_NORMAL            (0ULL) /**< Normal memory */
@@ -112,49 +116,75 @@
 
 #define BLOCK_SIZE (0x40000000000ULL) /**< Block size */
 
-/* MMU table instance */
-static mmu_table_t mmu_table_1 = { 0 };
+#define MMU_VA_BITS         (48U)                   /**< Width of a hypervisor virtual address */
+#define MMU_BLOCK_ADDR_MASK (0x0000FC0000000000ULL) /**< Output address of a block entry */
+#define MMU_PAGE_OFFSET     (0xFFFULL)              /**< Offset bits PAR_EL1 does not report */
+
+/* MMU table instance, shared by all CPUs */
+static mmu_table_t   mmu_table_1     = { 0 };
+static sync_ticket_t mmu_table_lock  = SYNC_TICKET_INIT; /* Serializes the table setup */
+static int           mmu_table_ready = 0;                /* Table filled in */
 
 /**
  * @brief Sets up the page table.
  *
- * This function initializes the page table with block attributes and sets the
- * translation table base register (TTBR).
+ * This function initializes the page table with block attributes. The
+ * table is shared, so only the first caller fills it in.
  */
 void page_table_setup(void)
 {
     uint64_t phys = 0x0ULL; /**< Physical address initialization */
 
-    for (size_t i = 0; i < sizeof(mmu_table_1.entries) / sizeof(mmu_table_1.entries[0]); ++i)
+    sync_ticket_lock(&mmu_table_lock);
+
+    if (!mmu_table_ready)
     {
-        mmu_table_1.entries[i] = phys | BLOCK_ATTR; /**< Setting block attributes */
-        phys += BLOCK_SIZE;                         /**< Increment physical address */
+        for (size_t i = 0; i < sizeof(mmu_table_1.entries) / sizeof(mmu_table_1.entries[0]); ++i)
+        {
+            mmu_table_1.entries[i] = phys | BLOCK_ATTR; /**< Setting block attributes */
+            phys += BLOCK_SIZE;                         /**< Increment physical address */
+        }
+        mmu_table_ready = 1;
     }
 
-    asm volatile("msr ttbr0_el2, %0" ::"r"((uint64_t)(mmu_table_1.entries))); /**< Set TTBR0_EL2 */
-
-    printf("ttbr0_el2 set to: 0x%lx\n\r", (uint64_t)(mmu_table_1.entries)); /**< Print TTBR0_EL2 value */
+    sync_ticket_unlock(&mmu_table_lock);
 }
 
 /**
  * @brief Initializes the MMU.
  *
- * This function sets up the memory attribute indirection register (MAIR),
- * configures the translation control register (TCR), and enables the MMU.
+ * This function builds the shared page table and enables the MMU on the
+ * calling CPU.
  */
 void mmu_init(void)
+{
+    page_table_setup(); /**< Setup page table */
+
+    mmu_enable(); /**< Enable the MMU on this CPU */
+
+    LOG_DEBUG("ttbr0_el2 set to: 0x%lx\n\r", (uint64_t)(uintptr_t)(mmu_table_1.entries)); /**< Print TTBR0_EL2 value */
+}
+
+/**
+ * @brief Enables the MMU with the shared page table.
+ *
+ * This function sets up the memory attribute indirection register (MAIR),
+ * the translation table base register (TTBR), configures the translation
+ * control register (TCR), and enables the MMU. Secondary CPUs call it
+ * directly, the table was built by the boot CPU.
+ */
+void mmu_enable(void)
 {
     uint64_t hcr   = 0x0ULL; /**< Hypervisor Configuration Register initialization */
     uint64_t mmfr0 = 0x0ULL; /**< Memory model feature register initialization */
     uint64_t sctlr = 0x0ULL; /**< System Control Register initialization */
     uint64_t tcr   = 0x0ULL; /**< Translation Control Register initialization */
 
-    asm volatile("msr mair_el2, %0" ::"r"(MAIR_MASK)); /**< Set MAIR_EL2 */
+    SYSREG_WRITE(mair_el2, MAIR_MASK); /**< Set MAIR_EL2 */
 
-    page_table_setup(); /**< Setup page table */
+    SYSREG_WRITE(ttbr0_el2, (uintptr_t)(mmu_table_1.entries)); /**< Set TTBR0_EL2 */
 
-    asm volatile("mrs %0, id_aa64mmfr0_el1"
-                 : "=r"(mmfr0)); /**< Read memory model feature register */
+    mmfr0 = SYSREG_READ(id_aa64mmfr0_el1); /**< Read memory model feature register */
 
     if ((mmfr0 & ID_AA64MMFR0_EL1_TGRAN64_MASK) != ID_AA64MMFR0_EL1_TGRAN64_ENABLED)
     {
@@ -162,12 +192,9 @@ void mmu_init(void)
         return; /**< Return if 64KB granule is not enabled */
     }
 
-    asm volatile("mrs %0, tcr_el2"
-                 : "=r"(tcr)); /**< Read Translation Control Register */
-    asm volatile("mrs %0, hcr_el2"
-                 : "=r"(hcr)); /**< Read Hypervisor Configuration Register */
-    asm volatile("mrs %0, sctlr_el2"
-                 : "=r"(sctlr)); /**< Read System Control Register */
+    tcr   = SYSREG_READ(tcr_el2);   /**< Read Translation Control Register */
+    hcr   = SYSREG_READ(hcr_el2);   /**< Read Hypervisor Configuration Register */
+    sctlr = SYSREG_READ(sctlr_el2); /**< Read System Control Register */
 
     hcr &= ~(HCR_MASK);                                  /**< Clear HCR mask */
     tcr = (tcr & ~TCR_EL2_TG0_MASK) | TCR_EL2_TG0_64KIB; /**< Configure translation granule */
@@ -179,9 +206,9 @@ void mmu_init(void)
     sctlr = (sctlr & ~SCTLR_EL2_EE_MASK) | SCTLR_EL2_EE_LITTLE_ENDIAN; /**< Set little endian mode */
     sctlr = (sctlr & ~SCTLR_EL2_M_MASK) | SCTLR_EL2_M_ENABLE;          /**< Enable MMU */
 
-    asm volatile("msr tcr_el2, %0" ::"r"(tcr));     /**< Write TCR_EL2 */
-    asm volatile("msr hcr_el2, %0" ::"r"(hcr));     /**< Write HCR_EL2 */
-    asm volatile("msr sctlr_el2, %0" ::"r"(sctlr)); /**< Write SCTLR_EL2 */
+    SYSREG_WRITE(tcr_el2, tcr);     /**< Write TCR_EL2 */
+    SYSREG_WRITE(hcr_el2, hcr);     /**< Write HCR_EL2 */
+    SYSREG_WRITE(sctlr_el2, sctlr); /**< Write SCTLR_EL2 */
 }
 
 /**
@@ -191,10 +218,74 @@ void mmu_init(void)
  */
 uint64_t mmu_get_page_table_base(void)
 {
-    uint64_t ttbr0_el2 = 0x0ULL; /**< TTBR0_EL2 initialization */
-
-    asm volatile("mrs %0, ttbr0_el2"
-                 : "=r"(ttbr0_el2)); /**< Read TTBR0_EL2 */
+    uint64_t ttbr0_el2 = SYSREG_READ(ttbr0_el2); /**< Read TTBR0_EL2 */
 
     return ttbr0_el2; /**< Return TTBR0_EL2 value */
 }
+
+/**
+ * @brief Walks the hypervisor page table in software.
+ *
+ * @param va The hypervisor virtual address.
+ * @param pa Receives the physical address.
+ * @return STATUS_OK, or STATUS_ERR_NOT_FOUND if the address is not mapped.
+ */
+static status_t mmu_walk_va(uint64_t va, uint64_t* pa)
+{
+    const mmu_pte_t* table = NULL;  /**< Table TTBR0_EL2 points at */
+    mmu_pte_t        pte   = 0x0ULL; /**< Entry covering the address */
+
+    if ((SYSREG_READ(sctlr_el2) & SCTLR_EL2_M_MASK) != SCTLR_EL2_M_ENABLE)
+    {
+        *pa = va; /**< MMU off, flat mapping */
+        return STATUS_OK;
+    }
+
+    if (0 != (va >> MMU_VA_BITS))
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    table = (const mmu_pte_t*)(uintptr_t)mmu_get_page_table_base();
+    pte   = table[va / BLOCK_SIZE];
+
+    if (!(pte & PF_TYPE_BLOCK))
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    *pa = (pte & MMU_BLOCK_ADDR_MASK) | (va & (BLOCK_SIZE - 1)); /**< Block base plus offset */
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Translates a hypervisor virtual address.
+ *
+ * This function asks the hardware with AT S1E2R and falls back to a
+ * software walk of the hypervisor page table if the translation aborts,
+ * which is always the case in the native host build. PAR_EL1 belongs to
+ * the loaded vCPU and is preserved.
+ *
+ * @param va The hypervisor virtual address.
+ * @param pa Receives the physical address.
+ * @return STATUS_OK, or STATUS_ERR_NOT_FOUND if the address is not mapped.
+ */
+status_t mmu_translate_va(uint64_t va, uint64_t* pa)
+{
+    uint64_t saved = SYSREG_READ(par_el1); /**< Guest PAR_EL1 */
+    uint64_t par   = 0x0ULL;               /**< Translation result */
+
+    AT(s1e2r, va);
+    ISB();
+    par = SYSREG_READ(par_el1);
+    SYSREG_WRITE(par_el1, saved);
+
+    if (!(par & PAR_EL1_F))
+    {
+        *pa = (par & PAR_EL1_PA_MASK) | (va & MMU_PAGE_OFFSET);
+        return STATUS_OK;
+    }
+
+    return mmu_walk_va(va, pa);
+}
@@ -0,0 +1,925 @@
+/**
+ * @file stage2.c
+ * @brief Stage-2 translation table management.
+ *
+ * This file contains the function implementations for building the
+ * stage-2 (IPA to PA) translation tables of a VM.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Translation tables are cacheable (see VTCR_EL2 below), so descriptor
+ * updates only need a DSB before they are visible to the table walker.
+ * Valid descriptors are only ever replaced after being invalidated and
+ * flushed from the TLB (break-before-make).
+ *
+ * Splitting a block and folding a table back into a block both go through
+ * an invalid descriptor. The flush targets the IPAs of the old leaves only,
+ * one TLBI per leaf, so the rest of the VM keeps its TLB entries.
+ *
+ * Missing tables and new leaves are installed with a compare and swap, so
+ * two CPUs mapping IPAs under the same table share one table and neither
+ * overwrites the other's leaf; the loser sees STATUS_ERR_EXISTS. Splitting
+ * and folding free or replace tables and need the caller to serialize them
+ * against every other update of the range, see gmem.c.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Function implementations for stage-2 translation tables.
+ */
+
+/* this module's header */
+#include "stage2.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "frame.h"
+#include "sync.h"
+#include "sysreg.h"
+
+/* Virtualization Translation Control Register */
+#define VTCR_EL2_T0SZ(bits)   (64ULL - (bits))  /**< Size of the IPA space */
+#define VTCR_EL2_SL0_LEVEL1   (1ULL << 6)       /**< Start walks at level 1 */
+#define VTCR_EL2_IRGN0_WBWA   (1ULL << 8)       /**< Inner write-back write-allocate walks */
+#define VTCR_EL2_ORGN0_WBWA   (1ULL << 10)      /**< Outer write-back write-allocate walks */
+#define VTCR_EL2_SH0_INNER    (3ULL << 12)      /**< Inner shareable walks */
+#define VTCR_EL2_TG0_4KIB     (0ULL << 14)      /**< 4KB granule */
+#define VTCR_EL2_PS_OFFSET    (16ULL)           /**< Physical size offset */
+#define VTCR_EL2_RES1         (1ULL << 31)      /**< Reserved, set to one */
+
+#define ID_AA64MMFR0_EL1_PARANGE_MASK (0xfULL) /**< Physical address range mask */
+#define VTTBR_VMID_SHIFT              (48ULL)  /**< VMID offset in VTTBR_EL2 */
+
+#define LEVEL_FIRST (1U) /**< First lookup level */
+#define LEVEL_LAST  (3U) /**< Last lookup level */
+
+#define LEVEL_SHIFT(level) (12ULL + (9ULL * (LEVEL_LAST - (level)))) /**< IPA bits resolved below a level */
+#define LEVEL_SIZE(level)  (1ULL << LEVEL_SHIFT(level))              /**< Bytes mapped by one entry */
+#define LEVEL_INDEX(ipa, level) (((ipa) >> LEVEL_SHIFT(level)) & (STAGE2_ENTRIES - 1ULL)) /**< Table index */
+
+/**
+ * @brief Get the table a table descriptor points to.
+ *
+ * @param pte The table descriptor.
+ * @return Pointer to the next level table.
+ */
+static inline mmu_pte_t* stage2_next_table(mmu_pte_t pte)
+{
+    return (mmu_pte_t*)(uintptr_t)(pte & S2_PTE_ADDR_MASK);
+}
+
+/**
+ * @brief Check whether a descriptor points to a next level table.
+ *
+ * @param pte The descriptor.
+ * @param level The lookup level of the descriptor.
+ * @return Non-zero for a table descriptor.
+ */
+static inline int stage2_is_table(mmu_pte_t pte, uint32_t level)
+{
+    return (level < LEVEL_LAST) && ((pte & (S2_PTE_VALID | S2_PTE_TABLE)) == (S2_PTE_VALID | S2_PTE_TABLE));
+}
+
+/**
+ * @brief Compute the VTTBR_EL2 value of a regime.
+ *
+ * @param s2 The regime.
+ * @return The VTTBR_EL2 value.
+ */
+static inline uint64_t stage2_vttbr(const stage2_t* s2)
+{
+    return ((uint64_t)(uintptr_t)s2->root) | ((uint64_t)s2->vmid << VTTBR_VMID_SHIFT);
+}
+
+/**
+ * @brief Find the descriptor for an IPA at a given level.
+ *
+ * @param s2 The regime.
+ * @param ipa The IPA.
+ * @param level The level of the wanted descriptor.
+ * @param alloc Non-zero to allocate missing tables on the way.
+ * @return Pointer to the descriptor, or NULL if a table is missing (or
+ *         a block is mapped above the wanted level).
+ */
+static mmu_pte_t* stage2_walk(const stage2_t* s2, uint64_t ipa, uint32_t level, int alloc)
+{
+    mmu_pte_t* table = s2->root; /* Table at the current level */
+
+    for (uint32_t cur = LEVEL_FIRST; cur < level; ++cur)
+    {
+        mmu_pte_t* pte  = &table[LEVEL_INDEX(ipa, cur)];
+        mmu_pte_t  desc = __atomic_load_n(pte, __ATOMIC_ACQUIRE); /* Descriptor as read */
+
+        if (!(desc & S2_PTE_VALID))
+        {
+            uint64_t  pa   = 0x0ULL; /* New table */
+            mmu_pte_t seen = 0x0ULL; /* Descriptor replaced by the install */
+
+            if (!alloc)
+            {
+                return NULL;
+            }
+
+            pa = frame_alloc_zeroed();
+            if (0x0ULL == pa)
+            {
+                return NULL;
+            }
+
+            /* A walk on another CPU may install a table first, then use its one */
+            DSB(ishst);
+            seen = sync_cas64(pte, desc, pa | S2_PTE_VALID | S2_PTE_TABLE);
+            if (seen == desc)
+            {
+                desc = pa | S2_PTE_VALID | S2_PTE_TABLE;
+            }
+            else
+            {
+                frame_free(pa);
+                desc = seen;
+            }
+        }
+
+        if (!stage2_is_table(desc, cur))
+        {
+            return NULL;
+        }
+
+        table = stage2_next_table(desc);
+    }
+
+    return &table[LEVEL_INDEX(ipa, level)];
+}
+
+/**
+ * @brief Free a table and all tables below it.
+ *
+ * @param table The table.
+ * @param level Its lookup level.
+ */
+static void stage2_free_table(mmu_pte_t* table, uint32_t level)
+{
+    for (uint64_t i = 0; i < STAGE2_ENTRIES; ++i)
+    {
+        if (stage2_is_table(table[i], level))
+        {
+            stage2_free_table(stage2_next_table(table[i]), level + 1);
+        }
+    }
+
+    frame_free((uint64_t)(uintptr_t)table);
+}
+
+/**
+ * @brief Visit the valid leaves of a table overlapping an IPA range.
+ *
+ * @param table The table.
+ * @param level Its lookup level.
+ * @param base First IPA mapped by the table.
+ * @param start Start of the range.
+ * @param end End of the range (exclusive).
+ * @param fn Called for each leaf.
+ * @param arg Passed to fn.
+ */
+static void stage2_visit(mmu_pte_t* table, uint32_t level, uint64_t base, uint64_t start, uint64_t end, stage2_leaf_fn_t fn, void* arg)
+{
+    uint64_t size  = LEVEL_SIZE(level);                                            /* Bytes per entry */
+    uint64_t first = (start > base) ? ((start - base) >> LEVEL_SHIFT(level)) : 0; /* First entry in range */
+
+    for (uint64_t i = first; i < STAGE2_ENTRIES; ++i)
+    {
+        uint64_t ipa = base + (i * size); /* IPA mapped by the entry */
+
+        if (ipa >= end)
+        {
+            break;
+        }
+
+        if (stage2_is_table(table[i], level))
+        {
+            stage2_visit(stage2_next_table(table[i]), level + 1, ipa, start, end, fn, arg);
+        }
+        else if (table[i] & S2_PTE_VALID)
+        {
+            fn(ipa, size, &table[i], arg);
+        }
+    }
+}
+
+/**
+ * @brief Leaf callback of stage2_protect().
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor.
+ * @param arg The protect request.
+ */
+static void stage2_protect_leaf(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg)
+{
+    uint64_t* req = (uint64_t*)arg; /* clear mask, set mask, update count */
+
+    (void)ipa;
+    (void)size;
+
+    *pte = (*pte & ~req[0]) | req[1];
+    req[2]++;
+}
+
+/**
+ * @brief Leaf callback of stage2_census().
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor.
+ * @param arg The census.
+ */
+static void stage2_census_leaf(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg)
+{
+    stage2_census_t* census = (stage2_census_t*)arg; /* Counts so far */
+
+    (void)ipa;
+    (void)pte;
+
+    if (STAGE2_BLOCK_1G == size)
+    {
+        census->blocks_1g++;
+    }
+    else if (STAGE2_BLOCK_2M == size)
+    {
+        census->blocks_2m++;
+    }
+    else
+    {
+        census->pages++;
+    }
+}
+
+/**
+ * @brief Invalidate the TLB entries of consecutive leaves.
+ *
+ * @param s2 The regime.
+ * @param ipa First IPA mapped by the first leaf.
+ * @param step Bytes mapped by each leaf.
+ * @param count Number of leaves.
+ */
+static void stage2_tlb_flush_leaves(stage2_t* s2, uint64_t ipa, uint64_t step, uint64_t count)
+{
+    uint64_t vttbr = SYSREG_READ(vttbr_el2); /* Regime to restore */
+
+    SYSREG_WRITE(vttbr_el2, stage2_vttbr(s2));
+    ISB();
+
+    DSB(ishst);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        TLBI_ARG(ipas2e1is, (ipa + (i * step)) >> 12);
+    }
+    DSB(ish);
+    TLBI(vmalle1is); /* Stage-1 entries may cache the old IPA */
+    DSB(ish);
+
+    SYSREG_WRITE(vttbr_el2, vttbr);
+    ISB();
+
+    __atomic_fetch_add(&s2->gen, 1U, __ATOMIC_RELEASE); /* After the invalidation is complete */
+}
+
+/**
+ * @brief Replace a block descriptor by a table of the next level.
+ *
+ * @param s2 The regime.
+ * @param pte The block descriptor.
+ * @param level Its lookup level.
+ * @param ipa An IPA within the block.
+ * @return STATUS_OK or STATUS_ERR_NO_MEMORY.
+ */
+static status_t stage2_split_block(stage2_t* s2, mmu_pte_t* pte, uint32_t level, uint64_t ipa)
+{
+    uint64_t   size  = LEVEL_SIZE(level);                        /* Bytes mapped by the block */
+    uint64_t   sub   = LEVEL_SIZE(level + 1);                    /* Bytes mapped by each new entry */
+    uint64_t   pa    = *pte & S2_PTE_ADDR_MASK & ~(size - 1ULL); /* Block output address */
+    uint64_t   attr  = *pte & S2_PTE_ATTR_MASK;                  /* Attributes every entry inherits */
+    uint64_t   frame = frame_alloc();                            /* New table */
+    mmu_pte_t* table = (mmu_pte_t*)(uintptr_t)frame;             /* New table entries */
+
+    if (0x0ULL == frame)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    for (uint64_t i = 0; i < STAGE2_ENTRIES; ++i)
+    {
+        table[i] = (pa + (i * sub)) | attr | S2_PTE_VALID | ((LEVEL_LAST == (level + 1)) ? S2_PTE_TABLE : 0x0ULL);
+    }
+
+    /* Break-before-make, the table is written before the descriptor points to it */
+    *pte = 0x0ULL;
+    stage2_tlb_flush_leaves(s2, ipa & ~(size - 1ULL), size, 1);
+    *pte = frame | S2_PTE_VALID | S2_PTE_TABLE;
+    DSB(ishst);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Find the table descriptor that a block of a given size would replace.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA, aligned to size.
+ * @param size STAGE2_BLOCK_2M or STAGE2_BLOCK_1G.
+ * @param level Receives the lookup level of the descriptor.
+ * @param pte Receives the descriptor.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS if the range
+ *         is a block already, STATUS_ERR_NOT_FOUND if it is unmapped or
+ *         inside a larger block, or STATUS_ERR_NOT_SUPPORTED if the table
+ *         below it is not full of leaves.
+ */
+static status_t stage2_fold_target(stage2_t* s2, uint64_t ipa, uint64_t size, uint32_t* level, mmu_pte_t** pte)
+{
+    const mmu_pte_t* table = NULL; /* Leaves to fold */
+
+    if ((NULL == s2) || (NULL == s2->root) ||
+        ((STAGE2_BLOCK_2M != size) && (STAGE2_BLOCK_1G != size)) ||
+        (0 != (ipa & (size - 1ULL))) || ((ipa + size) > (1ULL << STAGE2_IPA_BITS)))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    *level = (STAGE2_BLOCK_1G == size) ? LEVEL_FIRST : (LEVEL_FIRST + 1U);
+    *pte   = stage2_walk(s2, ipa, *level, 0);
+    if ((NULL == *pte) || !(**pte & S2_PTE_VALID))
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+    if (!stage2_is_table(**pte, *level))
+    {
+        return STATUS_ERR_EXISTS;
+    }
+
+    table = stage2_next_table(**pte);
+    for (uint64_t i = 0; i < STAGE2_ENTRIES; ++i)
+    {
+        if (!(table[i] & S2_PTE_VALID) || stage2_is_table(table[i], *level + 1U))
+        {
+            return STATUS_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Replace a table full of leaves by one block descriptor.
+ *
+ * @param s2 The regime.
+ * @param pte The table descriptor.
+ * @param level Its lookup level.
+ * @param ipa First IPA mapped by the table.
+ * @param pa Output address of the block.
+ * @param attr Attributes of the block.
+ * @param fn Called for each old leaf once the block is in place, may be NULL.
+ * @param arg Passed to fn.
+ */
+static void stage2_fold(stage2_t* s2, mmu_pte_t* pte, uint32_t level, uint64_t ipa, uint64_t pa, uint64_t attr, stage2_leaf_fn_t fn, void* arg)
+{
+    mmu_pte_t* table = stage2_next_table(*pte); /* Old leaves */
+    uint64_t   sub   = LEVEL_SIZE(level + 1);   /* Bytes mapped by each of them */
+
+    /* Break-before-make, every old leaf leaves the TLB before the block is written */
+    *pte = 0x0ULL;
+    stage2_tlb_flush_leaves(s2, ipa, sub, STAGE2_ENTRIES);
+    *pte = pa | (attr & S2_PTE_ATTR_MASK) | S2_PTE_VALID;
+    DSB(ishst);
+
+    if (NULL != fn)
+    {
+        for (uint64_t i = 0; i < STAGE2_ENTRIES; ++i)
+        {
+            fn(ipa + (i * sub), sub, &table[i], arg);
+        }
+    }
+
+    frame_free((uint64_t)(uintptr_t)table);
+}
+
+/**
+ * @brief Configure VTCR_EL2 for the stage-2 layout.
+ */
+void stage2_hw_init(void)
+{
+    uint64_t mmfr0 = SYSREG_READ(id_aa64mmfr0_el1); /* Memory model feature register */
+    uint64_t vtcr  = 0x0ULL;                        /* Virtualization Translation Control Register */
+
+    vtcr = VTCR_EL2_T0SZ(STAGE2_IPA_BITS) |
+           VTCR_EL2_SL0_LEVEL1 |
+           VTCR_EL2_IRGN0_WBWA |
+           VTCR_EL2_ORGN0_WBWA |
+           VTCR_EL2_SH0_INNER |
+           VTCR_EL2_TG0_4KIB |
+           ((mmfr0 & ID_AA64MMFR0_EL1_PARANGE_MASK) << VTCR_EL2_PS_OFFSET) |
+           VTCR_EL2_RES1;
+
+    SYSREG_WRITE(vtcr_el2, vtcr);
+    ISB();
+}
+
+/**
+ * @brief Create an empty stage-2 translation regime.
+ *
+ * @param s2 The regime to initialize.
+ * @param vmid The VMID tagging this regime's TLB entries.
+ * @return STATUS_OK or STATUS_ERR_NO_MEMORY.
+ */
+status_t stage2_init(stage2_t* s2, uint16_t vmid)
+{
+    uint64_t root = 0x0ULL; /* Level 1 table */
+
+    if (NULL == s2)
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    root = frame_alloc_zeroed();
+    if (0x0ULL == root)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    s2->root = (mmu_pte_t*)(uintptr_t)root;
+    s2->vmid = vmid;
+    s2->gen  = 0;
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Free all translation tables of a regime.
+ *
+ * @param s2 The regime.
+ */
+void stage2_destroy(stage2_t* s2)
+{
+    if ((NULL == s2) || (NULL == s2->root))
+    {
+        return;
+    }
+
+    stage2_tlb_flush_all(s2);
+    stage2_free_table(s2->root, LEVEL_FIRST);
+    s2->root = NULL;
+}
+
+/**
+ * @brief Map an IPA range.
+ *
+ * @param s2 The regime.
+ * @param ipa Page aligned start IPA.
+ * @param pa Page aligned start PA.
+ * @param size Page aligned size in bytes.
+ * @param attr Descriptor attributes, e.g. STAGE2_MEM_NORMAL.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS or
+ *         STATUS_ERR_NO_MEMORY.
+ */
+status_t stage2_map(stage2_t* s2, uint64_t ipa, uint64_t pa, uint64_t size, uint64_t attr)
+{
+    if ((NULL == s2) || (NULL == s2->root) ||
+        ((ipa | pa | size) & (STAGE2_PAGE_SIZE - 1ULL)) ||
+        ((ipa + size) > (1ULL << STAGE2_IPA_BITS)))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    attr &= S2_PTE_ATTR_MASK;
+
+    while (size > 0)
+    {
+        uint32_t   level = LEVEL_FIRST; /* Level of the new descriptor */
+        mmu_pte_t* pte   = NULL;        /* New descriptor */
+        mmu_pte_t  old   = 0x0ULL;      /* Descriptor it replaces */
+
+        /* Use the largest block the alignment allows */
+        while ((level < LEVEL_LAST) &&
+               (((ipa | pa) & (LEVEL_SIZE(level) - 1ULL)) || (size < LEVEL_SIZE(level))))
+        {
+            level++;
+        }
+
+        if (STATUS_OK == stage2_lookup(s2, ipa, NULL, NULL))
+        {
+            return STATUS_ERR_EXISTS;
+        }
+
+        pte = stage2_walk(s2, ipa, level, 1);
+        if (NULL == pte)
+        {
+            return STATUS_ERR_NO_MEMORY;
+        }
+
+        /* Never overwrite a leaf a concurrent map installed after the lookup */
+        old = __atomic_load_n(pte, __ATOMIC_RELAXED);
+        if ((old & S2_PTE_VALID) ||
+            (old != sync_cas64(pte, old, pa | attr | S2_PTE_VALID | ((LEVEL_LAST == level) ? S2_PTE_TABLE : 0x0ULL))))
+        {
+            return STATUS_ERR_EXISTS;
+        }
+
+        ipa += LEVEL_SIZE(level);
+        pa += LEVEL_SIZE(level);
+        size -= LEVEL_SIZE(level);
+    }
+
+    DSB(ishst);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Unmap an IPA range and invalidate its TLB entries.
+ *
+ * @param s2 The regime.
+ * @param ipa Page aligned start IPA.
+ * @param size Page aligned size in bytes.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NOT_SUPPORTED when
+ *         the range splits a block.
+ */
+status_t stage2_unmap(stage2_t* s2, uint64_t ipa, uint64_t size)
+{
+    if ((NULL == s2) || (NULL == s2->root) || ((ipa | size) & (STAGE2_PAGE_SIZE - 1ULL)))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    while (size > 0)
+    {
+        mmu_pte_t* table = s2->root;   /* Table at the current level */
+        uint32_t   level = LEVEL_FIRST; /* Level of the leaf descriptor */
+        mmu_pte_t* pte   = NULL;        /* Leaf descriptor */
+        uint64_t   span  = 0x0ULL;      /* Bytes covered by the leaf */
+
+        /* Descend to the leaf (or the hole) covering ipa */
+        for (;;)
+        {
+            pte = &table[LEVEL_INDEX(ipa, level)];
+            if (!stage2_is_table(*pte, level))
+            {
+                break;
+            }
+            table = stage2_next_table(*pte);
+            level++;
+        }
+
+        span = LEVEL_SIZE(level) - (ipa & (LEVEL_SIZE(level) - 1ULL));
+
+        if (*pte & S2_PTE_VALID)
+        {
+            if ((ipa & (LEVEL_SIZE(level) - 1ULL)) || (size < LEVEL_SIZE(level)))
+            {
+                return STATUS_ERR_NOT_SUPPORTED;
+            }
+
+            *pte = 0x0ULL;
+            stage2_tlb_flush_ipa(s2, ipa);
+        }
+
+        if (span >= size)
+        {
+            break;
+        }
+        ipa += span;
+        size -= span;
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Translate an IPA.
+ *
+ * @param s2 The regime.
+ * @param ipa The IPA to translate.
+ * @param pa Receives the PA, may be NULL.
+ * @param attr Receives the descriptor attributes, may be NULL.
+ * @return STATUS_OK or STATUS_ERR_NOT_FOUND.
+ */
+status_t stage2_lookup(const stage2_t* s2, uint64_t ipa, uint64_t* pa, uint64_t* attr)
+{
+    const mmu_pte_t* table = NULL;        /* Table at the current level */
+    mmu_pte_t        pte   = 0x0ULL;      /* Current descriptor */
+    uint32_t         level = LEVEL_FIRST; /* Current level */
+
+    if ((NULL == s2) || (NULL == s2->root) || (ipa >= (1ULL << STAGE2_IPA_BITS)))
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    table = s2->root;
+    for (;;)
+    {
+        pte = table[LEVEL_INDEX(ipa, level)];
+        if (!stage2_is_table(pte, level))
+        {
+            break;
+        }
+        table = stage2_next_table(pte);
+        level++;
+    }
+
+    if (!(pte & S2_PTE_VALID))
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    if (NULL != pa)
+    {
+        *pa = (pte & S2_PTE_ADDR_MASK & ~(LEVEL_SIZE(level) - 1ULL)) | (ipa & (LEVEL_SIZE(level) - 1ULL));
+    }
+    if (NULL != attr)
+    {
+        *attr = pte & S2_PTE_ATTR_MASK;
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Visit every valid leaf overlapping an IPA range.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA.
+ * @param size Size of the range in bytes.
+ * @param fn Called for each leaf.
+ * @param arg Passed to fn.
+ */
+void stage2_for_each_leaf(stage2_t* s2, uint64_t ipa, uint64_t size, stage2_leaf_fn_t fn, void* arg)
+{
+    if ((NULL == s2) || (NULL == s2->root) || (NULL == fn) || (0 == size))
+    {
+        return;
+    }
+
+    stage2_visit(s2->root, LEVEL_FIRST, 0x0ULL, ipa, ipa + size, fn, arg);
+}
+
+/**
+ * @brief Change the attributes of the leaves in an IPA range.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA.
+ * @param size Size of the range in bytes.
+ * @param clear Attribute bits to clear, e.g. S2_PTE_S2AP_W.
+ * @param set Attribute bits to set.
+ * @return Number of leaves updated.
+ */
+uint64_t stage2_protect(stage2_t* s2, uint64_t ipa, uint64_t size, uint64_t clear, uint64_t set)
+{
+    uint64_t req[3] = { clear & S2_PTE_ATTR_MASK, set & S2_PTE_ATTR_MASK, 0 }; /* clear, set, count */
+
+    stage2_for_each_leaf(s2, ipa, size, stage2_protect_leaf, req);
+    DSB(ishst);
+
+    return req[2];
+}
+
+/**
+ * @brief Break the blocks covering an IPA down to a 4KB page.
+ *
+ * @param s2 The regime.
+ * @param ipa The IPA.
+ * @return STATUS_OK if a block was split, STATUS_ERR_EXISTS if the IPA is
+ *         mapped by a page already, STATUS_ERR_INVALID,
+ *         STATUS_ERR_NOT_FOUND or STATUS_ERR_NO_MEMORY.
+ */
+status_t stage2_split(stage2_t* s2, uint64_t ipa)
+{
+    mmu_pte_t* table  = NULL;              /* Table at the current level */
+    mmu_pte_t* pte    = NULL;              /* Descriptor covering ipa */
+    uint32_t   level  = LEVEL_FIRST;       /* Its lookup level */
+    status_t   status = STATUS_ERR_EXISTS; /* Result if nothing is split */
+
+    if ((NULL == s2) || (NULL == s2->root) || (ipa >= (1ULL << STAGE2_IPA_BITS)))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    table = s2->root;
+    for (;;)
+    {
+        pte = &table[LEVEL_INDEX(ipa, level)];
+        if (!(*pte & S2_PTE_VALID))
+        {
+            return STATUS_ERR_NOT_FOUND;
+        }
+        if (LEVEL_LAST == level)
+        {
+            return status;
+        }
+
+        if (!stage2_is_table(*pte, level))
+        {
+            if (STATUS_OK != stage2_split_block(s2, pte, level, ipa))
+            {
+                return STATUS_ERR_NO_MEMORY;
+            }
+            status = STATUS_OK;
+        }
+
+        table = stage2_next_table(*pte);
+        level++;
+    }
+}
+
+/**
+ * @brief Fold a range mapped linearly by smaller leaves into one block.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA, aligned to size.
+ * @param size STAGE2_BLOCK_2M or STAGE2_BLOCK_1G.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS if the range is
+ *         a block already, STATUS_ERR_NOT_FOUND if it has no table, or
+ *         STATUS_ERR_NOT_SUPPORTED if the leaves cannot form a block.
+ */
+status_t stage2_promote(stage2_t* s2, uint64_t ipa, uint64_t size)
+{
+    mmu_pte_t*       pte    = NULL;      /* Table descriptor to replace */
+    uint32_t         level  = 0;         /* Its lookup level */
+    const mmu_pte_t* table  = NULL;      /* Leaves below it */
+    uint64_t         sub    = 0x0ULL;    /* Bytes mapped by each leaf */
+    uint64_t         pa     = 0x0ULL;    /* Output address of the block */
+    uint64_t         attr   = 0x0ULL;    /* Attributes of the block */
+    status_t         status = STATUS_OK; /* Table check */
+
+    status = stage2_fold_target(s2, ipa, size, &level, &pte);
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+
+    table = stage2_next_table(*pte);
+    sub   = LEVEL_SIZE(level + 1);
+    pa    = table[0] & S2_PTE_ADDR_MASK;
+    attr  = table[0] & S2_PTE_ATTR_MASK;
+
+    if (0 != (pa & (size - 1ULL)))
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    for (uint64_t i = 1; i < STAGE2_ENTRIES; ++i)
+    {
+        if (((table[i] & S2_PTE_ADDR_MASK) != (pa + (i * sub))) || ((table[i] & S2_PTE_ATTR_MASK) != attr))
+        {
+            return STATUS_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    stage2_fold(s2, pte, level, ipa, pa, attr, NULL, NULL);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Map a fully populated range with one block at a new address.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA, aligned to size.
+ * @param size STAGE2_BLOCK_2M or STAGE2_BLOCK_1G.
+ * @param pa Output address of the block, aligned to size.
+ * @param attr Attributes of the block.
+ * @param fn Called for each replaced leaf once the block is in place, may
+ *           be NULL.
+ * @param arg Passed to fn.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS,
+ *         STATUS_ERR_NOT_FOUND or STATUS_ERR_NOT_SUPPORTED if a part of
+ *         the range is unmapped.
+ */
+status_t stage2_collapse(stage2_t* s2, uint64_t ipa, uint64_t size, uint64_t pa, uint64_t attr, stage2_leaf_fn_t fn, void* arg)
+{
+    mmu_pte_t* pte    = NULL;      /* Table descriptor to replace */
+    uint32_t   level  = 0;         /* Its lookup level */
+    status_t   status = STATUS_OK; /* Table check */
+
+    if (0 != (pa & (size - 1ULL)))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    status = stage2_fold_target(s2, ipa, size, &level, &pte);
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+
+    stage2_fold(s2, pte, level, ipa, pa, attr, fn, arg);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Count the leaves of an IPA range by size.
+ *
+ * @param s2 The regime.
+ * @param ipa Start IPA.
+ * @param size Size of the range in bytes.
+ * @param census Receives the counts.
+ */
+void stage2_census(stage2_t* s2, uint64_t ipa, uint64_t size, stage2_census_t* census)
+{
+    *census = (stage2_census_t){ 0 };
+
+    stage2_for_each_leaf(s2, ipa, size, stage2_census_leaf, census);
+}
+
+/**
+ * @brief Make a regime the active stage-2 translation.
+ *
+ * @param s2 The regime.
+ */
+void stage2_activate(const stage2_t* s2)
+{
+    SYSREG_WRITE(vttbr_el2, stage2_vttbr(s2));
+    ISB();
+}
+
+/**
+ * @brief Invalidate the TLB entries of one IPA page.
+ *
+ * TLBI IPAS2E1IS operates on the VMID in VTTBR_EL2, so the regime is
+ * made current for the duration of the invalidation. Bumps the regime's
+ * generation, so software caches of its translations see the change.
+ *
+ * @param s2 The regime.
+ * @param ipa The IPA.
+ */
+void stage2_tlb_flush_ipa(stage2_t* s2, uint64_t ipa)
+{
+    stage2_tlb_flush_leaves(s2, ipa, STAGE2_PAGE_SIZE, 1);
+}
+
+/**
+ * @brief Invalidate the TLB entries of an IPA range.
+ *
+ * @param s2 The regime.
+ * @param ipa Page aligned start IPA.
+ * @param size Page aligned size in bytes.
+ */
+void stage2_tlb_flush_range(stage2_t* s2, uint64_t ipa, uint64_t size)
+{
+    uint64_t pages = size >> 12; /* Pages in the range */
+
+    if (pages > STAGE2_ENTRIES)
+    {
+        stage2_tlb_flush_all(s2);
+        return;
+    }
+
+    stage2_tlb_flush_leaves(s2, ipa, STAGE2_PAGE_SIZE, pages);
+}
+
+/**
+ * @brief Invalidate all TLB entries of a regime.
+ *
+ * Bumps the regime's generation like stage2_tlb_flush_ipa().
+ *
+ * @param s2 The regime.
+ */
+void stage2_tlb_flush_all(stage2_t* s2)
+{
+    uint64_t vttbr = SYSREG_READ(vttbr_el2); /* Regime to restore */
+
+    SYSREG_WRITE(vttbr_el2, stage2_vttbr(s2));
+    ISB();
+
+    DSB(ishst);
+    TLBI(vmalls12e1is);
+    DSB(ish);
+
+    SYSREG_WRITE(vttbr_el2, vttbr);
+    ISB();
+
+    __atomic_fetch_add(&s2->gen, 1U, __ATOMIC_RELEASE); /* After the invalidation is complete */
+}
@@ -93,11 +93,9 @@ zero_bss:
     // Compare current address with end address
     cmp x2, x3
     // If current address >= end address, branch to done_zero_bss
-    b.ge done_zero_bss
-    // Store zero value at current address
+    b.hs done_zero_bss
+    // Store zero value at current address and advance by 8 (size of a double word)
     str x4, [x2], #8
-    // Increment address by 8 (size of a double word)
-    add x2, x2, #8
     // Branch back to zero_bss
     b zero_bss
 done_zero_bss:
@@ -113,15 +111,11 @@ copy_data:
     // Compare current address with end address
     cmp x2, x3
     // If current address >= end address, branch to done_copy_data
-    b.ge done_copy_data
-    // Load data from source address
+    b.hs done_copy_data
+    // Load data from source address and advance it by 8
     ldr x5, [x4], #8
-    // Store data to destination address
+    // Store data to destination address and advance it by 8
     str x5, [x2], #8
-    // Increment destination address by 8
-    add x2, x2, #8
-    // Increment source address by 8
-    add x4, x4, #8
     // Branch back to copy_data
     b copy_data
 done_copy_data:
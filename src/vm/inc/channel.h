@@ -0,0 +1,268 @@
+/**
+ * @file channel.h
+ * @brief Shared memory channels between VMs.
+ *
+ * This file contains the ring layout shared with guests, the ring access
+ * helpers and the function prototypes to create channels and ring their
+ * doorbells.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A channel is two pages, each holding a single producer single consumer
+ * ring, mapped into both VMs with the rings swapped: at its channel IPA a
+ * VM finds the ring it sends on, and one page above it the ring it
+ * receives on. The hypervisor is not involved in moving data.
+ *
+ * Head and tail indices are free running and live on separate cache
+ * lines, together with the state written by the same side. A sender rings
+ * the doorbell with HYPERCALL_CHANNEL_DOORBELL after publishing messages.
+ * The peer is only interrupted if it armed notification with
+ * channel_ring_arm(), and arming is one-shot, so a busy receiver that
+ * polls costs no interrupts at all.
+ *
+ * Every message carries the counter value at send time, which lets the
+ * receive helper account delivery latency on the consumer's cache line.
+ * Guests run the same helpers; the counter is the physical counter, which
+ * EL1 is allowed to read.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Inter-VM channel layout, helpers and function prototypes.
+ *
+ * @section examples Examples
+ * @code
+ * // sender
+ * if (channel_ring_send(tx, msg, len))
+ * {
+ *     hvc(HYPERCALL_CHANNEL_DOORBELL, channel_index);
+ * }
+ *
+ * // receiver
+ * while (channel_ring_recv(rx, buf) < 0)
+ * {
+ *     if (!channel_ring_arm(rx))
+ *     {
+ *         wfi();
+ *     }
+ * }
+ * @endcode
+ */
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdint.h>
+
+#include "status.h"
+#include "sysreg.h"
+
+#define CHANNEL_SLOTS     (32U)                      /**< Messages per ring, must be a power of two */
+#define CHANNEL_MSG_MAX   (96U)                      /**< Largest message in bytes */
+#define CHANNEL_LINE_SIZE (64U)                      /**< Cache line size separating the indices */
+#define CHANNEL_PAGE_SIZE (0x1000ULL)                /**< Size of one ring page */
+#define CHANNEL_SIZE      (2ULL * CHANNEL_PAGE_SIZE) /**< IPA space taken by a channel */
+
+struct vm;
+
+/**
+ * @brief One message slot.
+ */
+typedef struct channel_slot
+{
+    uint32_t len;                   /**< message length in bytes */
+    uint32_t reserved;              /**< keeps stamp aligned */
+    uint64_t stamp;                 /**< counter value at send time */
+    uint8_t  data[CHANNEL_MSG_MAX]; /**< message */
+} channel_slot_t;
+
+/**
+ * @brief Layout of a ring page.
+ */
+typedef struct channel_ring
+{
+    /* producer cache line */
+    uint32_t       head;                                 /**< messages sent */
+    uint8_t        producer_pad[CHANNEL_LINE_SIZE - 4];  /**< keeps the consumer line apart */
+
+    /* consumer cache line */
+    uint32_t       tail;                                 /**< messages received */
+    uint32_t       armed;                                /**< consumer waits for a doorbell interrupt */
+    uint64_t       lat_sum;                              /**< total delivery latency in counter ticks */
+    uint64_t       lat_max;                              /**< worst delivery latency in counter ticks */
+    uint8_t        consumer_pad[CHANNEL_LINE_SIZE - 24]; /**< fills the consumer line */
+
+    channel_slot_t slots[CHANNEL_SLOTS];                 /**< message slots */
+} channel_ring_t;
+
+_Static_assert(sizeof(channel_ring_t) <= CHANNEL_PAGE_SIZE, "channel ring must fit in a page");
+_Static_assert(0 == (CHANNEL_SLOTS & (CHANNEL_SLOTS - 1U)), "CHANNEL_SLOTS must be a power of two");
+
+/**
+ * @brief Doorbell counters of one direction of a channel.
+ */
+typedef struct channel_stats
+{
+    uint64_t doorbells;  /**< doorbell hypercalls by the sender */
+    uint64_t notified;   /**< doorbells that interrupted the receiver */
+    uint64_t suppressed; /**< doorbells dropped because the receiver was polling */
+} channel_stats_t;
+
+/**
+ * @brief One side of a channel.
+ */
+typedef struct channel_endpoint
+{
+    struct vm* vm;  /**< VM owning the endpoint */
+    uint64_t   ipa; /**< page aligned IPA of the endpoint's send ring */
+    uint32_t   irq; /**< virtual interrupt raised by the peer's doorbell */
+} channel_endpoint_t;
+
+/**
+ * @brief A channel between two VMs.
+ *
+ * Ring n carries messages sent by endpoint n.
+ */
+typedef struct channel
+{
+    channel_endpoint_t ep[2];        /**< the two sides */
+    channel_ring_t*    ring[2];      /**< ring pages, hypervisor view */
+    channel_stats_t    stats[2];     /**< doorbell counters per sender */
+    uint32_t           index[2];     /**< channel index within each VM */
+    uint32_t           last_head[2]; /**< head at the previous report */
+    uint64_t           last_report;  /**< counter value at the previous report */
+} channel_t;
+
+/**
+ * @brief Queue a message.
+ *
+ * @param ring The ring to send on.
+ * @param data The message.
+ * @param len Length in bytes, at most CHANNEL_MSG_MAX.
+ * @return Non-zero if queued, zero if the ring is full or len too large.
+ */
+static inline int channel_ring_send(channel_ring_t* ring, const void* data, uint32_t len)
+{
+    uint32_t        head = ring->head;                                     /* Only the producer writes it */
+    uint32_t        tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE); /* Slots freed by the consumer */
+    channel_slot_t* slot = &ring->slots[head & (CHANNEL_SLOTS - 1U)];      /* Slot to fill */
+
+    if ((len > CHANNEL_MSG_MAX) || ((head - tail) >= CHANNEL_SLOTS))
+    {
+        return 0;
+    }
+
+    __builtin_memcpy(slot->data, data, len);
+    slot->len   = len;
+    slot->stamp = arch_counter_read();
+
+    __atomic_store_n(&ring->head, head + 1U, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/**
+ * @brief Dequeue a message.
+ *
+ * @param ring The ring to receive on.
+ * @param data Receives the message, CHANNEL_MSG_MAX bytes.
+ * @return Message length, or -1 if the ring is empty.
+ */
+static inline int32_t channel_ring_recv(channel_ring_t* ring, void* data)
+{
+    uint32_t        tail = ring->tail;                                     /* Only the consumer writes it */
+    uint32_t        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE); /* Messages published */
+    channel_slot_t* slot = &ring->slots[tail & (CHANNEL_SLOTS - 1U)];      /* Oldest message */
+    uint32_t        len  = 0;                                              /* Message length */
+    uint64_t        lat  = 0x0ULL;                                         /* Delivery latency */
+
+    if (head == tail)
+    {
+        return -1;
+    }
+
+    len = (slot->len > CHANNEL_MSG_MAX) ? CHANNEL_MSG_MAX : slot->len;
+    __builtin_memcpy(data, slot->data, len);
+
+    lat = arch_counter_read() - slot->stamp;
+    ring->lat_sum += lat;
+    if (lat > ring->lat_max)
+    {
+        ring->lat_max = lat;
+    }
+
+    __atomic_store_n(&ring->tail, tail + 1U, __ATOMIC_RELEASE);
+
+    return (int32_t)len;
+}
+
+/**
+ * @brief Ask for an interrupt on the next doorbell.
+ *
+ * @param ring The ring to receive on.
+ * @return Non-zero if messages arrived meanwhile, in which case the
+ *         caller should receive them instead of waiting.
+ */
+static inline int channel_ring_arm(channel_ring_t* ring)
+{
+    __atomic_store_n(&ring->armed, 1U, __ATOMIC_RELAXED);
+
+    /* Pairs with the fence in channel_doorbell(), no wakeup can be lost */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    return __atomic_load_n(&ring->head, __ATOMIC_RELAXED) != ring->tail;
+}
+
+/**
+ * @brief Create a channel and map it into both VMs.
+ *
+ * @param ch The channel, owned by the caller.
+ * @param a First endpoint.
+ * @param b Second endpoint, in a different VM.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS if an IPA is
+ *         already mapped, or STATUS_ERR_NO_MEMORY.
+ */
+status_t channel_create(channel_t* ch, const channel_endpoint_t* a, const channel_endpoint_t* b);
+
+/**
+ * @brief Ring the doorbell of a channel.
+ *
+ * @param vm The sending VM.
+ * @param index Channel index within the sending VM.
+ * @param notified Receives 1 if the peer was interrupted, 0 otherwise.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t channel_doorbell(struct vm* vm, uint64_t index, uint64_t* notified);
+
+/**
+ * @brief Log throughput, latency and doorbell counters of a channel.
+ *
+ * Throughput is measured since the previous report.
+ *
+ * @param ch The channel.
+ */
+void channel_report(channel_t* ch);
+
+#endif // CHANNEL_H
@@ -0,0 +1,287 @@
+/**
+ * @file gmem.h
+ * @brief Demand paged guest memory.
+ *
+ * This file contains the function prototypes to back guest RAM on first
+ * touch and to give pages back to the hypervisor.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Guest RAM is left unmapped at VM creation. The first access to a page
+ * raises a stage-2 translation fault, which gmem_handle_fault() resolves by
+ * mapping a pre-zeroed frame. Pages released by the guest (through the
+ * balloon device) are unmapped and their frames returned to the pool, which
+ * lets the sum of guest RAM sizes exceed physical memory.
+ *
+ * Dirty logging write-protects resident pages and records the first write
+ * to each of them in a bitmap, one bit per guest page. Syncing the log
+ * hands out the bitmap and re-protects only the pages that were dirty, so
+ * the cost of an incremental snapshot scales with the written pages.
+ *
+ * Demand paging maps 4KB pages, which cost TLB reach once a guest has
+ * touched most of its RAM. A compaction step, run by a CPU about to idle
+ * in WFI, looks for fully populated 2MB regions with uniform permissions.
+ * A region whose frames already form an aligned run is folded into a
+ * block in place; any other is copied into a fresh aligned run first, with
+ * guest writes held off until the block is installed. 1GB blocks are not
+ * formed, the frame pool cannot hand out a 1GB aligned run to back one.
+ * A write logged by dirty tracking, or a page given back through the
+ * balloon, splits its block again.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Demand paging function prototypes and counters.
+ */
+
+#ifndef GMEM_H
+#define GMEM_H
+
+#include <stdint.h>
+
+#include "status.h"
+
+#define GMEM_COMPACT_SCAN (8U) /**< 2MB regions one compaction step looks at */
+
+struct vm;
+
+/**
+ * @brief Per-VM demand paging counters.
+ */
+typedef struct gmem_stats
+{
+    uint64_t faults;          /**< stage-2 faults resolved by populating a page */
+    uint64_t fault_ticks;     /**< total fault handling time in counter ticks */
+    uint64_t fault_ticks_max; /**< slowest fault in counter ticks */
+    uint64_t resident_pages;  /**< pages currently backed by a frame */
+    uint64_t ballooned_pages; /**< pages currently handed back by the guest */
+} gmem_stats_t;
+
+/**
+ * @brief Per-VM dirty page log.
+ */
+typedef struct gmem_dirty_log
+{
+    uint64_t* bitmap;       /**< one bit per guest page, NULL when logging is off */
+    uint64_t  words;        /**< bitmap size in 64-bit words */
+    uint64_t  frames;       /**< frames backing the bitmap */
+    uint64_t  write_faults; /**< permission faults taken to log a write */
+    uint64_t  syncs;        /**< log syncs since logging started */
+} gmem_dirty_log_t;
+
+/**
+ * @brief Per-VM huge page compaction state and counters.
+ */
+typedef struct gmem_compact
+{
+    uint64_t next;       /**< 2MB region the next step starts with */
+    uint64_t swept;      /**< regions found ineligible in a row */
+    uint32_t pending;    /**< the layout changed since the last full sweep */
+    uint32_t pins;       /**< gmem_pin() holders, compaction waits for 0 */
+    uint64_t promotions; /**< blocks formed from leaves already in place */
+    uint64_t migrations; /**< 2MB regions copied into an aligned frame run */
+    uint64_t splits;     /**< blocks split because a page needed other permissions */
+} gmem_compact_t;
+
+/**
+ * @brief Prepare guest memory of a VM.
+ *
+ * @param vm The VM.
+ * @return STATUS_OK.
+ */
+status_t gmem_init(struct vm* vm);
+
+/**
+ * @brief Release all frames backing guest memory.
+ *
+ * @param vm The VM.
+ */
+void gmem_destroy(struct vm* vm);
+
+/**
+ * @brief Check whether an IPA is guest RAM.
+ *
+ * @param vm The VM.
+ * @param ipa The IPA.
+ * @return Non-zero if the IPA lies in guest RAM.
+ */
+int gmem_contains(const struct vm* vm, uint64_t ipa);
+
+/**
+ * @brief Resolve a stage-2 fault on guest RAM.
+ *
+ * A permission fault that raced compaction or the end of dirty logging
+ * and finds the access allowed by the time it is handled only retries.
+ *
+ * @param vm The VM.
+ * @param ipa The faulting IPA.
+ * @param esr The exception syndrome.
+ * @return STATUS_OK, STATUS_ERR_NOT_SUPPORTED for faults other than
+ *         translation faults, logged writes and stale permission faults,
+ *         or STATUS_ERR_NO_MEMORY.
+ */
+status_t gmem_handle_fault(struct vm* vm, uint64_t ipa, uint64_t esr);
+
+/**
+ * @brief Populate a guest page.
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK (also if already resident) or STATUS_ERR_NO_MEMORY.
+ */
+status_t gmem_populate(struct vm* vm, uint64_t ipa);
+
+/**
+ * @brief Unmap a guest page and free its frame.
+ *
+ * Unlike gmem_release() the page is not accounted as ballooned; its next
+ * access reads as zero. A block mapping the page is split first.
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY if the
+ *         block mapping the page cannot be split.
+ */
+status_t gmem_discard(struct vm* vm, uint64_t ipa);
+
+/**
+ * @brief Take a page back from the guest (balloon inflate).
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t gmem_release(struct vm* vm, uint64_t ipa);
+
+/**
+ * @brief Give a page back to the guest (balloon deflate).
+ *
+ * The page is not populated until the guest touches it again.
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t gmem_reclaim(struct vm* vm, uint64_t ipa);
+
+/**
+ * @brief Get a hypervisor pointer to resident guest memory.
+ *
+ * The pointer stays valid only while the caller holds gmem_pin(), which
+ * keeps compaction from moving the page to another frame.
+ *
+ * @param vm The VM.
+ * @param ipa Start IPA.
+ * @param len Length of the access, must not cross a page.
+ * @return Pointer to the memory, or NULL if not resident.
+ */
+void* gmem_ipa_to_host(struct vm* vm, uint64_t ipa, uint64_t len);
+
+/**
+ * @brief Keep guest RAM in its frames while host pointers to it are used.
+ *
+ * Compaction steps return at once until every pin is dropped again with
+ * gmem_unpin(). Take the pin before translating, a step in progress then
+ * finishes before the translation is looked up. Pins nest.
+ *
+ * @param vm The VM.
+ */
+void gmem_pin(struct vm* vm);
+
+/**
+ * @brief Drop a pin taken with gmem_pin().
+ *
+ * @param vm The VM.
+ */
+void gmem_unpin(struct vm* vm);
+
+/**
+ * @brief Start logging writes to guest RAM.
+ *
+ * Every resident page starts out dirty so that the first sync returns the
+ * full memory image.
+ *
+ * @param vm The VM.
+ * @return STATUS_OK, STATUS_ERR_BUSY if already logging or
+ *         STATUS_ERR_NO_MEMORY.
+ */
+status_t gmem_dirty_log_start(struct vm* vm);
+
+/**
+ * @brief Stop logging writes and make guest RAM writable again.
+ *
+ * @param vm The VM.
+ */
+void gmem_dirty_log_stop(struct vm* vm);
+
+/**
+ * @brief Fetch and clear the dirty page log.
+ *
+ * Pages reported dirty are write-protected again, all other pages keep
+ * their current permissions.
+ *
+ * @param vm The VM.
+ * @param out Receives vm->dirty.words words, bit n covers page n of guest
+ *            RAM. May be NULL to only count.
+ * @return Number of dirty pages.
+ */
+uint64_t gmem_dirty_log_sync(struct vm* vm, uint64_t* out);
+
+/**
+ * @brief Record a hypervisor write to guest RAM in the dirty log.
+ *
+ * Writes done by the hypervisor on behalf of the guest bypass stage-2
+ * permissions and must be reported explicitly.
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the written page, ignored outside guest RAM.
+ */
+void gmem_dirty_log_mark(struct vm* vm, uint64_t ipa);
+
+/**
+ * @brief Run one step of the huge page compaction pass.
+ *
+ * Looks at up to GMEM_COMPACT_SCAN 2MB regions of guest RAM, resuming
+ * where the previous step stopped, and turns the first eligible one into
+ * a block. Returns at once while dirty logging is on, or if nothing was
+ * populated since a full sweep found no candidate, while guest RAM is
+ * pinned, or if vm->s2_lock is held. Faults of the VM's vCPUs wait on that lock until the block is in
+ * place.
+ *
+ * @param vm The VM.
+ * @return Number of 2MB blocks formed, 0 or 1.
+ */
+uint32_t gmem_compact(struct vm* vm);
+
+/**
+ * @brief Log the demand paging counters of a VM.
+ *
+ * Includes how much of guest RAM is mapped by blocks and by pages.
+ *
+ * @param vm The VM.
+ */
+void gmem_report(struct vm* vm);
+
+#endif // GMEM_H
@@ -0,0 +1,129 @@
+/**
+ * @file hypercall.h
+ * @brief Guest hypercall interface.
+ *
+ * This file contains the hypercall function IDs, the layout of a batch
+ * page and the function prototypes of the hypercall dispatcher.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Hypercalls follow the SMC Calling Convention: the function ID goes in
+ * x0 and arguments in x1-x3 of an HVC #0. The status is returned in x0
+ * and a result value, if any, in x1. IDs are fast 64-bit calls in the
+ * vendor specific hypervisor service range.
+ *
+ * HYPERCALL_MULTICALL executes a batch of operations with a single guest
+ * exit. The guest fills a page of guest RAM with hypercall_entry_t
+ * records, each holding a function ID and the arguments of the equivalent
+ * single call. The whole batch is validated before any of it runs. Each
+ * record then gets its own status, and read results go to args[0]. A
+ * HYPERCALL_MEM_DISCARD of the batch page itself is invalid.
+ *
+ * HYPERCALL_SNAPSHOT_SAVE writes the VM to a numbered slot file on the
+ * debug host, see snapshot.h. It returns with x1 = 0, and a later
+ * HYPERCALL_SNAPSHOT_RESTORE of that slot resumes every vCPU at its state
+ * in the file, the calling one from its save call with x1 = 1, much like
+ * setjmp().
+ *
+ * The dispatcher also takes PSCI CPU_ON (SMC64), which a guest uses to
+ * start its secondary vCPUs: x1 is the target's MPIDR, Aff0 being the
+ * vCPU number, x2 its entry point and x3 the value it gets in x0. Only the
+ * PSCI return code comes back, in x0.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Hypercall IDs, batch layout and function prototypes.
+ *
+ * @section examples Examples
+ * @code
+ * // guest side, page is a guest RAM page known to the hypervisor by IPA
+ * page[0] = (hypercall_entry_t){ .op = HYPERCALL_MEM_DISCARD, .args = { ipa0 } };
+ * page[1] = (hypercall_entry_t){ .op = HYPERCALL_MMIO_WRITE, .args = { reg, 4, val } };
+ * hvc(HYPERCALL_MULTICALL, page_ipa, 2);
+ * @endcode
+ */
+
+#ifndef HYPERCALL_H
+#define HYPERCALL_H
+
+#include <stdint.h>
+
+#include "status.h"
+#include "vm.h"
+
+#define HYPERCALL_FN(n) (0xC6000000U | (n)) /**< Fast SMC64 call, vendor hypervisor service */
+
+#define HYPERCALL_VERSION      HYPERCALL_FN(0x00U) /**< Get the interface version in x1 */
+#define HYPERCALL_NOP          HYPERCALL_FN(0x01U) /**< Do nothing, measures the exit cost */
+#define HYPERCALL_MEM_POPULATE HYPERCALL_FN(0x02U) /**< Back the guest page at x1 */
+#define HYPERCALL_MEM_DISCARD  HYPERCALL_FN(0x03U) /**< Return the guest page at x1 to the hypervisor */
+#define HYPERCALL_MMIO_WRITE   HYPERCALL_FN(0x04U) /**< Store x3 to the register at x1, x2 bytes wide */
+#define HYPERCALL_MMIO_READ    HYPERCALL_FN(0x05U) /**< Load the register at x1, x2 bytes wide, into x1 */
+#define HYPERCALL_MULTICALL    HYPERCALL_FN(0x10U) /**< Run x2 entries of the batch page at x1 */
+#define HYPERCALL_SHUTDOWN     HYPERCALL_FN(0x11U) /**< Power the VM off */
+
+#define HYPERCALL_CHANNEL_DOORBELL HYPERCALL_FN(0x20U) /**< Notify the peer of channel x1, x1 = 1 if interrupted */
+
+#define HYPERCALL_SNAPSHOT_SAVE    HYPERCALL_FN(0x30U) /**< Save the VM to slot x2, x1 = snapshot_type_t */
+#define HYPERCALL_SNAPSHOT_RESTORE HYPERCALL_FN(0x31U) /**< Roll the VM back to slot x1, returns only on error */
+
+#define HYPERCALL_SNAPSHOT_SLOTS (16U) /**< Snapshot slot files per VM */
+
+#define HYPERCALL_INTERFACE_VERSION (0x00010000U) /**< Version 1.0 */
+
+#define HYPERCALL_ERR_UNKNOWN (-1) /**< SMCCC NOT_SUPPORTED, returned for unknown IDs */
+
+/**
+ * @brief One operation of a batch page.
+ */
+typedef struct hypercall_entry
+{
+    uint32_t op;      /**< HYPERCALL_* function ID, not MULTICALL or SHUTDOWN */
+    int32_t  result;  /**< status written back by the hypervisor */
+    uint64_t args[3]; /**< x1-x3 of the single call, args[0] receives read values */
+} hypercall_entry_t;
+
+#define HYPERCALL_BATCH_MAX (0x1000U / sizeof(hypercall_entry_t)) /**< Entries per batch page */
+
+/**
+ * @brief Handle an HVC taken by a vCPU.
+ *
+ * Reads the call from the vCPU's trap frame and writes the results back
+ * to x0 and x1.
+ *
+ * @param vcpu The calling vCPU.
+ * @return STATUS_OK if the guest can be resumed.
+ */
+status_t hypercall_handle(vcpu_t* vcpu);
+
+/**
+ * @brief Log the hypercall counters of a VM.
+ *
+ * @param vm The VM.
+ */
+void hypercall_report(const vm_t* vm);
+
+#endif // HYPERCALL_H
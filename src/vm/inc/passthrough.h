@@ -0,0 +1,111 @@
+/**
+ * @file passthrough.h
+ * @brief Physical devices assigned to a VM.
+ *
+ * This file contains the passthrough device type and the function
+ * prototypes to assign a device to a VM and to forward its interrupt.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A passthrough device is a physical MMIO range mapped into one VM with
+ * Device-nGnRE stage-2 attributes, so the guest's register accesses never
+ * trap. Its SPI is forwarded to the same interrupt ID in the VM: the
+ * hypervisor injects it into vCPU 0 through a hardware list register and
+ * the guest's deactivation completes the physical interrupt, with no exit
+ * on the way out. The SPI follows vCPU 0 to the CPU it runs on.
+ *
+ * Assigning the hypervisor's own UART moves the hypervisor log to another
+ * sink, see log_release_uart().
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Passthrough device type and function prototypes.
+ */
+
+#ifndef PASSTHROUGH_H
+#define PASSTHROUGH_H
+
+#include <stdint.h>
+
+#include "status.h"
+
+#define PASSTHROUGH_MAX     (4U) /**< Devices assigned at the same time */
+#define PASSTHROUGH_NO_IRQ  (0U) /**< The device has no interrupt */
+
+struct vm;
+
+/**
+ * @brief A physical device assigned to a VM.
+ */
+typedef struct passthrough
+{
+    struct vm* vm;   /**< owning VM */
+    uint64_t   ipa;  /**< guest address of the register window */
+    uint64_t   pa;   /**< physical address of the register window */
+    uint64_t   size; /**< size of the register window in bytes */
+    uint32_t   irq;  /**< SPI, physical and virtual, or PASSTHROUGH_NO_IRQ */
+    uint32_t   cpu;  /**< CPU the SPI is routed to */
+    uint64_t   irqs; /**< interrupts forwarded */
+} passthrough_t;
+
+/**
+ * @brief Assign a physical device to a VM.
+ *
+ * Maps the register window into the VM and forwards the device's SPI to
+ * it. Releases the log from the UART if the window covers it.
+ *
+ * @param pt The device, owned by the caller.
+ * @param vm The VM.
+ * @param ipa Page aligned guest address of the register window.
+ * @param pa Page aligned physical address of the register window.
+ * @param size Page aligned size of the register window.
+ * @param irq The SPI, or PASSTHROUGH_NO_IRQ.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS if the IPA or
+ *         the SPI is taken, or STATUS_ERR_NO_MEMORY.
+ */
+status_t passthrough_assign(passthrough_t* pt, struct vm* vm, uint64_t ipa, uint64_t pa, uint64_t size, uint32_t irq);
+
+/**
+ * @brief Take a device back from its VM.
+ *
+ * Disables the SPI and unmaps the register window.
+ *
+ * @param pt The device.
+ */
+void passthrough_release(passthrough_t* pt);
+
+/**
+ * @brief Forward a physical interrupt that belongs to an assigned device.
+ *
+ * Must be called between gic_ack() and gic_eoi().
+ *
+ * @param intid The acknowledged interrupt ID.
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if no assigned device
+ *         uses the interrupt.
+ */
+status_t passthrough_irq(uint32_t intid);
+
+#endif // PASSTHROUGH_H
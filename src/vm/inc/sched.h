@@ -0,0 +1,305 @@
+/**
+ * @file sched.h
+ * @brief Per-CPU vCPU scheduler with a tickless idle loop.
+ *
+ * This file contains the definitions and function prototypes to place
+ * vCPUs on physical CPUs, block them in WFI and wake them again.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Every physical CPU owns a run queue that only it modifies once it has
+ * started scheduling. Runnable vCPUs share the CPU in round-robin time
+ * slices, a vCPU that executes WFI is unloaded and marked blocked until
+ * it has a virtual interrupt pending or its virtual timer expires.
+ *
+ * There is no periodic tick. Whenever the CPU goes idle or switches vCPUs
+ * the EL2 physical timer (CNTHP) is programmed to the nearest real
+ * deadline: the virtual timers of the blocked vCPUs and, only if another
+ * vCPU is waiting for the CPU, the end of the current time slice. If no
+ * deadline exists the timer stays off and the CPU sleeps until an
+ * interrupt arrives. Deadlines that fall within the slack of the earliest
+ * one are served by a single wakeup at the latest of them.
+ *
+ * A vCPU that waits in WFE for a lock while a sibling of its VM is
+ * runnable on the same CPU yields to that sibling, preferring one that
+ * was preempted at the end of its slice and may hold the lock.
+ *
+ * Idle CPUs wait in WFI with interrupts masked and poll the GIC when they
+ * wake, so the per-CPU statistics can attribute every wakeup.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Scheduler definitions and function prototypes.
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+#include "status.h"
+#include "vm.h"
+
+#define SCHED_MAX_VCPUS (8U) /**< vCPUs per physical CPU */
+
+#ifndef SCHED_SLACK_US
+#define SCHED_SLACK_US (50U) /**< Default timer coalescing slack in microseconds */
+#endif
+
+#ifndef SCHED_SLICE_US
+#define SCHED_SLICE_US (10000U) /**< Time slice in microseconds */
+#endif
+
+#define SCHED_TIMER_PPI   (26U)        /**< EL2 physical timer interrupt */
+#define SCHED_VTIMER_PPI  (27U)        /**< EL1 virtual timer interrupt */
+#define SCHED_KICK_SGI    (0U)         /**< Makes a CPU re-evaluate its run queue */
+#define SCHED_NO_DEADLINE (UINT64_MAX) /**< No timer needed */
+
+/**
+ * @brief Idle and wakeup counters of a physical CPU.
+ */
+typedef struct sched_stats
+{
+    uint64_t since;         /**< counter value when the CPU started scheduling */
+    uint64_t idle_ticks;    /**< counter ticks spent in WFI */
+    uint64_t wakeups;       /**< WFI exits */
+    uint64_t timer_wakeups; /**< WFI exits caused by the EL2 timer */
+    uint64_t empty_wakeups; /**< WFI exits that found nothing to run */
+    uint64_t timer_fires;   /**< EL2 timer interrupts, idle or not */
+    uint64_t timer_arms;    /**< EL2 timer reprogrammings */
+    uint64_t coalesced;     /**< deadlines served by another deadline's interrupt */
+    uint64_t switches;      /**< changes of the loaded vCPU */
+    uint64_t yields;        /**< WFE traps that handed the CPU to a sibling */
+    uint64_t yield_holders; /**< of those, yields to a preempted sibling */
+    uint64_t yield_misses;  /**< WFE traps that found no sibling to run */
+    uint64_t ipis;          /**< virtual SGIs sent to a sibling vCPU from this CPU */
+    uint64_t ipi_kicks;     /**< of those, delivered with a physical SGI */
+} sched_stats_t;
+
+/**
+ * @brief Add a vCPU to the run queue of a physical CPU.
+ *
+ * Only valid before that CPU starts scheduling, the vCPU becomes runnable.
+ *
+ * @param vcpu The vCPU, reset to its entry state.
+ * @param cpu The physical CPU number.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY if the run
+ *         queue is full.
+ */
+status_t sched_add(vcpu_t* vcpu, uint32_t cpu);
+
+/**
+ * @brief Add a powered off vCPU to the run queue of a physical CPU.
+ *
+ * Only valid before that CPU starts scheduling. The vCPU is not picked
+ * until sched_power_on() starts it, typically for a guest PSCI CPU_ON.
+ *
+ * @param vcpu The vCPU.
+ * @param cpu The physical CPU number.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY if the run
+ *         queue is full.
+ */
+status_t sched_add_off(vcpu_t* vcpu, uint32_t cpu);
+
+/**
+ * @brief Start a powered off vCPU.
+ *
+ * Resets the vCPU to its entry point and makes it runnable on the CPU it
+ * was added to, kicking that CPU out of idle. May be called from the trap
+ * of a sibling on any CPU; of two concurrent calls only one starts it.
+ *
+ * @param vcpu The vCPU, added with sched_add_off().
+ * @param entry Guest entry point (IPA).
+ * @param arg Value passed in x0.
+ * @return STATUS_OK, STATUS_ERR_BUSY if the vCPU is on already or being
+ *         started, or STATUS_ERR_INVALID if it is in no run queue.
+ */
+status_t sched_power_on(vcpu_t* vcpu, uint64_t entry, uint64_t arg);
+
+/**
+ * @brief Start scheduling on all CPUs that have vCPUs.
+ *
+ * Powers up the secondary CPUs with a non-empty run queue. vCPUs of CPUs
+ * that cannot be started move to the calling CPU, which then schedules
+ * its own run queue.
+ */
+void sched_start(void) __attribute__((noreturn));
+
+/**
+ * @brief Start scheduling the run queue of a secondary CPU.
+ *
+ * For vCPUs added to a CPU that was left off by sched_start(), or that
+ * was powered off since. If the CPU cannot be started, its vCPUs move to
+ * the calling CPU, which must be scheduling already.
+ *
+ * @param cpu The physical CPU number.
+ * @return STATUS_OK, STATUS_ERR_INVALID, or the error of smp_cpu_on()
+ *         once the vCPUs moved to the calling CPU.
+ */
+status_t sched_cpu_on(uint32_t cpu);
+
+/**
+ * @brief Block the loaded vCPU until it has work.
+ *
+ * Called when the vCPU executes WFI. Returns with the next vCPU to run
+ * loaded, which may be the same one; the CPU idles in between if nothing
+ * is runnable. A vCPU entered directly with vcpu_run() joins the run queue
+ * of its CPU the first time it waits.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void sched_wait(vcpu_t* vcpu);
+
+/**
+ * @brief Wake a vCPU after an interrupt was made pending for it.
+ *
+ * Safe from any CPU. The CPU that owns the vCPU is kicked so that it
+ * re-evaluates its run queue, or exits the guest to deliver the interrupt.
+ * On the owning CPU itself no SGI is sent: a blocked vCPU is made runnable
+ * and the loaded vCPU's slice is armed for it.
+ *
+ * @param vcpu The vCPU.
+ */
+void sched_wake(vcpu_t* vcpu);
+
+/**
+ * @brief Wake a vCPU after a sibling made a virtual SGI pending for it.
+ *
+ * Called in the trap of the sending vCPU. A blocked target is made
+ * runnable directly. The target's CPU is kicked only if the target runs
+ * there, or was blocked and that CPU is not the sender's; a target that
+ * waits for its CPU gets the interrupt when it is loaded. Called with no
+ * vCPU loaded, a target on the calling CPU is left for its next pick.
+ *
+ * @param vcpu The target vCPU.
+ */
+void sched_ipi(vcpu_t* vcpu);
+
+/**
+ * @brief Hand the CPU from a spinning vCPU to a sibling.
+ *
+ * Called when the vCPU executes WFE. Switches to a runnable vCPU of the
+ * same VM on this CPU, a preempted one first, which starts a new time
+ * slice. Returns with the loaded vCPU unchanged if there is none.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void sched_yield(vcpu_t* vcpu);
+
+/**
+ * @brief Take the loaded vCPU off its CPU for good.
+ *
+ * Returns with the next vCPU to run loaded.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void sched_exit(vcpu_t* vcpu);
+
+/**
+ * @brief Take every vCPU of a VM but the calling one off its CPU.
+ *
+ * Kicks the CPUs that run a vCPU of the VM and waits until they switched
+ * away; none of its vCPUs is loaded again until sched_resume(). The
+ * calling vCPU, if it belongs to the VM, stays loaded. Must not be called
+ * with a lock held that the kicked CPUs may take.
+ *
+ * @param vm The VM.
+ * @return STATUS_OK, or STATUS_ERR_BUSY if the VM is paused already.
+ */
+status_t sched_pause(vm_t* vm);
+
+/**
+ * @brief Let the vCPUs of a paused VM run again.
+ *
+ * @param vm The VM.
+ */
+void sched_resume(vm_t* vm);
+
+/**
+ * @brief Handle a physical interrupt that belongs to the scheduler.
+ *
+ * Must be called between gic_ack() and gic_eoi().
+ *
+ * @param intid The acknowledged interrupt ID.
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the interrupt is not
+ *         one of the scheduler's.
+ */
+status_t sched_irq(uint32_t intid);
+
+/**
+ * @brief Re-evaluate the run queue from guest context.
+ *
+ * Called after a scheduler interrupt has been completed. May switch the
+ * loaded vCPU.
+ */
+void sched_preempt(void);
+
+/**
+ * @brief Set the timer coalescing slack.
+ *
+ * @param us Slack in microseconds, 0 programs every deadline exactly.
+ */
+void sched_set_slack(uint64_t us);
+
+/**
+ * @brief Enable or disable the directed yield on WFE.
+ *
+ * Enabled by default. While disabled WFE is not trapped and spinning
+ * vCPUs keep the CPU until their slice ends.
+ *
+ * @param enable Non-zero to trap WFE while a sibling vCPU is runnable.
+ */
+void sched_set_yield(int enable);
+
+/**
+ * @brief Pick the timer expiry that serves the earliest deadline.
+ *
+ * Deadlines up to slack after the earliest one are served by the same
+ * expiry, which is the latest of them.
+ *
+ * @param deadlines Absolute counter values.
+ * @param num Number of deadlines.
+ * @param slack Coalescing window in counter ticks.
+ * @param served Receives the number of deadlines served by the expiry.
+ * @return The expiry, or SCHED_NO_DEADLINE if num is 0.
+ */
+uint64_t sched_coalesce(const uint64_t* deadlines, uint32_t num, uint64_t slack, uint32_t* served);
+
+/**
+ * @brief Get the counters of a physical CPU.
+ *
+ * @param cpu The physical CPU number.
+ * @param stats Receives a copy of the counters.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t sched_get_stats(uint32_t cpu, sched_stats_t* stats);
+
+/**
+ * @brief Log idle residency and wakeup counters of every scheduling CPU.
+ */
+void sched_report(void);
+
+#endif // SCHED_H
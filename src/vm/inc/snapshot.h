@@ -0,0 +1,143 @@
+/**
+ * @file snapshot.h
+ * @brief Full and incremental VM snapshots.
+ *
+ * This file contains the snapshot file format and the function prototypes
+ * to save a VM to, and restore it from, a file on the debug host.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A full snapshot starts dirty logging and writes every resident page. A
+ * delta snapshot only writes the pages dirtied since the previous snapshot
+ * of either kind, so its cost is proportional to the guest's write working
+ * set rather than to its RAM size. Restoring a full snapshot followed by
+ * its deltas, in order, rebuilds the VM.
+ *
+ * A file is a snapshot_header_t, one vCPU record (trap_frame_t followed by
+ * vcpu_el1_t) per vCPU, then a list of snapshot_run_t records. A run
+ * covers consecutive pages and is followed by their contents, unless it is
+ * flagged SNAPSHOT_RUN_ZERO. A run of zero pages ends the file.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Snapshot file format and function prototypes.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "status.h"
+#include "vm.h"
+
+#define SNAPSHOT_MAGIC   (0x4E534C48U) /**< "HLSN" */
+#define SNAPSHOT_VERSION (1U)          /**< File format version */
+
+#define SNAPSHOT_RUN_ZERO (1U << 0) /**< Pages of the run read as zero, no data follows */
+
+#define SNAPSHOT_STAGING_SIZE (0x10000ULL) /**< Bytes moved per semihosting request */
+
+/**
+ * @brief Kind of snapshot.
+ */
+typedef enum snapshot_type
+{
+    SNAPSHOT_FULL  = 0, /**< all resident pages, restarts dirty logging */
+    SNAPSHOT_DELTA = 1, /**< pages dirtied since the previous snapshot */
+} snapshot_type_t;
+
+/**
+ * @brief Snapshot file header.
+ */
+typedef struct snapshot_header
+{
+    uint32_t magic;     /**< SNAPSHOT_MAGIC */
+    uint16_t version;   /**< SNAPSHOT_VERSION */
+    uint16_t type;      /**< snapshot_type_t */
+    uint32_t vm_id;     /**< VM identifier */
+    uint32_t num_vcpus; /**< vCPU records that follow */
+    uint64_t ram_ipa;   /**< start IPA of guest RAM */
+    uint64_t ram_size;  /**< size of guest RAM in bytes */
+    uint64_t sequence;  /**< 1 for a full snapshot, incremented by each delta */
+    uint64_t pages;     /**< pages described by the runs */
+} snapshot_header_t;
+
+/**
+ * @brief Header of a run of consecutive guest pages.
+ */
+typedef struct snapshot_run
+{
+    uint64_t ipa;   /**< IPA of the first page */
+    uint32_t pages; /**< pages in the run, 0 ends the file */
+    uint32_t flags; /**< SNAPSHOT_RUN_* */
+} snapshot_run_t;
+
+/**
+ * @brief Cost of a snapshot.
+ */
+typedef struct snapshot_stats
+{
+    uint64_t data_pages; /**< pages written with their contents */
+    uint64_t zero_pages; /**< pages recorded as discarded */
+    uint64_t runs;       /**< run records */
+    uint64_t bytes;      /**< file size */
+    uint64_t ticks;      /**< time taken, in counter ticks */
+} snapshot_stats_t;
+
+/**
+ * @brief Save a VM to a host file.
+ *
+ * Pauses the VM's vCPUs for the duration of the save. May be called from
+ * the trap of one of them, whose live EL1 registers are saved.
+ *
+ * @param vm The VM.
+ * @param path Host file name, overwritten.
+ * @param type SNAPSHOT_FULL or SNAPSHOT_DELTA.
+ * @param stats Receives the cost of the snapshot, may be NULL.
+ * @return STATUS_OK, STATUS_ERR_INVALID for a delta without a previous
+ *         full snapshot, STATUS_ERR_BUSY, STATUS_ERR_NO_MEMORY or
+ *         STATUS_ERR_IO.
+ */
+status_t snapshot_save(vm_t* vm, const char* path, snapshot_type_t type, snapshot_stats_t* stats);
+
+/**
+ * @brief Restore a VM from a host file.
+ *
+ * Dirty logging is stopped, take a full snapshot to start a new chain.
+ * A full snapshot discards all guest RAM first, a delta applies on top of
+ * the current contents and must be the one that follows the snapshot
+ * restored last. Pauses the VM's vCPUs like snapshot_save().
+ *
+ * @param vm A VM created with the same RAM layout and vCPU count.
+ * @param path Host file name.
+ * @return STATUS_OK, STATUS_ERR_INVALID if the file does not match the
+ *         VM or does not follow the snapshot restored last,
+ *         STATUS_ERR_BUSY, STATUS_ERR_NO_MEMORY or STATUS_ERR_IO.
+ */
+status_t snapshot_restore(vm_t* vm, const char* path);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,338 @@
+/**
+ * @file vm.h
+ * @brief Virtual machine and vCPU management.
+ *
+ * This file contains the VM and vCPU structures together with the
+ * function prototypes to create VMs, register emulated MMIO regions and
+ * run vCPUs.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * VM and vCPU structures are owned by the caller, the VM module never
+ * allocates them. The trap frame is the first member of a vCPU so that
+ * TPIDR_EL2 can point to both (see vectors.s).
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * VM and vCPU structures and function prototypes.
+ */
+
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+
+#include "gmem.h"
+#include "stage2.h"
+#include "status.h"
+#include "sync.h"
+#include "sysreg.h"
+#include "trap.h"
+#include "vgic.h"
+#include "xlate.h"
+
+#define VM_MAX_VCPUS        (4U) /**< vCPUs per VM */
+#define VM_MAX_MMIO_REGIONS (4U) /**< Emulated MMIO regions per VM */
+#define VM_MAX_CHANNELS     (4U) /**< Inter-VM channels per VM */
+
+struct vm;
+struct channel;
+
+/**
+ * @brief Callbacks of an emulated MMIO region.
+ */
+typedef struct vm_mmio_ops
+{
+    uint64_t (*read)(void* opaque, uint64_t offset, uint32_t size);                /**< guest load */
+    void (*write)(void* opaque, uint64_t offset, uint32_t size, uint64_t value);    /**< guest store */
+} vm_mmio_ops_t;
+
+/**
+ * @brief An emulated MMIO region of a VM.
+ */
+typedef struct vm_mmio_region
+{
+    uint64_t             base;   /**< start IPA */
+    uint64_t             size;   /**< size in bytes */
+    const vm_mmio_ops_t* ops;    /**< access callbacks */
+    void*                opaque; /**< passed to the callbacks */
+} vm_mmio_region_t;
+
+/**
+ * @brief EL1 system register state of a vCPU.
+ *
+ * Only meaningful while the vCPU is not loaded on a physical CPU, see
+ * vcpu_el1_save() and vcpu_el1_restore().
+ */
+typedef struct vcpu_el1
+{
+    uint64_t sctlr;      /**< SCTLR_EL1 */
+    uint64_t ttbr0;      /**< TTBR0_EL1 */
+    uint64_t ttbr1;      /**< TTBR1_EL1 */
+    uint64_t tcr;        /**< TCR_EL1 */
+    uint64_t mair;       /**< MAIR_EL1 */
+    uint64_t amair;      /**< AMAIR_EL1 */
+    uint64_t vbar;       /**< VBAR_EL1 */
+    uint64_t contextidr; /**< CONTEXTIDR_EL1 */
+    uint64_t tpidr_el0;  /**< TPIDR_EL0 */
+    uint64_t tpidrro;    /**< TPIDRRO_EL0 */
+    uint64_t tpidr;      /**< TPIDR_EL1 */
+    uint64_t sp_el0;     /**< SP_EL0 */
+    uint64_t sp_el1;     /**< SP_EL1 */
+    uint64_t elr;        /**< ELR_EL1 */
+    uint64_t spsr;       /**< SPSR_EL1 */
+    uint64_t esr;        /**< ESR_EL1 */
+    uint64_t far;        /**< FAR_EL1 */
+    uint64_t afsr0;      /**< AFSR0_EL1 */
+    uint64_t afsr1;      /**< AFSR1_EL1 */
+    uint64_t par;        /**< PAR_EL1 */
+    uint64_t cpacr;      /**< CPACR_EL1 */
+    uint64_t csselr;     /**< CSSELR_EL1 */
+    uint64_t cntkctl;    /**< CNTKCTL_EL1 */
+    uint64_t cntv_ctl;   /**< CNTV_CTL_EL0 */
+    uint64_t cntv_cval;  /**< CNTV_CVAL_EL0 */
+} vcpu_el1_t;
+
+/**
+ * @brief Scheduling state of a vCPU.
+ */
+typedef enum vcpu_state
+{
+    VCPU_STATE_OFFLINE     = 0, /**< not in a run queue */
+    VCPU_STATE_RUNNABLE    = 1, /**< running or waiting for its physical CPU */
+    VCPU_STATE_BLOCKED     = 2, /**< waiting in WFI, not loaded */
+    VCPU_STATE_POWERED_OFF = 3, /**< in a run queue, waiting for PSCI CPU_ON */
+    VCPU_STATE_STARTING    = 4, /**< being reset by PSCI CPU_ON */
+} vcpu_state_t;
+
+/**
+ * @brief A virtual CPU.
+ */
+typedef struct vcpu
+{
+    trap_frame_t  ctx;        /**< guest registers, must stay the first member */
+    struct vm*    vm;         /**< owning VM */
+    uint32_t      id;         /**< index within the VM */
+    uint32_t      state;      /**< vcpu_state_t, changed atomically */
+    uint32_t      cpu;        /**< physical CPU whose run queue holds the vCPU */
+    uint32_t      preempted;  /**< taken off its CPU while runnable, a likely lock holder */
+    uint32_t      yield_trap; /**< trap WFE, a runnable sibling waits for this CPU */
+    vgic_state_t  vgic;       /**< pending virtual interrupts */
+    vcpu_el1_t    el1;        /**< EL1 system registers while not loaded */
+    xlate_cache_t xlate;      /**< recent guest address translations */
+} vcpu_t;
+
+/**
+ * @brief Called when a vCPU powers its VM off.
+ *
+ * The guest's registers are still in vcpu->ctx. If the hook resets the
+ * vCPU and returns, the guest resumes from the new state.
+ */
+typedef void (*vm_shutdown_fn_t)(vcpu_t* vcpu);
+
+/**
+ * @brief Hypercall counters of a VM.
+ */
+typedef struct vm_hypercall_stats
+{
+    uint64_t calls;       /**< hypercalls taken, each one a guest exit */
+    uint64_t multicalls;  /**< batched hypercalls */
+    uint64_t batched_ops; /**< operations executed from batches */
+    uint64_t rejected;    /**< batches refused by validation */
+} vm_hypercall_stats_t;
+
+/**
+ * @brief A virtual machine.
+ */
+typedef struct vm
+{
+    uint32_t             id;                        /**< VM identifier, also used as VMID */
+    stage2_t             s2;                        /**< stage-2 translation */
+    sync_ticket_t        s2_lock;                   /**< serializes stage-2 updates of guest RAM */
+    uint64_t             ram_ipa;                   /**< start IPA of guest RAM */
+    uint64_t             ram_size;                  /**< size of guest RAM in bytes */
+    gmem_stats_t         mem_stats;                 /**< demand paging counters */
+    gmem_dirty_log_t     dirty;                     /**< dirty page log */
+    gmem_compact_t       compact;                   /**< huge page compaction state */
+    vcpu_t               vcpus[VM_MAX_VCPUS];       /**< virtual CPUs */
+    uint32_t             num_vcpus;                 /**< vCPUs in use */
+    vm_mmio_region_t     mmio[VM_MAX_MMIO_REGIONS]; /**< emulated MMIO regions */
+    uint32_t             num_mmio;                  /**< MMIO regions in use */
+    struct channel*      channels[VM_MAX_CHANNELS]; /**< inter-VM channels, by index */
+    uint32_t             num_channels;              /**< channels in use */
+    vm_hypercall_stats_t hc_stats;                  /**< hypercall counters */
+    vm_shutdown_fn_t     on_shutdown;               /**< power-off hook, NULL halts the core */
+    uint32_t             tlbi_gen;                  /**< bumped by every trapped guest TLBI */
+    uint32_t             xlate_trap;                /**< trap guest TLBIs, a vCPU caches VA translations */
+    uint32_t             paused;                    /**< held off every CPU by sched_pause() */
+    uint64_t             snapshot_seq;              /**< sequence of the snapshot restored last, 0 if none */
+} vm_t;
+
+/**
+ * @brief Create a VM.
+ *
+ * Guest RAM is not backed yet, frames are allocated on first touch.
+ *
+ * @param vm The VM to initialize.
+ * @param id VM identifier, must be non-zero.
+ * @param ram_ipa Page aligned start IPA of guest RAM.
+ * @param ram_size Page aligned size of guest RAM.
+ * @param num_vcpus Number of vCPUs.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY.
+ */
+status_t vm_init(vm_t* vm, uint32_t id, uint64_t ram_ipa, uint64_t ram_size, uint32_t num_vcpus);
+
+/**
+ * @brief Register an emulated MMIO region.
+ *
+ * @param vm The VM.
+ * @param base Start IPA of the region.
+ * @param size Size of the region in bytes.
+ * @param ops Access callbacks.
+ * @param opaque Passed to the callbacks.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY.
+ */
+status_t vm_mmio_register(vm_t* vm, uint64_t base, uint64_t size, const vm_mmio_ops_t* ops, void* opaque);
+
+/**
+ * @brief Access an emulated MMIO register on behalf of a vCPU.
+ *
+ * @param vm The VM.
+ * @param ipa The register IPA.
+ * @param size Access size in bytes (1, 2, 4 or 8).
+ * @param write Non-zero for a store.
+ * @param value Value to store, or receives the loaded value.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NOT_FOUND if no
+ *         region covers the IPA.
+ */
+status_t vm_mmio_access(vm_t* vm, uint64_t ipa, uint32_t size, int write, uint64_t* value);
+
+/**
+ * @brief Handle a stage-2 abort taken by a vCPU.
+ *
+ * Populates guest RAM on first touch and emulates accesses to registered
+ * MMIO regions.
+ *
+ * @param vcpu The faulting vCPU.
+ * @param esr The exception syndrome.
+ * @param ipa The faulting IPA.
+ * @return STATUS_OK if the guest can be resumed.
+ */
+status_t vm_handle_abort(vcpu_t* vcpu, uint64_t esr, uint64_t ipa);
+
+/**
+ * @brief Raise a virtual interrupt in a VM.
+ *
+ * The interrupt is delivered to the first vCPU, which is woken if it is
+ * waiting in WFI.
+ *
+ * @param vm The VM.
+ * @param intid The virtual interrupt ID.
+ */
+void vm_irq_raise(vm_t* vm, uint32_t intid);
+
+/**
+ * @brief Power off the VM of a vCPU at the guest's request.
+ *
+ * Runs the VM's on_shutdown hook. Without one the vCPU leaves its run
+ * queue and the physical CPU moves on to other work.
+ *
+ * @param vcpu The requesting vCPU.
+ */
+void vm_shutdown(vcpu_t* vcpu);
+
+/**
+ * @brief Set the entry state of a vCPU.
+ *
+ * @param vcpu The vCPU.
+ * @param entry Guest entry point (IPA).
+ * @param arg Value passed in x0.
+ */
+void vcpu_reset(vcpu_t* vcpu, uint64_t entry, uint64_t arg);
+
+/**
+ * @brief Save the EL1 system registers of the loaded vCPU.
+ *
+ * @param vcpu The vCPU currently loaded on the calling physical CPU.
+ */
+void vcpu_el1_save(vcpu_t* vcpu);
+
+/**
+ * @brief Load the EL1 system registers of a vCPU.
+ *
+ * @param vcpu The vCPU to load on the calling physical CPU.
+ */
+void vcpu_el1_restore(const vcpu_t* vcpu);
+
+/**
+ * @brief Make a vCPU the one loaded on the calling physical CPU.
+ *
+ * Restores its EL1 registers, virtual CPU interface and stage-2 context
+ * and points TPIDR_EL2 at it.
+ *
+ * @param vcpu The vCPU, no other vCPU may be loaded.
+ */
+void vcpu_load(vcpu_t* vcpu);
+
+/**
+ * @brief Bring the trap configuration of the loaded vCPU up to date.
+ *
+ * Guest TLB maintenance is trapped while any vCPU of the VM caches
+ * guest virtual address translations, see xlate_va(). WFE is trapped
+ * while the scheduler has a sibling vCPU to yield to, see sched_yield().
+ *
+ * @param vcpu The vCPU loaded on the calling physical CPU.
+ */
+void vcpu_sync_traps(vcpu_t* vcpu);
+
+/**
+ * @brief Unload the vCPU loaded on the calling physical CPU.
+ *
+ * Saves its EL1 registers and virtual CPU interface, stops its virtual
+ * timer from firing and clears TPIDR_EL2.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void vcpu_put(vcpu_t* vcpu);
+
+/**
+ * @brief Run a vCPU on the calling physical CPU.
+ *
+ * @param vcpu The vCPU.
+ */
+void vcpu_run(vcpu_t* vcpu) __attribute__((noreturn));
+
+/**
+ * @brief Get the vCPU running on the calling physical CPU.
+ *
+ * @return The current vCPU, or NULL outside of guest context.
+ */
+static inline vcpu_t* vcpu_current(void)
+{
+    return (vcpu_t*)(uintptr_t)SYSREG_READ(tpidr_el2);
+}
+
+#endif // VM_H
@@ -0,0 +1,189 @@
+/**
+ * @file vm_config.h
+ * @brief Static VM configuration.
+ *
+ * This file contains the types of the VM configuration tables generated at
+ * build time, the statically allocated VM instances and the function
+ * prototypes to bring the configured VMs up.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The VMs to run are declared in config/vm_config.cmake. At configure time
+ * cmake/vm_config.cmake checks the layout and generates const tables of the
+ * types below, together with .bss arrays sized for exactly the configured
+ * VMs, channels and devices. Boot walks the tables; there is no parsing and
+ * no heap allocation. Stage-2 tables and channel pages still come from the
+ * frame allocator.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Static VM configuration types and function prototypes.
+ */
+
+#ifndef VM_CONFIG_H
+#define VM_CONFIG_H
+
+#include <stdint.h>
+
+#include "channel.h"
+#include "passthrough.h"
+#include "status.h"
+#include "virtio_balloon.h"
+#include "vm.h"
+#include "vm_config_gen.h"
+
+/**
+ * @brief Stage-2 attributes of a configured region.
+ */
+typedef enum vm_config_region_type
+{
+    VM_CONFIG_REGION_NORMAL   = 0, /**< Normal memory, read-write */
+    VM_CONFIG_REGION_READONLY = 1, /**< Normal memory, read-only */
+    VM_CONFIG_REGION_DEVICE   = 2, /**< Device-nGnRE, read-write */
+} vm_config_region_type_t;
+
+/**
+ * @brief Emulated device types.
+ */
+typedef enum vm_config_device_type
+{
+    VM_CONFIG_DEVICE_VIRTIO_BALLOON = 0, /**< virtio-mmio memory balloon */
+} vm_config_device_type_t;
+
+/**
+ * @brief A physical range mapped into a VM at boot.
+ */
+typedef struct vm_config_region
+{
+    uint64_t                ipa;  /**< guest start address */
+    uint64_t                pa;   /**< physical start address */
+    uint64_t                size; /**< size in bytes */
+    vm_config_region_type_t type; /**< stage-2 attributes */
+} vm_config_region_t;
+
+/**
+ * @brief An emulated device attached to a VM.
+ */
+typedef struct vm_config_device
+{
+    vm_config_device_type_t type;     /**< device type */
+    uint64_t                base;     /**< IPA of the register window */
+    uint32_t                irq;      /**< virtual interrupt ID */
+    uint32_t                instance; /**< index into the instance array of the type */
+} vm_config_device_t;
+
+/**
+ * @brief A physical device assigned to a VM.
+ */
+typedef struct vm_config_passthrough
+{
+    uint64_t ipa;      /**< guest address of the register window */
+    uint64_t pa;       /**< physical address of the register window */
+    uint64_t size;     /**< size in bytes */
+    uint32_t irq;      /**< forwarded SPI, or PASSTHROUGH_NO_IRQ */
+    uint32_t instance; /**< index into vm_config_passthroughs */
+} vm_config_passthrough_t;
+
+/**
+ * @brief A configured VM.
+ */
+typedef struct vm_config
+{
+    const char*                    name;             /**< name used in the configuration file */
+    uint32_t                       id;               /**< VM ID, also the VMID */
+    uint32_t                       num_vcpus;        /**< vCPUs to create */
+    uint64_t                       ram_ipa;          /**< start of demand-paged RAM */
+    uint64_t                       ram_size;         /**< size of demand-paged RAM */
+    uint64_t                       entry;            /**< entry point of every vCPU */
+    const vm_config_region_t*      regions;          /**< mapped physical ranges */
+    uint32_t                       num_regions;      /**< entries in regions */
+    const vm_config_device_t*      devices;          /**< emulated devices */
+    uint32_t                       num_devices;      /**< entries in devices */
+    const vm_config_passthrough_t* passthroughs;     /**< assigned physical devices */
+    uint32_t                       num_passthroughs; /**< entries in passthroughs */
+} vm_config_t;
+
+/**
+ * @brief One side of a configured channel.
+ */
+typedef struct vm_config_endpoint
+{
+    uint32_t vm;  /**< index into vm_config_table */
+    uint64_t ipa; /**< channel IPA in that VM */
+    uint32_t irq; /**< doorbell interrupt ID */
+} vm_config_endpoint_t;
+
+/**
+ * @brief A configured channel.
+ */
+typedef struct vm_config_channel
+{
+    vm_config_endpoint_t ep[2]; /**< the two endpoints */
+} vm_config_channel_t;
+
+#if VM_CONFIG_NUM_VMS > 0
+extern const vm_config_t vm_config_table[VM_CONFIG_NUM_VMS]; /**< Configured VMs */
+extern vm_t              vm_config_vms[VM_CONFIG_NUM_VMS];   /**< VM instances, in table order */
+#endif
+
+#if VM_CONFIG_NUM_CHANNELS > 0
+extern const vm_config_channel_t vm_config_channel_table[VM_CONFIG_NUM_CHANNELS]; /**< Configured channels */
+extern channel_t                 vm_config_channels[VM_CONFIG_NUM_CHANNELS];      /**< Channel instances */
+#endif
+
+#if VM_CONFIG_NUM_BALLOONS > 0
+extern virtio_balloon_t vm_config_balloons[VM_CONFIG_NUM_BALLOONS]; /**< Balloon instances */
+#endif
+
+#if VM_CONFIG_NUM_PASSTHROUGHS > 0
+extern passthrough_t vm_config_passthroughs[VM_CONFIG_NUM_PASSTHROUGHS]; /**< Passthrough instances */
+#endif
+
+/**
+ * @brief Create every configured VM.
+ *
+ * Initializes the VMs, maps their regions, attaches their emulated and
+ * passthrough devices, creates the channels between them and resets all
+ * vCPUs to their entry point.
+ * The frame allocator must be initialized.
+ *
+ * @return STATUS_OK or the first error, which is logged.
+ */
+status_t vm_config_launch(void);
+
+/**
+ * @brief Place the vCPUs of every VM with a guest image on CPUs.
+ *
+ * vCPU k of the n-th configured VM goes to the run queue of physical CPU
+ * (n + k) modulo SMP_MAX_CPUS. vCPU 0 is runnable, the others stay
+ * powered off until the guest starts them with PSCI CPU_ON. VMs without
+ * an image at their entry point are skipped.
+ *
+ * @return The number of vCPUs placed.
+ */
+uint32_t vm_config_schedule(void);
+
+#endif // VM_CONFIG_H
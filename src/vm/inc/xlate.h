@@ -0,0 +1,165 @@
+/**
+ * @file xlate.h
+ * @brief Guest address translation with a per-vCPU cache.
+ *
+ * This file contains the function prototypes to turn guest virtual and
+ * intermediate physical addresses into physical addresses and hypervisor
+ * pointers for emulation code.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Virtual addresses of the loaded vCPU are translated by the hardware with
+ * AT S12E1R; other vCPUs, aborted translations and the native host build
+ * use a software walker of the guest's stage-1 tables (4KB granule) and
+ * the VM's stage-2 tables. Successful translations are kept in a small
+ * round-robin cache per vCPU, so repeated emulation on the same guest page
+ * skips the walk. The cache is dropped whenever the stage-2 regime is
+ * invalidated, the guest issues a TLBI or its stage-1 context changes.
+ * Guest TLBIs are only trapped while some vCPU of the VM caches virtual
+ * address translations.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Guest address translation function prototypes and cache layout.
+ */
+
+#ifndef XLATE_H
+#define XLATE_H
+
+#include <stdint.h>
+
+#include "status.h"
+
+#define XLATE_CACHE_SIZE (8U) /**< Translations cached per vCPU */
+
+struct vcpu;
+
+/**
+ * @brief A cached translation of one guest page.
+ */
+typedef struct xlate_entry
+{
+    uint64_t tag; /**< page address of the input, XLATE_TAG_* flags in the low bits */
+    uint64_t pa;  /**< page address of the output */
+} xlate_entry_t;
+
+/**
+ * @brief Translation counters of a vCPU.
+ */
+typedef struct xlate_stats
+{
+    uint64_t hits;     /**< translations served from the cache */
+    uint64_t misses;   /**< translations that needed a walk */
+    uint64_t at_walks; /**< walks done by the hardware */
+    uint64_t sw_walks; /**< walks done in software */
+    uint64_t flushes;  /**< times the cache was dropped */
+} xlate_stats_t;
+
+/**
+ * @brief Per-vCPU translation cache.
+ */
+typedef struct xlate_cache
+{
+    xlate_entry_t entry[XLATE_CACHE_SIZE]; /**< cached translations */
+    uint32_t      next;                    /**< entry replaced by the next miss */
+    uint32_t      s2_gen;                  /**< stage-2 generation the entries belong to */
+    uint32_t      tlbi_gen;                /**< guest TLBI generation the entries belong to */
+    uint64_t      ttbr0;                   /**< stage-1 context of the virtual address entries */
+    uint64_t      ttbr1;                   /**< TTBR1_EL1 of that context */
+    uint64_t      tcr;                     /**< TCR_EL1 of that context */
+    uint64_t      sctlr;                   /**< SCTLR_EL1 of that context */
+    xlate_stats_t stats;                   /**< translation counters */
+} xlate_cache_t;
+
+/**
+ * @brief Translate a guest IPA.
+ *
+ * @param vcpu The vCPU on whose behalf the translation is done.
+ * @param ipa The IPA.
+ * @param pa Receives the physical address.
+ * @return STATUS_OK or STATUS_ERR_NOT_FOUND if the IPA is not mapped.
+ */
+status_t xlate_ipa(struct vcpu* vcpu, uint64_t ipa, uint64_t* pa);
+
+/**
+ * @brief Translate a guest virtual address through both stages.
+ *
+ * Uses the vCPU's current EL1 translation regime. Permissions are not
+ * checked.
+ *
+ * @param vcpu The vCPU on whose behalf the translation is done.
+ * @param va The guest virtual address.
+ * @param pa Receives the physical address.
+ * @return STATUS_OK, STATUS_ERR_NOT_FOUND if either stage does not map
+ *         the address, or STATUS_ERR_NOT_SUPPORTED if the guest uses a
+ *         granule other than 4KB.
+ */
+status_t xlate_va(struct vcpu* vcpu, uint64_t va, uint64_t* pa);
+
+/**
+ * @brief Get a hypervisor pointer to resident guest RAM by IPA.
+ *
+ * @param vcpu The vCPU on whose behalf the access is done.
+ * @param ipa Start IPA.
+ * @param len Length of the access, must not cross a page.
+ * @return Pointer to the memory, or NULL if the range is not resident
+ *         guest RAM.
+ */
+void* xlate_ipa_to_host(struct vcpu* vcpu, uint64_t ipa, uint64_t len);
+
+/**
+ * @brief Get a hypervisor pointer to guest memory by virtual address.
+ *
+ * @param vcpu The vCPU on whose behalf the access is done.
+ * @param va Start guest virtual address.
+ * @param len Length of the access, must not cross a page.
+ * @return Pointer to the memory, or NULL if the range is not mapped to
+ *         normal memory.
+ */
+void* xlate_va_to_host(struct vcpu* vcpu, uint64_t va, uint64_t len);
+
+/**
+ * @brief Drop all cached translations of a vCPU.
+ *
+ * @param vcpu The vCPU.
+ */
+void xlate_flush(struct vcpu* vcpu);
+
+/**
+ * @brief Handle a trapped guest TLB maintenance instruction.
+ *
+ * Drops the cached translations of every vCPU of the VM, performs the
+ * invalidation on the guest's behalf and stops trapping TLBIs until a
+ * virtual address translation is cached again.
+ *
+ * @param vcpu The trapping vCPU.
+ * @param esr The exception syndrome (EC 0x18).
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the trapped
+ *         instruction is not a TLBI.
+ */
+status_t xlate_handle_tlbi(struct vcpu* vcpu, uint64_t esr);
+
+#endif // XLATE_H
@@ -0,0 +1,856 @@
+/**
+ * @file gmem.c
+ * @brief Demand paged guest memory.
+ *
+ * This file contains the implementation of guest RAM population on first
+ * touch and of page release for the balloon device.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Frames handed to a guest always come from frame_alloc_zeroed(), so no
+ * data leaks between VMs. Fault latency is measured with the physical
+ * counter from entry of gmem_handle_fault() until the new mapping is
+ * visible.
+ *
+ * While dirty logging is on, resident pages are mapped read-only. A guest
+ * write raises a stage-2 permission fault, which sets the page's bit and
+ * restores write access to that single page, splitting the block that
+ * maps it first.
+ *
+ * Compaction never runs while dirty logging is on. It resumes at a cursor
+ * so one step stays short, and stops sweeping once every 2MB region was
+ * found ineligible until a page is populated again.
+ *
+ * Every update of the guest RAM translation, and every lookup that decides
+ * one, holds vm->s2_lock. A vCPU faulting on a region that compaction is
+ * folding or copying waits for the block instead of walking into a level 3
+ * table that is about to be freed, and two vCPUs faulting on one page map
+ * it once. Compaction only tries the lock, an idle CPU never waits for a
+ * vCPU's fault. Host pointers from gmem_ipa_to_host() are used under a
+ * gmem_pin(), which holds compaction off so no frame behind one is freed.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of demand paged guest memory.
+ */
+
+/* this module's header */
+#include "gmem.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "frame.h"
+#include "logging.h"
+#include "stage2.h"
+#include "sync.h"
+#include "sysreg.h"
+#include "trap.h"
+#include "vm.h"
+
+#define GMEM_PREZERO_BATCH (FRAME_ZEROED_LOW)              /**< Frames zeroed ahead of the first faults */
+#define GMEM_BLOCK_PAGES   (STAGE2_BLOCK_2M >> FRAME_SHIFT) /**< Pages in a 2MB block */
+
+/**
+ * @brief Leaf scan of a 2MB region before migration.
+ */
+typedef struct gmem_scan
+{
+    uint64_t attr;  /**< attributes of the first page */
+    uint64_t pages; /**< pages with those attributes */
+} gmem_scan_t;
+
+/**
+ * @brief Copy of a 2MB region into an aligned frame run.
+ */
+typedef struct gmem_copy
+{
+    uint64_t ipa; /**< first IPA of the region */
+    uint64_t pa;  /**< first frame of the run */
+} gmem_copy_t;
+
+/**
+ * @brief Record a write to a guest page in the dirty log.
+ *
+ * @param vm The VM.
+ * @param page Page aligned IPA within guest RAM.
+ */
+static void gmem_mark_dirty(struct vm* vm, uint64_t page)
+{
+    uint64_t index = (page - vm->ram_ipa) >> FRAME_SHIFT; /* Page number within guest RAM */
+
+    if (NULL != vm->dirty.bitmap)
+    {
+        __atomic_fetch_or(&vm->dirty.bitmap[index / 64], 1ULL << (index % 64), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Leaf callback marking every page of a mapping dirty.
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor.
+ * @param arg The VM.
+ */
+static void gmem_mark_leaf(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg)
+{
+    struct vm* vm = (struct vm*)arg; /* Owning VM */
+
+    (void)pte;
+
+    for (uint64_t page = ipa; page < ipa + size; page += FRAME_SIZE)
+    {
+        if (gmem_contains(vm, page))
+        {
+            gmem_mark_dirty(vm, page);
+        }
+    }
+}
+
+/**
+ * @brief Leaf callback freeing the frames of a mapping.
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor.
+ * @param arg Unused.
+ */
+static void gmem_free_leaf(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg)
+{
+    (void)ipa;
+    (void)arg;
+
+    frame_free_contig(*pte & S2_PTE_ADDR_MASK, size >> FRAME_SHIFT);
+}
+
+/**
+ * @brief Leaf callback counting the pages of a region that share the
+ *        attributes of its first page.
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor.
+ * @param arg The scan.
+ */
+static void gmem_scan_leaf(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg)
+{
+    gmem_scan_t* scan = (gmem_scan_t*)arg;       /* Scan so far */
+    uint64_t     attr = *pte & S2_PTE_ATTR_MASK; /* Attributes of the leaf */
+
+    (void)ipa;
+
+    if (0 == scan->pages)
+    {
+        scan->attr = attr;
+    }
+    if ((FRAME_SIZE == size) && (attr == scan->attr))
+    {
+        scan->pages++;
+    }
+}
+
+/**
+ * @brief Leaf callback copying a page into the frame run of its region.
+ *
+ * @param ipa First IPA mapped by the leaf.
+ * @param size Bytes mapped by the leaf.
+ * @param pte The leaf descriptor.
+ * @param arg The copy.
+ */
+static void gmem_copy_leaf(uint64_t ipa, uint64_t size, mmu_pte_t* pte, void* arg)
+{
+    const gmem_copy_t* copy = (const gmem_copy_t*)arg; /* Region and run */
+
+    memcpy((void*)(uintptr_t)(copy->pa + (ipa - copy->ipa)), (const void*)(uintptr_t)(*pte & S2_PTE_ADDR_MASK), size);
+}
+
+/**
+ * @brief Copy a fully populated 2MB region into an aligned frame run and
+ *        map it with one block.
+ *
+ * Called with vm->s2_lock held.
+ *
+ * @param vm The VM.
+ * @param ipa First IPA of the region.
+ * @return STATUS_OK, STATUS_ERR_NOT_SUPPORTED if the region has holes or
+ *         mixed permissions, or STATUS_ERR_NO_MEMORY.
+ */
+static status_t gmem_migrate(struct vm* vm, uint64_t ipa)
+{
+    gmem_scan_t scan   = { 0 };     /* Pages of the region */
+    gmem_copy_t copy   = { 0 };     /* Copy of the region */
+    status_t    status = STATUS_OK; /* Fold status */
+
+    stage2_for_each_leaf(&vm->s2, ipa, STAGE2_BLOCK_2M, gmem_scan_leaf, &scan);
+    if (GMEM_BLOCK_PAGES != scan.pages)
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    copy.ipa = ipa;
+    copy.pa  = frame_alloc_aligned(GMEM_BLOCK_PAGES);
+    if (0x0ULL == copy.pa)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    /* Hold off writes while the pages are copied */
+    stage2_protect(&vm->s2, ipa, STAGE2_BLOCK_2M, S2_PTE_S2AP_W, 0x0ULL);
+    stage2_tlb_flush_range(&vm->s2, ipa, STAGE2_BLOCK_2M);
+
+    stage2_for_each_leaf(&vm->s2, ipa, STAGE2_BLOCK_2M, gmem_copy_leaf, &copy);
+
+    status = stage2_collapse(&vm->s2, ipa, STAGE2_BLOCK_2M, copy.pa, scan.attr, gmem_free_leaf, NULL);
+    if (STATUS_OK != status)
+    {
+        stage2_protect(&vm->s2, ipa, STAGE2_BLOCK_2M, 0x0ULL, scan.attr & S2_PTE_S2AP_W);
+        stage2_tlb_flush_range(&vm->s2, ipa, STAGE2_BLOCK_2M);
+        frame_free_contig(copy.pa, GMEM_BLOCK_PAGES);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Turn a 2MB region into a block.
+ *
+ * Called with vm->s2_lock held.
+ *
+ * @param vm The VM.
+ * @param ipa First IPA of the region.
+ * @return 1 if the region is now a block, 0 otherwise.
+ */
+static uint32_t gmem_compact_region(struct vm* vm, uint64_t ipa)
+{
+    status_t status = STATUS_OK; /* Fold status */
+
+    status = stage2_promote(&vm->s2, ipa, STAGE2_BLOCK_2M);
+    if (STATUS_OK == status)
+    {
+        vm->compact.promotions++;
+    }
+    else if (STATUS_ERR_NOT_SUPPORTED == status)
+    {
+        status = gmem_migrate(vm, ipa);
+        if (STATUS_OK == status)
+        {
+            vm->compact.migrations++;
+        }
+    }
+
+    return (STATUS_OK == status) ? 1 : 0;
+}
+
+/**
+ * @brief Resolve a permission fault on guest RAM.
+ *
+ * Called with vm->s2_lock held, so compaction and the dirty log paths are
+ * done with the page. A fault that raced one of them and finds the access
+ * allowed now is stale, the guest retries it.
+ *
+ * @param vm The VM.
+ * @param ipa The faulting IPA.
+ * @param esr The exception syndrome.
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the mapping does not
+ *         allow the access and dirty logging does not explain it.
+ */
+static status_t gmem_log_write(struct vm* vm, uint64_t ipa, uint64_t esr)
+{
+    uint64_t page = ipa & FRAME_MASK;                                      /* Written page */
+    uint64_t attr = 0x0ULL;                                                /* Current attributes */
+    uint64_t need = (esr & ESR_DABT_WNR) ? S2_PTE_S2AP_W : S2_PTE_S2AP_R; /* Permission of the access */
+
+    /* Released in the meantime, the retried access populates it */
+    if (STATUS_OK != stage2_lookup(&vm->s2, page, NULL, &attr))
+    {
+        return STATUS_OK;
+    }
+
+    /* Made writable by another vCPU, by the end of a migration or of logging */
+    if (0 != (attr & need))
+    {
+        return STATUS_OK;
+    }
+
+    if ((NULL == vm->dirty.bitmap) || (S2_PTE_S2AP_W != need))
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    gmem_mark_dirty(vm, page);
+
+    /* Only the written page becomes writable, not the whole block */
+    if (STATUS_OK == stage2_split(&vm->s2, page))
+    {
+        vm->compact.splits++;
+    }
+    stage2_protect(&vm->s2, page, FRAME_SIZE, 0x0ULL, S2_PTE_S2AP_W);
+    stage2_tlb_flush_ipa(&vm->s2, page);
+
+    vm->dirty.write_faults++;
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Prepare guest memory of a VM.
+ *
+ * @param vm The VM.
+ * @return STATUS_OK.
+ */
+status_t gmem_init(struct vm* vm)
+{
+    vm->mem_stats = (gmem_stats_t){ 0 };
+    vm->compact   = (gmem_compact_t){ 0 };
+
+    /* Have frames ready for the boot-time fault burst */
+    frame_prezero(GMEM_PREZERO_BATCH);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Release all frames backing guest memory.
+ *
+ * @param vm The VM.
+ */
+void gmem_destroy(struct vm* vm)
+{
+    gmem_dirty_log_stop(vm);
+
+    sync_ticket_lock(&vm->s2_lock);
+
+    stage2_for_each_leaf(&vm->s2, vm->ram_ipa, vm->ram_size, gmem_free_leaf, NULL);
+    stage2_unmap(&vm->s2, vm->ram_ipa, vm->ram_size);
+
+    vm->mem_stats.resident_pages = 0;
+
+    sync_ticket_unlock(&vm->s2_lock);
+}
+
+/**
+ * @brief Check whether an IPA is guest RAM.
+ *
+ * @param vm The VM.
+ * @param ipa The IPA.
+ * @return Non-zero if the IPA lies in guest RAM.
+ */
+int gmem_contains(const struct vm* vm, uint64_t ipa)
+{
+    return (ipa >= vm->ram_ipa) && ((ipa - vm->ram_ipa) < vm->ram_size);
+}
+
+/**
+ * @brief Populate a guest page.
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK (also if already resident) or STATUS_ERR_NO_MEMORY.
+ */
+status_t gmem_populate(struct vm* vm, uint64_t ipa)
+{
+    uint64_t page   = ipa & FRAME_MASK; /* Faulting page */
+    uint64_t pa     = 0x0ULL;           /* Backing frame */
+    status_t status = STATUS_OK;        /* Mapping status */
+
+    if (!gmem_contains(vm, ipa))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    sync_ticket_lock(&vm->s2_lock);
+
+    /* Another vCPU may have populated the page in the meantime */
+    if (STATUS_OK == stage2_lookup(&vm->s2, page, NULL, NULL))
+    {
+        sync_ticket_unlock(&vm->s2_lock);
+        return STATUS_OK;
+    }
+
+    pa = frame_alloc_zeroed();
+    if (0x0ULL == pa)
+    {
+        sync_ticket_unlock(&vm->s2_lock);
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    status = stage2_map(&vm->s2, page, pa, FRAME_SIZE, STAGE2_MEM_NORMAL);
+    if (STATUS_ERR_EXISTS == status)
+    {
+        /* Mapped by someone else between lookup and map, which is all the fault asked for */
+        sync_ticket_unlock(&vm->s2_lock);
+        frame_free(pa);
+        return STATUS_OK;
+    }
+    if (STATUS_OK == status)
+    {
+        vm->mem_stats.resident_pages++;
+        gmem_mark_dirty(vm, page);
+
+        /* The region may have become a block candidate */
+        vm->compact.pending = 1;
+        vm->compact.swept   = 0;
+    }
+
+    sync_ticket_unlock(&vm->s2_lock);
+
+    if (STATUS_OK != status)
+    {
+        frame_free(pa);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Resolve a stage-2 fault on guest RAM.
+ *
+ * @param vm The VM.
+ * @param ipa The faulting IPA.
+ * @param esr The exception syndrome.
+ * @return STATUS_OK, STATUS_ERR_NOT_SUPPORTED for faults other than
+ *         translation faults, logged writes and stale permission faults,
+ *         or STATUS_ERR_NO_MEMORY.
+ */
+status_t gmem_handle_fault(struct vm* vm, uint64_t ipa, uint64_t esr)
+{
+    uint64_t start  = arch_counter_read(); /* Fault entry time */
+    uint64_t ticks  = 0x0ULL;              /* Fault handling time */
+    status_t status = STATUS_OK;           /* Population status */
+
+    if (ESR_FSC_PERM == ESR_FSC_TYPE(esr))
+    {
+        sync_ticket_lock(&vm->s2_lock);
+        status = gmem_log_write(vm, ipa, esr);
+        sync_ticket_unlock(&vm->s2_lock);
+        return status;
+    }
+
+    if (ESR_FSC_TRANS != ESR_FSC_TYPE(esr))
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    status = gmem_populate(vm, ipa);
+    if (STATUS_OK != status)
+    {
+        LOG_ERR("VM%u: cannot populate IPA 0x%lx (%d)\n\r", vm->id, ipa, status);
+        return status;
+    }
+
+    ticks = arch_counter_read() - start;
+
+    vm->mem_stats.faults++;
+    vm->mem_stats.fault_ticks += ticks;
+    if (ticks > vm->mem_stats.fault_ticks_max)
+    {
+        vm->mem_stats.fault_ticks_max = ticks;
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Unmap a guest page and free its frame.
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY if the
+ *         block mapping the page cannot be split.
+ */
+status_t gmem_discard(struct vm* vm, uint64_t ipa)
+{
+    uint64_t page   = ipa & FRAME_MASK; /* Discarded page */
+    uint64_t pa     = 0x0ULL;           /* Backing frame */
+    status_t status = STATUS_OK;        /* Split status */
+
+    if (!gmem_contains(vm, ipa))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    sync_ticket_lock(&vm->s2_lock);
+
+    if (STATUS_OK == stage2_lookup(&vm->s2, page, &pa, NULL))
+    {
+        /* A page inside a block can only be unmapped on its own */
+        status = stage2_split(&vm->s2, page);
+        if (STATUS_OK == status)
+        {
+            vm->compact.splits++;
+        }
+
+        if ((STATUS_OK == status) || (STATUS_ERR_EXISTS == status))
+        {
+            stage2_unmap(&vm->s2, page, FRAME_SIZE);
+            frame_free(pa);
+            vm->mem_stats.resident_pages--;
+
+            /* The page now reads as zero, which a snapshot must record */
+            gmem_mark_dirty(vm, page);
+            status = STATUS_OK;
+        }
+    }
+
+    sync_ticket_unlock(&vm->s2_lock);
+
+    return status;
+}
+
+/**
+ * @brief Take a page back from the guest (balloon inflate).
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t gmem_release(struct vm* vm, uint64_t ipa)
+{
+    status_t status = gmem_discard(vm, ipa); /* Unmap status */
+
+    if (STATUS_OK == status)
+    {
+        vm->mem_stats.ballooned_pages++;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Give a page back to the guest (balloon deflate).
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the page.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t gmem_reclaim(struct vm* vm, uint64_t ipa)
+{
+    if (!gmem_contains(vm, ipa))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    if (vm->mem_stats.ballooned_pages > 0)
+    {
+        vm->mem_stats.ballooned_pages--;
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Get a hypervisor pointer to resident guest memory.
+ *
+ * @param vm The VM.
+ * @param ipa Start IPA.
+ * @param len Length of the access, must not cross a page.
+ * @return Pointer to the memory, or NULL if not resident.
+ */
+void* gmem_ipa_to_host(struct vm* vm, uint64_t ipa, uint64_t len)
+{
+    uint64_t pa = 0x0ULL; /* Translated address */
+
+    if ((0 == len) || (((ipa & ~FRAME_MASK) + len) > FRAME_SIZE) || !gmem_contains(vm, ipa))
+    {
+        return NULL;
+    }
+
+    sync_ticket_lock(&vm->s2_lock);
+    if (STATUS_OK != stage2_lookup(&vm->s2, ipa, &pa, NULL))
+    {
+        pa = 0x0ULL;
+    }
+    sync_ticket_unlock(&vm->s2_lock);
+
+    return (void*)(uintptr_t)pa;
+}
+
+/**
+ * @brief Keep guest RAM in its frames while host pointers to it are used.
+ *
+ * @param vm The VM.
+ */
+void gmem_pin(struct vm* vm)
+{
+    (void)__atomic_fetch_add(&vm->compact.pins, 1U, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Drop a pin taken with gmem_pin().
+ *
+ * @param vm The VM.
+ */
+void gmem_unpin(struct vm* vm)
+{
+    (void)__atomic_fetch_sub(&vm->compact.pins, 1U, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Start logging writes to guest RAM.
+ *
+ * @param vm The VM.
+ * @return STATUS_OK, STATUS_ERR_BUSY if already logging or
+ *         STATUS_ERR_NO_MEMORY.
+ */
+status_t gmem_dirty_log_start(struct vm* vm)
+{
+    uint64_t pages  = vm->ram_size >> FRAME_SHIFT;                                     /* Guest pages */
+    uint64_t words  = (pages + 63ULL) / 64ULL;                                         /* Bitmap words */
+    uint64_t frames = ((words * sizeof(uint64_t)) + FRAME_SIZE - 1ULL) >> FRAME_SHIFT; /* Bitmap frames */
+    uint64_t pa     = 0x0ULL;                                                          /* Bitmap storage */
+
+    if (NULL != vm->dirty.bitmap)
+    {
+        return STATUS_ERR_BUSY;
+    }
+
+    pa = frame_alloc_contig(frames);
+    if (0x0ULL == pa)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    memset((void*)(uintptr_t)pa, 0x0, frames << FRAME_SHIFT);
+
+    sync_ticket_lock(&vm->s2_lock);
+
+    vm->dirty.bitmap       = (uint64_t*)(uintptr_t)pa;
+    vm->dirty.words        = words;
+    vm->dirty.frames       = frames;
+    vm->dirty.write_faults = 0;
+    vm->dirty.syncs        = 0;
+
+    /* Everything resident is new to the log, then catch the next write */
+    stage2_for_each_leaf(&vm->s2, vm->ram_ipa, vm->ram_size, gmem_mark_leaf, vm);
+    stage2_protect(&vm->s2, vm->ram_ipa, vm->ram_size, S2_PTE_S2AP_W, 0x0ULL);
+    stage2_tlb_flush_all(&vm->s2);
+
+    sync_ticket_unlock(&vm->s2_lock);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Stop logging writes and make guest RAM writable again.
+ *
+ * @param vm The VM.
+ */
+void gmem_dirty_log_stop(struct vm* vm)
+{
+    if (NULL == vm->dirty.bitmap)
+    {
+        return;
+    }
+
+    sync_ticket_lock(&vm->s2_lock);
+
+    stage2_protect(&vm->s2, vm->ram_ipa, vm->ram_size, 0x0ULL, S2_PTE_S2AP_W);
+    stage2_tlb_flush_all(&vm->s2);
+
+    frame_free_contig((uint64_t)(uintptr_t)vm->dirty.bitmap, vm->dirty.frames);
+    vm->dirty = (gmem_dirty_log_t){ 0 };
+
+    /* Pages split by logged writes can form blocks again */
+    vm->compact.pending = 1;
+    vm->compact.swept   = 0;
+
+    sync_ticket_unlock(&vm->s2_lock);
+}
+
+/**
+ * @brief Fetch and clear the dirty page log.
+ *
+ * @param vm The VM.
+ * @param out Receives vm->dirty.words words, bit n covers page n of guest
+ *            RAM. May be NULL to only count.
+ * @return Number of dirty pages.
+ */
+uint64_t gmem_dirty_log_sync(struct vm* vm, uint64_t* out)
+{
+    uint64_t count = 0; /* Dirty pages */
+
+    if (NULL == vm->dirty.bitmap)
+    {
+        return 0;
+    }
+
+    sync_ticket_lock(&vm->s2_lock);
+
+    for (uint64_t w = 0; w < vm->dirty.words; ++w)
+    {
+        uint64_t bits = __atomic_exchange_n(&vm->dirty.bitmap[w], 0x0ULL, __ATOMIC_RELAXED); /* Dirty pages of the word */
+
+        if (NULL != out)
+        {
+            out[w] = bits;
+        }
+
+        /* Only pages written since the last sync lost their protection */
+        while (0 != bits)
+        {
+            uint64_t page = vm->ram_ipa + ((((w * 64) + (uint64_t)__builtin_ctzll(bits))) << FRAME_SHIFT);
+
+            stage2_protect(&vm->s2, page, FRAME_SIZE, S2_PTE_S2AP_W, 0x0ULL);
+            bits &= bits - 1ULL;
+            count++;
+        }
+    }
+
+    if (0 != count)
+    {
+        stage2_tlb_flush_all(&vm->s2);
+    }
+
+    sync_ticket_unlock(&vm->s2_lock);
+
+    vm->dirty.syncs++;
+
+    return count;
+}
+
+/**
+ * @brief Record a hypervisor write to guest RAM in the dirty log.
+ *
+ * @param vm The VM.
+ * @param ipa An IPA within the written page, ignored outside guest RAM.
+ */
+void gmem_dirty_log_mark(struct vm* vm, uint64_t ipa)
+{
+    if (gmem_contains(vm, ipa))
+    {
+        gmem_mark_dirty(vm, ipa & FRAME_MASK);
+    }
+}
+
+/**
+ * @brief Run one step of the huge page compaction pass.
+ *
+ * @param vm The VM.
+ * @return Number of 2MB blocks formed, 0 or 1.
+ */
+uint32_t gmem_compact(struct vm* vm)
+{
+    uint64_t start   = (vm->ram_ipa + STAGE2_BLOCK_2M - 1ULL) & ~(STAGE2_BLOCK_2M - 1ULL); /* First whole 2MB region */
+    uint64_t end     = (vm->ram_ipa + vm->ram_size) & ~(STAGE2_BLOCK_2M - 1ULL);           /* End of the last one */
+    uint64_t regions = 0;                                                                   /* 2MB regions in guest RAM */
+    uint32_t formed  = 0;                                                                   /* Blocks formed */
+
+    if (!__atomic_load_n(&vm->compact.pending, __ATOMIC_RELAXED) || (end <= start))
+    {
+        return 0;
+    }
+
+    /* A vCPU of the VM is updating the tables, try again at the next idle */
+    if (!sync_ticket_trylock(&vm->s2_lock))
+    {
+        return 0;
+    }
+
+    /* A pin taken before a translation under the lock is seen here, see gmem_pin() */
+    if (!vm->compact.pending || (NULL != vm->dirty.bitmap) || (0 != __atomic_load_n(&vm->compact.pins, __ATOMIC_ACQUIRE)))
+    {
+        sync_ticket_unlock(&vm->s2_lock);
+        return 0;
+    }
+
+    regions = (end - start) / STAGE2_BLOCK_2M;
+
+    for (uint32_t i = 0; (i < GMEM_COMPACT_SCAN) && (0 == formed); ++i)
+    {
+        uint64_t ipa = start + ((vm->compact.next % regions) * STAGE2_BLOCK_2M); /* Region to look at */
+
+        vm->compact.next = (vm->compact.next + 1) % regions;
+
+        formed = gmem_compact_region(vm, ipa);
+        if (0 != formed)
+        {
+            vm->compact.swept = 0;
+        }
+        else if (++vm->compact.swept >= regions)
+        {
+            vm->compact.pending = 0;
+            break;
+        }
+    }
+
+    sync_ticket_unlock(&vm->s2_lock);
+
+    return formed;
+}
+
+/**
+ * @brief Log the demand paging counters of a VM.
+ *
+ * @param vm The VM.
+ */
+void gmem_report(struct vm* vm)
+{
+    const gmem_stats_t*   stats  = &vm->mem_stats;       /* Counters */
+    const gmem_compact_t* comp   = &vm->compact;         /* Compaction counters */
+    stage2_census_t       census = { 0 };                /* Leaves of guest RAM */
+    uint64_t              freq   = arch_counter_freq(); /* Counter frequency */
+    uint64_t              avg_ns = 0x0ULL;              /* Mean fault latency */
+    uint64_t              max_ns = 0x0ULL;              /* Worst fault latency */
+    uint64_t              mapped = 0x0ULL;              /* Pages mapped */
+    uint64_t              blocks = 0x0ULL;              /* Pages mapped by blocks */
+    uint64_t              pct    = 0x0ULL;              /* Share mapped by blocks */
+
+    if ((0 != stats->faults) && (0 != freq))
+    {
+        avg_ns = (stats->fault_ticks * 1000000000ULL) / (stats->faults * freq);
+        max_ns = (stats->fault_ticks_max * 1000000000ULL) / freq;
+    }
+
+    LOG_INFO("VM%u: faults=%lu avg=%luns max=%luns resident=%lu pages ballooned=%lu pages\n\r",
+             vm->id,
+             stats->faults,
+             avg_ns,
+             max_ns,
+             stats->resident_pages,
+             stats->ballooned_pages);
+
+    stage2_census(&vm->s2, vm->ram_ipa, vm->ram_size, &census);
+    blocks = (census.blocks_1g * (STAGE2_BLOCK_1G >> FRAME_SHIFT)) + (census.blocks_2m * GMEM_BLOCK_PAGES);
+    mapped = blocks + census.pages;
+    if (0 != mapped)
+    {
+        pct = (blocks * 100ULL) / mapped;
+    }
+
+    LOG_INFO("VM%u: 1G=%lu 2M=%lu 4K=%lu blocks=%lu%% promoted=%lu migrated=%lu split=%lu\n\r",
+             vm->id,
+             census.blocks_1g,
+             census.blocks_2m,
+             census.pages,
+             pct,
+             comp->promotions,
+             comp->migrations,
+             comp->splits);
+}
@@ -0,0 +1,379 @@
+/**
+ * @file hypercall.c
+ * @brief Guest hypercall interface.
+ *
+ * This file contains the implementation of the hypercall dispatcher and of
+ * batched hypercalls.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A batch is checked as a whole before any entry runs: every function ID
+ * must be batchable and every argument must name guest RAM or an emulated
+ * register. A rejected batch has no side effects; only the result fields
+ * of the offending entries are written. The entries are copied out of
+ * guest RAM once, into a per-CPU buffer, and validated and run from the
+ * copy, so another vCPU cannot change them between the two steps.
+ *
+ * Snapshot slots are host files named after the VM and the slot number,
+ * in the emulator's working directory.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the hypercall dispatcher.
+ */
+
+/* this module's header */
+#include "hypercall.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* project includes */
+#include "channel.h"
+#include "frame.h"
+#include "gmem.h"
+#include "logging.h"
+#include "sched.h"
+#include "smp.h"
+#include "snapshot.h"
+#include "stage2.h"
+#include "xlate.h"
+
+#define HYPERCALL_SLOT_PATH_MAX (32U)            /* Room for a snapshot slot file name */
+#define HYPERCALL_MPIDR_AFF     (0xFF00FFFFFFULL) /* Affinity fields of a PSCI target, Aff3 to Aff0 */
+#define HYPERCALL_NO_BATCH      (~0x0ULL)         /* Batch page of a single call, matches no IPA */
+
+static hypercall_entry_t hypercall_batch[SMP_MAX_CPUS][HYPERCALL_BATCH_MAX]; /* Batch copies, one per CPU */
+
+/**
+ * @brief Check whether an access size is valid for a register.
+ *
+ * @param size Size in bytes.
+ * @return Non-zero if valid.
+ */
+static inline int hypercall_size_valid(uint64_t size)
+{
+    return (1 == size) || (2 == size) || (4 == size) || (8 == size);
+}
+
+/**
+ * @brief Check the arguments of an operation without running it.
+ *
+ * @param vm The calling VM.
+ * @param op Function ID.
+ * @param args x1-x3 of the call.
+ * @param page IPA of the batch page holding the operation, or
+ *             HYPERCALL_NO_BATCH.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NOT_SUPPORTED.
+ */
+static status_t hypercall_validate(vm_t* vm, uint32_t op, const uint64_t* args, uint64_t page)
+{
+    switch (op)
+    {
+    case HYPERCALL_NOP:
+        return STATUS_OK;
+    case HYPERCALL_MEM_POPULATE:
+        return gmem_contains(vm, args[0]) ? STATUS_OK : STATUS_ERR_INVALID;
+    case HYPERCALL_MEM_DISCARD:
+        /* The results of the batch are still to be written to its page */
+        return (gmem_contains(vm, args[0]) && ((args[0] & FRAME_MASK) != page)) ? STATUS_OK : STATUS_ERR_INVALID;
+    case HYPERCALL_MMIO_WRITE:
+    case HYPERCALL_MMIO_READ:
+        if (!hypercall_size_valid(args[1]) || gmem_contains(vm, args[0]))
+        {
+            return STATUS_ERR_INVALID;
+        }
+        for (uint32_t i = 0; i < vm->num_mmio; ++i)
+        {
+            if ((args[0] >= vm->mmio[i].base) && ((args[0] - vm->mmio[i].base) < vm->mmio[i].size))
+            {
+                return STATUS_OK;
+            }
+        }
+        return STATUS_ERR_INVALID;
+    case HYPERCALL_CHANNEL_DOORBELL:
+        return (args[0] < vm->num_channels) ? STATUS_OK : STATUS_ERR_INVALID;
+    default:
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+}
+
+/**
+ * @brief Run one validated operation.
+ *
+ * @param vm The calling VM.
+ * @param op Function ID.
+ * @param args x1-x3 of the call, args[0] receives read values.
+ * @return Status of the operation.
+ */
+static status_t hypercall_execute(vm_t* vm, uint32_t op, uint64_t* args)
+{
+    switch (op)
+    {
+    case HYPERCALL_NOP:
+        return STATUS_OK;
+    case HYPERCALL_MEM_POPULATE:
+        return gmem_populate(vm, args[0]);
+    case HYPERCALL_MEM_DISCARD:
+        return gmem_discard(vm, args[0]);
+    case HYPERCALL_MMIO_WRITE:
+        return vm_mmio_access(vm, args[0], (uint32_t)args[1], 1, &args[2]);
+    case HYPERCALL_MMIO_READ:
+        return vm_mmio_access(vm, args[0], (uint32_t)args[1], 0, &args[0]);
+    case HYPERCALL_CHANNEL_DOORBELL:
+        return channel_doorbell(vm, args[0], &args[0]);
+    default:
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+}
+
+/**
+ * @brief Run a batch page.
+ *
+ * @param vcpu The calling vCPU.
+ * @param ipa IPA of the batch page.
+ * @param count Number of entries.
+ * @param failed Receives the number of entries that failed, or the index
+ *               of the first invalid entry if the batch is rejected.
+ * @return STATUS_OK if the batch ran, STATUS_ERR_INVALID if it was
+ *         rejected.
+ */
+static status_t hypercall_multicall(vcpu_t* vcpu, uint64_t ipa, uint64_t count, uint64_t* failed)
+{
+    vm_t*              vm    = vcpu->vm;                                     /* Calling VM */
+    hypercall_entry_t* guest = NULL;                                         /* Batch page */
+    hypercall_entry_t* batch = hypercall_batch[smp_cpu_id() % SMP_MAX_CPUS]; /* Private copy */
+    uint64_t           bad   = count;                                        /* First invalid entry */
+    status_t           check = STATUS_OK;                                    /* Entry validation status */
+
+    *failed = 0;
+
+    if ((0 != (ipa & ~FRAME_MASK)) || (0 == count) || (count > HYPERCALL_BATCH_MAX))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    /* Results go back through the host pointer, the page must stay in its frame */
+    gmem_pin(vm);
+
+    guest = (hypercall_entry_t*)xlate_ipa_to_host(vcpu, ipa, FRAME_SIZE);
+    if (NULL == guest)
+    {
+        gmem_unpin(vm);
+        return STATUS_ERR_INVALID;
+    }
+
+    /* What is validated is what runs, whatever the guest stores meanwhile */
+    memcpy(batch, guest, count * sizeof(*batch));
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        check = hypercall_validate(vm, batch[i].op, batch[i].args, ipa);
+        if (STATUS_OK != check)
+        {
+            guest[i].result = check;
+            if (bad == count)
+            {
+                bad = i;
+            }
+        }
+    }
+
+    gmem_dirty_log_mark(vm, ipa);
+
+    if (bad != count)
+    {
+        gmem_unpin(vm);
+        vm->hc_stats.rejected++;
+        *failed = bad;
+        return STATUS_ERR_INVALID;
+    }
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        batch[i].result = hypercall_execute(vm, batch[i].op, batch[i].args);
+        if (STATUS_OK != batch[i].result)
+        {
+            (*failed)++;
+        }
+
+        guest[i].result  = batch[i].result;
+        guest[i].args[0] = batch[i].args[0];
+    }
+
+    gmem_unpin(vm);
+
+    vm->hc_stats.multicalls++;
+    vm->hc_stats.batched_ops += count;
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Emulate PSCI CPU_ON for a sibling vCPU.
+ *
+ * vCPUs are numbered by Aff0 in a single cluster, see vcpu_load().
+ *
+ * @param vcpu The calling vCPU.
+ * @param mpidr MPIDR of the vCPU to start.
+ * @param entry Its entry point (IPA).
+ * @param ctx Context ID, passed in its x0.
+ * @return PSCI_SUCCESS, PSCI_INVALID_PARAMETERS or PSCI_ALREADY_ON.
+ */
+static int64_t hypercall_cpu_on(vcpu_t* vcpu, uint64_t mpidr, uint64_t entry, uint64_t ctx)
+{
+    vm_t*    vm     = vcpu->vm;                     /* Calling VM */
+    uint64_t target = mpidr & MPIDR_EL1_AFF0_MASK; /* vCPU to start */
+    status_t status = STATUS_OK;                    /* Power on status */
+
+    if ((0 != (mpidr & HYPERCALL_MPIDR_AFF & ~MPIDR_EL1_AFF0_MASK)) || (target >= vm->num_vcpus))
+    {
+        return PSCI_INVALID_PARAMETERS;
+    }
+
+    status = sched_power_on(&vm->vcpus[target], entry, ctx);
+    if (STATUS_ERR_BUSY == status)
+    {
+        return PSCI_ALREADY_ON;
+    }
+
+    return (STATUS_OK == status) ? PSCI_SUCCESS : PSCI_INVALID_PARAMETERS;
+}
+
+/**
+ * @brief Save the calling VM to a snapshot slot, or roll it back to one.
+ *
+ * @param vcpu The calling vCPU.
+ * @param slot Slot number.
+ * @param type snapshot_type_t to save, or -1 to restore.
+ * @return STATUS_OK, or the snapshot error.
+ */
+static status_t hypercall_snapshot(vcpu_t* vcpu, uint64_t slot, int64_t type)
+{
+    char path[HYPERCALL_SLOT_PATH_MAX]; /* Slot file name */
+
+    if (slot >= HYPERCALL_SNAPSHOT_SLOTS)
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    (void)snprintf(path, sizeof(path), "vm%u-slot%lu.snap", vcpu->vm->id, slot);
+
+    if (type < 0)
+    {
+        return snapshot_restore(vcpu->vm, path);
+    }
+
+    /* What a restore of this slot returns to */
+    vcpu->ctx.x[0] = (uint64_t)STATUS_OK;
+    vcpu->ctx.x[1] = 1;
+
+    return snapshot_save(vcpu->vm, path, (snapshot_type_t)type, NULL);
+}
+
+/**
+ * @brief Handle an HVC taken by a vCPU.
+ *
+ * @param vcpu The calling vCPU.
+ * @return STATUS_OK if the guest can be resumed.
+ */
+status_t hypercall_handle(vcpu_t* vcpu)
+{
+    vm_t*         vm      = vcpu->vm;                                  /* Calling VM */
+    trap_frame_t* frame   = &vcpu->ctx;                                /* Guest registers */
+    uint32_t      op      = (uint32_t)frame->x[0];                     /* Function ID */
+    uint64_t      args[3] = { frame->x[1], frame->x[2], frame->x[3] }; /* Arguments */
+    status_t      status  = STATUS_OK;                                 /* Call status */
+
+    vm->hc_stats.calls++;
+
+    switch (op)
+    {
+    case HYPERCALL_VERSION:
+        args[0] = HYPERCALL_INTERFACE_VERSION;
+        break;
+    case HYPERCALL_MULTICALL:
+        status = hypercall_multicall(vcpu, args[0], args[1], &args[0]);
+        break;
+    case HYPERCALL_SHUTDOWN:
+        vm_shutdown(vcpu);
+        return STATUS_OK;
+    case PSCI_CPU_ON:
+        /* PSCI returns its own code in x0 and nothing else */
+        frame->x[0] = (uint64_t)hypercall_cpu_on(vcpu, args[0], args[1], args[2]);
+        return STATUS_OK;
+    case HYPERCALL_SNAPSHOT_SAVE:
+        status  = (args[0] > SNAPSHOT_DELTA) ? STATUS_ERR_INVALID : hypercall_snapshot(vcpu, args[1], (int64_t)args[0]);
+        args[0] = 0;
+        break;
+    case HYPERCALL_SNAPSHOT_RESTORE:
+        status = hypercall_snapshot(vcpu, args[0], -1);
+        if (STATUS_OK == status)
+        {
+            /* The trap frame now holds the restored registers */
+            return STATUS_OK;
+        }
+        args[0] = 0;
+        break;
+    default:
+        status = hypercall_validate(vm, op, args, HYPERCALL_NO_BATCH);
+        if (STATUS_ERR_NOT_SUPPORTED == status)
+        {
+            frame->x[0] = (uint64_t)(int64_t)HYPERCALL_ERR_UNKNOWN;
+            return STATUS_OK;
+        }
+        if (STATUS_OK == status)
+        {
+            status = hypercall_execute(vm, op, args);
+        }
+        break;
+    }
+
+    frame->x[0] = (uint64_t)(int64_t)status;
+    frame->x[1] = args[0];
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Log the hypercall counters of a VM.
+ *
+ * @param vm The VM.
+ */
+void hypercall_report(const vm_t* vm)
+{
+    const vm_hypercall_stats_t* stats = &vm->hc_stats; /* Counters */
+
+    LOG_INFO("VM%u: hypercalls=%lu multicalls=%lu batched ops=%lu rejected=%lu\n\r",
+             vm->id,
+             stats->calls,
+             stats->multicalls,
+             stats->batched_ops,
+             stats->rejected);
+}
@@ -0,0 +1,264 @@
+/**
+ * @file passthrough.c
+ * @brief Physical devices assigned to a VM.
+ *
+ * This file contains the implementation of device assignment and of the
+ * interrupt forwarding for assigned devices.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Assigned devices are kept in a small table searched by interrupt ID.
+ * Devices are assigned and released before the scheduler starts or while
+ * their VM does not run, the table slots are published with release
+ * stores for the interrupt path.
+ *
+ * An interrupt may arrive on a CPU that does not run vCPU 0, for instance
+ * before the first schedule or after vCPU 0 was moved. It is injected and
+ * the owning CPU kicked as usual, and the SPI is routed to that CPU so the
+ * next one lands there directly.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of device passthrough.
+ */
+
+/* this module's header */
+#include "passthrough.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "gic.h"
+#include "logging.h"
+#include "platform.h"
+#include "sched.h"
+#include "stage2.h"
+#include "vgic.h"
+#include "vm.h"
+
+#define PASSTHROUGH_PAGE_MASK (0xFFFULL) /* Offset within a 4KB page */
+
+static passthrough_t* passthrough_table[PASSTHROUGH_MAX]; /* Assigned devices, NULL if free */
+
+/**
+ * @brief Check whether two address ranges overlap.
+ *
+ * @param a Start of the first range.
+ * @param a_size Size of the first range.
+ * @param b Start of the second range.
+ * @param b_size Size of the second range.
+ * @return Non-zero if they overlap.
+ */
+static int passthrough_overlaps(uint64_t a, uint64_t a_size, uint64_t b, uint64_t b_size)
+{
+    return (a < (b + b_size)) && (b < (a + a_size));
+}
+
+/**
+ * @brief Find the device that uses an interrupt.
+ *
+ * @param intid The interrupt ID.
+ * @return The device, or NULL.
+ */
+static passthrough_t* passthrough_find(uint32_t intid)
+{
+    for (uint32_t i = 0; i < PASSTHROUGH_MAX; ++i)
+    {
+        passthrough_t* pt = __atomic_load_n(&passthrough_table[i], __ATOMIC_ACQUIRE); /* Assigned device */
+
+        if ((NULL != pt) && (pt->irq == intid))
+        {
+            return pt;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Check that a guest address range is free for a device.
+ *
+ * @param vm The VM.
+ * @param ipa Start of the range.
+ * @param size Size of the range.
+ * @return Non-zero if usable.
+ */
+static int passthrough_ipa_valid(const vm_t* vm, uint64_t ipa, uint64_t size)
+{
+    if (passthrough_overlaps(ipa, size, vm->ram_ipa, vm->ram_size))
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < vm->num_mmio; ++i)
+    {
+        if (passthrough_overlaps(ipa, size, vm->mmio[i].base, vm->mmio[i].size))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Assign a physical device to a VM.
+ *
+ * @param pt The device, owned by the caller.
+ * @param vm The VM.
+ * @param ipa Page aligned guest address of the register window.
+ * @param pa Page aligned physical address of the register window.
+ * @param size Page aligned size of the register window.
+ * @param irq The SPI, or PASSTHROUGH_NO_IRQ.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_EXISTS if the IPA or
+ *         the SPI is taken, or STATUS_ERR_NO_MEMORY.
+ */
+status_t passthrough_assign(passthrough_t* pt, struct vm* vm, uint64_t ipa, uint64_t pa, uint64_t size, uint32_t irq)
+{
+    status_t status = STATUS_OK;       /* Mapping status */
+    uint32_t slot   = PASSTHROUGH_MAX; /* Free table slot */
+
+    if ((NULL == pt) || (NULL == vm) || (0 == size) ||
+        (0 != ((ipa | pa | size) & PASSTHROUGH_PAGE_MASK)) ||
+        ((PASSTHROUGH_NO_IRQ != irq) && ((irq < 32) || (irq >= VGIC_MAX_INTID))) ||
+        passthrough_overlaps(pa, size, PLATFORM_RAM_BASE, PLATFORM_RAM_SIZE) ||
+        !passthrough_ipa_valid(vm, ipa, size))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    if ((PASSTHROUGH_NO_IRQ != irq) && (NULL != passthrough_find(irq)))
+    {
+        return STATUS_ERR_EXISTS;
+    }
+
+    for (uint32_t i = 0; i < PASSTHROUGH_MAX; ++i)
+    {
+        if (NULL == passthrough_table[i])
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (PASSTHROUGH_MAX == slot)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    status = stage2_map(&vm->s2, ipa, pa, size, STAGE2_MEM_DEVICE);
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+
+    *pt = (passthrough_t){ .vm = vm, .ipa = ipa, .pa = pa, .size = size, .irq = irq, .cpu = vm->vcpus[0].cpu };
+
+    if (PASSTHROUGH_NO_IRQ != irq)
+    {
+        status = gic_forward_spi(irq, pt->cpu);
+        if (STATUS_OK != status)
+        {
+            (void)stage2_unmap(&vm->s2, ipa, size);
+            return status;
+        }
+    }
+
+    __atomic_store_n(&passthrough_table[slot], pt, __ATOMIC_RELEASE);
+
+    if (passthrough_overlaps(pa, size, PLATFORM_UART_BASE, PLATFORM_UART_SIZE))
+    {
+        LOG_INFO("passthrough: UART assigned to VM%u, the log leaves the UART\n\r", vm->id);
+        log_release_uart();
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Take a device back from its VM.
+ *
+ * @param pt The device.
+ */
+void passthrough_release(passthrough_t* pt)
+{
+    if ((NULL == pt) || (NULL == pt->vm))
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < PASSTHROUGH_MAX; ++i)
+    {
+        if (pt == passthrough_table[i])
+        {
+            __atomic_store_n(&passthrough_table[i], NULL, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (PASSTHROUGH_NO_IRQ != pt->irq)
+    {
+        gic_release_spi(pt->irq);
+    }
+
+    (void)stage2_unmap(&pt->vm->s2, pt->ipa, pt->size);
+    pt->vm = NULL;
+}
+
+/**
+ * @brief Forward a physical interrupt that belongs to an assigned device.
+ *
+ * @param intid The acknowledged interrupt ID.
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if no assigned device
+ *         uses the interrupt.
+ */
+status_t passthrough_irq(uint32_t intid)
+{
+    passthrough_t* pt   = passthrough_find(intid); /* Owning device */
+    vcpu_t*        vcpu = NULL;                    /* Target vCPU */
+    uint32_t       cpu  = 0;                       /* CPU running the target */
+
+    if (NULL == pt)
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    /* The physical interrupt stays active until the guest deactivates it, so only one CPU gets here */
+    vcpu = &pt->vm->vcpus[0];
+    ++pt->irqs;
+
+    vgic_inject_hw(vcpu, intid);
+    sched_wake(vcpu);
+
+    cpu = __atomic_load_n(&vcpu->cpu, __ATOMIC_RELAXED);
+    if (cpu != pt->cpu)
+    {
+        gic_route_spi(intid, cpu);
+        pt->cpu = cpu;
+    }
+
+    return STATUS_OK;
+}
@@ -0,0 +1,1124 @@
+/**
+ * @file sched.c
+ * @brief Per-CPU vCPU scheduler with a tickless idle loop.
+ *
+ * This file contains the run queues, the idle loop and the EL2 timer
+ * programming of the scheduler.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * A blocked vCPU is never loaded, so its virtual timer lives in
+ * vcpu->el1 and CNTVOFF_EL2 is 0: the deadline is simply cntv_cval when
+ * the timer is enabled and unmasked. When it passes, the scheduler masks
+ * the saved timer and injects the virtual timer interrupt, the same as
+ * when the physical virtual timer fires while the vCPU runs. The guest
+ * clears the mask when it programs the next expiry.
+ *
+ * Blocking publishes VCPU_STATE_BLOCKED before looking at the pending
+ * bitmap and sched_wake() publishes the interrupt before looking at the
+ * state, both with a full barrier, so a wakeup is never lost between the
+ * two. The kick SGI wakes the owning CPU from WFI even though its
+ * interrupts are masked. A vCPU woken from its own CPU is not kicked, it
+ * is picked up there the same way as a virtual SGI target below.
+ *
+ * A vCPU switched away from while still runnable is marked preempted: if
+ * its VM takes locks, it is the one most likely to hold them. WFE traps
+ * are armed only while a runnable sibling of the same VM waits for the
+ * CPU, so a lone vCPU spins at full speed.
+ *
+ * A virtual SGI from a sibling vCPU takes a shorter path than
+ * sched_wake(): a blocked target is made runnable by the sender itself,
+ * and a physical SGI is only sent when the target's CPU has to notice,
+ * because the target runs there and needs a list register, or because
+ * that CPU idles or must arm a time slice for it. A target on the
+ * sender's own CPU never needs one: it only shortens the sender's slice,
+ * or is picked when the CPU schedules next if no vCPU sent it. Each CPU
+ * publishes the vCPU it has loaded for this decision.
+ *
+ * Secondary vCPUs sit in their run queue powered off until the guest
+ * starts them with PSCI CPU_ON. sched_power_on() claims such a vCPU with a
+ * compare and swap before it resets it, so it is never picked half reset.
+ *
+ * sched_pause() keeps the vCPUs of one VM off every CPU, for instance
+ * while a snapshot is taken from the trap of one of them. It kicks the
+ * CPUs that run one and waits until they switched away; a CPU publishes
+ * the vCPU it loads before it checks the pause flag again, and the pauser
+ * sets the flag before it looks at the loaded vCPUs, so one of the two
+ * always notices the other.
+ *
+ * Before WFI an idle CPU zeroes frames for the allocator's pre-zeroed
+ * stack, until an interrupt is pending or the stack is full, then runs one
+ * huge page compaction step for each vCPU placed on it, again only while
+ * no interrupt is pending.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of the vCPU scheduler.
+ */
+
+/* this module's header */
+#include "sched.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "frame.h"
+#include "gic.h"
+#include "gmem.h"
+#include "logging.h"
+#include "passthrough.h"
+#include "smp.h"
+#include "sysreg.h"
+#include "vgic.h"
+
+/* Timer control registers */
+#define CNT_CTL_ENABLE (1ULL << 0) /**< Timer enabled */
+#define CNT_CTL_IMASK  (1ULL << 1) /**< Timer interrupt masked */
+
+#define SCHED_US_PER_S (1000000ULL) /**< Microseconds per second */
+
+/**
+ * @brief Scheduling state of a physical CPU.
+ */
+typedef struct sched_cpu
+{
+    vcpu_t*       runq[SCHED_MAX_VCPUS]; /**< vCPUs placed on this CPU */
+    uint32_t      num;                   /**< entries in runq */
+    uint32_t      next;                  /**< round-robin position */
+    uint32_t      online;                /**< non-zero once the CPU schedules */
+    vcpu_t*       last;                  /**< last vCPU loaded */
+    vcpu_t*       loaded;                /**< vCPU loaded now, NULL while idle */
+    uint64_t      slice_end;             /**< end of the loaded vCPU's time slice */
+    uint64_t      armed;                 /**< programmed expiry, SCHED_NO_DEADLINE if off */
+    uint32_t      armed_served;          /**< deadlines served by that expiry */
+    sched_stats_t stats;                 /**< idle and wakeup counters */
+} sched_cpu_t;
+
+static sched_cpu_t sched_cpus[SMP_MAX_CPUS];         /* Per-CPU scheduling state */
+static uint64_t    sched_slack_us = SCHED_SLACK_US; /* Coalescing window */
+static int         sched_yield_on = 1;              /* Directed yield on WFE */
+
+/**
+ * @brief Convert microseconds to counter ticks.
+ *
+ * @param us Microseconds.
+ * @return Counter ticks.
+ */
+static uint64_t sched_us_to_ticks(uint64_t us)
+{
+    return (us * arch_counter_freq()) / SCHED_US_PER_S;
+}
+
+/**
+ * @brief Convert counter ticks to microseconds.
+ *
+ * @param ticks Counter ticks.
+ * @return Microseconds.
+ */
+static uint64_t sched_ticks_to_us(uint64_t ticks)
+{
+    uint64_t freq = arch_counter_freq(); /* Counter frequency */
+
+    return ((ticks / freq) * SCHED_US_PER_S) + (((ticks % freq) * SCHED_US_PER_S) / freq);
+}
+
+/**
+ * @brief Get the scheduling state of the calling CPU.
+ *
+ * @return The per-CPU state.
+ */
+static sched_cpu_t* sched_self(void)
+{
+    return &sched_cpus[smp_cpu_id() % SMP_MAX_CPUS];
+}
+
+/**
+ * @brief Publish the vCPU loaded on the calling CPU.
+ *
+ * @param sc The calling CPU's state.
+ * @param vcpu The loaded vCPU, or NULL.
+ */
+static void sched_set_loaded(sched_cpu_t* sc, vcpu_t* vcpu)
+{
+    __atomic_store_n(&sc->loaded, vcpu, __ATOMIC_RELEASE);
+
+    /* Before vgic_flush() reads the pending bitmap, pairs with the fence in sched_ipi() */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Check whether the VM of a vCPU is paused.
+ *
+ * @param vcpu The vCPU.
+ * @return Non-zero if it must not run.
+ */
+static inline int sched_paused(const vcpu_t* vcpu)
+{
+    return (0 != __atomic_load_n(&vcpu->vm->paused, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * @brief Get the virtual timer deadline of an unloaded vCPU.
+ *
+ * @param vcpu The vCPU.
+ * @return The counter value at which it fires, or SCHED_NO_DEADLINE.
+ */
+static uint64_t sched_vtimer_deadline(const vcpu_t* vcpu)
+{
+    if ((vcpu->el1.cntv_ctl & (CNT_CTL_ENABLE | CNT_CTL_IMASK)) != CNT_CTL_ENABLE)
+    {
+        return SCHED_NO_DEADLINE;
+    }
+
+    return vcpu->el1.cntv_cval;
+}
+
+/**
+ * @brief Wake the blocked vCPUs of a CPU that have work.
+ *
+ * @param sc The calling CPU's state.
+ * @param now The current counter value.
+ */
+static void sched_refresh(sched_cpu_t* sc, uint64_t now)
+{
+    for (uint32_t i = 0; i < sc->num; ++i)
+    {
+        vcpu_t*  vcpu     = sc->runq[i];         /* vCPU to check */
+        uint32_t expected = VCPU_STATE_BLOCKED; /* Only blocked vCPUs change here */
+
+        if (VCPU_STATE_BLOCKED != __atomic_load_n(&vcpu->state, __ATOMIC_ACQUIRE))
+        {
+            continue;
+        }
+
+        if (sched_vtimer_deadline(vcpu) <= now)
+        {
+            vcpu->el1.cntv_ctl |= CNT_CTL_IMASK;
+            vgic_inject(vcpu, SCHED_VTIMER_PPI);
+        }
+
+        if (vgic_has_pending(vcpu))
+        {
+            __atomic_compare_exchange_n(&vcpu->state, &expected, VCPU_STATE_RUNNABLE, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * @brief Pick the next runnable vCPU in round-robin order.
+ *
+ * @param sc The calling CPU's state.
+ * @return The vCPU, or NULL if none is runnable.
+ */
+static vcpu_t* sched_pick(sched_cpu_t* sc)
+{
+    for (uint32_t i = 0; i < sc->num; ++i)
+    {
+        uint32_t idx = (sc->next + i) % sc->num; /* Candidate */
+
+        if ((VCPU_STATE_RUNNABLE == __atomic_load_n(&sc->runq[idx]->state, __ATOMIC_ACQUIRE)) && !sched_paused(sc->runq[idx]))
+        {
+            sc->next = idx + 1;
+            return sc->runq[idx];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Pick a runnable sibling of a vCPU, preferring a preempted one.
+ *
+ * @param sc The calling CPU's state.
+ * @param vcpu The vCPU giving up the CPU.
+ * @return The sibling, or NULL if none is runnable.
+ */
+static vcpu_t* sched_pick_sibling(sched_cpu_t* sc, const vcpu_t* vcpu)
+{
+    vcpu_t* found = NULL; /* First runnable sibling */
+
+    for (uint32_t i = 0; i < sc->num; ++i)
+    {
+        vcpu_t* cand = sc->runq[(sc->next + i) % sc->num]; /* Candidate */
+
+        if ((cand == vcpu) || (cand->vm != vcpu->vm) || sched_paused(cand) ||
+            (VCPU_STATE_RUNNABLE != __atomic_load_n(&cand->state, __ATOMIC_ACQUIRE)))
+        {
+            continue;
+        }
+        if (0 != cand->preempted)
+        {
+            return cand;
+        }
+        if (NULL == found)
+        {
+            found = cand;
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief Program the EL2 timer to the nearest deadline.
+ *
+ * Also arms the WFE trap of the running vCPU if a sibling could use the
+ * CPU.
+ *
+ * @param sc The calling CPU's state.
+ * @param running The vCPU about to run, or NULL when idling.
+ */
+static void sched_arm(sched_cpu_t* sc, vcpu_t* running)
+{
+    uint64_t deadlines[SCHED_MAX_VCPUS + 1]; /* Pending deadlines */
+    uint32_t num      = 0;                   /* Entries in deadlines */
+    uint32_t others   = 0;                   /* Runnable vCPUs waiting for the CPU */
+    uint32_t siblings = 0;                   /* Of those, vCPUs of the running VM */
+    uint32_t served   = 0;                   /* Deadlines served by the expiry */
+    uint64_t expiry   = SCHED_NO_DEADLINE;   /* Timer expiry */
+
+    for (uint32_t i = 0; i < sc->num; ++i)
+    {
+        const vcpu_t* vcpu  = sc->runq[i];                                    /* vCPU to check */
+        uint32_t      state = __atomic_load_n(&vcpu->state, __ATOMIC_ACQUIRE); /* Its state */
+
+        if (VCPU_STATE_BLOCKED == state)
+        {
+            uint64_t deadline = sched_vtimer_deadline(vcpu); /* Virtual timer expiry */
+
+            if (SCHED_NO_DEADLINE != deadline)
+            {
+                deadlines[num++] = deadline;
+            }
+        }
+        else if ((VCPU_STATE_RUNNABLE == state) && (vcpu != running))
+        {
+            ++others;
+            if ((NULL != running) && (vcpu->vm == running->vm))
+            {
+                ++siblings;
+            }
+        }
+    }
+
+    if (NULL != running)
+    {
+        running->yield_trap = sched_yield_on && (0 != siblings);
+    }
+
+    /* A lone vCPU keeps the CPU, its own timer fires while it runs */
+    if ((NULL != running) && (0 != others))
+    {
+        deadlines[num++] = sc->slice_end;
+    }
+
+    expiry = sched_coalesce(deadlines, num, sched_us_to_ticks(sched_slack_us), &served);
+    if (expiry == sc->armed)
+    {
+        sc->armed_served = served;
+        return;
+    }
+
+    if (SCHED_NO_DEADLINE == expiry)
+    {
+        SYSREG_WRITE(cnthp_ctl_el2, 0x0ULL);
+    }
+    else
+    {
+        SYSREG_WRITE(cnthp_cval_el2, expiry);
+        SYSREG_WRITE(cnthp_ctl_el2, CNT_CTL_ENABLE);
+        ++sc->stats.timer_arms;
+    }
+    ISB();
+
+    sc->armed        = expiry;
+    sc->armed_served = served;
+}
+
+/**
+ * @brief Wait in WFI until an interrupt arrives and handle it.
+ *
+ * @param sc The calling CPU's state.
+ */
+static void sched_idle(sched_cpu_t* sc)
+{
+    uint64_t start = 0;                  /* Counter before WFI */
+    uint32_t intid = GIC_INTID_SPURIOUS; /* Interrupt that woke the CPU */
+
+    sched_arm(sc, NULL);
+
+    /* Refill the pre-zeroed frames first, a batch at a time so a wakeup or deadline is not kept waiting */
+    while (!gic_pending() && frame_refill(FRAME_REFILL_BATCH))
+    {
+    }
+
+    /* Then spend the time on the TLB reach of the VMs placed here, one bounded step each */
+    for (uint32_t i = 0; (i < sc->num) && !gic_pending(); ++i)
+    {
+        (void)gmem_compact(sc->runq[i]->vm);
+    }
+
+    start = arch_counter_read();
+    WFI();
+    sc->stats.idle_ticks += arch_counter_read() - start;
+    ++sc->stats.wakeups;
+
+    while ((intid = gic_ack()) < GIC_INTID_SPURIOUS)
+    {
+        if (SCHED_TIMER_PPI == intid)
+        {
+            ++sc->stats.timer_wakeups;
+        }
+        if ((STATUS_OK != sched_irq(intid)) && (STATUS_OK != passthrough_irq(intid)))
+        {
+            LOG_WARNING("Unhandled physical IRQ %u\n\r", intid);
+        }
+        gic_eoi(intid);
+    }
+}
+
+/**
+ * @brief Find the next vCPU to run, idling until there is one.
+ *
+ * @param sc The calling CPU's state.
+ * @param prev The loaded vCPU, unloaded if the CPU has to idle.
+ * @return The vCPU to run.
+ */
+static vcpu_t* sched_next(sched_cpu_t* sc, vcpu_t* prev)
+{
+    vcpu_t* next = NULL; /* vCPU to run */
+
+    sched_refresh(sc, arch_counter_read());
+    next = sched_pick(sc);
+
+    while (NULL == next)
+    {
+        if (NULL != prev)
+        {
+            vcpu_put(prev);
+            sched_set_loaded(sc, NULL);
+            prev = NULL;
+        }
+
+        sched_idle(sc);
+
+        sched_refresh(sc, arch_counter_read());
+        next = sched_pick(sc);
+        if (NULL == next)
+        {
+            ++sc->stats.empty_wakeups;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * @brief Load a vCPU and give it a fresh time slice.
+ *
+ * @param sc The calling CPU's state.
+ * @param next The vCPU to run.
+ */
+static void sched_switch(sched_cpu_t* sc, vcpu_t* next)
+{
+    vcpu_t* prev = vcpu_current(); /* vCPU loaded on entry */
+
+    if (next != prev)
+    {
+        if (NULL != prev)
+        {
+            prev->preempted = (VCPU_STATE_RUNNABLE == __atomic_load_n(&prev->state, __ATOMIC_ACQUIRE));
+            vcpu_put(prev);
+        }
+        vcpu_load(next);
+        sched_set_loaded(sc, next);
+    }
+    next->preempted = 0;
+
+    if (next != sc->last)
+    {
+        ++sc->stats.switches;
+        sc->last = next;
+    }
+
+    sc->slice_end = arch_counter_read() + sched_us_to_ticks(SCHED_SLICE_US);
+    sched_arm(sc, next);
+}
+
+/**
+ * @brief Make sure a vCPU is loaded and program the next deadline.
+ *
+ * @param sc The calling CPU's state.
+ * @param prev The vCPU loaded on entry, or NULL.
+ */
+static void sched_schedule(sched_cpu_t* sc, vcpu_t* prev)
+{
+    vcpu_t* next = NULL; /* vCPU to run */
+
+    if ((NULL != prev) && (arch_counter_read() < sc->slice_end) && !sched_paused(prev))
+    {
+        /* Still within its slice, only the deadlines may have changed */
+        sched_refresh(sc, arch_counter_read());
+        sched_arm(sc, prev);
+        return;
+    }
+
+    /* The VM may be paused between the pick and the publication of the loaded vCPU */
+    do
+    {
+        next = sched_next(sc, prev);
+        sched_switch(sc, next);
+        prev = next;
+    } while (sched_paused(next));
+}
+
+/**
+ * @brief Enable the scheduler's interrupts on the calling CPU.
+ *
+ * @param sc The calling CPU's state.
+ */
+static void sched_cpu_start(sched_cpu_t* sc)
+{
+    if ((STATUS_OK != gic_enable_private(SCHED_TIMER_PPI, GIC_PRIORITY_DFLT)) ||
+        (STATUS_OK != gic_enable_private(SCHED_VTIMER_PPI, GIC_PRIORITY_DFLT)) ||
+        (STATUS_OK != gic_enable_private(SCHED_KICK_SGI, GIC_PRIORITY_DFLT)))
+    {
+        LOG_WARNING("sched: CPU%u has no redistributor, timers will not fire\n\r", smp_cpu_id());
+    }
+
+    SYSREG_WRITE(cnthp_ctl_el2, 0x0ULL);
+    ISB();
+
+    sc->armed       = SCHED_NO_DEADLINE;
+    sc->stats.since = arch_counter_read();
+    __atomic_store_n(&sc->online, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Schedule the run queue of the calling CPU, never returns.
+ *
+ * @param sc The calling CPU's state.
+ */
+static void sched_run(sched_cpu_t* sc) __attribute__((noreturn));
+static void sched_run(sched_cpu_t* sc)
+{
+    vcpu_t* next = NULL; /* First vCPU to run */
+
+    sched_cpu_start(sc);
+
+    for (;;)
+    {
+        next = sched_next(sc, NULL);
+        sched_set_loaded(sc, next);
+        if (!sched_paused(next))
+        {
+            break;
+        }
+        sched_set_loaded(sc, NULL);
+    }
+
+    sc->last      = next;
+    sc->slice_end = arch_counter_read() + sched_us_to_ticks(SCHED_SLICE_US);
+    ++sc->stats.switches;
+    sched_arm(sc, next);
+
+    vcpu_run(next);
+}
+
+/**
+ * @brief Entry of a secondary CPU that schedules vCPUs.
+ *
+ * @param cpu The CPU number.
+ * @param arg Unused.
+ */
+static void sched_cpu_main(uint32_t cpu, void* arg)
+{
+    (void)arg;
+
+    sched_run(&sched_cpus[cpu]);
+}
+
+/**
+ * @brief Put an offline vCPU in the run queue of a physical CPU.
+ *
+ * @param vcpu The vCPU.
+ * @param cpu The physical CPU number.
+ * @param state VCPU_STATE_RUNNABLE or VCPU_STATE_POWERED_OFF.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY if the run
+ *         queue is full.
+ */
+static status_t sched_enqueue(vcpu_t* vcpu, uint32_t cpu, uint32_t state)
+{
+    sched_cpu_t* sc = NULL; /* Target CPU */
+
+    if ((NULL == vcpu) || (cpu >= SMP_MAX_CPUS) || (VCPU_STATE_OFFLINE != vcpu->state))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    sc = &sched_cpus[cpu];
+    if (sc->num >= SCHED_MAX_VCPUS)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    vcpu->cpu            = cpu;
+    sc->runq[sc->num++] = vcpu;
+    __atomic_store_n(&vcpu->state, state, __ATOMIC_RELEASE);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Add a vCPU to the run queue of a physical CPU.
+ *
+ * @param vcpu The vCPU, reset to its entry state.
+ * @param cpu The physical CPU number.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY if the run
+ *         queue is full.
+ */
+status_t sched_add(vcpu_t* vcpu, uint32_t cpu)
+{
+    return sched_enqueue(vcpu, cpu, VCPU_STATE_RUNNABLE);
+}
+
+/**
+ * @brief Add a powered off vCPU to the run queue of a physical CPU.
+ *
+ * @param vcpu The vCPU.
+ * @param cpu The physical CPU number.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY if the run
+ *         queue is full.
+ */
+status_t sched_add_off(vcpu_t* vcpu, uint32_t cpu)
+{
+    return sched_enqueue(vcpu, cpu, VCPU_STATE_POWERED_OFF);
+}
+
+/**
+ * @brief Start a powered off vCPU.
+ *
+ * @param vcpu The vCPU, added with sched_add_off().
+ * @param entry Guest entry point (IPA).
+ * @param arg Value passed in x0.
+ * @return STATUS_OK, STATUS_ERR_BUSY if the vCPU is on already or being
+ *         started, or STATUS_ERR_INVALID if it is in no run queue.
+ */
+status_t sched_power_on(vcpu_t* vcpu, uint64_t entry, uint64_t arg)
+{
+    uint32_t expected = VCPU_STATE_POWERED_OFF; /* Only a powered off vCPU is started */
+
+    /* Claimed first, so a concurrent call neither resets it twice nor sees it half reset */
+    if (!__atomic_compare_exchange_n(&vcpu->state, &expected, VCPU_STATE_STARTING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        return (VCPU_STATE_OFFLINE == expected) ? STATUS_ERR_INVALID : STATUS_ERR_BUSY;
+    }
+
+    vcpu_reset(vcpu, entry, arg);
+    __atomic_store_n(&vcpu->state, VCPU_STATE_RUNNABLE, __ATOMIC_RELEASE);
+
+    sched_wake(vcpu);
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Start scheduling on all CPUs that have vCPUs.
+ */
+void sched_start(void)
+{
+    uint32_t self = smp_cpu_id(); /* Boot CPU */
+
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; ++cpu)
+    {
+        if ((cpu != self) && (0 != sched_cpus[cpu].num))
+        {
+            (void)sched_cpu_on(cpu);
+        }
+    }
+
+    sched_run(&sched_cpus[self]);
+}
+
+/**
+ * @brief Start scheduling the run queue of a secondary CPU.
+ *
+ * @param cpu The physical CPU number.
+ * @return STATUS_OK, STATUS_ERR_INVALID, or the error of smp_cpu_on()
+ *         once the vCPUs moved to the calling CPU.
+ */
+status_t sched_cpu_on(uint32_t cpu)
+{
+    uint32_t     self   = smp_cpu_id(); /* Calling CPU */
+    sched_cpu_t* sc     = NULL;         /* CPU to start */
+    status_t     status = STATUS_OK;    /* Power on status */
+
+    if ((cpu >= SMP_MAX_CPUS) || (cpu == self) || __atomic_load_n(&sched_cpus[cpu].online, __ATOMIC_ACQUIRE))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    sc     = &sched_cpus[cpu];
+    status = smp_cpu_on(cpu, sched_cpu_main, NULL);
+    if (STATUS_OK == status)
+    {
+        return STATUS_OK;
+    }
+
+    LOG_WARNING("sched: CPU%u unavailable, its %u vCPU(s) run on CPU%u\n\r", cpu, sc->num, self);
+
+    for (uint32_t i = 0; i < sc->num; ++i)
+    {
+        /* A powered off vCPU stays off until the guest starts it */
+        uint32_t state = (VCPU_STATE_POWERED_OFF == sc->runq[i]->state) ? VCPU_STATE_POWERED_OFF : VCPU_STATE_RUNNABLE;
+
+        sc->runq[i]->state = VCPU_STATE_OFFLINE;
+        if (STATUS_OK != sched_enqueue(sc->runq[i], self, state))
+        {
+            LOG_ERR("sched: no room for VM%u vCPU%u\n\r", sc->runq[i]->vm->id, sc->runq[i]->id);
+        }
+    }
+    sc->num = 0;
+
+    return status;
+}
+
+/**
+ * @brief Block the loaded vCPU until it has work.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void sched_wait(vcpu_t* vcpu)
+{
+    sched_cpu_t* sc = sched_self(); /* Calling CPU */
+
+    if (!sc->online)
+    {
+        sched_cpu_start(sc);
+    }
+    if ((VCPU_STATE_OFFLINE == vcpu->state) && (STATUS_OK != sched_add(vcpu, smp_cpu_id())))
+    {
+        return;
+    }
+
+    /* Pending list registers move to the bitmap before the state is published */
+    vcpu_put(vcpu);
+    sched_set_loaded(sc, NULL);
+    __atomic_store_n(&vcpu->state, VCPU_STATE_BLOCKED, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    sched_schedule(sc, NULL);
+}
+
+/**
+ * @brief Wake a vCPU after an interrupt was made pending for it.
+ *
+ * @param vcpu The vCPU.
+ */
+void sched_wake(vcpu_t* vcpu)
+{
+    uint32_t state = VCPU_STATE_OFFLINE; /* State after the interrupt was published */
+    vcpu_t*  self  = vcpu_current();     /* Loaded vCPU, if any */
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    state = __atomic_load_n(&vcpu->state, __ATOMIC_ACQUIRE);
+    if (((VCPU_STATE_RUNNABLE != state) && (VCPU_STATE_BLOCKED != state)) || (vcpu == self) ||
+        !__atomic_load_n(&sched_cpus[vcpu->cpu].online, __ATOMIC_ACQUIRE))
+    {
+        /* Not scheduled, or it picks the interrupt up on its next entry */
+        return;
+    }
+
+    if (vcpu->cpu == smp_cpu_id())
+    {
+        /* Never kick ourselves: it runs when the loaded vCPU waits, when the slice armed now ends, or at the next pick */
+        if ((NULL != self) &&
+            __atomic_compare_exchange_n(&vcpu->state, &state, VCPU_STATE_RUNNABLE, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            sched_arm(sched_self(), self);
+        }
+        return;
+    }
+
+    gic_send_sgi(vcpu->cpu, SCHED_KICK_SGI);
+}
+
+/**
+ * @brief Wake a vCPU after a sibling made a virtual SGI pending for it.
+ *
+ * @param vcpu The target vCPU.
+ */
+void sched_ipi(vcpu_t* vcpu)
+{
+    sched_cpu_t* sc       = sched_self();             /* Sending CPU */
+    uint32_t     cpu      = vcpu->cpu % SMP_MAX_CPUS; /* CPU owning the target */
+    sched_cpu_t* owner    = &sched_cpus[cpu];         /* Its state */
+    vcpu_t*      self     = vcpu_current();           /* Sending vCPU */
+    uint32_t     expected = VCPU_STATE_BLOCKED;       /* Only a blocked target is woken here */
+
+    ++sc->stats.ipis;
+
+    /* The interrupt is published before the target's state and CPU are looked at */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if ((vcpu == self) || !__atomic_load_n(&owner->online, __ATOMIC_ACQUIRE))
+    {
+        /* Not scheduled, or it picks the interrupt up on its next entry */
+        return;
+    }
+
+    if (__atomic_compare_exchange_n(&vcpu->state, &expected, VCPU_STATE_RUNNABLE, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        if (owner == sc)
+        {
+            /* It runs when the sender waits, or when the slice armed now ends, or at the next pick */
+            if (NULL != self)
+            {
+                sched_arm(sc, self);
+            }
+            return;
+        }
+    }
+    else if ((VCPU_STATE_RUNNABLE != expected) || (owner == sc) || (vcpu != __atomic_load_n(&owner->loaded, __ATOMIC_ACQUIRE)))
+    {
+        /* Offline, waiting for its CPU, or loaded here next: vgic_flush() loads the interrupt when it runs */
+        return;
+    }
+
+    ++sc->stats.ipi_kicks;
+    gic_send_sgi(cpu, SCHED_KICK_SGI);
+}
+
+/**
+ * @brief Hand the CPU from a spinning vCPU to a sibling.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void sched_yield(vcpu_t* vcpu)
+{
+    sched_cpu_t* sc   = sched_self(); /* Calling CPU */
+    vcpu_t*      next = NULL;         /* Sibling to run */
+
+    if (!sc->online || (vcpu != vcpu_current()))
+    {
+        return;
+    }
+
+    sched_refresh(sc, arch_counter_read());
+    next = sched_pick_sibling(sc, vcpu);
+    if (NULL == next)
+    {
+        /* The sibling blocked or moved since the trap was armed */
+        ++sc->stats.yield_misses;
+        sched_arm(sc, vcpu);
+        return;
+    }
+
+    ++sc->stats.yields;
+    if (0 != next->preempted)
+    {
+        ++sc->stats.yield_holders;
+    }
+
+    sched_switch(sc, next);
+
+    /* It gave the CPU away while spinning, not while holding a lock */
+    vcpu->preempted = 0;
+}
+
+/**
+ * @brief Take the loaded vCPU off its CPU for good.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void sched_exit(vcpu_t* vcpu)
+{
+    sched_cpu_t* sc = sched_self(); /* Calling CPU */
+
+    if (!sc->online)
+    {
+        sched_cpu_start(sc);
+    }
+
+    for (uint32_t i = 0; i < sc->num; ++i)
+    {
+        if (sc->runq[i] == vcpu)
+        {
+            sc->runq[i] = sc->runq[--sc->num];
+            break;
+        }
+    }
+
+    vcpu_put(vcpu);
+    sched_set_loaded(sc, NULL);
+    __atomic_store_n(&vcpu->state, VCPU_STATE_OFFLINE, __ATOMIC_RELEASE);
+    sc->next = 0;
+
+    sched_schedule(sc, NULL);
+}
+
+/**
+ * @brief Take every vCPU of a VM but the calling one off its CPU.
+ *
+ * @param vm The VM.
+ * @return STATUS_OK, or STATUS_ERR_BUSY if the VM is paused already.
+ */
+status_t sched_pause(vm_t* vm)
+{
+    uint32_t self     = smp_cpu_id(); /* Calling CPU */
+    uint32_t expected = 0;            /* Only one pauser at a time */
+
+    if (!__atomic_compare_exchange_n(&vm->paused, &expected, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+        return STATUS_ERR_BUSY;
+    }
+
+    /* The flag is set before the loaded vCPUs are looked at, pairs with the fence in sched_set_loaded() */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; ++cpu)
+    {
+        vcpu_t* loaded = __atomic_load_n(&sched_cpus[cpu].loaded, __ATOMIC_ACQUIRE); /* vCPU that CPU runs */
+
+        if ((cpu == self) || (NULL == loaded) || (loaded->vm != vm))
+        {
+            continue;
+        }
+
+        /* The kick ends its slice, sched_pick() skips the VM from now on */
+        gic_send_sgi(cpu, SCHED_KICK_SGI);
+        while ((NULL != (loaded = __atomic_load_n(&sched_cpus[cpu].loaded, __ATOMIC_ACQUIRE))) && (loaded->vm == vm))
+        {
+        }
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Let the vCPUs of a paused VM run again.
+ *
+ * @param vm The VM.
+ */
+void sched_resume(vm_t* vm)
+{
+    vcpu_t* self = vcpu_current(); /* Calling vCPU, never taken off */
+
+    __atomic_store_n(&vm->paused, 0, __ATOMIC_SEQ_CST);
+
+    for (uint32_t i = 0; i < vm->num_vcpus; ++i)
+    {
+        vcpu_t* vcpu = &vm->vcpus[i]; /* vCPU to run again */
+
+        if ((vcpu != self) && (VCPU_STATE_RUNNABLE == __atomic_load_n(&vcpu->state, __ATOMIC_ACQUIRE)))
+        {
+            /* Its CPU may have gone idle while the VM was paused */
+            sched_wake(vcpu);
+        }
+    }
+}
+
+/**
+ * @brief Handle a physical interrupt that belongs to the scheduler.
+ *
+ * @param intid The acknowledged interrupt ID.
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the interrupt is not
+ *         one of the scheduler's.
+ */
+status_t sched_irq(uint32_t intid)
+{
+    sched_cpu_t* sc   = sched_self();   /* Calling CPU */
+    vcpu_t*      vcpu = vcpu_current(); /* Loaded vCPU, if any */
+
+    switch (intid)
+    {
+    case SCHED_TIMER_PPI:
+        /* The line stays asserted until the timer is turned off */
+        SYSREG_WRITE(cnthp_ctl_el2, 0x0ULL);
+        ISB();
+        ++sc->stats.timer_fires;
+        if (0 != sc->armed_served)
+        {
+            sc->stats.coalesced += sc->armed_served - 1;
+        }
+        sc->armed        = SCHED_NO_DEADLINE;
+        sc->armed_served = 0;
+        return STATUS_OK;
+    case SCHED_VTIMER_PPI:
+        if (NULL != vcpu)
+        {
+            SYSREG_WRITE(cntv_ctl_el0, SYSREG_READ(cntv_ctl_el0) | CNT_CTL_IMASK);
+            ISB();
+            vgic_inject(vcpu, SCHED_VTIMER_PPI);
+        }
+        return STATUS_OK;
+    case SCHED_KICK_SGI:
+        return STATUS_OK;
+    default:
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+}
+
+/**
+ * @brief Re-evaluate the run queue from guest context.
+ */
+void sched_preempt(void)
+{
+    sched_cpu_t* sc = sched_self(); /* Calling CPU */
+
+    if (sc->online && (NULL != vcpu_current()))
+    {
+        sched_schedule(sc, vcpu_current());
+    }
+}
+
+/**
+ * @brief Set the timer coalescing slack.
+ *
+ * @param us Slack in microseconds, 0 programs every deadline exactly.
+ */
+void sched_set_slack(uint64_t us)
+{
+    sched_slack_us = us;
+}
+
+/**
+ * @brief Enable or disable the directed yield on WFE.
+ *
+ * @param enable Non-zero to trap WFE while a sibling vCPU is runnable.
+ */
+void sched_set_yield(int enable)
+{
+    sched_yield_on = (0 != enable);
+}
+
+/**
+ * @brief Pick the timer expiry that serves the earliest deadline.
+ *
+ * @param deadlines Absolute counter values.
+ * @param num Number of deadlines.
+ * @param slack Coalescing window in counter ticks.
+ * @param served Receives the number of deadlines served by the expiry.
+ * @return The expiry, or SCHED_NO_DEADLINE if num is 0.
+ */
+uint64_t sched_coalesce(const uint64_t* deadlines, uint32_t num, uint64_t slack, uint32_t* served)
+{
+    uint64_t earliest = SCHED_NO_DEADLINE; /* Deadline that must be met */
+    uint64_t limit    = 0;                 /* End of the coalescing window */
+    uint64_t expiry   = 0;                 /* Latest deadline inside the window */
+
+    *served = 0;
+
+    for (uint32_t i = 0; i < num; ++i)
+    {
+        if (deadlines[i] < earliest)
+        {
+            earliest = deadlines[i];
+        }
+    }
+    if (SCHED_NO_DEADLINE == earliest)
+    {
+        return SCHED_NO_DEADLINE;
+    }
+
+    limit = (earliest > (SCHED_NO_DEADLINE - slack)) ? SCHED_NO_DEADLINE - 1 : earliest + slack;
+
+    for (uint32_t i = 0; i < num; ++i)
+    {
+        if (deadlines[i] <= limit)
+        {
+            expiry = (deadlines[i] > expiry) ? deadlines[i] : expiry;
+            ++*served;
+        }
+    }
+
+    return expiry;
+}
+
+/**
+ * @brief Get the counters of a physical CPU.
+ *
+ * @param cpu The physical CPU number.
+ * @param stats Receives a copy of the counters.
+ * @return STATUS_OK or STATUS_ERR_INVALID.
+ */
+status_t sched_get_stats(uint32_t cpu, sched_stats_t* stats)
+{
+    if ((cpu >= SMP_MAX_CPUS) || (NULL == stats))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    *stats = sched_cpus[cpu].stats;
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Log idle residency and wakeup counters of every scheduling CPU.
+ */
+void sched_report(void)
+{
+    uint64_t now = arch_counter_read(); /* End of the measurement */
+
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; ++cpu)
+    {
+        const sched_stats_t* stats = &sched_cpus[cpu].stats; /* Counters to report */
+        uint64_t             total = 0;                      /* Ticks since start */
+        uint64_t             idle  = 0;                      /* Idle share in 1/10000 */
+
+        if (!__atomic_load_n(&sched_cpus[cpu].online, __ATOMIC_ACQUIRE))
+        {
+            continue;
+        }
+
+        total = now - stats->since;
+        idle  = (0 == total) ? 0 : (stats->idle_ticks * 10000) / total;
+
+        LOG_INFO("sched: CPU%u idle %lu.%02lu%% of %lu us, %lu wakeups (%lu timer, %lu empty), "
+                 "%lu timer irqs, %lu arms, %lu coalesced, %lu switches, "
+                 "%lu yields (%lu to preempted, %lu missed), %lu vIPIs (%lu kicked)\n\r",
+                 cpu,
+                 idle / 100,
+                 idle % 100,
+                 sched_ticks_to_us(total),
+                 stats->wakeups,
+                 stats->timer_wakeups,
+                 stats->empty_wakeups,
+                 stats->timer_fires,
+                 stats->timer_arms,
+                 stats->coalesced,
+                 stats->switches,
+                 stats->yields,
+                 stats->yield_holders,
+                 stats->yield_misses,
+                 stats->ipis,
+                 stats->ipi_kicks);
+    }
+}
@@ -0,0 +1,557 @@
+/**
+ * @file snapshot.c
+ * @brief Full and incremental VM snapshots.
+ *
+ * This file contains the implementation of saving VMs to, and restoring
+ * them from, files on the debug host through semihosting.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Each semihosting request traps to the emulator, so all file data goes
+ * through a staging buffer and is moved SNAPSHOT_STAGING_SIZE bytes at a
+ * time. The dirty bitmap is copied out of the log into frames borrowed
+ * from the frame allocator for the duration of a save.
+ *
+ * The VM's other vCPUs are paused for both directions, see sched_pause(),
+ * so memory and vCPU state do not change underneath. A save called from
+ * the trap of one of the VM's vCPUs flushes its live EL1 registers first.
+ * A delta is only applied on top of the snapshot it follows, checked by
+ * the sequence number in the header.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of VM snapshots.
+ */
+
+/* this module's header */
+#include "snapshot.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "frame.h"
+#include "gmem.h"
+#include "logging.h"
+#include "sched.h"
+#include "semihosting.h"
+#include "sysreg.h"
+
+/**
+ * @brief Buffered writer to a host file.
+ */
+typedef struct snapshot_writer
+{
+    int64_t  handle; /**< host file */
+    uint64_t fill;   /**< bytes in the staging buffer */
+    uint64_t bytes;  /**< bytes written so far */
+    status_t status; /**< first error */
+} snapshot_writer_t;
+
+static uint8_t snapshot_staging[SNAPSHOT_STAGING_SIZE] __attribute__((aligned(FRAME_SIZE))); /* Staging buffer */
+
+/**
+ * @brief Write the staging buffer to the host file.
+ *
+ * @param w The writer.
+ */
+static void snapshot_flush(snapshot_writer_t* w)
+{
+    if ((STATUS_OK == w->status) && (0 != w->fill))
+    {
+        w->status = semihosting_write(w->handle, snapshot_staging, w->fill);
+    }
+
+    w->fill = 0;
+}
+
+/**
+ * @brief Append data to the host file.
+ *
+ * @param w The writer.
+ * @param data The data.
+ * @param len Number of bytes.
+ */
+static void snapshot_emit(snapshot_writer_t* w, const void* data, uint64_t len)
+{
+    const uint8_t* src = (const uint8_t*)data; /* Remaining data */
+
+    while (0 != len)
+    {
+        uint64_t chunk = SNAPSHOT_STAGING_SIZE - w->fill; /* Room in the buffer */
+
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+
+        memcpy(&snapshot_staging[w->fill], src, chunk);
+        w->fill  += chunk;
+        w->bytes += chunk;
+        src      += chunk;
+        len      -= chunk;
+
+        if (SNAPSHOT_STAGING_SIZE == w->fill)
+        {
+            snapshot_flush(w);
+        }
+    }
+}
+
+/**
+ * @brief Check whether page n of guest RAM is dirty in a bitmap copy.
+ *
+ * @param bitmap The bitmap.
+ * @param n Page number within guest RAM.
+ * @return Non-zero if dirty.
+ */
+static inline int snapshot_is_dirty(const uint64_t* bitmap, uint64_t n)
+{
+    return (0 != (bitmap[n / 64] & (1ULL << (n % 64))));
+}
+
+/**
+ * @brief Write the page runs described by a dirty bitmap.
+ *
+ * Consecutive dirty pages that are all resident, or all discarded, share
+ * one run record.
+ *
+ * @param w The writer.
+ * @param vm The VM.
+ * @param bitmap Dirty pages.
+ * @param stats Updated with the pages and runs written.
+ */
+static void snapshot_emit_runs(snapshot_writer_t* w, vm_t* vm, const uint64_t* bitmap, snapshot_stats_t* stats)
+{
+    uint64_t pages = vm->ram_size >> FRAME_SHIFT; /* Guest pages */
+    uint64_t n     = 0;                           /* Current page */
+
+    while (n < pages)
+    {
+        snapshot_run_t run      = { 0 }; /* Run record */
+        int            resident = 0;     /* Run has contents */
+
+        if (0 == bitmap[n / 64])
+        {
+            n = (n | 63ULL) + 1ULL;
+            continue;
+        }
+
+        if (!snapshot_is_dirty(bitmap, n))
+        {
+            n++;
+            continue;
+        }
+
+        run.ipa  = vm->ram_ipa + (n << FRAME_SHIFT);
+        resident = (STATUS_OK == stage2_lookup(&vm->s2, run.ipa, NULL, NULL));
+
+        while (((n + run.pages) < pages) && (run.pages < UINT32_MAX) && snapshot_is_dirty(bitmap, n + run.pages) &&
+               (resident == (STATUS_OK == stage2_lookup(&vm->s2, run.ipa + ((uint64_t)run.pages << FRAME_SHIFT), NULL, NULL))))
+        {
+            run.pages++;
+        }
+
+        run.flags = resident ? 0U : SNAPSHOT_RUN_ZERO;
+        snapshot_emit(w, &run, sizeof(run));
+
+        for (uint32_t i = 0; resident && (i < run.pages); ++i)
+        {
+            snapshot_emit(w, gmem_ipa_to_host(vm, run.ipa + ((uint64_t)i << FRAME_SHIFT), FRAME_SIZE), FRAME_SIZE);
+        }
+
+        if (resident)
+        {
+            stats->data_pages += run.pages;
+        }
+        else
+        {
+            stats->zero_pages += run.pages;
+        }
+
+        stats->runs++;
+        n += run.pages;
+    }
+}
+
+/**
+ * @brief Write a paused VM to a host file.
+ *
+ * @param vm The VM.
+ * @param path Host file name, overwritten.
+ * @param type SNAPSHOT_FULL or SNAPSHOT_DELTA.
+ * @param stats Receives the cost of the snapshot, may be NULL.
+ * @return STATUS_OK, STATUS_ERR_INVALID for a delta without a previous
+ *         full snapshot, STATUS_ERR_NO_MEMORY or STATUS_ERR_IO.
+ */
+static status_t snapshot_write(vm_t* vm, const char* path, snapshot_type_t type, snapshot_stats_t* stats)
+{
+    uint64_t          start  = arch_counter_read(); /* Save start time */
+    snapshot_header_t header = { 0 };               /* File header */
+    snapshot_writer_t w      = { 0 };               /* Output file */
+    snapshot_stats_t  local  = { 0 };               /* Cost of this snapshot */
+    snapshot_run_t    end    = { 0 };               /* Terminating run */
+    uint64_t          copy   = 0x0ULL;              /* Dirty bitmap copy */
+    uint64_t          frames = 0;                   /* Frames backing the copy */
+    status_t          status = STATUS_OK;           /* Result */
+
+    if (SNAPSHOT_FULL == type)
+    {
+        /* Restarting the log marks every resident page dirty */
+        gmem_dirty_log_stop(vm);
+        status = gmem_dirty_log_start(vm);
+        if (STATUS_OK != status)
+        {
+            return status;
+        }
+    }
+    else if (NULL == vm->dirty.bitmap)
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    frames = vm->dirty.frames;
+    copy   = frame_alloc_contig(frames);
+    if (0x0ULL == copy)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    w.handle = semihosting_open(path, SEMIHOSTING_MODE_WB);
+    if (w.handle < 0)
+    {
+        frame_free_contig(copy, frames);
+        return STATUS_ERR_IO;
+    }
+
+    header.magic     = SNAPSHOT_MAGIC;
+    header.version   = SNAPSHOT_VERSION;
+    header.type      = (uint16_t)type;
+    header.vm_id     = vm->id;
+    header.num_vcpus = vm->num_vcpus;
+    header.ram_ipa   = vm->ram_ipa;
+    header.ram_size  = vm->ram_size;
+    header.pages     = gmem_dirty_log_sync(vm, (uint64_t*)(uintptr_t)copy);
+    header.sequence  = vm->dirty.syncs;
+
+    snapshot_emit(&w, &header, sizeof(header));
+
+    for (uint32_t i = 0; i < vm->num_vcpus; ++i)
+    {
+        snapshot_emit(&w, &vm->vcpus[i].ctx, sizeof(vm->vcpus[i].ctx));
+        snapshot_emit(&w, &vm->vcpus[i].el1, sizeof(vm->vcpus[i].el1));
+    }
+
+    snapshot_emit_runs(&w, vm, (const uint64_t*)(uintptr_t)copy, &local);
+    snapshot_emit(&w, &end, sizeof(end));
+    snapshot_flush(&w);
+
+    frame_free_contig(copy, frames);
+
+    status = w.status;
+    if (STATUS_OK != semihosting_close(w.handle))
+    {
+        status = STATUS_ERR_IO;
+    }
+
+    local.bytes = w.bytes;
+    local.ticks = arch_counter_read() - start;
+
+    LOG_INFO("VM%u: %s snapshot #%lu: %lu data pages, %lu zero pages, %lu runs, %lu bytes, %lu ticks\n\r",
+             vm->id,
+             (SNAPSHOT_FULL == type) ? "full" : "delta",
+             header.sequence,
+             local.data_pages,
+             local.zero_pages,
+             local.runs,
+             local.bytes,
+             local.ticks);
+
+    if (NULL != stats)
+    {
+        *stats = local;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Save a VM to a host file.
+ *
+ * @param vm The VM.
+ * @param path Host file name, overwritten.
+ * @param type SNAPSHOT_FULL or SNAPSHOT_DELTA.
+ * @param stats Receives the cost of the snapshot, may be NULL.
+ * @return STATUS_OK, STATUS_ERR_INVALID for a delta without a previous
+ *         full snapshot, STATUS_ERR_BUSY, STATUS_ERR_NO_MEMORY or
+ *         STATUS_ERR_IO.
+ */
+status_t snapshot_save(vm_t* vm, const char* path, snapshot_type_t type, snapshot_stats_t* stats)
+{
+    vcpu_t*  self   = vcpu_current(); /* Loaded vCPU, if any */
+    status_t status = STATUS_OK;      /* Result */
+
+    if ((NULL == vm) || (NULL == path) || ((SNAPSHOT_FULL != type) && (SNAPSHOT_DELTA != type)))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    /* Memory and vCPU state stay still while the file is written */
+    status = sched_pause(vm);
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+
+    /* The loaded vCPU's EL1 registers are live in hardware */
+    if ((NULL != self) && (self->vm == vm))
+    {
+        vcpu_el1_save(self);
+    }
+
+    /* Pages are read through host pointers, an idle CPU must not move them */
+    gmem_pin(vm);
+    status = snapshot_write(vm, path, type, stats);
+    gmem_unpin(vm);
+
+    sched_resume(vm);
+
+    return status;
+}
+
+/**
+ * @brief Read the page runs of a snapshot into guest RAM.
+ *
+ * @param vm The VM.
+ * @param handle The host file, positioned on the first run.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_NO_MEMORY or
+ *         STATUS_ERR_IO.
+ */
+static status_t snapshot_load_runs(vm_t* vm, int64_t handle)
+{
+    const uint64_t batch = SNAPSHOT_STAGING_SIZE >> FRAME_SHIFT; /* Pages per read */
+
+    for (;;)
+    {
+        snapshot_run_t run    = { 0 };     /* Run record */
+        status_t       status = STATUS_OK; /* Step status */
+
+        status = semihosting_read(handle, &run, sizeof(run));
+        if (STATUS_OK != status)
+        {
+            return status;
+        }
+
+        if (0 == run.pages)
+        {
+            return STATUS_OK;
+        }
+
+        if ((0 != (run.ipa & ~FRAME_MASK)) || (0 != (run.flags & ~SNAPSHOT_RUN_ZERO)) || !gmem_contains(vm, run.ipa) ||
+            (((uint64_t)run.pages << FRAME_SHIFT) > (vm->ram_ipa + vm->ram_size - run.ipa)))
+        {
+            return STATUS_ERR_INVALID;
+        }
+
+        for (uint64_t done = 0; done < run.pages;)
+        {
+            uint64_t count = run.pages - done; /* Pages in this step */
+
+            if (run.flags & SNAPSHOT_RUN_ZERO)
+            {
+                (void)gmem_discard(vm, run.ipa + (done << FRAME_SHIFT));
+                done++;
+                continue;
+            }
+
+            if (count > batch)
+            {
+                count = batch;
+            }
+
+            status = semihosting_read(handle, snapshot_staging, count << FRAME_SHIFT);
+            if (STATUS_OK != status)
+            {
+                return status;
+            }
+
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                uint64_t ipa  = run.ipa + ((done + i) << FRAME_SHIFT); /* Restored page */
+                void*    host = NULL;                                  /* Its backing frame */
+
+                status = gmem_populate(vm, ipa);
+                if (STATUS_OK != status)
+                {
+                    return status;
+                }
+
+                host = gmem_ipa_to_host(vm, ipa, FRAME_SIZE);
+                if (NULL == host)
+                {
+                    return STATUS_ERR_INVALID;
+                }
+
+                memcpy(host, &snapshot_staging[i << FRAME_SHIFT], FRAME_SIZE);
+            }
+
+            done += count;
+        }
+    }
+}
+
+/**
+ * @brief Check that a snapshot header fits a VM and its restore chain.
+ *
+ * @param vm The VM.
+ * @param header The header read from the file.
+ * @return Non-zero if the snapshot can be applied.
+ */
+static int snapshot_header_valid(const vm_t* vm, const snapshot_header_t* header)
+{
+    if ((SNAPSHOT_MAGIC != header->magic) || (SNAPSHOT_VERSION != header->version) || (vm->num_vcpus != header->num_vcpus) ||
+        (vm->ram_ipa != header->ram_ipa) || (vm->ram_size != header->ram_size))
+    {
+        return 0;
+    }
+
+    if (SNAPSHOT_FULL == header->type)
+    {
+        return (1 == header->sequence);
+    }
+
+    /* A delta only applies on top of the snapshot it was taken after */
+    return (SNAPSHOT_DELTA == header->type) && (0 != vm->snapshot_seq) && ((vm->snapshot_seq + 1) == header->sequence);
+}
+
+/**
+ * @brief Read a snapshot into a paused VM.
+ *
+ * @param vm The VM.
+ * @param handle The host file, positioned on the header.
+ * @return STATUS_OK, STATUS_ERR_INVALID, STATUS_ERR_NO_MEMORY or
+ *         STATUS_ERR_IO.
+ */
+static status_t snapshot_read(vm_t* vm, int64_t handle)
+{
+    snapshot_header_t header = { 0 };     /* File header */
+    status_t          status = STATUS_OK; /* Result */
+
+    status = semihosting_read(handle, &header, sizeof(header));
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+    if (!snapshot_header_valid(vm, &header))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    /* From here on a failure leaves the VM in no snapshot's state */
+    vm->snapshot_seq = 0;
+    gmem_dirty_log_stop(vm);
+
+    if (SNAPSHOT_FULL == header.type)
+    {
+        gmem_destroy(vm);
+    }
+
+    for (uint32_t i = 0; i < vm->num_vcpus; ++i)
+    {
+        vcpu_t* vcpu = &vm->vcpus[i]; /* Restored vCPU */
+
+        status = semihosting_read(handle, &vcpu->ctx, sizeof(vcpu->ctx));
+        if (STATUS_OK == status)
+        {
+            status = semihosting_read(handle, &vcpu->el1, sizeof(vcpu->el1));
+        }
+        if (STATUS_OK != status)
+        {
+            return status;
+        }
+
+        /* The trap frame is reloaded on exception return, the EL1 registers are not */
+        if (vcpu == vcpu_current())
+        {
+            vcpu_el1_restore(vcpu);
+        }
+    }
+
+    status = snapshot_load_runs(vm, handle);
+    if (STATUS_OK == status)
+    {
+        vm->snapshot_seq = header.sequence;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Restore a VM from a host file.
+ *
+ * @param vm A VM created with the same RAM layout and vCPU count.
+ * @param path Host file name.
+ * @return STATUS_OK, STATUS_ERR_INVALID if the file does not match the
+ *         VM or does not follow the snapshot restored last,
+ *         STATUS_ERR_BUSY, STATUS_ERR_NO_MEMORY or STATUS_ERR_IO.
+ */
+status_t snapshot_restore(vm_t* vm, const char* path)
+{
+    int64_t  handle = -1;        /* Input file */
+    status_t status = STATUS_OK; /* Result */
+
+    if ((NULL == vm) || (NULL == path))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    handle = semihosting_open(path, SEMIHOSTING_MODE_RB);
+    if (handle < 0)
+    {
+        return STATUS_ERR_IO;
+    }
+
+    /* The other vCPUs are rewritten while they are off their CPUs */
+    status = sched_pause(vm);
+    if (STATUS_OK == status)
+    {
+        gmem_pin(vm);
+        status = snapshot_read(vm, handle);
+        gmem_unpin(vm);
+        sched_resume(vm);
+    }
+
+    (void)semihosting_close(handle);
+
+    if (STATUS_OK != status)
+    {
+        LOG_ERR("VM%u: cannot restore snapshot %s (%d)\n\r", vm->id, path, status);
+    }
+
+    return status;
+}
@@ -0,0 +1,497 @@
+/**
+ * @file vm.c
+ * @brief Virtual machine and vCPU management.
+ *
+ * This file contains the implementation of VM creation, MMIO emulation
+ * dispatch and vCPU entry.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * Guests run at EL1 with stage-2 translation enabled. Physical interrupts
+ * are routed to EL2 and SMC instructions are trapped so that a guest
+ * cannot reach the firmware directly.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of VM and vCPU management.
+ */
+
+/* this module's header */
+#include "vm.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "frame.h"
+#include "logging.h"
+#include "sched.h"
+#include "trace.h"
+
+/* Hypervisor Configuration Register */
+#define HCR_EL2_VM   (1ULL << 0)  /**< Enable stage-2 translation */
+#define HCR_EL2_SWIO (1ULL << 1)  /**< Set/way invalidation override */
+#define HCR_EL2_FMO  (1ULL << 3)  /**< Route FIQs to EL2 */
+#define HCR_EL2_IMO  (1ULL << 4)  /**< Route IRQs to EL2 */
+#define HCR_EL2_AMO  (1ULL << 5)  /**< Route SErrors to EL2 */
+#define HCR_EL2_TWI  (1ULL << 13) /**< Trap WFI */
+#define HCR_EL2_TWE  (1ULL << 14) /**< Trap WFE */
+#define HCR_EL2_TSC  (1ULL << 19) /**< Trap SMC */
+#define HCR_EL2_TTLB (1ULL << 25) /**< Trap TLB maintenance */
+#define HCR_EL2_RW   (1ULL << 31) /**< EL1 is AArch64 */
+
+#define HCR_EL2_GUEST (HCR_EL2_VM | HCR_EL2_SWIO | HCR_EL2_FMO | HCR_EL2_IMO | HCR_EL2_AMO | HCR_EL2_TWI | HCR_EL2_TSC | HCR_EL2_RW) /**< Guest configuration */
+
+/* Counter-timer Hypervisor Control Register */
+#define CNTHCTL_EL2_EL1PCTEN (1ULL << 0) /**< EL1 physical counter access */
+#define CNTHCTL_EL2_EL1PCEN  (1ULL << 1) /**< EL1 physical timer access */
+
+#define CNTV_CTL_ENABLE (1ULL << 0) /**< Virtual timer enabled */
+
+#define SCTLR_EL1_RESET  (0x30D00800ULL) /**< SCTLR_EL1 RES1 bits, MMU and caches off */
+#define SPSR_EL1H_MASKED (0x3C5ULL)      /**< EL1h with D, A, I and F masked */
+#define VMPIDR_EL2_RES1  (1ULL << 31)    /**< VMPIDR_EL2 reserved bit */
+
+/**
+ * @brief Find the MMIO region containing an IPA.
+ *
+ * @param vm The VM.
+ * @param ipa The IPA.
+ * @return The region, or NULL.
+ */
+static vm_mmio_region_t* vm_mmio_find(vm_t* vm, uint64_t ipa)
+{
+    for (uint32_t i = 0; i < vm->num_mmio; ++i)
+    {
+        if ((ipa >= vm->mmio[i].base) && ((ipa - vm->mmio[i].base) < vm->mmio[i].size))
+        {
+            return &vm->mmio[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Emulate a trapped load or store to an MMIO region.
+ *
+ * @param vcpu The faulting vCPU.
+ * @param region The MMIO region.
+ * @param esr The exception syndrome.
+ * @param ipa The accessed IPA.
+ * @return STATUS_OK or STATUS_ERR_NOT_SUPPORTED if the access cannot be
+ *         decoded from the syndrome.
+ */
+static status_t vm_mmio_emulate(vcpu_t* vcpu, vm_mmio_region_t* region, uint64_t esr, uint64_t ipa)
+{
+    uint32_t size   = 0;                  /* Access size in bytes */
+    uint64_t reg    = 0;                  /* Transfer register */
+    uint64_t mask   = 0x0ULL;             /* Access size mask */
+    uint64_t value  = 0x0ULL;             /* Transferred value */
+    uint64_t offset = ipa - region->base; /* Offset in the region */
+
+    if ((ESR_EC_DABT_LOW != ESR_EC(esr)) || !(esr & ESR_DABT_ISV))
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    size = 1U << ESR_DABT_SAS(esr);
+    reg  = ESR_DABT_SRT(esr);
+    mask = (8 == size) ? ~0x0ULL : ((1ULL << (size * 8)) - 1ULL);
+
+    if (esr & ESR_DABT_WNR)
+    {
+        value = trap_frame_get_reg(&vcpu->ctx, reg) & mask;
+        region->ops->write(region->opaque, offset, size, value);
+    }
+    else
+    {
+        value = region->ops->read(region->opaque, offset, size) & mask;
+        if ((esr & ESR_DABT_SSE) && (size < 8) && (value & (1ULL << ((size * 8) - 1))))
+        {
+            value |= ~mask;
+            if (!(esr & ESR_DABT_SF))
+            {
+                value &= 0xFFFFFFFFULL;
+            }
+        }
+        trap_frame_set_reg(&vcpu->ctx, reg, value);
+    }
+
+    /* Skip the emulated instruction */
+    vcpu->ctx.elr += 4;
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Create a VM.
+ *
+ * @param vm The VM to initialize.
+ * @param id VM identifier, must be non-zero.
+ * @param ram_ipa Page aligned start IPA of guest RAM.
+ * @param ram_size Page aligned size of guest RAM.
+ * @param num_vcpus Number of vCPUs.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY.
+ */
+status_t vm_init(vm_t* vm, uint32_t id, uint64_t ram_ipa, uint64_t ram_size, uint32_t num_vcpus)
+{
+    status_t status = STATUS_OK; /* Initialization status */
+
+    if ((NULL == vm) || (0 == id) || (0 == num_vcpus) || (num_vcpus > VM_MAX_VCPUS) ||
+        ((ram_ipa | ram_size) & (STAGE2_PAGE_SIZE - 1ULL)))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    memset(vm, 0x0, sizeof(*vm));
+
+    vm->id        = id;
+    vm->ram_ipa   = ram_ipa;
+    vm->ram_size  = ram_size;
+    vm->num_vcpus = num_vcpus;
+
+    status = stage2_init(&vm->s2, (uint16_t)id);
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+
+    for (uint32_t i = 0; i < num_vcpus; ++i)
+    {
+        vm->vcpus[i].vm = vm;
+        vm->vcpus[i].id = i;
+    }
+
+    return gmem_init(vm);
+}
+
+/**
+ * @brief Register an emulated MMIO region.
+ *
+ * @param vm The VM.
+ * @param base Start IPA of the region.
+ * @param size Size of the region in bytes.
+ * @param ops Access callbacks.
+ * @param opaque Passed to the callbacks.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NO_MEMORY.
+ */
+status_t vm_mmio_register(vm_t* vm, uint64_t base, uint64_t size, const vm_mmio_ops_t* ops, void* opaque)
+{
+    if ((NULL == vm) || (NULL == ops) || (0 == size) || gmem_contains(vm, base))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    if (vm->num_mmio >= VM_MAX_MMIO_REGIONS)
+    {
+        return STATUS_ERR_NO_MEMORY;
+    }
+
+    vm->mmio[vm->num_mmio].base   = base;
+    vm->mmio[vm->num_mmio].size   = size;
+    vm->mmio[vm->num_mmio].ops    = ops;
+    vm->mmio[vm->num_mmio].opaque = opaque;
+    vm->num_mmio++;
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Access an emulated MMIO register on behalf of a vCPU.
+ *
+ * @param vm The VM.
+ * @param ipa The register IPA.
+ * @param size Access size in bytes (1, 2, 4 or 8).
+ * @param write Non-zero for a store.
+ * @param value Value to store, or receives the loaded value.
+ * @return STATUS_OK, STATUS_ERR_INVALID or STATUS_ERR_NOT_FOUND if no
+ *         region covers the IPA.
+ */
+status_t vm_mmio_access(vm_t* vm, uint64_t ipa, uint32_t size, int write, uint64_t* value)
+{
+    vm_mmio_region_t* region = vm_mmio_find(vm, ipa);                                 /* Emulated region */
+    uint64_t          mask   = (8 == size) ? ~0x0ULL : ((1ULL << (size * 8)) - 1ULL); /* Access size mask */
+
+    if ((NULL == value) || (0 == size) || (size > 8) || (0 != (size & (size - 1))))
+    {
+        return STATUS_ERR_INVALID;
+    }
+
+    if (NULL == region)
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    if (write)
+    {
+        region->ops->write(region->opaque, ipa - region->base, size, *value & mask);
+    }
+    else
+    {
+        *value = region->ops->read(region->opaque, ipa - region->base, size) & mask;
+    }
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Handle a stage-2 abort taken by a vCPU.
+ *
+ * @param vcpu The faulting vCPU.
+ * @param esr The exception syndrome.
+ * @param ipa The faulting IPA.
+ * @return STATUS_OK if the guest can be resumed.
+ */
+status_t vm_handle_abort(vcpu_t* vcpu, uint64_t esr, uint64_t ipa)
+{
+    vm_t*             vm     = vcpu->vm; /* Faulting VM */
+    vm_mmio_region_t* region = NULL;     /* Emulated region */
+
+    if (gmem_contains(vm, ipa))
+    {
+        return gmem_handle_fault(vm, ipa, esr);
+    }
+
+    region = vm_mmio_find(vm, ipa);
+    if (NULL != region)
+    {
+        return vm_mmio_emulate(vcpu, region, esr, ipa);
+    }
+
+    return STATUS_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Raise a virtual interrupt in a VM.
+ *
+ * @param vm The VM.
+ * @param intid The virtual interrupt ID.
+ */
+void vm_irq_raise(vm_t* vm, uint32_t intid)
+{
+    vgic_inject(&vm->vcpus[0], intid);
+    sched_wake(&vm->vcpus[0]);
+}
+
+/**
+ * @brief Power off the VM of a vCPU at the guest's request.
+ *
+ * @param vcpu The requesting vCPU.
+ */
+void vm_shutdown(vcpu_t* vcpu)
+{
+    vm_t* vm = vcpu->vm; /* Owning VM */
+
+    LOG_INFO("VM%u: powered off by vCPU%u\n\r", vm->id, vcpu->id);
+
+    if (NULL != vm->on_shutdown)
+    {
+        vm->on_shutdown(vcpu);
+        return;
+    }
+
+    sched_report();
+    gmem_report(vm);
+    frame_report();
+    trace_dump(log_get_sink());
+    sched_exit(vcpu);
+}
+
+/**
+ * @brief Set the entry state of a vCPU.
+ *
+ * @param vcpu The vCPU.
+ * @param entry Guest entry point (IPA).
+ * @param arg Value passed in x0.
+ */
+void vcpu_reset(vcpu_t* vcpu, uint64_t entry, uint64_t arg)
+{
+    memset(&vcpu->ctx, 0x0, sizeof(vcpu->ctx));
+    memset(&vcpu->vgic, 0x0, sizeof(vcpu->vgic));
+
+    vcpu->ctx.x[0] = arg;
+    vcpu->ctx.elr  = entry;
+    vcpu->ctx.spsr = SPSR_EL1H_MASKED;
+
+    memset(&vcpu->el1, 0x0, sizeof(vcpu->el1));
+    vcpu->el1.sctlr = SCTLR_EL1_RESET;
+}
+
+/**
+ * @brief Save the EL1 system registers of the loaded vCPU.
+ *
+ * @param vcpu The vCPU currently loaded on the calling physical CPU.
+ */
+void vcpu_el1_save(vcpu_t* vcpu)
+{
+    vcpu_el1_t* el1 = &vcpu->el1; /* Saved state */
+
+    el1->sctlr      = SYSREG_READ(sctlr_el1);
+    el1->ttbr0      = SYSREG_READ(ttbr0_el1);
+    el1->ttbr1      = SYSREG_READ(ttbr1_el1);
+    el1->tcr        = SYSREG_READ(tcr_el1);
+    el1->mair       = SYSREG_READ(mair_el1);
+    el1->amair      = SYSREG_READ(amair_el1);
+    el1->vbar       = SYSREG_READ(vbar_el1);
+    el1->contextidr = SYSREG_READ(contextidr_el1);
+    el1->tpidr_el0  = SYSREG_READ(tpidr_el0);
+    el1->tpidrro    = SYSREG_READ(tpidrro_el0);
+    el1->tpidr      = SYSREG_READ(tpidr_el1);
+    el1->sp_el0     = SYSREG_READ(sp_el0);
+    el1->sp_el1     = SYSREG_READ(sp_el1);
+    el1->elr        = SYSREG_READ(elr_el1);
+    el1->spsr       = SYSREG_READ(spsr_el1);
+    el1->esr        = SYSREG_READ(esr_el1);
+    el1->far        = SYSREG_READ(far_el1);
+    el1->afsr0      = SYSREG_READ(afsr0_el1);
+    el1->afsr1      = SYSREG_READ(afsr1_el1);
+    el1->par        = SYSREG_READ(par_el1);
+    el1->cpacr      = SYSREG_READ(cpacr_el1);
+    el1->csselr     = SYSREG_READ(csselr_el1);
+    el1->cntkctl    = SYSREG_READ(cntkctl_el1);
+    el1->cntv_ctl   = SYSREG_READ(cntv_ctl_el0);
+    el1->cntv_cval  = SYSREG_READ(cntv_cval_el0);
+}
+
+/**
+ * @brief Load the EL1 system registers of a vCPU.
+ *
+ * @param vcpu The vCPU to load on the calling physical CPU.
+ */
+void vcpu_el1_restore(const vcpu_t* vcpu)
+{
+    const vcpu_el1_t* el1 = &vcpu->el1; /* Saved state */
+
+    SYSREG_WRITE(sctlr_el1, el1->sctlr);
+    SYSREG_WRITE(ttbr0_el1, el1->ttbr0);
+    SYSREG_WRITE(ttbr1_el1, el1->ttbr1);
+    SYSREG_WRITE(tcr_el1, el1->tcr);
+    SYSREG_WRITE(mair_el1, el1->mair);
+    SYSREG_WRITE(amair_el1, el1->amair);
+    SYSREG_WRITE(vbar_el1, el1->vbar);
+    SYSREG_WRITE(contextidr_el1, el1->contextidr);
+    SYSREG_WRITE(tpidr_el0, el1->tpidr_el0);
+    SYSREG_WRITE(tpidrro_el0, el1->tpidrro);
+    SYSREG_WRITE(tpidr_el1, el1->tpidr);
+    SYSREG_WRITE(sp_el0, el1->sp_el0);
+    SYSREG_WRITE(sp_el1, el1->sp_el1);
+    SYSREG_WRITE(elr_el1, el1->elr);
+    SYSREG_WRITE(spsr_el1, el1->spsr);
+    SYSREG_WRITE(esr_el1, el1->esr);
+    SYSREG_WRITE(far_el1, el1->far);
+    SYSREG_WRITE(afsr0_el1, el1->afsr0);
+    SYSREG_WRITE(afsr1_el1, el1->afsr1);
+    SYSREG_WRITE(par_el1, el1->par);
+    SYSREG_WRITE(cpacr_el1, el1->cpacr);
+    SYSREG_WRITE(csselr_el1, el1->csselr);
+    SYSREG_WRITE(cntkctl_el1, el1->cntkctl);
+    SYSREG_WRITE(cntv_cval_el0, el1->cntv_cval);
+    SYSREG_WRITE(cntv_ctl_el0, el1->cntv_ctl);
+}
+
+/**
+ * @brief Make a vCPU the one loaded on the calling physical CPU.
+ *
+ * @param vcpu The vCPU, no other vCPU may be loaded.
+ */
+void vcpu_load(vcpu_t* vcpu)
+{
+    SYSREG_WRITE(vmpidr_el2, VMPIDR_EL2_RES1 | vcpu->id);
+    vcpu_sync_traps(vcpu);
+
+    vcpu_el1_restore(vcpu);
+    vgic_restore(vcpu);
+
+    stage2_activate(&vcpu->vm->s2);
+
+    SYSREG_WRITE(tpidr_el2, (uintptr_t)vcpu);
+    ISB();
+}
+
+/**
+ * @brief Bring the trap configuration of the loaded vCPU up to date.
+ *
+ * Called on every guest entry, so HCR_EL2 is only written when the VM's
+ * TLBI trap or the vCPU's WFE trap was armed or disarmed since.
+ *
+ * @param vcpu The vCPU loaded on the calling physical CPU.
+ */
+void vcpu_sync_traps(vcpu_t* vcpu)
+{
+    uint64_t hcr = HCR_EL2_GUEST; /* Wanted configuration */
+
+    if (0 != __atomic_load_n(&vcpu->vm->xlate_trap, __ATOMIC_ACQUIRE))
+    {
+        hcr |= HCR_EL2_TTLB;
+    }
+    if (0 != vcpu->yield_trap)
+    {
+        hcr |= HCR_EL2_TWE;
+    }
+
+    if (SYSREG_READ(hcr_el2) != hcr)
+    {
+        SYSREG_WRITE(hcr_el2, hcr);
+        ISB();
+    }
+}
+
+/**
+ * @brief Unload the vCPU loaded on the calling physical CPU.
+ *
+ * @param vcpu The loaded vCPU.
+ */
+void vcpu_put(vcpu_t* vcpu)
+{
+    vcpu_el1_save(vcpu);
+    vgic_save(vcpu);
+
+    /* Its deadline is tracked by the scheduler while it is off the CPU */
+    SYSREG_WRITE(cntv_ctl_el0, vcpu->el1.cntv_ctl & ~CNTV_CTL_ENABLE);
+
+    SYSREG_WRITE(tpidr_el2, 0x0ULL);
+    ISB();
+}
+
+/**
+ * @brief Run a vCPU on the calling physical CPU.
+ *
+ * @param vcpu The vCPU.
+ */
+void vcpu_run(vcpu_t* vcpu)
+{
+    uint64_t cnthctl = SYSREG_READ(cnthctl_el2); /* Keeps the event stream set up by sync_cpu_init() */
+
+    SYSREG_WRITE(cnthctl_el2, cnthctl | CNTHCTL_EL2_EL1PCTEN | CNTHCTL_EL2_EL1PCEN);
+    SYSREG_WRITE(cntvoff_el2, 0x0ULL);
+
+    vcpu_load(vcpu);
+
+    trap_guest_enter();
+}
@@ -0,0 +1,245 @@
+/**
+ * @file vm_config.c
+ * @brief Static VM configuration.
+ *
+ * This file contains the functions that bring up the VMs described by the
+ * configuration tables generated at build time.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The tables and the VM, channel and device instances are generated from
+ * config/vm_config.cmake into vm_config_table.c. The layout was checked
+ * when the tables were generated, so launch failures here only come from
+ * running out of frames.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Bring-up of the statically configured VMs.
+ */
+
+/* this module's header */
+#include "vm_config.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* project includes */
+#include "logging.h"
+#include "sched.h"
+#include "smp.h"
+#include "stage2.h"
+
+#if VM_CONFIG_NUM_VMS > 0
+/**
+ * @brief Get the stage-2 attributes of a region type.
+ *
+ * @param type The region type.
+ * @return Stage-2 descriptor attributes.
+ */
+static uint64_t vm_config_region_attr(vm_config_region_type_t type)
+{
+    switch (type)
+    {
+    case VM_CONFIG_REGION_READONLY:
+        return STAGE2_MEM_NORMAL & ~S2_PTE_S2AP_W;
+    case VM_CONFIG_REGION_DEVICE:
+        return STAGE2_MEM_DEVICE;
+    default:
+        return STAGE2_MEM_NORMAL;
+    }
+}
+
+/**
+ * @brief Create one configured VM.
+ *
+ * @param cfg The VM configuration.
+ * @param vm The VM instance.
+ * @return STATUS_OK or the first error.
+ */
+static status_t vm_config_create(const vm_config_t* cfg, vm_t* vm)
+{
+    status_t status = STATUS_OK; /* Creation status */
+
+    status = vm_init(vm, cfg->id, cfg->ram_ipa, cfg->ram_size, cfg->num_vcpus);
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+
+    for (uint32_t i = 0; i < cfg->num_regions; ++i)
+    {
+        const vm_config_region_t* region = &cfg->regions[i]; /* Region to map */
+
+        status = stage2_map(&vm->s2, region->ipa, region->pa, region->size, vm_config_region_attr(region->type));
+        if (STATUS_OK != status)
+        {
+            return status;
+        }
+    }
+
+    for (uint32_t i = 0; i < cfg->num_devices; ++i)
+    {
+        const vm_config_device_t* device = &cfg->devices[i]; /* Device to attach */
+
+        switch (device->type)
+        {
+#if VM_CONFIG_NUM_BALLOONS > 0
+        case VM_CONFIG_DEVICE_VIRTIO_BALLOON:
+            status = virtio_balloon_init(&vm_config_balloons[device->instance], vm, device->base, device->irq);
+            break;
+#endif
+        default:
+            status = STATUS_ERR_INVALID;
+            break;
+        }
+
+        if (STATUS_OK != status)
+        {
+            return status;
+        }
+    }
+
+#if VM_CONFIG_NUM_PASSTHROUGHS > 0
+    for (uint32_t i = 0; i < cfg->num_passthroughs; ++i)
+    {
+        const vm_config_passthrough_t* pt = &cfg->passthroughs[i]; /* Device to assign */
+
+        status = passthrough_assign(&vm_config_passthroughs[pt->instance], vm, pt->ipa, pt->pa, pt->size, pt->irq);
+        if (STATUS_OK != status)
+        {
+            return status;
+        }
+    }
+#endif
+
+    for (uint32_t i = 0; i < cfg->num_vcpus; ++i)
+    {
+        vcpu_reset(&vm->vcpus[i], cfg->entry, 0);
+    }
+
+    return STATUS_OK;
+}
+#endif
+
+/**
+ * @brief Create every configured VM.
+ *
+ * Initializes the VMs, maps their regions, attaches their emulated and
+ * passthrough devices, creates the channels between them and resets all
+ * vCPUs to their entry point.
+ * The frame allocator must be initialized.
+ *
+ * @return STATUS_OK or the first error, which is logged.
+ */
+status_t vm_config_launch(void)
+{
+    status_t status = STATUS_OK; /* Launch status */
+
+#if VM_CONFIG_NUM_VMS > 0
+    for (uint32_t i = 0; i < VM_CONFIG_NUM_VMS; ++i)
+    {
+        const vm_config_t* cfg = &vm_config_table[i]; /* VM to create */
+
+        status = vm_config_create(cfg, &vm_config_vms[i]);
+        if (STATUS_OK != status)
+        {
+            LOG_ERR("VM '%s' failed to start (%d)\n\r", cfg->name, status);
+            return status;
+        }
+
+        LOG_INFO("VM '%s': id %u, %u vCPU(s), %lu KB RAM, entry 0x%lx\n\r", cfg->name, cfg->id,
+                 cfg->num_vcpus, cfg->ram_size >> 10, cfg->entry);
+    }
+#endif
+
+#if VM_CONFIG_NUM_CHANNELS > 0
+    for (uint32_t i = 0; i < VM_CONFIG_NUM_CHANNELS; ++i)
+    {
+        const vm_config_channel_t* cfg = &vm_config_channel_table[i]; /* Channel to create */
+        channel_endpoint_t         ep[2];                              /* Resolved endpoints */
+
+        for (uint32_t n = 0; n < 2; ++n)
+        {
+            ep[n].vm  = &vm_config_vms[cfg->ep[n].vm];
+            ep[n].ipa = cfg->ep[n].ipa;
+            ep[n].irq = cfg->ep[n].irq;
+        }
+
+        status = channel_create(&vm_config_channels[i], &ep[0], &ep[1]);
+        if (STATUS_OK != status)
+        {
+            LOG_ERR("Channel %u between '%s' and '%s' failed (%d)\n\r", i,
+                      vm_config_table[cfg->ep[0].vm].name, vm_config_table[cfg->ep[1].vm].name, status);
+            return status;
+        }
+    }
+#endif
+
+    return status;
+}
+
+/**
+ * @brief Place the vCPUs of every VM with a guest image on CPUs.
+ *
+ * @return The number of vCPUs placed.
+ */
+uint32_t vm_config_schedule(void)
+{
+    uint32_t placed = 0; /* vCPUs in run queues */
+
+#if VM_CONFIG_NUM_VMS > 0
+    for (uint32_t i = 0; i < VM_CONFIG_NUM_VMS; ++i)
+    {
+        const vm_config_t* cfg = &vm_config_table[i]; /* VM to place */
+        uint64_t           pa  = 0;                   /* Backing of the entry point */
+
+        /* Guest RAM is demand-paged and starts out zeroed, an image must sit in a region */
+        if ((STATUS_OK != stage2_lookup(&vm_config_vms[i].s2, cfg->entry, &pa, NULL)) ||
+            (0 == *(volatile uint32_t*)(uintptr_t)pa))
+        {
+            LOG_INFO("VM '%s': no guest image, not scheduled\n\r", cfg->name);
+            continue;
+        }
+
+        if (STATUS_OK != sched_add(&vm_config_vms[i].vcpus[0], i % SMP_MAX_CPUS))
+        {
+            continue;
+        }
+        ++placed;
+
+        for (uint32_t n = 1; n < cfg->num_vcpus; ++n)
+        {
+            if (STATUS_OK == sched_add_off(&vm_config_vms[i].vcpus[n], (i + n) % SMP_MAX_CPUS))
+            {
+                ++placed;
+            }
+        }
+    }
+#endif
+
+    return placed;
+}
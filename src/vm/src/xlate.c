@@ -0,0 +1,595 @@
+/**
+ * @file xlate.c
+ * @brief Guest address translation with a per-vCPU cache.
+ *
+ * This file contains the implementation of guest virtual address and IPA
+ * translation for emulation code, the per-vCPU translation cache and its
+ * invalidation.
+ *
+ * @date 2026-10-18
+ * @version 1.0
+ * @author Charles Fulton Greiner
+ *
+ * @details
+ * The cache is only touched by the physical CPU the vCPU runs on, so it
+ * needs no lock; staleness is detected with generation counters. The
+ * stage-2 generation is bumped by every stage-2 TLB invalidation, which
+ * covers unmapping and permission changes; new mappings never make a
+ * cached translation wrong. The VM's TLBI generation is bumped by every
+ * trapped guest TLBI. Guest TLBIs are trapped from the first cached
+ * virtual address translation until the next TLBI. A vCPU that is inside
+ * the guest while the trap is armed only picks it up at its next exit, so
+ * a TLBI it issues right then is missed; the scheduler tick bounds that
+ * window.
+ *
+ * @section license License
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @section description Description
+ * Implementation of guest address translation.
+ */
+
+/* this module's header */
+#include "xlate.h"
+
+/* standard includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "frame.h"
+#include "gmem.h"
+#include "stage2.h"
+#include "sysreg.h"
+#include "trap.h"
+#include "vm.h"
+
+/* Cache entry tag flags */
+#define XLATE_TAG_VALID (1ULL << 0) /**< Entry in use */
+#define XLATE_TAG_IPA   (1ULL << 1) /**< Input is an IPA, not a virtual address */
+
+/* Stage-1 walk with the 4KB granule */
+#define XLATE_LEVEL_BITS  (9U)         /**< Index bits resolved per level */
+#define XLATE_LEVEL_LAST  (3U)         /**< Level of page descriptors */
+#define XLATE_TXSZ_MIN    (16ULL)      /**< Largest input range, 48 bits */
+#define XLATE_TXSZ_MAX    (39ULL)      /**< Smallest input range, 25 bits */
+#define XLATE_VA_TTBR1    (1ULL << 55) /**< Selects TTBR1_EL1 */
+#define XLATE_VA_TOP_BYTE (56U)        /**< First bit ignored with TBI */
+
+/* Input address bits below the index of a level */
+#define XLATE_LEVEL_SHIFT(level) (FRAME_SHIFT + (XLATE_LEVEL_BITS * (XLATE_LEVEL_LAST - (level))))
+
+/* System Control Register (EL1) */
+#define SCTLR_EL1_M (1ULL << 0) /**< Stage-1 translation enabled */
+
+/* Translation Control Register (EL1) */
+#define TCR_EL1_T0SZ(tcr) ((tcr) & 0x3FULL)         /**< TTBR0 region size offset */
+#define TCR_EL1_EPD0      (1ULL << 7)               /**< TTBR0 walks disabled */
+#define TCR_EL1_TG0(tcr)  (((tcr) >> 14) & 0x3ULL)  /**< TTBR0 granule */
+#define TCR_EL1_TG0_4KB   (0x0ULL)                  /**< 4KB granule encoding of TG0 */
+#define TCR_EL1_T1SZ(tcr) (((tcr) >> 16) & 0x3FULL) /**< TTBR1 region size offset */
+#define TCR_EL1_EPD1      (1ULL << 23)              /**< TTBR1 walks disabled */
+#define TCR_EL1_TG1(tcr)  (((tcr) >> 30) & 0x3ULL)  /**< TTBR1 granule */
+#define TCR_EL1_TG1_4KB   (0x2ULL)                  /**< 4KB granule encoding of TG1 */
+#define TCR_EL1_TBI0      (1ULL << 37)              /**< Top byte ignored, TTBR0 */
+#define TCR_EL1_TBI1      (1ULL << 38)              /**< Top byte ignored, TTBR1 */
+
+#define TTBR_BADDR_MASK (0x0000FFFFFFFFFFFEULL) /**< Table base address */
+
+/* Stage-1 descriptor bits */
+#define S1_DESC_VALID     (1ULL << 0)             /**< Valid descriptor */
+#define S1_DESC_TABLE     (1ULL << 1)             /**< Table (levels 0-2) or page (level 3) */
+#define S1_DESC_ADDR_MASK (0x0000FFFFFFFFF000ULL) /**< Output address mask */
+
+/* PAR_EL1 memory attributes of a successful translation */
+#define PAR_EL1_ATTR(par)       ((par) >> 56) /**< MAIR encoding of the combined attributes */
+#define PAR_EL1_ATTR_OUTER_MASK (0xF0ULL)     /**< Zero for Device memory */
+
+/* TLB maintenance instructions are SYS #op1, C8, Cm, #op2 */
+#define ESR_SYS_OP0_SYS (1ULL) /**< Op0 of SYS instructions */
+#define ESR_SYS_CRN_TLB (8ULL) /**< CRn of TLB maintenance */
+
+/**
+ * @brief Stage-1 translation context of a vCPU.
+ */
+typedef struct xlate_s1
+{
+    uint64_t sctlr; /**< SCTLR_EL1 */
+    uint64_t tcr;   /**< TCR_EL1 */
+    uint64_t ttbr0; /**< TTBR0_EL1 */
+    uint64_t ttbr1; /**< TTBR1_EL1 */
+} xlate_s1_t;
+
+/**
+ * @brief Check whether a vCPU is loaded on the calling physical CPU.
+ *
+ * @param vcpu The vCPU.
+ * @return Non-zero if its EL1 registers are live.
+ */
+static int xlate_loaded(const vcpu_t* vcpu)
+{
+    return vcpu_current() == vcpu;
+}
+
+/**
+ * @brief Read the stage-1 translation context of a vCPU.
+ *
+ * @param vcpu The vCPU.
+ * @param s1 Receives the context.
+ */
+static void xlate_s1_read(const vcpu_t* vcpu, xlate_s1_t* s1)
+{
+    if (xlate_loaded(vcpu))
+    {
+        s1->sctlr = SYSREG_READ(sctlr_el1);
+        s1->tcr   = SYSREG_READ(tcr_el1);
+        s1->ttbr0 = SYSREG_READ(ttbr0_el1);
+        s1->ttbr1 = SYSREG_READ(ttbr1_el1);
+    }
+    else
+    {
+        s1->sctlr = vcpu->el1.sctlr;
+        s1->tcr   = vcpu->el1.tcr;
+        s1->ttbr0 = vcpu->el1.ttbr0;
+        s1->ttbr1 = vcpu->el1.ttbr1;
+    }
+}
+
+/**
+ * @brief Drop the cache if the VM's translations changed since it was filled.
+ *
+ * @param vcpu The vCPU.
+ */
+static void xlate_validate(vcpu_t* vcpu)
+{
+    xlate_cache_t* cache    = &vcpu->xlate;                                            /* The cache */
+    uint32_t       s2_gen   = __atomic_load_n(&vcpu->vm->s2.gen, __ATOMIC_ACQUIRE);   /* Current stage-2 generation */
+    uint32_t       tlbi_gen = __atomic_load_n(&vcpu->vm->tlbi_gen, __ATOMIC_ACQUIRE); /* Current TLBI generation */
+
+    if ((cache->s2_gen != s2_gen) || (cache->tlbi_gen != tlbi_gen))
+    {
+        xlate_flush(vcpu);
+        cache->s2_gen   = s2_gen;
+        cache->tlbi_gen = tlbi_gen;
+    }
+}
+
+/**
+ * @brief Look a page up in the cache.
+ *
+ * @param cache The cache.
+ * @param tag Tag of the page.
+ * @param pa Receives the page address of the output.
+ * @return Non-zero on a hit.
+ */
+static int xlate_lookup(xlate_cache_t* cache, uint64_t tag, uint64_t* pa)
+{
+    for (uint32_t i = 0; i < XLATE_CACHE_SIZE; ++i)
+    {
+        if (cache->entry[i].tag == tag)
+        {
+            *pa = cache->entry[i].pa;
+            cache->stats.hits++;
+            return 1;
+        }
+    }
+
+    cache->stats.misses++;
+
+    return 0;
+}
+
+/**
+ * @brief Add a translation to the cache, replacing the oldest entry.
+ *
+ * @param cache The cache.
+ * @param tag Tag of the page.
+ * @param pa Page address of the output.
+ */
+static void xlate_insert(xlate_cache_t* cache, uint64_t tag, uint64_t pa)
+{
+    cache->entry[cache->next].tag = tag;
+    cache->entry[cache->next].pa  = pa;
+    cache->next                   = (cache->next + 1U) % XLATE_CACHE_SIZE;
+}
+
+/**
+ * @brief Translate an IPA through the VM's stage-2 tables.
+ *
+ * @param vm The VM.
+ * @param ipa The IPA.
+ * @param pa Receives the physical address.
+ * @param device Receives non-zero if the IPA is mapped as Device memory.
+ * @return STATUS_OK or STATUS_ERR_NOT_FOUND.
+ */
+static status_t xlate_stage2(vm_t* vm, uint64_t ipa, uint64_t* pa, int* device)
+{
+    uint64_t attr   = 0x0ULL;                                 /* Descriptor attributes */
+    status_t status = stage2_lookup(&vm->s2, ipa, pa, &attr); /* Lookup status */
+
+    *device = ((attr & S2_PTE_MEM_MASK) == S2_PTE_MEM_DEVICE);
+
+    return status;
+}
+
+/**
+ * @brief Walk the guest's stage-1 tables in software.
+ *
+ * Table descriptors are read through the VM's stage-2 tables, so tables
+ * that are not resident make the walk fail. Permissions and the access
+ * flag are not checked.
+ *
+ * @param vm The VM.
+ * @param s1 The stage-1 context.
+ * @param va The guest virtual address.
+ * @param ipa Receives the IPA.
+ * @return STATUS_OK, STATUS_ERR_NOT_FOUND or STATUS_ERR_NOT_SUPPORTED for
+ *         granules other than 4KB.
+ */
+static status_t xlate_s1_walk(vm_t* vm, const xlate_s1_t* s1, uint64_t va, uint64_t* ipa)
+{
+    int      upper  = (0 != (va & XLATE_VA_TTBR1));                            /* Upper range, TTBR1 */
+    uint64_t txsz   = upper ? TCR_EL1_T1SZ(s1->tcr) : TCR_EL1_T0SZ(s1->tcr);   /* Region size offset */
+    int      tbi    = (0 != (s1->tcr & (upper ? TCR_EL1_TBI1 : TCR_EL1_TBI0))); /* Top byte ignored */
+    uint64_t table  = (upper ? s1->ttbr1 : s1->ttbr0) & TTBR_BADDR_MASK;       /* Current table IPA */
+    uint64_t bits   = 0;                                                       /* Input address bits */
+    uint64_t range  = 0x0ULL;                                                  /* Upper bits that must match bit 55 */
+    uint32_t level  = 0;                                                       /* Current level */
+    uint64_t pa     = 0x0ULL;                                                  /* Descriptor address */
+    int      device = 0;                                                       /* Table in Device memory */
+
+    if (!(s1->sctlr & SCTLR_EL1_M))
+    {
+        *ipa = va;
+        return STATUS_OK;
+    }
+
+    if ((upper ? TCR_EL1_TG1(s1->tcr) != TCR_EL1_TG1_4KB : TCR_EL1_TG0(s1->tcr) != TCR_EL1_TG0_4KB))
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    if ((s1->tcr & (upper ? TCR_EL1_EPD1 : TCR_EL1_EPD0)) || (txsz < XLATE_TXSZ_MIN) || (txsz > XLATE_TXSZ_MAX))
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    bits  = 64ULL - txsz;
+    range = ~((1ULL << bits) - 1ULL);
+    if (tbi)
+    {
+        range &= (1ULL << XLATE_VA_TOP_BYTE) - 1ULL;
+    }
+    if ((va & range) != (upper ? range : 0x0ULL))
+    {
+        return STATUS_ERR_NOT_FOUND;
+    }
+
+    /* Each level resolves XLATE_LEVEL_BITS, the first one what is left */
+    level = XLATE_LEVEL_LAST - (uint32_t)((bits - FRAME_SHIFT - 1ULL) / XLATE_LEVEL_BITS);
+    va &= (1ULL << bits) - 1ULL;
+
+    for (;;)
+    {
+        uint64_t shift = XLATE_LEVEL_SHIFT(level);                             /* Input bits below the index */
+        uint64_t index = (va >> shift) & ((1ULL << XLATE_LEVEL_BITS) - 1ULL); /* Descriptor index */
+        uint64_t desc  = 0x0ULL;                                               /* Descriptor */
+
+        if ((STATUS_OK != xlate_stage2(vm, table + (index * sizeof(uint64_t)), &pa, &device)) || device)
+        {
+            return STATUS_ERR_NOT_FOUND;
+        }
+
+        desc = __atomic_load_n((const uint64_t*)(uintptr_t)pa, __ATOMIC_RELAXED); /* The guest may be editing it */
+        if (!(desc & S1_DESC_VALID))
+        {
+            return STATUS_ERR_NOT_FOUND;
+        }
+
+        if (XLATE_LEVEL_LAST == level)
+        {
+            if (!(desc & S1_DESC_TABLE))
+            {
+                return STATUS_ERR_NOT_FOUND;
+            }
+            *ipa = (desc & S1_DESC_ADDR_MASK) | (va & ~FRAME_MASK);
+            return STATUS_OK;
+        }
+
+        if (desc & S1_DESC_TABLE)
+        {
+            table = desc & S1_DESC_ADDR_MASK;
+            level++;
+            continue;
+        }
+
+        /* 1GB and 2MB blocks, there are none at level 0 */
+        if (0 == level)
+        {
+            return STATUS_ERR_NOT_FOUND;
+        }
+        *ipa = (desc & S1_DESC_ADDR_MASK & ~((1ULL << shift) - 1ULL)) | (va & ((1ULL << shift) - 1ULL));
+        return STATUS_OK;
+    }
+}
+
+/**
+ * @brief Translate a guest virtual address without the cache.
+ *
+ * @param vcpu The vCPU.
+ * @param s1 Its stage-1 context.
+ * @param va The guest virtual address.
+ * @param pa Receives the physical address.
+ * @param device Receives non-zero if the address is Device memory.
+ * @return STATUS_OK, STATUS_ERR_NOT_FOUND or STATUS_ERR_NOT_SUPPORTED.
+ */
+static status_t xlate_va_walk(vcpu_t* vcpu, const xlate_s1_t* s1, uint64_t va, uint64_t* pa, int* device)
+{
+    uint64_t ipa    = 0x0ULL;    /* Stage-1 output */
+    status_t status = STATUS_OK; /* Walk status */
+
+    if (xlate_loaded(vcpu))
+    {
+        uint64_t saved = SYSREG_READ(par_el1); /* Guest PAR_EL1 */
+        uint64_t par   = 0x0ULL;               /* Translation result */
+
+        AT(s12e1r, va);
+        ISB();
+        par = SYSREG_READ(par_el1);
+        SYSREG_WRITE(par_el1, saved);
+
+        if (!(par & PAR_EL1_F))
+        {
+            vcpu->xlate.stats.at_walks++;
+            *pa     = (par & PAR_EL1_PA_MASK) | (va & ~FRAME_MASK);
+            *device = (0 == (PAR_EL1_ATTR(par) & PAR_EL1_ATTR_OUTER_MASK));
+            return STATUS_OK;
+        }
+    }
+
+    /* Not loaded, or the hardware walk aborted: find out in software */
+    vcpu->xlate.stats.sw_walks++;
+
+    status = xlate_s1_walk(vcpu->vm, s1, va, &ipa);
+    if (STATUS_OK != status)
+    {
+        return status;
+    }
+
+    return xlate_stage2(vcpu->vm, ipa, pa, device);
+}
+
+/**
+ * @brief Translate a guest virtual address, through the cache.
+ *
+ * @param vcpu The vCPU.
+ * @param va The guest virtual address.
+ * @param pa Receives the physical address.
+ * @param device Receives non-zero if the address is Device memory.
+ * @return STATUS_OK, STATUS_ERR_NOT_FOUND or STATUS_ERR_NOT_SUPPORTED.
+ */
+static status_t xlate_va_cached(vcpu_t* vcpu, uint64_t va, uint64_t* pa, int* device)
+{
+    xlate_cache_t* cache  = &vcpu->xlate;                         /* The cache */
+    uint64_t       tag    = (va & FRAME_MASK) | XLATE_TAG_VALID; /* Cache tag */
+    uint64_t       out    = 0x0ULL;                               /* Translation */
+    status_t       status = STATUS_OK;                            /* Walk status */
+    xlate_s1_t     s1;                                            /* Stage-1 context */
+
+    xlate_s1_read(vcpu, &s1);
+    xlate_validate(vcpu);
+
+    if ((cache->sctlr != s1.sctlr) || (cache->tcr != s1.tcr) ||
+        (cache->ttbr0 != s1.ttbr0) || (cache->ttbr1 != s1.ttbr1))
+    {
+        xlate_flush(vcpu);
+        cache->sctlr = s1.sctlr;
+        cache->tcr   = s1.tcr;
+        cache->ttbr0 = s1.ttbr0;
+        cache->ttbr1 = s1.ttbr1;
+    }
+
+    if (xlate_lookup(cache, tag, &out))
+    {
+        *pa     = out | (va & ~FRAME_MASK);
+        *device = 0;
+        return STATUS_OK;
+    }
+
+    status = xlate_va_walk(vcpu, &s1, va, pa, device);
+    if ((STATUS_OK == status) && !*device)
+    {
+        /* Guest TLBIs must be seen from now on */
+        if (0 == __atomic_load_n(&vcpu->vm->xlate_trap, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(&vcpu->vm->xlate_trap, 1U, __ATOMIC_RELEASE);
+        }
+        xlate_insert(cache, tag, *pa & FRAME_MASK);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Translate a guest IPA, through the cache.
+ *
+ * @param vcpu The vCPU.
+ * @param ipa The IPA.
+ * @param pa Receives the physical address.
+ * @param device Receives non-zero if the IPA is mapped as Device memory.
+ * @return STATUS_OK or STATUS_ERR_NOT_FOUND.
+ */
+static status_t xlate_ipa_cached(vcpu_t* vcpu, uint64_t ipa, uint64_t* pa, int* device)
+{
+    xlate_cache_t* cache  = &vcpu->xlate;                                          /* The cache */
+    uint64_t       tag    = (ipa & FRAME_MASK) | XLATE_TAG_IPA | XLATE_TAG_VALID; /* Cache tag */
+    uint64_t       out    = 0x0ULL;                                                /* Translation */
+    status_t       status = STATUS_OK;                                             /* Lookup status */
+
+    xlate_validate(vcpu);
+
+    if (xlate_lookup(cache, tag, &out))
+    {
+        *pa     = out | (ipa & ~FRAME_MASK);
+        *device = 0;
+        return STATUS_OK;
+    }
+
+    cache->stats.sw_walks++;
+
+    status = xlate_stage2(vcpu->vm, ipa, pa, device);
+    if ((STATUS_OK == status) && !*device)
+    {
+        xlate_insert(cache, tag, *pa & FRAME_MASK);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Translate a guest IPA.
+ *
+ * @param vcpu The vCPU on whose behalf the translation is done.
+ * @param ipa The IPA.
+ * @param pa Receives the physical address.
+ * @return STATUS_OK or STATUS_ERR_NOT_FOUND if the IPA is not mapped.
+ */
+status_t xlate_ipa(vcpu_t* vcpu, uint64_t ipa, uint64_t* pa)
+{
+    int device = 0; /* Unused */
+
+    return xlate_ipa_cached(vcpu, ipa, pa, &device);
+}
+
+/**
+ * @brief Translate a guest virtual address through both stages.
+ *
+ * @param vcpu The vCPU on whose behalf the translation is done.
+ * @param va The guest virtual address.
+ * @param pa Receives the physical address.
+ * @return STATUS_OK, STATUS_ERR_NOT_FOUND if either stage does not map
+ *         the address, or STATUS_ERR_NOT_SUPPORTED if the guest uses a
+ *         granule other than 4KB.
+ */
+status_t xlate_va(vcpu_t* vcpu, uint64_t va, uint64_t* pa)
+{
+    int device = 0; /* Unused */
+
+    return xlate_va_cached(vcpu, va, pa, &device);
+}
+
+/**
+ * @brief Get a hypervisor pointer to resident guest RAM by IPA.
+ *
+ * @param vcpu The vCPU on whose behalf the access is done.
+ * @param ipa Start IPA.
+ * @param len Length of the access, must not cross a page.
+ * @return Pointer to the memory, or NULL if the range is not resident
+ *         guest RAM.
+ */
+void* xlate_ipa_to_host(vcpu_t* vcpu, uint64_t ipa, uint64_t len)
+{
+    uint64_t pa     = 0x0ULL; /* Translated address */
+    int      device = 0;      /* Mapped as Device memory */
+
+    if ((0 == len) || (((ipa & ~FRAME_MASK) + len) > FRAME_SIZE) || !gmem_contains(vcpu->vm, ipa))
+    {
+        return NULL;
+    }
+
+    if ((STATUS_OK != xlate_ipa_cached(vcpu, ipa, &pa, &device)) || device)
+    {
+        return NULL;
+    }
+
+    return (void*)(uintptr_t)pa;
+}
+
+/**
+ * @brief Get a hypervisor pointer to guest memory by virtual address.
+ *
+ * @param vcpu The vCPU on whose behalf the access is done.
+ * @param va Start guest virtual address.
+ * @param len Length of the access, must not cross a page.
+ * @return Pointer to the memory, or NULL if the range is not mapped to
+ *         normal memory.
+ */
+void* xlate_va_to_host(vcpu_t* vcpu, uint64_t va, uint64_t len)
+{
+    uint64_t pa     = 0x0ULL; /* Translated address */
+    int      device = 0;      /* Device memory */
+
+    if ((0 == len) || (((va & ~FRAME_MASK) + len) > FRAME_SIZE))
+    {
+        return NULL;
+    }
+
+    if ((STATUS_OK != xlate_va_cached(vcpu, va, &pa, &device)) || device)
+    {
+        return NULL;
+    }
+
+    return (void*)(uintptr_t)pa;
+}
+
+/**
+ * @brief Drop all cached translations of a vCPU.
+ *
+ * @param vcpu The vCPU.
+ */
+void xlate_flush(vcpu_t* vcpu)
+{
+    memset(vcpu->xlate.entry, 0x0, sizeof(vcpu->xlate.entry));
+    vcpu->xlate.next = 0;
+    vcpu->xlate.stats.flushes++;
+}
+
+/**
+ * @brief Handle a trapped guest TLB maintenance instruction.
+ *
+ * Every guest TLBI is widened to TLBI VMALLE1IS, which is always safe.
+ *
+ * @param vcpu The trapping vCPU.
+ * @param esr The exception syndrome (EC 0x18).
+ * @return STATUS_OK, or STATUS_ERR_NOT_SUPPORTED if the trapped
+ *         instruction is not a TLBI.
+ */
+status_t xlate_handle_tlbi(vcpu_t* vcpu, uint64_t esr)
+{
+    vm_t* vm = vcpu->vm; /* Trapping VM */
+
+    if ((ESR_SYS_OP0_SYS != ESR_SYS_OP0(esr)) || (ESR_SYS_CRN_TLB != ESR_SYS_CRN(esr)))
+    {
+        return STATUS_ERR_NOT_SUPPORTED;
+    }
+
+    /* Disarm first: a vCPU caching after the bump re-arms for good */
+    __atomic_store_n(&vm->xlate_trap, 0U, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&vm->tlbi_gen, 1U, __ATOMIC_ACQ_REL);
+
+    DSB(ishst);
+    TLBI(vmalle1is);
+    DSB(ish);
+    ISB();
+
+    return STATUS_OK;
+}
@@ -1,10 +1,55 @@
+#include "channel.h"
+#include "frame.h"
+#include "hypercall.h"
+#include "logging.h"
 #include "mmu.h"
+#include "passthrough.h"
+#include "platform.h"
+#include "sched.h"
+#include "smp.h"
+#include "snapshot.h"
+#include "stage2.h"
+#include "sync.h"
+#include "trace.h"
+#include "trap.h"
 #include "unity.h"
+#include "vm.h"
+#include "vm_config.h"
+#include "xlate.h"
+#include <stdio.h>
 #include <string.h>
 
 #define PAGE_TABLE_ADDR_SHIFT (0x40000000000ULL) /* shift for the mirrored address */
 
-static char message[32] = { 0 }; /* MMU test buffer */
+#define GUEST_RAM_IPA  (0x40000000ULL) /* guest RAM base used by the VM tests */
+#define GUEST_RAM_SIZE (0x1000000ULL)  /* 16MB of guest RAM */
+
+/* ESR of a level 3 stage-2 translation fault on a data access */
+#define ESR_DABT_TRANS_L3 ((ESR_EC_DABT_LOW << ESR_EC_SHIFT) | ESR_FSC_TRANS | 0x3ULL)
+
+/* ESR of a level 3 stage-2 permission fault on a data write */
+#define ESR_DABT_PERM_W_L3 ((ESR_EC_DABT_LOW << ESR_EC_SHIFT) | ESR_DABT_WNR | ESR_FSC_PERM | 0x3ULL)
+
+/* ESR of a trapped TLBI VMALLE1IS (op0 1, op1 0, CRn 8, CRm 3, op2 0) */
+#define ESR_SYS_TLBI_VMALLE1IS ((ESR_EC_SYS64 << ESR_EC_SHIFT) | (1ULL << 20) | (8ULL << 10) | (3ULL << 1))
+
+/* ESR of a trapped MSR ICC_SGI1R_EL1, x5 (op0 3, op1 0, CRn 12, CRm 11, op2 5) */
+#define ESR_SYS_SGI1R_X5 ((ESR_EC_SYS64 << ESR_EC_SHIFT) | (3ULL << 20) | (5ULL << 17) | (12ULL << 10) | (5ULL << 5) | (11ULL << 1))
+
+/* ESR of an HVC #0 */
+#define ESR_HVC_0 ((ESR_EC_HVC64 << ESR_EC_SHIFT) | ESR_IL)
+
+/* Entry point a test guest gives its secondary vCPU */
+#define GUEST_SECONDARY_ENTRY (GUEST_RAM_IPA + 0x8000ULL)
+
+extern char __frame_pool_start__; /* Defined by the linker */
+
+static char message[32] = { 0 };               /* MMU test buffer */
+static vm_t test_vm;                           /* VM used by the VM tests */
+static vm_t test_peer;                         /* second VM for the channel tests */
+static channel_t test_channel;                 /* channel between the two test VMs */
+static trace_event_t test_trace[TRACE_EVENTS]; /* trace snapshot for the tracing test */
+static uint8_t test_page[FRAME_SIZE];          /* expected page contents */
 
 void setUp(void)
 {
@@ -68,12 +113,720 @@ void test_memory_access(void)
     translation_table[1] = old_entry;
 }
 
+void test_stage2_map_lookup(void)
+{
+    stage2_t s2;
+    uint64_t frame = frame_alloc();
+    uint64_t pa = 0x0ULL;
+    uint64_t attr = 0x0ULL;
+
+    TEST_ASSERT_NOT_EQUAL_UINT64(0x0ULL, frame);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_init(&s2, 1));
+
+    /* Map one page and translate an address inside it */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_map(&s2, 0x80001000ULL, frame, FRAME_SIZE, STAGE2_MEM_NORMAL));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&s2, 0x80001234ULL, &pa, &attr));
+    TEST_ASSERT_EQUAL_UINT64(frame + 0x234ULL, pa);
+    TEST_ASSERT_EQUAL_UINT64(STAGE2_MEM_NORMAL, attr);
+
+    /* Mapping twice is refused, unmapping removes the translation */
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_EXISTS, stage2_map(&s2, 0x80001000ULL, frame, FRAME_SIZE, STAGE2_MEM_NORMAL));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_unmap(&s2, 0x80001000ULL, FRAME_SIZE));
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_FOUND, stage2_lookup(&s2, 0x80001000ULL, NULL, NULL));
+
+    stage2_destroy(&s2);
+    frame_free(frame);
+}
+
+void test_demand_paging(void)
+{
+    uint64_t ipa = GUEST_RAM_IPA + 0x5000ULL;
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+
+    /* Nothing is backed until the first touch */
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_FOUND, stage2_lookup(&test_vm.s2, ipa, NULL, NULL));
+
+    /* A translation fault populates a zeroed page */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_handle_fault(&test_vm, ipa, ESR_DABT_TRANS_L3));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&test_vm.s2, ipa, NULL, NULL));
+    TEST_ASSERT_EQUAL_UINT64(1, test_vm.mem_stats.faults);
+    TEST_ASSERT_EQUAL_UINT64(1, test_vm.mem_stats.resident_pages);
+    TEST_ASSERT_EQUAL_UINT8(0, *(uint8_t*)gmem_ipa_to_host(&test_vm, ipa, 1));
+
+    /* Inflating the balloon returns the page to the hypervisor */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_release(&test_vm, ipa));
+    TEST_ASSERT_EQUAL_UINT64(0, test_vm.mem_stats.resident_pages);
+    TEST_ASSERT_EQUAL_UINT64(1, test_vm.mem_stats.ballooned_pages);
+    TEST_ASSERT_NULL(gmem_ipa_to_host(&test_vm, ipa, 1));
+
+    gmem_destroy(&test_vm);
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_huge_pages(void)
+{
+    stage2_t s2;
+    stage2_census_t census;
+    uint64_t run = frame_alloc_aligned(512);
+    uint64_t pa = 0x0ULL;
+    uint64_t region = GUEST_RAM_IPA + STAGE2_BLOCK_2M;
+
+    TEST_ASSERT_NOT_EQUAL_UINT64(0x0ULL, run);
+    TEST_ASSERT_EQUAL_UINT64(0x0ULL, run & (STAGE2_BLOCK_2M - 1ULL));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_init(&s2, 1));
+
+    /* 512 linear pages fold into one 2MB block */
+    for (uint64_t i = 0; i < 512; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_map(&s2, 0x80200000ULL + (i * FRAME_SIZE), run + (i * FRAME_SIZE), FRAME_SIZE, STAGE2_MEM_NORMAL));
+    }
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_promote(&s2, 0x80200000ULL, STAGE2_BLOCK_2M));
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_EXISTS, stage2_promote(&s2, 0x80200000ULL, STAGE2_BLOCK_2M));
+    stage2_census(&s2, 0x80000000ULL, STAGE2_BLOCK_1G, &census);
+    TEST_ASSERT_EQUAL_UINT64(1, census.blocks_2m);
+    TEST_ASSERT_EQUAL_UINT64(0, census.pages);
+
+    /* Splitting keeps every translation */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_split(&s2, 0x80234000ULL));
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_EXISTS, stage2_split(&s2, 0x80234000ULL));
+    stage2_census(&s2, 0x80000000ULL, STAGE2_BLOCK_1G, &census);
+    TEST_ASSERT_EQUAL_UINT64(0, census.blocks_2m);
+    TEST_ASSERT_EQUAL_UINT64(512, census.pages);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&s2, 0x80234567ULL, &pa, NULL));
+    TEST_ASSERT_EQUAL_UINT64(run + 0x34567ULL, pa);
+
+    /* A page with other permissions keeps the range split */
+    stage2_protect(&s2, 0x80234000ULL, FRAME_SIZE, S2_PTE_S2AP_W, 0x0ULL);
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_SUPPORTED, stage2_promote(&s2, 0x80200000ULL, STAGE2_BLOCK_2M));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_unmap(&s2, 0x80200000ULL, STAGE2_BLOCK_2M));
+
+    stage2_destroy(&s2);
+    frame_free_contig(run, 512);
+
+    /* A fully touched guest region becomes a block, a released page splits it */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+    for (uint64_t ipa = region; ipa < region + STAGE2_BLOCK_2M; ipa += FRAME_SIZE)
+    {
+        TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_populate(&test_vm, ipa));
+    }
+
+    /* Nothing moves while a host pointer may be in use */
+    gmem_pin(&test_vm);
+    TEST_ASSERT_EQUAL_UINT32(0, gmem_compact(&test_vm));
+    gmem_unpin(&test_vm);
+
+    TEST_ASSERT_EQUAL_UINT32(1, gmem_compact(&test_vm));
+    TEST_ASSERT_EQUAL_UINT64(1, test_vm.compact.promotions + test_vm.compact.migrations);
+    stage2_census(&test_vm.s2, GUEST_RAM_IPA, GUEST_RAM_SIZE, &census);
+    TEST_ASSERT_EQUAL_UINT64(1, census.blocks_2m);
+    TEST_ASSERT_EQUAL_UINT8(0, *(uint8_t*)gmem_ipa_to_host(&test_vm, region + 0x1234ULL, 1));
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_discard(&test_vm, region));
+    TEST_ASSERT_EQUAL_UINT64(1, test_vm.compact.splits);
+    TEST_ASSERT_NULL(gmem_ipa_to_host(&test_vm, region, 1));
+    TEST_ASSERT_NOT_NULL(gmem_ipa_to_host(&test_vm, region + FRAME_SIZE, 1));
+
+    gmem_destroy(&test_vm);
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_dirty_logging(void)
+{
+    uint64_t ipa = GUEST_RAM_IPA + 0x3000ULL;
+    uint64_t attr = 0x0ULL;
+    uint64_t bitmap[GUEST_RAM_SIZE / FRAME_SIZE / 64] = { 0 };
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_populate(&test_vm, ipa));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_populate(&test_vm, ipa + FRAME_SIZE));
+
+    /* Resident pages start dirty and lose write access once synced */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_dirty_log_start(&test_vm));
+    TEST_ASSERT_EQUAL_UINT64(2, gmem_dirty_log_sync(&test_vm, bitmap));
+    TEST_ASSERT_EQUAL_UINT64(0x3ULL << 3, bitmap[0]);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&test_vm.s2, ipa, NULL, &attr));
+    TEST_ASSERT_EQUAL_UINT64(0, attr & S2_PTE_S2AP_W);
+
+    /* A write fault logs only the written page and makes it writable */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_handle_fault(&test_vm, ipa + FRAME_SIZE, ESR_DABT_PERM_W_L3));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&test_vm.s2, ipa + FRAME_SIZE, NULL, &attr));
+    TEST_ASSERT_NOT_EQUAL_UINT64(0, attr & S2_PTE_S2AP_W);
+    TEST_ASSERT_EQUAL_UINT64(1, gmem_dirty_log_sync(&test_vm, bitmap));
+    TEST_ASSERT_EQUAL_UINT64(0x1ULL << 4, bitmap[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, gmem_dirty_log_sync(&test_vm, NULL));
+
+    /* Stopping the log restores write access */
+    gmem_dirty_log_stop(&test_vm);
+    TEST_ASSERT_NULL(test_vm.dirty.bitmap);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&test_vm.s2, ipa, NULL, &attr));
+    TEST_ASSERT_EQUAL_UINT64(STAGE2_MEM_NORMAL, attr);
+
+    /* A write that faulted just before the log stopped only retries */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_handle_fault(&test_vm, ipa, ESR_DABT_PERM_W_L3));
+
+    /* A write to a page that is read-only for another reason is not the log's */
+    stage2_protect(&test_vm.s2, ipa, FRAME_SIZE, S2_PTE_S2AP_W, 0x0ULL);
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_SUPPORTED, gmem_handle_fault(&test_vm, ipa, ESR_DABT_PERM_W_L3));
+
+    gmem_destroy(&test_vm);
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_snapshot(void)
+{
+    vcpu_t* vcpu = &test_vm.vcpus[0];
+    vcpu_t* peer = &test_vm.vcpus[1];
+    uint64_t ipa = GUEST_RAM_IPA + 0x2000ULL;
+    snapshot_stats_t stats;
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 2));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_populate(&test_vm, ipa));
+    memset(gmem_ipa_to_host(&test_vm, ipa, FRAME_SIZE), 0xA5, FRAME_SIZE);
+    peer->ctx.x[7] = 0x1234ULL;
+    peer->el1.vbar = 0x80000ULL;
+
+    /* The guest saves itself into slot 0 */
+    vcpu->ctx.x[0] = HYPERCALL_SNAPSHOT_SAVE;
+    vcpu->ctx.x[1] = SNAPSHOT_FULL;
+    vcpu->ctx.x[2] = 0;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, hypercall_handle(vcpu));
+    TEST_ASSERT_EQUAL_UINT64(STATUS_OK, vcpu->ctx.x[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, vcpu->ctx.x[1]);
+
+    /* A delta holds the written page and the new one */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_handle_fault(&test_vm, ipa, ESR_DABT_PERM_W_L3));
+    memset(gmem_ipa_to_host(&test_vm, ipa, FRAME_SIZE), 0x11, FRAME_SIZE);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_populate(&test_vm, ipa + FRAME_SIZE));
+    memset(gmem_ipa_to_host(&test_vm, ipa + FRAME_SIZE, FRAME_SIZE), 0x22, FRAME_SIZE);
+    peer->ctx.x[7] = 0x5678ULL;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, snapshot_save(&test_vm, "vm1-delta.snap", SNAPSHOT_DELTA, &stats));
+    TEST_ASSERT_EQUAL_UINT64(2, stats.data_pages);
+
+    /* Scribble over everything */
+    memset(gmem_ipa_to_host(&test_vm, ipa, FRAME_SIZE), 0xFF, FRAME_SIZE);
+    peer->ctx.x[7] = 0;
+    peer->el1.vbar = 0;
+
+    /* A delta needs the snapshot it follows */
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID, snapshot_restore(&test_vm, "vm1-delta.snap"));
+
+    /* Rolling back returns from the save call again */
+    vcpu->ctx.x[0] = HYPERCALL_SNAPSHOT_RESTORE;
+    vcpu->ctx.x[1] = 0;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, hypercall_handle(vcpu));
+    TEST_ASSERT_EQUAL_UINT64(STATUS_OK, vcpu->ctx.x[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, vcpu->ctx.x[1]);
+    TEST_ASSERT_EQUAL_UINT64(0x1234ULL, peer->ctx.x[7]);
+    TEST_ASSERT_EQUAL_UINT64(0x80000ULL, peer->el1.vbar);
+    memset(test_page, 0xA5, FRAME_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(test_page, gmem_ipa_to_host(&test_vm, ipa, FRAME_SIZE), FRAME_SIZE);
+    TEST_ASSERT_NULL(gmem_ipa_to_host(&test_vm, ipa + FRAME_SIZE, 1));
+
+    /* The delta applies on top, once */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, snapshot_restore(&test_vm, "vm1-delta.snap"));
+    TEST_ASSERT_EQUAL_UINT64(0x5678ULL, peer->ctx.x[7]);
+    memset(test_page, 0x11, FRAME_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(test_page, gmem_ipa_to_host(&test_vm, ipa, FRAME_SIZE), FRAME_SIZE);
+    memset(test_page, 0x22, FRAME_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(test_page, gmem_ipa_to_host(&test_vm, ipa + FRAME_SIZE, FRAME_SIZE), FRAME_SIZE);
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID, snapshot_restore(&test_vm, "vm1-delta.snap"));
+
+    gmem_destroy(&test_vm);
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_multicall(void)
+{
+    vcpu_t* vcpu = &test_vm.vcpus[0];
+    hypercall_entry_t* batch = NULL;
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_populate(&test_vm, GUEST_RAM_IPA));
+    batch = (hypercall_entry_t*)gmem_ipa_to_host(&test_vm, GUEST_RAM_IPA, FRAME_SIZE);
+
+    /* One exit populates two pages */
+    batch[0] = (hypercall_entry_t){ .op = HYPERCALL_MEM_POPULATE, .args = { GUEST_RAM_IPA + 0x1000ULL } };
+    batch[1] = (hypercall_entry_t){ .op = HYPERCALL_MEM_POPULATE, .args = { GUEST_RAM_IPA + 0x2000ULL } };
+    vcpu->ctx.x[0] = HYPERCALL_MULTICALL;
+    vcpu->ctx.x[1] = GUEST_RAM_IPA;
+    vcpu->ctx.x[2] = 2;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, hypercall_handle(vcpu));
+    TEST_ASSERT_EQUAL_UINT64(STATUS_OK, vcpu->ctx.x[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, vcpu->ctx.x[1]);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, batch[1].result);
+    TEST_ASSERT_EQUAL_UINT64(3, test_vm.mem_stats.resident_pages);
+
+    /* An invalid entry rejects the whole batch before anything runs */
+    batch[0] = (hypercall_entry_t){ .op = HYPERCALL_MEM_DISCARD, .args = { GUEST_RAM_IPA + 0x1000ULL } };
+    batch[1] = (hypercall_entry_t){ .op = HYPERCALL_SHUTDOWN };
+    vcpu->ctx.x[0] = HYPERCALL_MULTICALL;
+    vcpu->ctx.x[1] = GUEST_RAM_IPA;
+    vcpu->ctx.x[2] = 2;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, hypercall_handle(vcpu));
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)(int64_t)STATUS_ERR_INVALID, vcpu->ctx.x[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, vcpu->ctx.x[1]);
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_SUPPORTED, batch[1].result);
+    TEST_ASSERT_EQUAL_UINT64(3, test_vm.mem_stats.resident_pages);
+
+    /* A batch cannot give back the page its results go to */
+    batch[0] = (hypercall_entry_t){ .op = HYPERCALL_MEM_DISCARD, .args = { GUEST_RAM_IPA + 0x10ULL } };
+    vcpu->ctx.x[0] = HYPERCALL_MULTICALL;
+    vcpu->ctx.x[1] = GUEST_RAM_IPA;
+    vcpu->ctx.x[2] = 1;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, hypercall_handle(vcpu));
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)(int64_t)STATUS_ERR_INVALID, vcpu->ctx.x[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, vcpu->ctx.x[1]);
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID, batch[0].result);
+    TEST_ASSERT_EQUAL_UINT64(3, test_vm.mem_stats.resident_pages);
+
+    gmem_destroy(&test_vm);
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_channel_doorbell(void)
+{
+    channel_endpoint_t a = { .vm = &test_vm, .ipa = 0x20000000ULL, .irq = 40 };
+    channel_endpoint_t b = { .vm = &test_peer, .ipa = 0x30000000ULL, .irq = 41 };
+    uint64_t pa_tx = 0x0ULL;
+    uint64_t pa_rx = 0x0ULL;
+    uint64_t notified = 0;
+    char msg[CHANNEL_MSG_MAX] = { 0 };
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_peer, 2, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, channel_create(&test_channel, &a, &b));
+
+    /* What one side sends on is what the other receives on */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&test_vm.s2, a.ipa, &pa_tx, NULL));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&test_peer.s2, b.ipa + CHANNEL_PAGE_SIZE, &pa_rx, NULL));
+    TEST_ASSERT_EQUAL_UINT64(pa_tx, pa_rx);
+
+    TEST_ASSERT_TRUE(channel_ring_send(test_channel.ring[0], "ping", 5));
+    TEST_ASSERT_EQUAL_INT(5, channel_ring_recv((channel_ring_t*)(uintptr_t)pa_rx, msg));
+    TEST_ASSERT_EQUAL_STRING("ping", msg);
+
+    /* A polling receiver is not interrupted, an armed one is, once */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, channel_doorbell(&test_vm, 0, &notified));
+    TEST_ASSERT_EQUAL_UINT64(0, notified);
+    TEST_ASSERT_FALSE(channel_ring_arm(test_channel.ring[0]));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, channel_doorbell(&test_vm, 0, &notified));
+    TEST_ASSERT_EQUAL_UINT64(1, notified);
+    TEST_ASSERT_TRUE(vgic_has_pending(&test_peer.vcpus[0]));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, channel_doorbell(&test_vm, 0, &notified));
+    TEST_ASSERT_EQUAL_UINT64(0, notified);
+
+    stage2_destroy(&test_vm.s2);
+    stage2_destroy(&test_peer.s2);
+    frame_free((uintptr_t)test_channel.ring[0]);
+    frame_free((uintptr_t)test_channel.ring[1]);
+}
+
+void test_passthrough(void)
+{
+    passthrough_t rtc = { 0 };
+    passthrough_t other = { 0 };
+    uint64_t pa = 0x0ULL;
+    uint64_t attr = 0x0ULL;
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+
+    /* The PL031 RTC and its SPI, at the same address in the guest */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, passthrough_assign(&rtc, &test_vm, 0x09010000ULL, 0x09010000ULL, 0x1000ULL, 34));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stage2_lookup(&test_vm.s2, 0x09010004ULL, &pa, &attr));
+    TEST_ASSERT_EQUAL_UINT64(0x09010004ULL, pa);
+    TEST_ASSERT_EQUAL_UINT64(STAGE2_MEM_DEVICE, attr);
+
+    /* RAM and a forwarded SPI cannot be assigned again */
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID, passthrough_assign(&other, &test_vm, 0x09020000ULL, PLATFORM_RAM_BASE, 0x1000ULL, 35));
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_EXISTS, passthrough_assign(&other, &test_vm, 0x09020000ULL, 0x09020000ULL, 0x1000ULL, 34));
+
+    /* The SPI is injected into vCPU 0, linked to the physical interrupt */
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_SUPPORTED, passthrough_irq(35));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, passthrough_irq(34));
+    TEST_ASSERT_TRUE(test_vm.vcpus[0].vgic.pending[0] & (1ULL << 34));
+    TEST_ASSERT_TRUE(test_vm.vcpus[0].vgic.hw[0] & (1ULL << 34));
+    TEST_ASSERT_EQUAL_UINT64(1, rtc.irqs);
+
+    passthrough_release(&rtc);
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_FOUND, stage2_lookup(&test_vm.s2, 0x09010000ULL, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_SUPPORTED, passthrough_irq(34));
+
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_log_sink(void)
+{
+    static char line[LOG_SINK_BUFFER_SIZE + 16];
+    size_t after_info = 0;
+    size_t after_err = 0;
+    size_t after_wrap = 0;
+    uint64_t wraps = 0;
+    log_sink_t released = LOG_SINK_UART;
+
+    /* run_tests.sh enables semihosting, so the bulk sink must be active */
+    TEST_ASSERT_EQUAL_INT(LOG_SINK_SEMIHOSTING, log_get_sink());
+
+    /* Output is buffered until an error, or until the buffer is full */
+    log_flush();
+    TEST_ASSERT_EQUAL_UINT64(0, log_get_fill(NULL));
+    LOG_INFO("log sink buffered line\n\r");
+    TEST_ASSERT_NOT_EQUAL_UINT64(0, log_get_fill(NULL));
+    LOG_ERR("log sink error line, flushed right away\n\r");
+    TEST_ASSERT_EQUAL_UINT64(0, log_get_fill(NULL));
+    memset(line, '.', sizeof(line));
+    line[sizeof(line) - 1] = '\n';
+    log_write(line, sizeof(line));
+    TEST_ASSERT_EQUAL_UINT64(16, log_get_fill(NULL));
+    log_flush();
+    TEST_ASSERT_EQUAL_UINT64(0, log_get_fill(NULL));
+
+    /* Releasing the UART moves a UART log to the host; the memory ring wraps and is never flushed.
+       Unity prints through the log, so the checks wait until the sink is back */
+    log_init(LOG_SINK_UART);
+    log_release_uart();
+    released = log_get_sink();
+    log_init(LOG_SINK_MEMORY);
+    LOG_INFO("log sink ring line\n\r");
+    after_info = log_get_fill(NULL);
+    LOG_ERR("log sink ring error\n\r");
+    after_err = log_get_fill(NULL);
+    log_write(line, sizeof(line));
+    log_flush();
+    after_wrap = log_get_fill(&wraps);
+    log_init(LOG_SINK_SEMIHOSTING);
+
+    TEST_ASSERT_EQUAL_INT(LOG_SINK_SEMIHOSTING, released);
+    TEST_ASSERT_EQUAL_UINT64(strlen("INFO:  log sink ring line\n\r"), after_info);
+    TEST_ASSERT_EQUAL_UINT64(after_info + strlen("ERROR: log sink ring error\n\r"), after_err);
+    TEST_ASSERT_EQUAL_UINT64(1, wraps);
+    TEST_ASSERT_EQUAL_UINT64(after_err + 16, after_wrap);
+}
+
+void test_vm_config_tables(void)
+{
+#if VM_CONFIG_NUM_VMS > 0
+    for (uint32_t i = 0; i < VM_CONFIG_NUM_VMS; ++i)
+    {
+        const vm_config_t* cfg = &vm_config_table[i];
+
+        TEST_ASSERT_EQUAL_UINT32(i + 1U, cfg->id);
+        TEST_ASSERT_TRUE((cfg->num_vcpus > 0) && (cfg->num_vcpus <= VM_MAX_VCPUS));
+
+        /* Regions in RAM must be kept out of the frame pool handed out above */
+        for (uint32_t r = 0; r < cfg->num_regions; ++r)
+        {
+            const vm_config_region_t* region = &cfg->regions[r];
+
+            TEST_ASSERT_TRUE((region->pa >= VM_CONFIG_POOL_END) || (region->pa + region->size <= PLATFORM_RAM_BASE));
+        }
+    }
+#endif
+#if VM_CONFIG_NUM_CHANNELS > 0
+    for (uint32_t i = 0; i < VM_CONFIG_NUM_CHANNELS; ++i)
+    {
+        TEST_ASSERT_TRUE(vm_config_channel_table[i].ep[0].vm < VM_CONFIG_NUM_VMS);
+        TEST_ASSERT_TRUE(vm_config_channel_table[i].ep[1].vm < VM_CONFIG_NUM_VMS);
+        TEST_ASSERT_NOT_EQUAL(vm_config_channel_table[i].ep[0].vm, vm_config_channel_table[i].ep[1].vm);
+    }
+#endif
+}
+
+void test_sync_primitives(void)
+{
+    sync_ticket_t   ticket = SYNC_TICKET_INIT;
+    sync_mcs_t      mcs    = SYNC_MCS_INIT;
+    sync_mcs_node_t node;
+    sync_rwlock_t   rw     = SYNC_RWLOCK_INIT;
+    sync_seqcount_t sc     = SYNC_SEQCOUNT_INIT;
+    uint32_t        seq    = 0;
+    uint32_t        word   = 5;
+
+    /* Atomics return the previous value */
+    TEST_ASSERT_EQUAL_UINT32(5, sync_fetch_add32(&word, 2));
+    TEST_ASSERT_EQUAL_UINT32(7, sync_cas32(&word, 6, 9));
+    TEST_ASSERT_EQUAL_UINT32(7, sync_cas32(&word, 7, 9));
+    TEST_ASSERT_EQUAL_UINT32(9, word);
+
+    sync_ticket_lock(&ticket);
+    TEST_ASSERT_FALSE(sync_ticket_trylock(&ticket));
+    sync_ticket_unlock(&ticket);
+    TEST_ASSERT_TRUE(sync_ticket_trylock(&ticket));
+    sync_ticket_unlock(&ticket);
+
+    sync_mcs_lock(&mcs, &node);
+    TEST_ASSERT_EQUAL_PTR(&node, mcs.tail);
+    sync_mcs_unlock(&mcs, &node);
+    TEST_ASSERT_NULL(mcs.tail);
+
+    /* Readers share, a writer leaves the lock free behind it */
+    sync_read_lock(&rw);
+    sync_read_lock(&rw);
+    TEST_ASSERT_EQUAL_UINT32(2, rw.word);
+    sync_read_unlock(&rw);
+    sync_read_unlock(&rw);
+    sync_write_lock(&rw);
+    TEST_ASSERT_EQUAL_UINT32(SYNC_RWLOCK_WRITER, rw.word);
+    sync_write_unlock(&rw);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.word);
+
+    seq = sync_seq_read_begin(&sc);
+    TEST_ASSERT_FALSE(sync_seq_read_retry(&sc, seq));
+    sync_seq_write_begin(&sc);
+    sync_seq_write_end(&sc);
+    TEST_ASSERT_TRUE(sync_seq_read_retry(&sc, seq));
+}
+
+void test_sched_coalesce(void)
+{
+    const uint64_t deadlines[] = { 400, 100, 130 };
+    uint32_t       served      = 0;
+
+    TEST_ASSERT_TRUE(SCHED_NO_DEADLINE == sched_coalesce(deadlines, 0, 50, &served));
+    TEST_ASSERT_EQUAL_UINT32(0, served);
+
+    /* Without slack only the earliest deadline is served */
+    TEST_ASSERT_TRUE(100 == sched_coalesce(deadlines, 3, 0, &served));
+    TEST_ASSERT_EQUAL_UINT32(1, served);
+
+    /* Deadlines inside the window share the latest expiry of the window */
+    TEST_ASSERT_TRUE(130 == sched_coalesce(deadlines, 3, 50, &served));
+    TEST_ASSERT_EQUAL_UINT32(2, served);
+    TEST_ASSERT_TRUE(400 == sched_coalesce(deadlines, 3, 300, &served));
+    TEST_ASSERT_EQUAL_UINT32(3, served);
+}
+
+void test_virtual_sgi(void)
+{
+    vcpu_t* vcpu = &test_vm.vcpus[0];
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 3));
+
+    /* Other trapped system instructions are left to their handlers */
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_SUPPORTED, vgic_handle_sgi(vcpu, ESR_SYS_TLBI_VMALLE1IS));
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_SUPPORTED, vgic_handle_sgi(vcpu, ESR_SYS_SGI1R_X5 | ESR_SYS_READ));
+
+    /* SGI 3 to vCPU 2 by target list */
+    vcpu->ctx.x[5] = (3ULL << 24) | (1ULL << 2);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vgic_handle_sgi(vcpu, ESR_SYS_SGI1R_X5));
+    TEST_ASSERT_FALSE(vgic_has_pending(&test_vm.vcpus[1]));
+    TEST_ASSERT_EQUAL_UINT64(1ULL << 3, test_vm.vcpus[2].vgic.pending[0]);
+
+    /* Other affinity clusters hold no vCPUs */
+    vcpu->ctx.x[5] = (4ULL << 24) | (1ULL << 16) | (1ULL << 1);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vgic_handle_sgi(vcpu, ESR_SYS_SGI1R_X5));
+    TEST_ASSERT_FALSE(vgic_has_pending(&test_vm.vcpus[1]));
+
+    /* Neither do Aff0 16-31, selected by RS = 1 */
+    vcpu->ctx.x[5] = (5ULL << 24) | (1ULL << 44) | (1ULL << 1);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vgic_handle_sgi(vcpu, ESR_SYS_SGI1R_X5));
+    TEST_ASSERT_FALSE(vgic_has_pending(&test_vm.vcpus[1]));
+
+    /* Broadcast reaches every vCPU but the sender */
+    vcpu->ctx.x[5] = (7ULL << 24) | (1ULL << 40);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vgic_handle_sgi(vcpu, ESR_SYS_SGI1R_X5));
+    TEST_ASSERT_FALSE(vgic_has_pending(vcpu));
+    TEST_ASSERT_EQUAL_UINT64(1ULL << 7, test_vm.vcpus[1].vgic.pending[0]);
+    TEST_ASSERT_EQUAL_UINT64((1ULL << 3) | (1ULL << 7), test_vm.vcpus[2].vgic.pending[0]);
+
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_secondary_vcpu(void)
+{
+    vcpu_t* boot = &test_vm.vcpus[0];
+    vcpu_t* second = &test_vm.vcpus[1];
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 2));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, sched_add_off(second, SMP_MAX_CPUS - 1));
+
+    /* The boot vCPU starts its sibling with PSCI CPU_ON */
+    boot->ctx.x[0] = PSCI_CPU_ON;
+    boot->ctx.x[1] = 1;
+    boot->ctx.x[2] = GUEST_SECONDARY_ENTRY;
+    boot->ctx.x[3] = 0xC0FFEEULL;
+    SYSREG_WRITE(esr_el2, ESR_HVC_0);
+    trap_handle_sync(&boot->ctx);
+    TEST_ASSERT_EQUAL_INT64(PSCI_SUCCESS, (int64_t)boot->ctx.x[0]);
+    TEST_ASSERT_EQUAL_UINT32(VCPU_STATE_RUNNABLE, second->state);
+    TEST_ASSERT_EQUAL_UINT64(GUEST_SECONDARY_ENTRY, second->ctx.elr);
+    TEST_ASSERT_EQUAL_UINT64(0xC0FFEEULL, second->ctx.x[0]);
+
+    /* Only once, and only for vCPUs the VM has */
+    boot->ctx.x[0] = PSCI_CPU_ON;
+    trap_handle_sync(&boot->ctx);
+    TEST_ASSERT_EQUAL_INT64(PSCI_ALREADY_ON, (int64_t)boot->ctx.x[0]);
+    boot->ctx.x[0] = PSCI_CPU_ON;
+    boot->ctx.x[1] = 2;
+    trap_handle_sync(&boot->ctx);
+    TEST_ASSERT_EQUAL_INT64(PSCI_INVALID_PARAMETERS, (int64_t)boot->ctx.x[0]);
+    boot->ctx.x[0] = PSCI_CPU_ON;
+    boot->ctx.x[1] = (1ULL << 8) | 1ULL;
+    trap_handle_sync(&boot->ctx);
+    TEST_ASSERT_EQUAL_INT64(PSCI_INVALID_PARAMETERS, (int64_t)boot->ctx.x[0]);
+
+    /* Both vCPUs then signal each other through trapped SGI writes */
+    boot->ctx.elr = GUEST_RAM_IPA;
+    boot->ctx.x[5] = (1ULL << 24) | (1ULL << 1);
+    SYSREG_WRITE(esr_el2, ESR_SYS_SGI1R_X5);
+    trap_handle_sync(&boot->ctx);
+    TEST_ASSERT_EQUAL_UINT64(1ULL << 1, second->vgic.pending[0]);
+    TEST_ASSERT_EQUAL_UINT64(GUEST_RAM_IPA + 4ULL, boot->ctx.elr);
+
+    second->ctx.x[5] = (2ULL << 24) | (1ULL << 0);
+    trap_handle_sync(&second->ctx);
+    TEST_ASSERT_EQUAL_UINT64(1ULL << 2, boot->vgic.pending[0]);
+    TEST_ASSERT_EQUAL_UINT64(GUEST_SECONDARY_ENTRY + 4ULL, second->ctx.elr);
+
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_guest_translation(void)
+{
+    vcpu_t* vcpu = &test_vm.vcpus[0];
+    uint64_t* l1 = NULL;
+    uint64_t* l2 = NULL;
+    uint64_t* l3 = NULL;
+    uint64_t page = 0x0ULL;
+    uint64_t pa = 0x0ULL;
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vm_init(&test_vm, 1, GUEST_RAM_IPA, GUEST_RAM_SIZE, 1));
+    for (uint64_t ipa = GUEST_RAM_IPA + 0x1000ULL; ipa <= GUEST_RAM_IPA + 0x5000ULL; ipa += FRAME_SIZE)
+    {
+        TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_populate(&test_vm, ipa));
+    }
+    l1 = (uint64_t*)gmem_ipa_to_host(&test_vm, GUEST_RAM_IPA + 0x1000ULL, FRAME_SIZE);
+    l2 = (uint64_t*)gmem_ipa_to_host(&test_vm, GUEST_RAM_IPA + 0x2000ULL, FRAME_SIZE);
+    l3 = (uint64_t*)gmem_ipa_to_host(&test_vm, GUEST_RAM_IPA + 0x3000ULL, FRAME_SIZE);
+
+    /* Guest stage-1 with 39-bit VAs and 4KB pages: VA 0x1000 maps the page at RAM + 0x5000 */
+    l1[0] = (GUEST_RAM_IPA + 0x2000ULL) | 0x3ULL;
+    l2[0] = (GUEST_RAM_IPA + 0x3000ULL) | 0x3ULL;
+    l3[1] = (GUEST_RAM_IPA + 0x5000ULL) | 0x403ULL;
+    vcpu->el1.sctlr = 0x1ULL;
+    vcpu->el1.tcr = 25ULL;
+    vcpu->el1.ttbr0 = GUEST_RAM_IPA + 0x1000ULL;
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, xlate_ipa(vcpu, GUEST_RAM_IPA + 0x5000ULL, &page));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, xlate_va(vcpu, 0x1234ULL, &pa));
+    TEST_ASSERT_EQUAL_UINT64(page + 0x234ULL, pa);
+    TEST_ASSERT_EQUAL_UINT32(1, test_vm.xlate_trap);
+
+    /* The next access to the page skips the walk */
+    TEST_ASSERT_NOT_NULL(xlate_va_to_host(vcpu, 0x1238ULL, 8));
+    TEST_ASSERT_EQUAL_UINT64(1, vcpu->xlate.stats.hits);
+
+    /* Unmapping the page drops the cached translation */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, gmem_discard(&test_vm, GUEST_RAM_IPA + 0x5000ULL));
+    TEST_ASSERT_EQUAL_INT(STATUS_ERR_NOT_FOUND, xlate_va(vcpu, 0x1234ULL, &pa));
+
+    /* A guest TLBI stops the trapping until a translation is cached again */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, xlate_handle_tlbi(vcpu, ESR_SYS_TLBI_VMALLE1IS));
+    TEST_ASSERT_EQUAL_UINT32(0, test_vm.xlate_trap);
+
+    /* Hypervisor addresses are mapped flat */
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, mmu_translate_va((uintptr_t)message, &pa));
+    TEST_ASSERT_EQUAL_UINT64((uintptr_t)message, pa);
+
+    gmem_destroy(&test_vm);
+    stage2_destroy(&test_vm.s2);
+}
+
+void test_exit_trace(void)
+{
+    uint32_t before = trace_snapshot(0, test_trace, NULL);
+    uint32_t count = 0;
+
+    /* While the key is off the hooks record nothing */
+    trace_enable(0);
+    trace_exit_begin(TRACE_EXIT_SYNC, 1, 0, 0x0ULL, 0x0ULL);
+    trace_exit_end();
+    TEST_ASSERT_EQUAL_UINT32(before, trace_snapshot(0, test_trace, NULL));
+
+    trace_enable(1);
+    trace_exit_begin(TRACE_EXIT_SYNC, 3, 2, ESR_DABT_TRANS_L3, 0x80000ULL);
+    trace_exit_end();
+    trace_enable(0);
+
+    count = trace_snapshot(0, test_trace, NULL);
+    TEST_ASSERT_EQUAL_UINT32((before < TRACE_EVENTS) ? before + 1 : TRACE_EVENTS, count);
+    TEST_ASSERT_EQUAL_UINT32(3, test_trace[count - 1].vm);
+    TEST_ASSERT_EQUAL_UINT32(2, test_trace[count - 1].vcpu);
+    TEST_ASSERT_EQUAL_UINT32(TRACE_EXIT_SYNC, test_trace[count - 1].type);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)ESR_DABT_TRANS_L3, test_trace[count - 1].esr);
+    TEST_ASSERT_EQUAL_UINT64(0x80000ULL, test_trace[count - 1].arg);
+}
+
+void test_runtime(void)
+{
+    static uint8_t buf[1024] __attribute__((aligned(64)));
+    char text[16] = { 0 };
+
+    /* Large zero fill at an odd offset takes the DC ZVA path and must not spill */
+    memset(buf, 0xA5, sizeof(buf));
+    memset(buf + 3, 0, 700);
+    TEST_ASSERT_EQUAL_UINT32(0xA5, buf[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, buf[3]);
+    TEST_ASSERT_EQUAL_UINT32(0, buf[702]);
+    TEST_ASSERT_EQUAL_UINT32(0xA5, buf[703]);
+
+    /* Overlapping moves in both directions */
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        buf[i] = (uint8_t)i;
+    }
+    memmove(buf + 5, buf, 200);
+    TEST_ASSERT_EQUAL_UINT32(0, buf[5]);
+    TEST_ASSERT_EQUAL_UINT32(199, buf[204]);
+    memmove(buf, buf + 5, 200);
+    TEST_ASSERT_EQUAL_UINT32(0, buf[0]);
+    TEST_ASSERT_EQUAL_UINT32(199, buf[199]);
+
+    memcpy(buf + 513, buf, 199);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(buf + 513, buf, 199));
+    buf[513 + 150]++;
+    TEST_ASSERT_TRUE(memcmp(buf + 513, buf, 199) > 0);
+
+    TEST_ASSERT_EQUAL_INT(17, snprintf(text, sizeof(text), "%-4s|%05d|0x%lx", "ab", -42, 0xbeefUL));
+    TEST_ASSERT_EQUAL_STRING("ab  |-0042|0xbe", text);
+}
+
 int main(void)
 {
+    sync_init();
+
+    /* test output goes to the host in bulk rather than one UART trap per character */
+    log_init(LOG_SINK_SEMIHOSTING);
+
+    /* frame pool and stage-2 layout for the VM tests */
+    frame_init((uintptr_t)&__frame_pool_start__, VM_CONFIG_POOL_END - (uintptr_t)&__frame_pool_start__);
+    stage2_hw_init();
+
     UNITY_BEGIN();
 
     RUN_TEST(test_address_translation);
     RUN_TEST(test_memory_access);
+    RUN_TEST(test_stage2_map_lookup);
+    RUN_TEST(test_demand_paging);
+    RUN_TEST(test_huge_pages);
+    RUN_TEST(test_dirty_logging);
+    RUN_TEST(test_snapshot);
+    RUN_TEST(test_multicall);
+    RUN_TEST(test_channel_doorbell);
+    RUN_TEST(test_passthrough);
+    RUN_TEST(test_log_sink);
+    RUN_TEST(test_vm_config_tables);
+    RUN_TEST(test_sync_primitives);
+    RUN_TEST(test_sched_coalesce);
+    RUN_TEST(test_virtual_sgi);
+    RUN_TEST(test_secondary_vcpu);
+    RUN_TEST(test_guest_translation);
+    RUN_TEST(test_exit_trace);
+    RUN_TEST(test_runtime);
+
+    int failures = UNITY_END();
+
+    log_flush();
 
-    return UNITY_END();
+    return failures;
 }